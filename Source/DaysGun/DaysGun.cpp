@@ -3,4 +3,11 @@
 #include "DaysGun.h"
 #include "Modules/ModuleManager.h"
 
+DEFINE_LOG_CATEGORY(LogDaysGun);
+
+LLM_DEFINE_TAG(DaysGun_Character);
+LLM_DEFINE_TAG(DaysGun_Animation);
+LLM_DEFINE_TAG(DaysGun_Backpack);
+LLM_DEFINE_TAG(DaysGun_Footsteps);
+
 IMPLEMENT_PRIMARY_GAME_MODULE( FDefaultGameModuleImpl, DaysGun, "DaysGun" );
@@ -3,4 +3,14 @@
 #pragma once
 
 #include "CoreMinimal.h"
+#include "HAL/LowLevelMemTracker.h"
 
+DECLARE_LOG_CATEGORY_EXTERN(LogDaysGun, Log, All);
+
+DECLARE_STATS_GROUP(TEXT("DaysGun"), STATGROUP_DaysGun, STATCAT_Advanced);
+
+/** Low level memory tracker tags, see them with -llm and stat LLM */
+LLM_DECLARE_TAG_API(DaysGun_Character, DAYSGUN_API);
+LLM_DECLARE_TAG_API(DaysGun_Animation, DAYSGUN_API);
+LLM_DECLARE_TAG_API(DaysGun_Backpack, DAYSGUN_API);
+LLM_DECLARE_TAG_API(DaysGun_Footsteps, DAYSGUN_API);
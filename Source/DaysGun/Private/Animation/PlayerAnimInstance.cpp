@@ -3,25 +3,81 @@
 
 #include "Animation/PlayerAnimInstance.h"
 
+#include "DaysGun.h"
+#include "Animation/PlayerAnimInstanceProxy.h"
+#include "Components/SkeletalMeshComponent.h"
 #include "GameFramework/CharacterMovementComponent.h"
-#include "Kismet/GameplayStatics.h"
-#include "Kismet/KismetMathLibrary.h"
+#include "Locomotion/GaitTransitionEntryTable.h"
+#include "Locomotion/LocomotionRecorderSubsystem.h"
+#include "Locomotion/LocomotionSnapshotSubsystem.h"
+#include "Math/DaysGunMath.h"
 #include "Player/BaseCharacter.h"
+#include "Player/HitchRecorderSubsystem.h"
+
+namespace
+{
+	/** -1 leaves UseWarping to each anim instance, set by DaysGun.Anim.Warping */
+	int32 GWarpingOverride = -1;
+
+	/** The warping mode plays the forward start of the same gait for every start angle */
+	ELocomotionClip GetWarpingStartClip(ELocomotionClip Clip)
+	{
+		switch (Clip)
+		{
+		case ELocomotionClip::ELC_WalkStart90L:
+		case ELocomotionClip::ELC_WalkStart180L:
+		case ELocomotionClip::ELC_WalkStart90R:
+		case ELocomotionClip::ELC_WalkStart180R:
+			return ELocomotionClip::ELC_WalkStartF;
+		case ELocomotionClip::ELC_RunStart90L:
+		case ELocomotionClip::ELC_RunStart180L:
+		case ELocomotionClip::ELC_RunStart90R:
+		case ELocomotionClip::ELC_RunStart180R:
+			return ELocomotionClip::ELC_RunStartF;
+		default:
+			return Clip;
+		}
+	}
+}
 
 void UPlayerAnimInstance::NativeInitializeAnimation()
 {
+	LLM_SCOPE_BYTAG(DaysGun_Animation);
 	Super::NativeInitializeAnimation();
 	SetReferences();
+	RegisterSnapshot();
+
+	const auto World = GetWorld();
+	RecorderSubsystem = World ? World->GetSubsystem<ULocomotionRecorderSubsystem>() : nullptr;
+	HitchRecorder = World ? World->GetSubsystem<UHitchRecorderSubsystem>() : nullptr;
 }
 
 void UPlayerAnimInstance::NativeUpdateAnimation(float DeltaSeconds)
 {
+	LLM_SCOPE_BYTAG(DaysGun_Animation);
 	Super::NativeUpdateAnimation(DeltaSeconds);
 	if (!PlayerRef) return;
 
-	SetEssentialMovementData();
-	DetermineLocomotionState();
-	TrackLocomotionStates();
+	FHitchRecorderScope HitchScope(HitchRecorder, EHitchTimer::AnimUpdate, PlayerRef);
+	WarpingActive = IsWarpingEnabled();
+
+	if (FixedStepSettings.UseFixedStep)
+	{
+		SimulateFixedSteps(DeltaSeconds);
+	}
+	else
+	{
+		SimStepsThisFrame = 1;
+		SimDeltaSeconds = DeltaSeconds;
+		RotationSteps.Reset();
+		FrameSample = SampleMovement();
+		StepSample = FrameSample;
+		SimulateLocomotionStep();
+	}
+
+	UpdateOrientationWarping(DeltaSeconds);
+	UpdateFootsteps();
+	PublishSnapshot();
 }
 
 void UPlayerAnimInstance::NativePostEvaluateAnimation()
@@ -33,90 +89,600 @@ void UPlayerAnimInstance::NativePostEvaluateAnimation()
 	ResetTransition();
 }
 
+void UPlayerAnimInstance::NativeUninitializeAnimation()
+{
+	UnregisterSnapshot();
+	Super::NativeUninitializeAnimation();
+}
+
+FAnimInstanceProxy* UPlayerAnimInstance::CreateAnimInstanceProxy()
+{
+	return new FPlayerAnimInstanceProxy(this);
+}
+
+void UPlayerAnimInstance::DestroyAnimInstanceProxy(FAnimInstanceProxy* InProxy)
+{
+	delete static_cast<FPlayerAnimInstanceProxy*>(InProxy);
+}
+
+void UPlayerAnimInstance::SetPooled(bool Pooled)
+{
+	ResetLocomotion();
+
+	if (Pooled)
+	{
+		UnregisterSnapshot();
+	}
+	else
+	{
+		RegisterSnapshot();
+	}
+}
+
+void UPlayerAnimInstance::GetLocomotionClipGroups(TMap<FName, TArray<UAnimSequence*>>& OutGroups,
+                                                  bool WarpingClipsOnly) const
+{
+	OutGroups.FindOrAdd("Stop").Append({WalkStopAnim, RunStopAnim});
+	if (WarpingClipsOnly)
+	{
+		OutGroups.FindOrAdd("WalkStart").Add(WalkStartFAnim);
+		OutGroups.FindOrAdd("RunStart").Add(RunStartFAnim);
+		OutGroups.FindOrAdd("GaitTransition");
+		return;
+	}
+
+	OutGroups.FindOrAdd("WalkStart").Append({
+		WalkStartFAnim, WalkStart90LAnim, WalkStart180LAnim, WalkStart90RAnim, WalkStart180RAnim
+	});
+	OutGroups.FindOrAdd("RunStart").Append({
+		RunStartFAnim, RunStart90LAnim, RunStart180LAnim, RunStart90RAnim, RunStart180RAnim
+	});
+	OutGroups.FindOrAdd("GaitTransition").Append({WalkToRunLFAnim, WalkToRunRFAnim, RunToWalkLFAnim, RunToWalkRFAnim});
+}
+
+bool UPlayerAnimInstance::IsWarpingEnabled() const
+{
+	return GWarpingOverride >= 0 ? GWarpingOverride > 0 : UseWarping;
+}
+
+void UPlayerAnimInstance::PredictTrajectory(float Interval, TArrayView<FTrajectoryPoint> OutPoints) const
+{
+	Trajectory.Predict(GetTrajectoryModel(), Interval, OutPoints);
+}
+
+FTrajectoryMovementModel UPlayerAnimInstance::GetTrajectoryModel() const
+{
+	return CharacterMovementRef
+		       ? FTrajectoryMovementModel::FromMovement(*CharacterMovementRef)
+		       : FTrajectoryMovementModel();
+}
+
+void UPlayerAnimInstance::ResetLocomotion()
+{
+	DecisionCore.Reset();
+	LocomotionState = DecisionCore.GetLocomotionState();
+	PrevLocomotionState = DecisionCore.GetPrevLocomotionState();
+	TimeInLocomotionState = DecisionCore.GetTimeInLocomotionState();
+	PlayStartAnim = false;
+	PlayGaitTransitionAnim = false;
+	StopMovingValue = 0.f;
+	OrientationWarpingAngle = 0.f;
+	StrideWarpingScale = 1.f;
+
+	Velocity = FVector::ZeroVector;
+	PrevVelocity = FVector::ZeroVector;
+	Acceleration = FVector::ZeroVector;
+	GroundSpeed = 0.f;
+	InputVector = FVector::ZeroVector;
+	InputVectorLastFrame = FVector::ZeroVector;
+	InputVectorRotationRate = 0.f;
+	InputVectorRotationRateTarget = 0.f;
+
+	Lean = FVector::ZeroVector;
+	LeanTarget = FVector::ZeroVector;
+	PrevVisualOutputs = FLocomotionVisualOutputs();
+	CurrentVisualOutputs = FLocomotionVisualOutputs();
+	ApplyVisualOutputs(CurrentVisualOutputs);
+
+	const auto OwnerRotation = PlayerRef ? PlayerRef->GetActorRotation() : FRotator::ZeroRotator;
+	ActorRotation = OwnerRotation;
+	StartRotation = OwnerRotation;
+	TargetRotation = OwnerRotation;
+	TargetRotationSmoothed = OwnerRotation;
+	PrevTargetRotationSmoothed = OwnerRotation;
+	RenderedRotation = OwnerRotation;
+	StartAngle = 0.f;
+	PrevStartAngle = 0.f;
+
+	Trajectory.Reset();
+	SimAccumulator.Reset();
+	HasFrameSample = false;
+	RotationSteps.Reset();
+
+	PrevFootPhase = 0.f;
+	FootstepSurfaceCache.Invalidate();
+
+	LandingPredictor.Stop(false, 0.0);
+	LandPending = false;
+	LandingPredicted = false;
+	PlayLandAnim = false;
+	LandIntoStart = false;
+	TimeToLand = 0.f;
+}
+
+void UPlayerAnimInstance::SimulateFixedSteps(float DeltaSeconds)
+{
+	SimStepsThisFrame = SimAccumulator.Advance(DeltaSeconds, FixedStepSettings);
+	SimDeltaSeconds = FixedStepSettings.GetStepDeltaSeconds();
+	RotationSteps.Reset();
+
+	PrevFrameSample = FrameSample;
+	FrameSample = SampleMovement();
+	if (!HasFrameSample)
+	{
+		PrevFrameSample = FrameSample;
+		HasFrameSample = true;
+	}
+
+	if (SimStepsThisFrame > 0)
+	{
+		// Steps continue from the simulated values, not from last frame's interpolated ones
+		ApplyVisualOutputs(CurrentVisualOutputs);
+	}
+
+	for (int32 Step = 0; Step < SimStepsThisFrame; ++Step)
+	{
+		// Movement only updates once per frame, each step sees it as it was when the step ends
+		StepSample = FLocomotionMovementSample::Interpolate(PrevFrameSample, FrameSample,
+		                                                    SimAccumulator.GetStepFrameAlpha(Step));
+
+		PrevVisualOutputs = CurrentVisualOutputs;
+		SimulateLocomotionStep();
+		CurrentVisualOutputs = CaptureVisualOutputs();
+	}
+
+	ApplyVisualOutputs(FLocomotionVisualOutputs::Interpolate(PrevVisualOutputs, CurrentVisualOutputs,
+	                                                         SimAccumulator.GetAlpha()));
+}
+
 void UPlayerAnimInstance::SetReferences()
 {
 	if (const auto playerRef = Cast<ABaseCharacter>(TryGetPawnOwner()))
 	{
 		PlayerRef = playerRef;
 		CharacterMovementRef = PlayerRef->GetCharacterMovement();
+		FixedStepSettings = PlayerRef->GetFixedStepSettings();
+
+		const auto GaitProfiles = PlayerRef->GetGaitProfiles();
+		RunMinMaxSpeed = GaitProfiles->GetMinSpeedForState(ELocomotionState::ELS_Run);
+	}
+
+	SetDecisionParams();
+
+	const auto World = GetWorld();
+	if (World && World->IsGameWorld())
+	{
+		FootstepSubsystem = World->GetSubsystem<UFootstepSubsystem>();
 	}
 }
 
+FLocomotionMovementSample UPlayerAnimInstance::SampleMovement() const
+{
+	FLocomotionMovementSample Sample;
+	Sample.Location = PlayerRef->GetActorLocation();
+	Sample.Velocity = CharacterMovementRef->Velocity;
+	Sample.InputVector = CharacterMovementRef->GetLastInputVector().GetClampedToMaxSize(1.0);
+	Sample.Acceleration = CharacterMovementRef->GetCurrentAcceleration();
+	Sample.ActorRotation = PlayerRef->GetActorRotation();
+	Sample.MaxSpeed = CharacterMovementRef->MaxWalkSpeed;
+	Sample.IsFalling = CharacterMovementRef->IsFalling();
+	return Sample;
+}
+
+void UPlayerAnimInstance::SimulateLocomotionStep()
+{
+	SetEssentialMovementData();
+	UpdateLocomotionDecision();
+
+	// The post-evaluate rotation replays this frame's steps with the velocity and rate each of them saw
+	RotationSteps.Add({FDaysGunMath::YawFromVector(Velocity), InputVectorRotationRate});
+}
+
 void UPlayerAnimInstance::SetEssentialMovementData()
 {
 	UpdateVelocity();
 	UpdatePlayerInput();
 
-	MaxSpeed = CharacterMovementRef->MaxWalkSpeed;
-	IsFalling = CharacterMovementRef->IsFalling();
-	ActorRotation = PlayerRef->GetActorRotation();
+	MaxSpeed = StepSample.MaxSpeed;
+	IsFalling = StepSample.IsFalling;
+	ActorRotation = StepSample.ActorRotation;
+
+	Trajectory.AddSample(StepSample.Location, Velocity, InputVector, ActorRotation.Yaw, SimDeltaSeconds);
 
 	UpdateInputVectorRotationRate();
 	UpdateLean();
 	UpdateAimOffset();
 }
 
-void UPlayerAnimInstance::DetermineLocomotionState()
+void UPlayerAnimInstance::SetDecisionParams()
 {
-	PrevLocomotionState = LocomotionState;
+	DecisionParams.MinTimeInLocomotionState = MinTimeInLocomotionState;
+	DecisionParams.MinTimeGaitTransitionAnim = MinTimeGaitTransitionAnim;
+
+	DecisionParams.RunMinCurrentSpeed = RunMinCurrentSpeed;
+	DecisionParams.RunMinMaxSpeed = RunMinMaxSpeed;
+	DecisionParams.RunMinInputAcceleration = RunMinInputAcceleration;
+
+	DecisionParams.WalkMinCurrentSpeed = WalkMinCurrentSpeed;
+	DecisionParams.WalkMinMaxSpeed = WalkMinMaxSpeed;
+	DecisionParams.WalkMinInputAcceleration = WalkMinInputAcceleration;
+
+	DecisionParams.MaxSpeedForPlayingStartAnim = MaxSpeedForPlayingStartAnim;
+	DecisionParams.RunStopSpeedLimit = RunStopSpeedLimit;
+	DecisionParams.TrajectoryRateWindow = TrajectoryRateWindow;
+	DecisionParams.StartPredictionSeconds = StartPredictionSeconds;
+	DecisionParams.MoveDataLeftFootPhaseLimit = MoveDataLeftFootPhaseLimit;
+
+	DecisionParams.RotationRateInputRange = RotationRateInputRange;
+	DecisionParams.ConstRotationRateMin = ConstRotationRateMin;
+	DecisionParams.ConstRotationRateMax = ConstRotationRateMax;
+	DecisionParams.SmoothRotationRateMin = SmoothRotationRateMin;
+	DecisionParams.SmoothRotationRateMax = SmoothRotationRateMax;
+
+	LandingParams.MaxSeconds = LandingPredictionSeconds;
+	LandingParams.NumSegments = LandingPredictionSegments;
+	LandingParams.VelocityTolerance = LandingVelocityTolerance;
+}
 
-	if (IsFalling || StartedJumping)
+void UPlayerAnimInstance::UpdateLocomotionDecision()
+{
+	FLocomotionDecisionInput Input;
+	Input.DeltaSeconds = SimDeltaSeconds;
+	Input.GroundSpeed = GroundSpeed;
+	Input.MaxSpeed = MaxSpeed;
+	Input.InputSize = InputVector.Size();
+	Input.VelocityAccelerationDot = FVector::DotProduct(
+		Velocity.GetSafeNormal(UE_KINDA_SMALL_NUMBER),
+		StepSample.Acceleration.GetSafeNormal(UE_KINDA_SMALL_NUMBER));
+	Input.ActorYaw = ActorRotation.Yaw;
+	Input.InputYaw = FDaysGunMath::YawFromVector(InputVector);
+	Input.VelocityYaw = FDaysGunMath::YawFromVector(Velocity);
+	Input.IsFalling = IsFalling;
+	Input.StartedJumping = StartedJumping;
+
+	const auto Events = DecisionCore.Step(Input, DecisionParams, *this);
+
+	LocomotionState = DecisionCore.GetLocomotionState();
+	PrevLocomotionState = DecisionCore.GetPrevLocomotionState();
+	TimeInLocomotionState = DecisionCore.GetTimeInLocomotionState();
+
+	auto Clip = ELocomotionClip::ELC_None;
+	if (EnumHasAnyFlags(Events, ELocomotionDecisionEvents::StopSelected))
+	{
+		StopMovingValue = 0.f;
+		Clip = ApplyDecisionClip(DecisionCore.GetStopClip());
+	}
+
+	if (EnumHasAnyFlags(Events, ELocomotionDecisionEvents::StartSelected))
+	{
+		PlayStartAnim = true;
+		UpdateEntryVariables();
+		Clip = ApplyDecisionClip(DecisionCore.GetStartClip());
+	}
+
+	if (EnumHasAnyFlags(Events, ELocomotionDecisionEvents::GaitTransitionSelected))
+	{
+		// Stride warping carries the cycle through the speed change instead of a transition clip
+		Clip = DecisionCore.GetGaitTransitionClip();
+		if (!WarpingActive)
+		{
+			PlayGaitTransitionAnim = true;
+			Clip = ApplyGaitTransitionClip(Clip);
+		}
+	}
+
+	// Recorded after applying, so the recorders see the clip that plays rather than the one the core picked
+	if (RecorderSubsystem && RecorderSubsystem->ShouldRecord())
+	{
+		RecordLocomotionDecision(Input, Events, Clip);
+	}
+
+	if (HitchRecorder && Events != ELocomotionDecisionEvents::None)
+	{
+		RecordHitchEvents(Events, Clip);
+	}
+
+	UpdateLanding(Events);
+
+	// Play rate follows the speed curve of the cycle, which only plays from the step after entering a state
+	if (EnumHasAnyFlags(Events, ELocomotionDecisionEvents::StateEntered)) return;
+
+	if (LocomotionState == ELocomotionState::ELS_Walk ||
+		LocomotionState == ELocomotionState::ELS_Run ||
+		LocomotionState == ELocomotionState::ELS_Crouch)
+	{
+		UpdateLocomotionValues();
+	}
+}
+
+void UPlayerAnimInstance::RecordLocomotionDecision(const FLocomotionDecisionInput& Input,
+                                                   ELocomotionDecisionEvents Events, ELocomotionClip Clip)
+{
+	FLocomotionRecord Record;
+	Record.Time = GetWorld()->GetTimeSeconds();
+	Record.FrameNumber = static_cast<uint32>(GFrameCounter);
+	Record.StartAngle = DecisionCore.GetStartAngle();
+	Record.GroundSpeed = Input.GroundSpeed;
+	Record.VelocityAccelerationDot = Input.VelocityAccelerationDot;
+	Record.TimeInLocomotionState = TimeInLocomotionState;
+	Record.FootPhase = GetFootPhase();
+	Record.LocomotionState = LocomotionState;
+	Record.Events = Events;
+	Record.Clip = Clip;
+
+	RecorderSubsystem->Record(this, Record);
+}
+
+void UPlayerAnimInstance::RecordHitchEvents(ELocomotionDecisionEvents Events, ELocomotionClip Clip)
+{
+	if (EnumHasAnyFlags(Events, ELocomotionDecisionEvents::StateEntered))
+	{
+		HitchRecorder->AddEvent(EHitchEvent::StateEntered, PlayerRef, static_cast<uint8>(LocomotionState));
+	}
+
+	if (Clip != ELocomotionClip::ELC_None)
+	{
+		HitchRecorder->AddEvent(EHitchEvent::ClipSelected, PlayerRef, static_cast<uint8>(Clip));
+	}
+}
+
+void UPlayerAnimInstance::UpdateLanding(ELocomotionDecisionEvents Events)
+{
+	const auto Entered = EnumHasAnyFlags(Events, ELocomotionDecisionEvents::StateEntered);
+
+	if (LocomotionState != ELocomotionState::ELS_Jump)
 	{
-		LocomotionState = ELocomotionState::ELS_Jump;
+		if (!Entered || PrevLocomotionState != ELocomotionState::ELS_Jump) return;
+
+		// The decision core selects no start out of a jump, the one decided with the land animation plays instead
+		if (LandIntoStart && (LocomotionState == ELocomotionState::ELS_Walk ||
+			LocomotionState == ELocomotionState::ELS_Run))
+		{
+			PlayStartAnim = true;
+			UpdateEntryVariables();
+			StartAngle = LandStartAngle;
+			PrevStartAngle = LandStartAngle;
+			ApplyDecisionClip(FLocomotionDecisionCore::SelectStartClip(
+				LandStartAngle, LocomotionState == ELocomotionState::ELS_Run));
+		}
+
+		LandingPredictor.Stop(false, 0.0);
+		LandPending = false;
+		LandingPredicted = false;
+		PlayLandAnim = false;
+		LandIntoStart = false;
+		return;
+	}
+
+	if (Entered)
+	{
+		if (FLandingPredictor::IsPredictionEnabled()) LandingPredictor.Start(this, *PlayerRef, LandingParams);
+		LandPending = true;
+		LandingPredicted = false;
+		PlayLandAnim = false;
+		LandIntoStart = false;
+	}
+
+	if (!LandPending) return;
+
+	const auto Now = GetWorld()->GetTimeSeconds();
+	if (!IsFalling)
+	{
+		// Touched down, the state leaves the jump after MinTimeInLocomotionState
+		LandingPredictor.Stop(true, Now);
+		LandPending = false;
+		TimeToLand = 0.f;
+
+		if (PlayLandAnim)
+		{
+			FLandingPredictor::RecordImpactFrameError(static_cast<float>(Now - LandImpactFrameTime));
+			return;
+		}
+
+		// Reactive: nothing predicted in time, the land animation starts now and its impact frame plays late
+		const auto Heavy = LandingImpactSpeed >= HeavyLandingSpeed;
+		const auto ImpactTime = Heavy ? LandHeavyAnimImpactTime : LandLightAnimImpactTime;
+		LandAnim = Heavy ? LandHeavyAnim : LandLightAnim;
+		LandAnimStartTime = 0.f;
+		PlayLandAnim = true;
+		LandIntoStart = Velocity.Size2D() < MaxSpeedForPlayingStartAnim &&
+			InputVector.Size() >= WalkMinInputAcceleration;
+		LandStartAngle = FDaysGunMath::DeltaYaw(FDaysGunMath::YawFromVector(InputVector), ActorRotation.Yaw);
+		FLandingPredictor::RecordImpactFrameError(ImpactTime);
 		return;
 	}
 
-	TimeInLocomotionState += GetDeltaSeconds();
-	if (!UKismetMathLibrary::Greater_DoubleDouble(TimeInLocomotionState, MinTimeInLocomotionState)) return;
+	if (!LandingPredictor.IsActive())
+	{
+		// The velocity is already flat on the touch down frame, the reactive path keeps the last falling speed
+		LandingImpactSpeed = FMath::Max(0.f, -Velocity.Z);
+		return;
+	}
+
+	LandingPredictor.Update(this, *PlayerRef, LandingParams, SimDeltaSeconds);
+
+	const auto& Landing = LandingPredictor.GetLanding();
+	LandingPredicted = Landing.Valid;
+	if (!Landing.Valid) return;
 
-	DetermineGroundLocomotionState();
+	TimeToLand = FMath::Max(0.f, static_cast<float>(Landing.Time - Now));
+	LandingLocation = Landing.Location;
+	LandingImpactSpeed = FMath::Max(0.f, -FVector::DotProduct(Landing.Velocity, Landing.ImpactNormal));
+
+	// Once playing, the land animation keeps its clip and start time
+	if (PlayLandAnim) return;
+
+	const auto Heavy = LandingImpactSpeed >= HeavyLandingSpeed;
+	const auto ImpactTime = Heavy ? LandHeavyAnimImpactTime : LandLightAnimImpactTime;
+	LandAnim = Heavy ? LandHeavyAnim : LandLightAnim;
+	LandAnimStartTime = FMath::Max(0.f, ImpactTime - TimeToLand);
+	if (TimeToLand > ImpactTime) return;
+
+	PlayLandAnim = true;
+	LandImpactFrameTime = Now + (ImpactTime - LandAnimStartTime);
+	LandIntoStart = Landing.Velocity.Size2D() < MaxSpeedForPlayingStartAnim &&
+		InputVector.Size() >= WalkMinInputAcceleration;
+	LandStartAngle = FDaysGunMath::DeltaYaw(FDaysGunMath::YawFromVector(InputVector), ActorRotation.Yaw);
+}
+
+void UPlayerAnimInstance::UpdateOrientationWarping(float DeltaSeconds)
+{
+#if !UE_SERVER
+	auto TargetAngle = 0.f;
+	if (WarpingActive && (LocomotionState == ELocomotionState::ELS_Walk ||
+		LocomotionState == ELocomotionState::ELS_Run))
+	{
+		// Velocity barely has a direction yet at the beginning of a start, the input already does
+		const auto& MoveVector = GroundSpeed > DecisionParams.StartAngleInputMinSpeed ? Velocity : InputVector;
+		if (!MoveVector.IsNearlyZero())
+		{
+			TargetAngle = FDaysGunMath::DeltaYaw(FDaysGunMath::YawFromVector(MoveVector),
+			                                     PlayerRef->GetActorRotation().Yaw);
+		}
+	}
+
+	TargetAngle = FMath::Clamp(TargetAngle, -MaxOrientationWarpingAngle, MaxOrientationWarpingAngle);
+	OrientationWarpingAngle = FMath::FInterpTo(OrientationWarpingAngle, TargetAngle, DeltaSeconds,
+	                                           OrientationWarpingInterpSpeed);
+#endif
 }
 
-void UPlayerAnimInstance::TrackLocomotionStates()
+ELocomotionClip UPlayerAnimInstance::ApplyGaitTransitionClip(ELocomotionClip Clip)
 {
-	TrackLocomotionState(ELocomotionState::ELS_Idle, EntryFlags.IdleFlag,
-	                     &UPlayerAnimInstance::OnEntryIdle,
-	                     &UPlayerAnimInstance::OnExitIdle,
-	                     &UPlayerAnimInstance::WhileTrueIdle,
-	                     &UPlayerAnimInstance::WhileFalseIdle);
+	if (!GaitTransitionEntryTable || !GaitTransitionEntryTable->IsBuilt()) return ApplyDecisionClip(Clip);
+
+	// The decision core only tells the direction here, the table picks the foot and the entry frame
+	const auto WalkToRun = Clip == ELocomotionClip::ELC_WalkToRunLF || Clip == ELocomotionClip::ELC_WalkToRunRF;
+	const auto& Entry = GaitTransitionEntryTable->Find(WalkToRun, GetFootPhase());
+	ApplyDecisionClip(Entry.Clip);
+	AnimStartTime = Entry.StartTime;
+	return Entry.Clip;
+}
+
+ELocomotionClip UPlayerAnimInstance::ApplyDecisionClip(ELocomotionClip Clip)
+{
+	if (WarpingActive)
+	{
+		Clip = GetWarpingStartClip(Clip);
+	}
+
+	switch (Clip)
+	{
+	case ELocomotionClip::ELC_WalkStop:
+		StopAnim = WalkStopAnim;
+		AnimStartTime = WalkAnimStartTime;
+		break;
+	case ELocomotionClip::ELC_RunStop:
+		StopAnim = RunStopAnim;
+		AnimStartTime = RunAnimStartTime;
+		break;
+	case ELocomotionClip::ELC_WalkStartF:
+		WalkStartAnim = WalkStartFAnim;
+		AnimStartTime = WalkStartFAnimTime;
+		break;
+	case ELocomotionClip::ELC_WalkStart90L:
+		WalkStartAnim = WalkStart90LAnim;
+		AnimStartTime = WalkStart90LAnimTime;
+		break;
+	case ELocomotionClip::ELC_WalkStart180L:
+		WalkStartAnim = WalkStart180LAnim;
+		AnimStartTime = WalkStart180LAnimTime;
+		break;
+	case ELocomotionClip::ELC_WalkStart90R:
+		WalkStartAnim = WalkStart90RAnim;
+		AnimStartTime = WalkStart90RAnimTime;
+		break;
+	case ELocomotionClip::ELC_WalkStart180R:
+		WalkStartAnim = WalkStart180RAnim;
+		AnimStartTime = WalkStart180RAnimTime;
+		break;
+	case ELocomotionClip::ELC_RunStartF:
+		RunStartAnim = RunStartFAnim;
+		AnimStartTime = RunStartFAnimTime;
+		break;
+	case ELocomotionClip::ELC_RunStart90L:
+		RunStartAnim = RunStart90LAnim;
+		AnimStartTime = RunStart90LAnimTime;
+		break;
+	case ELocomotionClip::ELC_RunStart180L:
+		RunStartAnim = RunStart180LAnim;
+		AnimStartTime = RunStart180LAnimTime;
+		break;
+	case ELocomotionClip::ELC_RunStart90R:
+		RunStartAnim = RunStart90RAnim;
+		AnimStartTime = RunStart90RAnimTime;
+		break;
+	case ELocomotionClip::ELC_RunStart180R:
+		RunStartAnim = RunStart180RAnim;
+		AnimStartTime = RunStart180RAnimTime;
+		break;
+	case ELocomotionClip::ELC_WalkToRunLF:
+		WalkToRunAnim = WalkToRunLFAnim;
+		AnimStartTime = WalkToRunLFTime;
+		break;
+	case ELocomotionClip::ELC_WalkToRunRF:
+		WalkToRunAnim = WalkToRunRFAnim;
+		AnimStartTime = WalkToRunRFTime;
+		break;
+	case ELocomotionClip::ELC_RunToWalkLF:
+		RunToWalkAnim = RunToWalkLFAnim;
+		AnimStartTime = RunToWalkLFTime;
+		break;
+	case ELocomotionClip::ELC_RunToWalkRF:
+		RunToWalkAnim = RunToWalkRFAnim;
+		AnimStartTime = RunToWalkRFTime;
+		break;
+	default:
+		break;
+	}
+	return Clip;
+}
 
-	TrackLocomotionState(ELocomotionState::ELS_Walk, EntryFlags.WalkFlag,
-	                     &UPlayerAnimInstance::OnEntryWalk,
-	                     &UPlayerAnimInstance::OnExitWalk,
-	                     &UPlayerAnimInstance::WhileTrueWalk,
-	                     &UPlayerAnimInstance::WhileFalseWalk);
+bool UPlayerAnimInstance::IsInWalkStartState()
+{
+	return StateMachineIsWalkStartState();
+}
 
-	TrackLocomotionState(ELocomotionState::ELS_Run, EntryFlags.RunFlag,
-	                     &UPlayerAnimInstance::OnEntryRun,
-	                     &UPlayerAnimInstance::OnExitRun,
-	                     &UPlayerAnimInstance::WhileTrueRun,
-	                     &UPlayerAnimInstance::WhileFalseRun);
+float UPlayerAnimInstance::GetFootPhase()
+{
+	return GetCurveValue(MoveDataFootPhaseCurveName);
+}
 
-	TrackLocomotionState(ELocomotionState::ELS_Crouch, EntryFlags.CrouchFlag,
-	                     &UPlayerAnimInstance::OnEntryCrouch,
-	                     &UPlayerAnimInstance::OnExitCrouch,
-	                     &UPlayerAnimInstance::WhileTrueCrouch,
-	                     &UPlayerAnimInstance::WhileFalseCrouch);
+bool UPlayerAnimInstance::GetPredictedHeading(float Seconds, float& OutYaw)
+{
+	return Trajectory.PredictHeading(GetTrajectoryModel(), Seconds, OutYaw);
+}
 
-	TrackLocomotionState(ELocomotionState::ELS_Jump, EntryFlags.JumpFlag,
-	                     &UPlayerAnimInstance::OnEntryJump,
-	                     &UPlayerAnimInstance::OnExitJump,
-	                     &UPlayerAnimInstance::WhileTrueJump,
-	                     &UPlayerAnimInstance::WhileFalseJump);
+float UPlayerAnimInstance::GetAverageGroundSpeed(float Window)
+{
+	return Trajectory.GetAverageVelocity(Window).Size2D();
 }
 
 void UPlayerAnimInstance::UpdateCharacterPosition()
 {
 	if (InCycleState())
 	{
+		FHitchRecorderScope HitchScope(HitchRecorder, EHitchTimer::PostEvaluateRotation, PlayerRef);
 		CycleRotationBehavior();
 	}
 	else if (InStartState())
 	{
+		FHitchRecorderScope HitchScope(HitchRecorder, EHitchTimer::PostEvaluateRotation, PlayerRef);
 		StartRotationBehavior();
 	}
 	else if (InStopState())
 	{
+		FHitchRecorderScope HitchScope(HitchRecorder, EHitchTimer::PostEvaluateLocation, PlayerRef);
 		StopMovingBehavior();
 	}
 }
@@ -131,7 +697,7 @@ void UPlayerAnimInstance::UpdateVelocity()
 {
 	PrevVelocity = Velocity;
 
-	Velocity = CharacterMovementRef->Velocity;
+	Velocity = StepSample.Velocity;
 	GroundSpeed = Velocity.Size2D();
 }
 
@@ -139,8 +705,7 @@ void UPlayerAnimInstance::UpdatePlayerInput()
 {
 	InputVectorLastFrame = InputVector;
 
-	InputVector = CharacterMovementRef->GetLastInputVector();
-	InputVector = UKismetMathLibrary::ClampVectorSize(InputVector, 0.0, 1.0);
+	InputVector = StepSample.InputVector;
 }
 
 void UPlayerAnimInstance::UpdateInputVectorRotationRate()
@@ -151,47 +716,37 @@ void UPlayerAnimInstance::UpdateInputVectorRotationRate()
 		return;
 	}
 
-	const auto NormalizedInputVector = UKismetMathLibrary::Normal(InputVector);
-	const auto NormalizedInputVectorLastFrame = UKismetMathLibrary::Normal(InputVectorLastFrame);
+	// Measured over a window so a single jittery input sample doesn't spike the rate
+	InputVectorRotationRateTarget = Trajectory.GetInputYawRate(TrajectoryRateWindow);
 
-	const auto InputVectorRotator = UKismetMathLibrary::MakeRotFromX(NormalizedInputVector);
-	const auto InputVectorLastFrameRotator = UKismetMathLibrary::MakeRotFromX(NormalizedInputVectorLastFrame);
-
-	const auto Delta = UKismetMathLibrary::NormalizedDeltaRotator(InputVectorRotator, InputVectorLastFrameRotator);
-
-	const auto DeltaSeconds = GetDeltaSeconds();
-	const auto InputVectorRotationRateTarget = Delta.Yaw / DeltaSeconds;
-
-	InputVectorRotationRate = UKismetMathLibrary::FInterpTo(
+	InputVectorRotationRate = FMath::FInterpTo(
 		InputVectorRotationRate,
 		InputVectorRotationRateTarget,
-		DeltaSeconds,
+		SimDeltaSeconds,
 		InputVectorRotationRateInterpSpeed
 	);
 }
 
 void UPlayerAnimInstance::UpdateLean()
 {
-	const auto WorldDeltaSeconds = UGameplayStatics::GetWorldDeltaSeconds(GetWorld());
+	const auto TrajectoryAcceleration = Trajectory.GetAcceleration(TrajectoryRateWindow);
+	Acceleration = FVector(TrajectoryAcceleration.X, TrajectoryAcceleration.Y, 0.f);
 
-	const auto VelocitySubtraction = UKismetMathLibrary::Subtract_VectorVector(
-		FVector(Velocity.X, Velocity.Y, 0), PrevVelocity);
-	Acceleration = VelocitySubtraction / WorldDeltaSeconds;
-
-	const bool IsGainingMomentum = UKismetMathLibrary::Greater_DoubleDouble(
-		UKismetMathLibrary::DotProduct2D(FVector2D(Acceleration), FVector2D(Velocity)), 0.f);
+	// Lean is cosmetic, server targets only keep the acceleration
+#if !UE_SERVER
+	const bool IsGainingMomentum = FDaysGunMath::Dot2D(Acceleration, Velocity) > 0.f;
 
 	const float MaxAcceleration = IsGainingMomentum
 		                              ? CharacterMovementRef->GetMaxAcceleration()
 		                              : CharacterMovementRef->GetMaxBrakingDeceleration();
 
-	const auto ClampedAcceleration = UKismetMathLibrary::Vector_ClampSizeMax(Acceleration, MaxAcceleration);
-	const auto RelativeAccelerationAmount = ActorRotation.UnrotateVector(ClampedAcceleration / MaxAcceleration);
+	const auto ClampedAcceleration = Acceleration.GetClampedToMaxSize(MaxAcceleration);
+	LeanTarget = ActorRotation.UnrotateVector(ClampedAcceleration / MaxAcceleration);
 
-	Lean = UKismetMathLibrary::VInterpTo(
+	Lean = FMath::VInterpTo(
 		Lean,
-		RelativeAccelerationAmount,
-		WorldDeltaSeconds,
+		LeanTarget,
+		SimDeltaSeconds,
 		LeanInterpSpeed
 	);
 
@@ -200,97 +755,17 @@ void UPlayerAnimInstance::UpdateLean()
 
 	LeanX = Lean.X * LeanXPower;
 	LeanY = Lean.Y * LeanYPower;
+#endif
 }
 
 void UPlayerAnimInstance::UpdateAimOffset()
 {
-	const auto AimOffsetRotator = UKismetMathLibrary::NormalizedDeltaRotator(
-		PlayerRef->GetControlRotation(), PlayerRef->GetActorRotation());
-	AimYaw = AimOffsetRotator.Yaw;
-	AimPitch = AimOffsetRotator.Pitch;
-}
-
-void UPlayerAnimInstance::DetermineGroundLocomotionState()
-{
-	const auto NormalizedVelocity = UKismetMathLibrary::Normal(Velocity);
-	const auto NormalizedCurrentAcceleration = UKismetMathLibrary::Normal(
-		CharacterMovementRef->GetCurrentAcceleration());
-
-	const auto VelocityAccelerationDotProduct = FVector::DotProduct(NormalizedVelocity, NormalizedCurrentAcceleration);
-
-	if (UKismetMathLibrary::Less_DoubleDouble(VelocityAccelerationDotProduct, -0.5))
-	{
-		LocomotionState = ELocomotionState::ELS_Idle;
-		return;
-	}
-
-	if (IsMovementWithinThresholds(RunMinCurrentSpeed, RunMinMaxSpeed, RunMinInputAcceleration))
-	{
-		LocomotionState = ELocomotionState::ELS_Run;
-		return;
-	}
-
-	if (IsMovementWithinThresholds(WalkMinCurrentSpeed, WalkMinMaxSpeed, WalkMinInputAcceleration))
-	{
-		LocomotionState = ELocomotionState::ELS_Walk;
-		return;
-	}
-
-	LocomotionState = ELocomotionState::ELS_Idle;
-}
-
-void UPlayerAnimInstance::UpdateStop()
-{
-	if (GroundSpeed > RunStopSpeedLimit)
-	{
-		StopAnim = RunStopAnim;
-		AnimStartTime = RunAnimStartTime;
-	}
-	else
-	{
-		StopAnim = WalkStopAnim;
-		AnimStartTime = WalkAnimStartTime;
-	}
-}
-
-void UPlayerAnimInstance::UpdateOnWalkEntry()
-{
-	UpdateEntryVariables();
-	UpdateStartAnim(WalkStartAnim,
-	                WalkStart90LAnim, WalkStart90LAnimTime,
-	                WalkStart180LAnim, WalkStart180LAnimTime,
-	                WalkStart90RAnim, WalkStart90RAnimTime,
-	                WalkStart180RAnim, WalkStart180RAnimTime,
-	                WalkStartFAnim, WalkStartFAnimTime);
-}
-
-void UPlayerAnimInstance::UpdateOnRunToWalk()
-{
-	UpdateTransitionAnim(RunToWalkAnim,
-	                     RunToWalkLFAnim,
-	                     RunToWalkLFTime,
-	                     RunToWalkRFAnim,
-	                     RunToWalkRFTime);
-}
-
-void UPlayerAnimInstance::UpdateOnRunEntry()
-{
-	UpdateEntryVariables();
-	UpdateStartAnim(RunStartAnim,
-	                RunStart90LAnim, RunStart90LAnimTime,
-	                RunStart180LAnim, RunStart180LAnimTime,
-	                RunStart90RAnim, RunStart90RAnimTime,
-	                RunStart180RAnim, RunStart180RAnimTime,
-	                RunStartFAnim, RunStartFAnimTime);
-}
-
-void UPlayerAnimInstance::UpdateOnWalkToRun()
-{
-	UpdateTransitionAnim(WalkToRunAnim,
-	                     WalkToRunLFAnim,
-	                     WalkToRunLFTime,
-	                     WalkToRunRFAnim,
-	                     WalkToRunRFTime);
+#if !UE_SERVER
+	const auto ControlRotation = PlayerRef->GetControlRotation();
+	const auto OwnerRotation = PlayerRef->GetActorRotation();
+	AimYaw = FDaysGunMath::DeltaYaw(ControlRotation.Yaw, OwnerRotation.Yaw);
+	AimPitch = FRotator::NormalizeAxis(ControlRotation.Pitch - OwnerRotation.Pitch);
+#endif
 }
 
 void UPlayerAnimInstance::UpdateLocomotionValues()
@@ -299,37 +774,49 @@ void UPlayerAnimInstance::UpdateLocomotionValues()
 	const auto ClampedMoveDataSpeed = FMath::Clamp(MoveDataSpeed, MoveDataSpeedMinClampValue,
 	                                               MoveDataSpeedMaxClampValue);
 
-	PlayRate = UKismetMathLibrary::SafeDivide(GroundSpeed, ClampedMoveDataSpeed);
+	const auto NominalPlayRate = FDaysGunMath::SafeDivide(GroundSpeed, ClampedMoveDataSpeed);
+	if (!WarpingActive)
+	{
+		PlayRate = NominalPlayRate;
+		StrideWarpingScale = 1.f;
+		return;
+	}
+
+	// Play rate stays near the authored one, longer or shorter strides make up the rest so the feet do not slide
+	PlayRate = FMath::Clamp(NominalPlayRate, WarpingMinPlayRate, WarpingMaxPlayRate);
+	StrideWarpingScale = FDaysGunMath::SafeDivide(NominalPlayRate, PlayRate);
 }
 
 void UPlayerAnimInstance::CycleRotationBehavior()
 {
-	if (UKismetMathLibrary::NotEqual_RotatorRotator(ActorRotation, TargetRotationSmoothed, 0.1f))
+	const auto CurrentRotation = PlayerRef->GetActorRotation();
+	if (!CurrentRotation.Equals(RenderedRotation, 0.1f))
 	{
-		TargetRotation = ActorRotation;
-		TargetRotationSmoothed = ActorRotation;
+		TargetRotation = CurrentRotation;
+		TargetRotationSmoothed = CurrentRotation;
+		PrevTargetRotationSmoothed = CurrentRotation;
 	}
 
-	CalculateTargetRotationSmoothed();
+	AdvanceTargetRotation(false);
 
-	const auto NewRotation = FRotator(0.f, TargetRotationSmoothed.Yaw, 0.f);
-	PlayerRef->SetActorRotation(NewRotation);
+	const auto RenderedYaw = FLocomotionVisualOutputs::LerpAngle(
+		PrevTargetRotationSmoothed.Yaw, TargetRotationSmoothed.Yaw, GetSimAlpha());
+	RenderedRotation = FRotator(0.f, RenderedYaw, 0.f);
+	PlayerRef->SetActorRotation(RenderedRotation);
 }
 
 void UPlayerAnimInstance::StartRotationBehavior()
 {
-	const auto TargetRotationBeforeInterp = TargetRotationSmoothed;
-	CalculateTargetRotationSmoothed();
-
-	const auto TargetRotationDelta = UKismetMathLibrary::NormalizedDeltaRotator(
-		TargetRotationSmoothed, TargetRotationBeforeInterp).Yaw;
-	StartAngle += TargetRotationDelta;
+	AdvanceTargetRotation(true);
 
-	const auto RotationBlendValue = GetCurveValue(MoveDataRotationBlendName);
-	const auto DeltaAngle = UKismetMathLibrary::Multiply_DoubleDouble(StartAngle, RotationBlendValue);
+	const auto RenderedStartAngle = FMath::Lerp(PrevStartAngle, StartAngle, GetSimAlpha());
+	const auto RotationBlendValue = WarpingActive
+		                                ? FMath::SmoothStep(0.f, WarpingStartTurnSeconds, TimeInLocomotionState)
+		                                : GetCurveValue(MoveDataRotationBlendName);
+	const auto DeltaAngle = RenderedStartAngle * RotationBlendValue;
 
-	const auto NewRotation = UKismetMathLibrary::ComposeRotators(StartRotation, FRotator(0.f, DeltaAngle, 0.f));
-	PlayerRef->SetActorRotation(NewRotation);
+	const auto NewYaw = FDaysGunMath::NormalizeYaw(StartRotation.Yaw + DeltaAngle);
+	PlayerRef->SetActorRotation(FRotator(StartRotation.Pitch, NewYaw, StartRotation.Roll));
 }
 
 void UPlayerAnimInstance::StopMovingBehavior()
@@ -343,289 +830,185 @@ void UPlayerAnimInstance::StopMovingBehavior()
 	if(FMath::IsNearlyZero(StopMovingDelta)) return;
 
 	const auto CurrentLocation = PlayerRef->GetActorLocation();
-	const auto ForwardVector = UKismetMathLibrary::GetForwardVector(PlayerRef->GetActorRotation());
+	const auto ForwardVector = FDaysGunMath::ForwardFromYaw(PlayerRef->GetActorRotation().Yaw);
 	const auto LocalTargetLocation = ForwardVector * StopMovingDelta;
 
-	const auto TargetLocation = CurrentLocation + LocalTargetLocation;
-	const auto SmoothedTargetLocation = UKismetMathLibrary::VEase(
-		CurrentLocation,
-		TargetLocation,
-		1.0,
-		EEasingFunc::Linear);
-	
-	PlayerRef->SetActorLocation(SmoothedTargetLocation, true);
+	// A linear ease at alpha 1 is the target itself
+	PlayerRef->SetActorLocation(CurrentLocation + LocalTargetLocation, true);
+
+	if (HitchRecorder)
+	{
+		HitchRecorder->AddEvent(EHitchEvent::StopCorrection, PlayerRef, 0, StopMovingDelta);
+	}
 }
 
 void UPlayerAnimInstance::UpdateEntryVariables()
 {
 	StartRotation = ActorRotation;
 
-	const auto MovementVector = GroundSpeed > 15.f ? InputVector : Velocity;
-	TargetRotation = UKismetMathLibrary::MakeRotFromX(MovementVector);
+	// The core measured the start angle towards the predicted heading, the target yaw follows it
+	StartAngle = DecisionCore.GetStartAngle();
+	TargetRotation = FRotator(0.f, FDaysGunMath::NormalizeYaw(ActorRotation.Yaw + StartAngle), 0.f);
 	TargetRotationSmoothed = TargetRotation;
 
-	StartAngle = UKismetMathLibrary::NormalizedDeltaRotator(TargetRotation, StartRotation).Yaw;
+	PrevTargetRotationSmoothed = TargetRotationSmoothed;
+	PrevStartAngle = StartAngle;
 }
 
-void UPlayerAnimInstance::CalculateTargetRotationSmoothed()
+void UPlayerAnimInstance::CalculateTargetRotationSmoothed(const FLocomotionRotationStep& Step)
 {
-	const auto WorldDeltaSeconds = UGameplayStatics::GetWorldDeltaSeconds(GetWorld());
-
-	const auto ConstRotationRate = CalculateConstRotationRate();
-	TargetRotation = UKismetMathLibrary::RInterpTo_Constant(
-		TargetRotation,
-		UKismetMathLibrary::MakeRotFromX(Velocity),
-		WorldDeltaSeconds,
-		ConstRotationRate
-	);
-
-	const auto SmoothRotationRate = CalculateSmoothRotationRate();
-	TargetRotationSmoothed = UKismetMathLibrary::RInterpTo(
-		TargetRotationSmoothed,
-		TargetRotation,
-		WorldDeltaSeconds,
-		SmoothRotationRate
-	);
+	auto TargetYaw = static_cast<float>(TargetRotation.Yaw);
+	auto SmoothedYaw = static_cast<float>(TargetRotationSmoothed.Yaw);
+	FLocomotionDecisionCore::AdvanceTargetYaw(Step.VelocityYaw, Step.InputVectorRotationRate, SimDeltaSeconds,
+	                                          DecisionParams, TargetYaw, SmoothedYaw);
+	TargetRotation.Yaw = TargetYaw;
+	TargetRotationSmoothed.Yaw = SmoothedYaw;
 }
 
-bool UPlayerAnimInstance::IsMovementWithinThresholds(float MinCurrentSpeed, float MinMaxSpeed,
-                                                     float MinInputAcceleration) const
-
+void UPlayerAnimInstance::AdvanceTargetRotation(bool AccumulateStartAngle)
 {
-	return UKismetMathLibrary::LessEqual_DoubleDouble(MinCurrentSpeed, GroundSpeed) &&
-		UKismetMathLibrary::LessEqual_DoubleDouble(MinMaxSpeed, MaxSpeed) &&
-		UKismetMathLibrary::LessEqual_DoubleDouble(MinInputAcceleration, InputVector.Size());
-}
-
-void UPlayerAnimInstance::TrackLocomotionState(ELocomotionState TracedState, bool& EnterFlag,
-                                               void (UPlayerAnimInstance::*OnEnterCallback)(),
-                                               void (UPlayerAnimInstance::*OnExitCallback)(),
-                                               void (UPlayerAnimInstance::*WhileTrueCallback)(),
-                                               void (UPlayerAnimInstance::*WhileFalseCallback)())
-{
-	if (LocomotionState == TracedState)
+	for (const auto& Step : RotationSteps)
 	{
-		if (EnterFlag != true)
-		{
-			EnterFlag = true;
-			(this->*OnEnterCallback)();
-			TimeInLocomotionState = 0.f;
-		}
-		else
-		{
-			(this->*WhileTrueCallback)();
-		}
-	}
-	else
-	{
-		if (EnterFlag != false)
-		{
-			EnterFlag = false;
-			(this->*OnExitCallback)();
-		}
-		else
-		{
-			(this->*WhileFalseCallback)();
-		}
-	}
-}
+		PrevTargetRotationSmoothed = TargetRotationSmoothed;
+		PrevStartAngle = StartAngle;
 
-void UPlayerAnimInstance::UpdateStartAnim(UAnimSequence*& FinishAnim, UAnimSequence* Start90LAnim,
-                                          const float Start90LAnimTime, UAnimSequence* Start180LAnim,
-                                          const float Start180LAnimTime,
-                                          UAnimSequence* Start90RAnim,
-                                          const float Start90RAnimTime, UAnimSequence* Start180RAnim,
-                                          const float Start180RAnimTime,
-                                          UAnimSequence* StartFAnim,
-                                          const float StartFAnimTime)
-{
-	if (UKismetMathLibrary::InRange_FloatFloat(StartAngle, -135, -45, false, true))
-	{
-		FinishAnim = Start90LAnim;
-		AnimStartTime = Start90LAnimTime;
-	}
-	else if (UKismetMathLibrary::InRange_FloatFloat(StartAngle, -180, -135, true, true))
-	{
-		FinishAnim = Start180LAnim;
-		AnimStartTime = Start180LAnimTime;
-	}
-	else if (UKismetMathLibrary::InRange_FloatFloat(StartAngle, 45, 135, true, false))
-	{
-		FinishAnim = Start90RAnim;
-		AnimStartTime = Start90RAnimTime;
-	}
-	else if (UKismetMathLibrary::InRange_FloatFloat(StartAngle, 135, 180, true, true))
-	{
-		FinishAnim = Start180RAnim;
-		AnimStartTime = Start180RAnimTime;
-	}
-	else
-	{
-		FinishAnim = StartFAnim;
-		AnimStartTime = StartFAnimTime;
-	}
-}
+		CalculateTargetRotationSmoothed(Step);
 
-void UPlayerAnimInstance::UpdateTransitionAnim(UAnimSequence*& FinishAnim, UAnimSequence* TransitionLFAnim,
-                                               const float AnimLFStartTime, UAnimSequence* TransitionRFAnim,
-                                               const float AnimRFStartTime)
-{
-	const auto FootPhase = GetCurveValue(MoveDataFootPhaseCurveName);
-	if (UKismetMathLibrary::GreaterEqual_DoubleDouble(FootPhase, MoveDataLeftFootPhaseLimit))
-	{
-		FinishAnim = TransitionLFAnim;
-		AnimStartTime = AnimLFStartTime;
-	}
-	else
-	{
-		FinishAnim = TransitionRFAnim;
-		AnimStartTime = AnimRFStartTime;
+		if (AccumulateStartAngle)
+		{
+			StartAngle += FDaysGunMath::DeltaYaw(TargetRotationSmoothed.Yaw, PrevTargetRotationSmoothed.Yaw);
+		}
 	}
 }
 
-float UPlayerAnimInstance::CalculateConstRotationRate() const
+FLocomotionVisualOutputs UPlayerAnimInstance::CaptureVisualOutputs() const
 {
-	return UKismetMathLibrary::MapRangeClamped(
-		UKismetMathLibrary::Abs(InputVectorRotationRate),
-		0.f, 200.f,
-		500.f, 2000.f);
+	FLocomotionVisualOutputs Outputs;
+	Outputs.LeanX = LeanX;
+	Outputs.LeanY = LeanY;
+	Outputs.AimYaw = AimYaw;
+	Outputs.AimPitch = AimPitch;
+	Outputs.PlayRate = PlayRate;
+	Outputs.StrideScale = StrideWarpingScale;
+	return Outputs;
 }
 
-float UPlayerAnimInstance::CalculateSmoothRotationRate() const
+void UPlayerAnimInstance::ApplyVisualOutputs(const FLocomotionVisualOutputs& Outputs)
 {
-	return UKismetMathLibrary::MapRangeClamped(
-		UKismetMathLibrary::Abs(InputVectorRotationRate),
-		0.f, 200.f,
-		5.f, 15.f);
+	LeanX = Outputs.LeanX;
+	LeanY = Outputs.LeanY;
+	AimYaw = Outputs.AimYaw;
+	AimPitch = Outputs.AimPitch;
+	PlayRate = Outputs.PlayRate;
+	StrideWarpingScale = Outputs.StrideScale;
 }
 
-#pragma region IdleCallbacks
-void UPlayerAnimInstance::OnEntryIdle()
+void UPlayerAnimInstance::UpdateFootsteps()
 {
-	StopMovingValue = 0.f;
-	UpdateStop();
-}
+#if !UE_SERVER
+	LLM_SCOPE_BYTAG(DaysGun_Footsteps);
+	const auto FootPhase = GetCurveValue(MoveDataFootPhaseCurveName);
+	const auto PrevPhase = PrevFootPhase;
+	PrevFootPhase = FootPhase;
 
-void UPlayerAnimInstance::OnExitIdle()
-{
-}
+	if (!FootstepSubsystem || !FootstepEffects) return;
+	if (IsFalling || GroundSpeed < FootstepMinSpeed) return;
+	if (LocomotionState != ELocomotionState::ELS_Walk && LocomotionState != ELocomotionState::ELS_Run) return;
 
-void UPlayerAnimInstance::WhileTrueIdle()
-{
-}
+	auto PhaseDelta = FootPhase - PrevPhase;
+	if (PhaseDelta < 0.f) PhaseDelta += 1.f;
+	if (FMath::IsNearlyZero(PhaseDelta) || PhaseDelta > MaxFootPhaseStep) return;
 
-void UPlayerAnimInstance::WhileFalseIdle()
-{
-}
-#pragma endregion
-
-#pragma region WalkCallbacks
-void UPlayerAnimInstance::OnEntryWalk()
-{
-	if (PrevLocomotionState == ELocomotionState::ELS_Run)
+	// Distance ahead of the previous phase to the plant phase, on the wrapped [0, 1) cycle
+	const auto CrossedPhase = [PrevPhase, PhaseDelta](float PlantPhase)
 	{
-		if (UKismetMathLibrary::Less_DoubleDouble(GroundSpeed, MaxSpeedForPlayingStartAnim))
-		{
-			PlayStartAnim = true;
-			UpdateOnWalkEntry();
-		}
-		else if (UKismetMathLibrary::Less_DoubleDouble(MinTimeGaitTransitionAnim, TimeInLocomotionState))
-		{
-			PlayGaitTransitionAnim = true;
-			UpdateOnRunToWalk();
-		}
-	}
-	else if (PrevLocomotionState == ELocomotionState::ELS_Idle)
-	{
-		PlayStartAnim = true;
-		UpdateOnWalkEntry();
-	}
-}
-
-void UPlayerAnimInstance::OnExitWalk()
-{
-}
-
-void UPlayerAnimInstance::WhileTrueWalk()
-{
-	UpdateLocomotionValues();
-}
+		auto Offset = PlantPhase - PrevPhase;
+		if (Offset <= 0.f) Offset += 1.f;
+		return Offset <= PhaseDelta;
+	};
 
-void UPlayerAnimInstance::WhileFalseWalk()
-{
-}
-#pragma endregion
-
-#pragma region RunCallbacks
-void UPlayerAnimInstance::OnEntryRun()
-{
-	if (PrevLocomotionState == ELocomotionState::ELS_Walk)
+	if (CrossedPhase(LeftFootPlantPhase))
 	{
-		if (StateMachineIsWalkStartState())
-		{
-			PlayStartAnim = true;
-			UpdateOnRunEntry();
-		}
-		else if (UKismetMathLibrary::Less_DoubleDouble(MinTimeGaitTransitionAnim, TimeInLocomotionState))
-		{
-			PlayGaitTransitionAnim = true;
-			UpdateOnWalkToRun();
-		}
+		PlayFootstep(EFootstepFoot::EFF_Left, LeftFootSocketName);
 	}
-	else if (PrevLocomotionState == ELocomotionState::ELS_Idle)
+
+	if (CrossedPhase(RightFootPlantPhase))
 	{
-		PlayStartAnim = true;
-		UpdateOnRunEntry();
+		PlayFootstep(EFootstepFoot::EFF_Right, RightFootSocketName);
 	}
+#endif
 }
 
-void UPlayerAnimInstance::OnExitRun()
+void UPlayerAnimInstance::PlayFootstep(EFootstepFoot Foot, FName FootSocketName)
 {
-}
+	FFootstepEvent Event;
+	Event.Location = GetOwningComponent()->GetSocketLocation(FootSocketName);
+	Event.Surface = FootstepSurfaceCache.Resolve(PlayerRef, Event.Location, FootstepTraceDistance);
+	Event.Foot = Foot;
+	Event.Effects = FootstepEffects;
 
-void UPlayerAnimInstance::WhileTrueRun()
-{
-	UpdateLocomotionValues();
+	FootstepSubsystem->PlayFootstep(Event);
 }
 
-void UPlayerAnimInstance::WhileFalseRun()
+void UPlayerAnimInstance::RegisterSnapshot()
 {
-}
-#pragma endregion
+	if (!PlayerRef || SnapshotHandle != INDEX_NONE) return;
 
-#pragma region CrouchCallbacks
-void UPlayerAnimInstance::OnEntryCrouch()
-{
-}
+	const auto World = GetWorld();
+	if (!World || !World->IsGameWorld()) return;
 
-void UPlayerAnimInstance::OnExitCrouch()
-{
-}
-
-void UPlayerAnimInstance::WhileTrueCrouch()
-{
-	UpdateLocomotionValues();
-}
-
-void UPlayerAnimInstance::WhileFalseCrouch()
-{
-}
-#pragma endregion
-
-#pragma region JumpCallbacks
-void UPlayerAnimInstance::OnEntryJump()
-{
-}
-
-void UPlayerAnimInstance::OnExitJump()
-{
+	SnapshotSubsystem = World->GetSubsystem<ULocomotionSnapshotSubsystem>();
+	if (SnapshotSubsystem)
+	{
+		SnapshotHandle = SnapshotSubsystem->Register(PlayerRef);
+	}
 }
 
-void UPlayerAnimInstance::WhileTrueJump()
+void UPlayerAnimInstance::UnregisterSnapshot()
 {
-}
+	if (SnapshotSubsystem && SnapshotHandle != INDEX_NONE)
+	{
+		SnapshotSubsystem->Unregister(SnapshotHandle);
+	}
 
-void UPlayerAnimInstance::WhileFalseJump()
-{
-}
-#pragma endregion
+	SnapshotHandle = INDEX_NONE;
+	SnapshotSubsystem = nullptr;
+}
+
+void UPlayerAnimInstance::PublishSnapshot() const
+{
+	if (!SnapshotSubsystem || SnapshotHandle == INDEX_NONE) return;
+
+	FLocomotionSnapshot Snapshot;
+	Snapshot.Location = PlayerRef->GetActorLocation();
+	Snapshot.Velocity = Velocity;
+	Snapshot.Acceleration = Acceleration;
+	Snapshot.GroundSpeed = GroundSpeed;
+	Snapshot.MaxSpeed = MaxSpeed;
+	Snapshot.ActorYaw = ActorRotation.Yaw;
+	Snapshot.LeanX = LeanX;
+	Snapshot.LeanY = LeanY;
+	Snapshot.AimYaw = AimYaw;
+	Snapshot.AimPitch = AimPitch;
+	Snapshot.PlayRate = PlayRate;
+	Snapshot.TimeInLocomotionState = TimeInLocomotionState;
+	Snapshot.FrameNumber = GFrameCounter;
+	Snapshot.LocomotionState = LocomotionState;
+	Snapshot.PrevLocomotionState = PrevLocomotionState;
+	Snapshot.IsFalling = IsFalling;
+
+	SnapshotSubsystem->Publish(SnapshotHandle, Snapshot);
+}
+
+#if !UE_BUILD_SHIPPING
+static FAutoConsoleCommandWithArgs GAnimWarpingCommand(
+	TEXT("DaysGun.Anim.Warping"),
+	TEXT("Overrides UseWarping on every player anim instance, -1 goes back to each asset's setting. ")
+	TEXT("Compare the us/bot column of DaysGun.Soak runs and the clips of DaysGun.Memory.Report. Args: -1|0|1"),
+	FConsoleCommandWithArgsDelegate::CreateLambda([](const TArray<FString>& Args)
+	{
+		if (Args.Num() > 0) GWarpingOverride = FMath::Clamp(FCString::Atoi(*Args[0]), -1, 1);
+		UE_LOG(LogDaysGun, Display, TEXT("Anim warping %s"),
+		       GWarpingOverride < 0 ? TEXT("per asset") : GWarpingOverride > 0 ? TEXT("on") : TEXT("off"));
+	}));
+#endif
@@ -0,0 +1,28 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "Animation/PlayerAnimInstanceProxy.h"
+
+#include "Animation/PlayerAnimInstance.h"
+#include "Player/HitchRecorderSubsystem.h"
+
+void FPlayerAnimInstanceProxy::PreUpdate(UAnimInstance* InAnimInstance, float DeltaSeconds)
+{
+	Super::PreUpdate(InAnimInstance, DeltaSeconds);
+
+	const auto AnimInstance = CastChecked<UPlayerAnimInstance>(InAnimInstance);
+	HitchRecorder = AnimInstance->HitchRecorder;
+	HitchOwner = AnimInstance->PlayerRef;
+}
+
+void FPlayerAnimInstanceProxy::UpdateAnimationNode(const FAnimationUpdateContext& InContext)
+{
+	FHitchRecorderScope HitchScope(HitchRecorder, EHitchTimer::ThreadSafeUpdate, HitchOwner);
+	Super::UpdateAnimationNode(InContext);
+}
+
+void FPlayerAnimInstanceProxy::EvaluateAnimationNode(FPoseContext& Output)
+{
+	FHitchRecorderScope HitchScope(HitchRecorder, EHitchTimer::Evaluate, HitchOwner);
+	Super::EvaluateAnimationNode(Output);
+}
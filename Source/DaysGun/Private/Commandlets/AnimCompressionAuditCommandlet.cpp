@@ -0,0 +1,647 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "Commandlets/AnimCompressionAuditCommandlet.h"
+
+#include "DaysGun.h"
+
+#if WITH_EDITOR
+#include "Animation/AnimBoneCompressionCodec.h"
+#include "Animation/AnimBoneCompressionSettings.h"
+#include "Animation/AnimCurveCompressionCodec.h"
+#include "Animation/AnimCurveCompressionSettings.h"
+#include "Animation/AnimSequence.h"
+#include "Animation/AttributesRuntime.h"
+#include "AssetRegistry/ARFilter.h"
+#include "AssetRegistry/IAssetRegistry.h"
+#include "BonePose.h"
+#include "HAL/FileManager.h"
+#include "HAL/PlatformTime.h"
+#include "Misc/FileHelper.h"
+#include "Misc/PackageName.h"
+#include "Misc/Paths.h"
+#include "UObject/Package.h"
+#include "UObject/SavePackage.h"
+
+namespace AnimCompressionAudit
+{
+	const TCHAR* ACLCodec = TEXT("/Script/ACLPlugin.AnimBoneCompressionCodec_ACL");
+	const TCHAR* MoveDataCurvePrefix = TEXT("MoveData_");
+
+	struct FCandidate
+	{
+		FString Name;
+
+		/** Empty keeps the bone settings of each sequence */
+		FString BoneCodecClass;
+		FString BoneCodecProperties;
+
+		/** Empty keeps the curve settings of each sequence */
+		FString CurveCodecClass;
+		FString CurveCodecProperties;
+	};
+
+	/** ACL error thresholds are in centimeters, measured on virtual vertices around each bone */
+	TArray<FCandidate> GetDefaultCandidates()
+	{
+		return {
+			{TEXT("Current")},
+			{TEXT("BitwiseOnly"), TEXT("/Script/Engine.AnimCompress_BitwiseCompressOnly")},
+			{TEXT("RemoveLinearKeys"), TEXT("/Script/Engine.AnimCompress_RemoveLinearKeys"),
+			 TEXT("MaxPosDiff=0.1,MaxAngleDiff=0.025,MaxEffectorDiff=0.01")},
+			{TEXT("ACL"), ACLCodec, TEXT("ErrorThreshold=0.01")},
+			{TEXT("ACL_Coarse"), ACLCodec, TEXT("ErrorThreshold=0.05")},
+			{TEXT("ACL_VeryCoarse"), ACLCodec, TEXT("ErrorThreshold=0.1")},
+			{TEXT("ACL_Medium"), ACLCodec, TEXT("CompressionLevel=ACLCL_Medium,ErrorThreshold=0.01")},
+			{TEXT("ACL_Highest"), ACLCodec, TEXT("CompressionLevel=ACLCL_Highest,ErrorThreshold=0.01")},
+			{TEXT("ACLSafe"), TEXT("/Script/ACLPlugin.AnimBoneCompressionCodec_ACLSafe")},
+			{TEXT("ACL_ACLCurves"), ACLCodec, TEXT("ErrorThreshold=0.01"),
+			 TEXT("/Script/ACLPlugin.AnimCurveCompressionCodec_ACL")},
+			{TEXT("ACL_RichCurves"), ACLCodec, TEXT("ErrorThreshold=0.01"),
+			 TEXT("/Script/Engine.AnimCurveCompressionCodec_CompressedRichCurve"), TEXT("MaxCurveError=0.001")},
+			{TEXT("ACL_UniformCurves"), ACLCodec, TEXT("ErrorThreshold=0.01"),
+			 TEXT("/Script/Engine.AnimCurveCompressionCodec_UniformlySampled"),
+			 TEXT("UseAnimSequenceSampleRate=False,SampleRate=30")},
+		};
+	}
+
+	/** Name;BoneCodecClass;Properties;CurveCodecClass;Properties, properties separated by commas */
+	bool ParseCandidate(const FString& Text, FCandidate& OutCandidate)
+	{
+		TArray<FString> Fields;
+		Text.ParseIntoArray(Fields, TEXT(";"), false);
+		if (Fields.Num() < 2 || Fields[0].IsEmpty()) return false;
+
+		Fields.SetNum(5);
+		OutCandidate = {Fields[0], Fields[1], Fields[2], Fields[3], Fields[4]};
+		return true;
+	}
+
+	bool SetProperties(UObject* Object, const FString& Properties)
+	{
+		TArray<FString> Pairs;
+		Properties.ParseIntoArray(Pairs, TEXT(","));
+		for (const auto& Pair : Pairs)
+		{
+			FString Name;
+			FString Value;
+			const auto Property = Pair.Split(TEXT("="), &Name, &Value)
+				                      ? FindFProperty<FProperty>(Object->GetClass(), *Name)
+				                      : nullptr;
+			if (!Property || !Property->ImportText_InContainer(*Value, Object, Object, PPF_None))
+			{
+				UE_LOG(LogDaysGun, Error, TEXT("AnimCompressionAudit: can't set %s on %s"), *Pair,
+				       *Object->GetClass()->GetName());
+				return false;
+			}
+		}
+		return true;
+	}
+
+	UAnimBoneCompressionSettings* CreateBoneSettings(const FCandidate& Candidate, UObject* Outer, FName Name)
+	{
+		const auto CodecClass = LoadClass<UAnimBoneCompressionCodec>(nullptr, *Candidate.BoneCodecClass);
+		if (!CodecClass)
+		{
+			UE_LOG(LogDaysGun, Warning, TEXT("AnimCompressionAudit: can't load %s, skipping %s"),
+			       *Candidate.BoneCodecClass, *Candidate.Name);
+			return nullptr;
+		}
+
+		const auto Settings = NewObject<UAnimBoneCompressionSettings>(Outer, Name, RF_Public | RF_Standalone);
+		const auto Codec = NewObject<UAnimBoneCompressionCodec>(Settings, CodecClass);
+		if (!SetProperties(Codec, Candidate.BoneCodecProperties)) return nullptr;
+
+		Settings->Codecs.Add(Codec);
+		return Settings;
+	}
+
+	UAnimCurveCompressionSettings* CreateCurveSettings(const FCandidate& Candidate, UObject* Outer, FName Name)
+	{
+		const auto CodecClass = LoadClass<UAnimCurveCompressionCodec>(nullptr, *Candidate.CurveCodecClass);
+		if (!CodecClass)
+		{
+			UE_LOG(LogDaysGun, Warning, TEXT("AnimCompressionAudit: can't load %s, skipping %s"),
+			       *Candidate.CurveCodecClass, *Candidate.Name);
+			return nullptr;
+		}
+
+		const auto Settings = NewObject<UAnimCurveCompressionSettings>(Outer, Name, RF_Public | RF_Standalone);
+		const auto Codec = NewObject<UAnimCurveCompressionCodec>(Settings, CodecClass);
+		if (!SetProperties(Codec, Candidate.CurveCodecProperties)) return nullptr;
+
+		Settings->Codec = Codec;
+		return Settings;
+	}
+
+	/** Raw reference of one sequence, sampled once and compared against every candidate */
+	struct FSequenceData
+	{
+		UAnimSequence* Sequence = nullptr;
+		UAnimBoneCompressionSettings* OriginalBoneSettings = nullptr;
+		UAnimCurveCompressionSettings* OriginalCurveSettings = nullptr;
+
+		FBoneContainer Bones;
+		TArray<double> SampleTimes;
+
+		/** Compact pose indices and names of the effectors the skeleton has */
+		TArray<FCompactPoseBoneIndex> Effectors;
+		TArray<FName> EffectorNames;
+
+		TArray<FName> Curves;
+
+		/** Sample major: [Sample * Effectors.Num() + Effector] */
+		TArray<FVector> RawEffectorLocations;
+		TArray<float> RawCurveValues;
+	};
+
+	struct FMeasurement
+	{
+		int64 CompressedBytes = 0;
+		uint64 DecompressCycles = 0;
+		int32 NumSamples = 0;
+
+		float MaxErrorCm = 0.f;
+		FName WorstEffector;
+		float MaxCurveError = 0.f;
+		FName WorstCurve;
+	};
+
+	struct FCandidateResult
+	{
+		const FCandidate* Candidate = nullptr;
+		TArray<FMeasurement> Sequences;
+		FMeasurement Total;
+
+		int32 WorstErrorSequence = INDEX_NONE;
+		int32 WorstCurveSequence = INDEX_NONE;
+		bool Passes = false;
+
+		double GetMicrosecondsPerSample() const
+		{
+			return FPlatformTime::ToMilliseconds64(Total.DecompressCycles) * 1000.0 / FMath::Max(Total.NumSamples, 1);
+		}
+	};
+
+	void EvaluatePose(const FSequenceData& Data, double Time, bool Raw, FCompactPose& OutPose,
+	                  FBlendedCurve& OutCurve)
+	{
+		OutPose.SetBoneContainer(&Data.Bones);
+		OutCurve.InitFrom(Data.Bones);
+
+		UE::Anim::FStackAttributeContainer Attributes;
+		FAnimationPoseData PoseData(OutPose, OutCurve, Attributes);
+		Data.Sequence->GetBonePose(PoseData, FAnimExtractContext(Time), Raw);
+	}
+
+	bool PrepareSequence(UAnimSequence* Sequence, const TArray<FString>& EffectorNames, FSequenceData& OutData)
+	{
+		const auto Skeleton = Sequence->GetSkeleton();
+		if (!Skeleton)
+		{
+			UE_LOG(LogDaysGun, Warning, TEXT("AnimCompressionAudit: %s has no skeleton"), *Sequence->GetName());
+			return false;
+		}
+
+		OutData.Sequence = Sequence;
+		OutData.OriginalBoneSettings = Sequence->BoneCompressionSettings;
+		OutData.OriginalCurveSettings = Sequence->CurveCompressionSettings;
+
+		const auto& ReferenceSkeleton = Skeleton->GetReferenceSkeleton();
+		TArray<FBoneIndexType> RequiredBones;
+		for (int32 Bone = 0; Bone < ReferenceSkeleton.GetNum(); ++Bone)
+		{
+			RequiredBones.Add(static_cast<FBoneIndexType>(Bone));
+		}
+		OutData.Bones.InitializeTo(RequiredBones, UE::Anim::FCurveFilterSettings(), *Skeleton);
+
+		for (const auto& EffectorName : EffectorNames)
+		{
+			const auto SkeletonIndex = ReferenceSkeleton.FindBoneIndex(*EffectorName);
+			if (SkeletonIndex == INDEX_NONE) continue;
+
+			OutData.Effectors.Add(OutData.Bones.GetCompactPoseIndexFromSkeletonIndex(SkeletonIndex));
+			OutData.EffectorNames.Add(*EffectorName);
+		}
+
+		TArray<const FFloatCurve*> RawCurves;
+		for (const auto& Curve : Sequence->GetDataModel()->GetFloatCurves())
+		{
+			if (!Curve.GetName().ToString().StartsWith(MoveDataCurvePrefix)) continue;
+
+			OutData.Curves.Add(Curve.GetName());
+			RawCurves.Add(&Curve);
+		}
+
+		// Every key plus the end, so no key of the raw data goes unchecked
+		const auto NumSamples = FMath::Max(Sequence->GetNumberOfSampledKeys(), 2);
+		const auto PlayLength = Sequence->GetPlayLength();
+
+		FCompactPose Pose;
+		FBlendedCurve BlendedCurve;
+		for (int32 Sample = 0; Sample < NumSamples; ++Sample)
+		{
+			const double Time = PlayLength * Sample / (NumSamples - 1);
+			OutData.SampleTimes.Add(Time);
+
+			EvaluatePose(OutData, Time, true, Pose, BlendedCurve);
+			FCSPose<FCompactPose> ComponentPose;
+			ComponentPose.InitPose(Pose);
+			for (const auto Effector : OutData.Effectors)
+			{
+				OutData.RawEffectorLocations.Add(ComponentPose.GetComponentSpaceTransform(Effector).GetLocation());
+			}
+
+			for (const auto RawCurve : RawCurves)
+			{
+				OutData.RawCurveValues.Add(RawCurve->Evaluate(Time));
+			}
+		}
+
+		return true;
+	}
+
+	FMeasurement Measure(const FSequenceData& Data)
+	{
+		FMeasurement Measurement;
+		Measurement.CompressedBytes = Data.Sequence->GetResourceSizeBytes(EResourceSizeMode::Exclusive);
+
+		const auto NumEffectors = Data.Effectors.Num();
+		const auto NumCurves = Data.Curves.Num();
+
+		FCompactPose Pose;
+		FBlendedCurve BlendedCurve;
+		for (int32 Sample = 0; Sample < Data.SampleTimes.Num(); ++Sample)
+		{
+			const auto StartCycles = FPlatformTime::Cycles64();
+			EvaluatePose(Data, Data.SampleTimes[Sample], false, Pose, BlendedCurve);
+			Measurement.DecompressCycles += FPlatformTime::Cycles64() - StartCycles;
+			++Measurement.NumSamples;
+
+			FCSPose<FCompactPose> ComponentPose;
+			ComponentPose.InitPose(Pose);
+			for (int32 Effector = 0; Effector < NumEffectors; ++Effector)
+			{
+				const auto& RawLocation = Data.RawEffectorLocations[Sample * NumEffectors + Effector];
+				const float Error = FVector::Dist(
+					ComponentPose.GetComponentSpaceTransform(Data.Effectors[Effector]).GetLocation(), RawLocation);
+				if (Error > Measurement.MaxErrorCm)
+				{
+					Measurement.MaxErrorCm = Error;
+					Measurement.WorstEffector = Data.EffectorNames[Effector];
+				}
+			}
+
+			for (int32 Curve = 0; Curve < NumCurves; ++Curve)
+			{
+				const auto Error = FMath::Abs(BlendedCurve.Get(Data.Curves[Curve]) -
+				                              Data.RawCurveValues[Sample * NumCurves + Curve]);
+				if (Error > Measurement.MaxCurveError)
+				{
+					Measurement.MaxCurveError = Error;
+					Measurement.WorstCurve = Data.Curves[Curve];
+				}
+			}
+		}
+
+		return Measurement;
+	}
+
+	void Recompress(UAnimSequence* Sequence, UAnimBoneCompressionSettings* BoneSettings,
+	                UAnimCurveCompressionSettings* CurveSettings)
+	{
+		Sequence->BoneCompressionSettings = BoneSettings;
+		Sequence->CurveCompressionSettings = CurveSettings;
+		Sequence->CacheDerivedDataForCurrentPlatform();
+	}
+
+	bool SavePackage(UPackage* Package, UObject* Asset)
+	{
+		const auto FileName = FPackageName::LongPackageNameToFilename(Package->GetName(),
+		                                                              FPackageName::GetAssetPackageExtension());
+		if (IFileManager::Get().IsReadOnly(*FileName))
+		{
+			UE_LOG(LogDaysGun, Error, TEXT("AnimCompressionAudit: %s is read only, check it out first"), *FileName);
+			return false;
+		}
+
+		FSavePackageArgs SaveArgs;
+		SaveArgs.TopLevelFlags = RF_Public | RF_Standalone;
+		if (!UPackage::SavePackage(Package, Asset, *FileName, SaveArgs))
+		{
+			UE_LOG(LogDaysGun, Error, TEXT("AnimCompressionAudit: can't save %s"), *FileName);
+			return false;
+		}
+		return true;
+	}
+
+	/** Saves the candidate's settings as assets and switches every sequence to them */
+	bool ApplyCandidate(const FCandidate& Candidate, const TArray<FSequenceData>& Sequences,
+	                    const FString& SettingsPath)
+	{
+		const auto CreateAsset = [&SettingsPath, &Candidate](const TCHAR* Prefix, auto Create) -> UObject*
+		{
+			const auto AssetName = FString::Printf(TEXT("%s_%s"), Prefix, *Candidate.Name);
+			const auto Package = CreatePackage(*(SettingsPath / AssetName));
+			const auto Asset = Create(Candidate, Package, FName(*AssetName));
+			return Asset && SavePackage(Package, Asset) ? Asset : nullptr;
+		};
+
+		auto BoneSettings = Sequences.Num() > 0 ? Sequences[0].OriginalBoneSettings : nullptr;
+		if (!Candidate.BoneCodecClass.IsEmpty())
+		{
+			BoneSettings = Cast<UAnimBoneCompressionSettings>(CreateAsset(TEXT("ABC"), &CreateBoneSettings));
+			if (!BoneSettings) return false;
+		}
+
+		auto CurveSettings = Sequences.Num() > 0 ? Sequences[0].OriginalCurveSettings : nullptr;
+		if (!Candidate.CurveCodecClass.IsEmpty())
+		{
+			CurveSettings = Cast<UAnimCurveCompressionSettings>(CreateAsset(TEXT("ACC"), &CreateCurveSettings));
+			if (!CurveSettings) return false;
+		}
+
+		bool Saved = true;
+		for (const auto& Data : Sequences)
+		{
+			Recompress(Data.Sequence,
+			           Candidate.BoneCodecClass.IsEmpty() ? Data.OriginalBoneSettings : BoneSettings,
+			           Candidate.CurveCodecClass.IsEmpty() ? Data.OriginalCurveSettings : CurveSettings);
+			Data.Sequence->MarkPackageDirty();
+			Saved &= SavePackage(Data.Sequence->GetPackage(), Data.Sequence);
+		}
+		return Saved;
+	}
+
+	FString WriteReport(const TArray<FCandidateResult>& Results, const TArray<FSequenceData>& Sequences,
+	                    const FString& Path, float MaxErrorCm, float MaxCurveError)
+	{
+		const FCandidateResult* Current = Results.FindByPredicate([](const FCandidateResult& Result)
+		{
+			return Result.Candidate->BoneCodecClass.IsEmpty() && Result.Candidate->CurveCodecClass.IsEmpty();
+		});
+
+		FString Report = FString::Printf(
+			TEXT("Animation compression audit of %d sequences under %s, limits %.3f cm and %.4f on %s curves\n\n"),
+			Sequences.Num(), *Path, MaxErrorCm, MaxCurveError, MoveDataCurvePrefix);
+		Report += TEXT("Rank Candidate            Size KB  vs current  us/sample  max error cm  worst sequence, bone")
+			TEXT("                    max curve error  worst sequence, curve\n");
+
+		int32 Rank = 0;
+		for (const auto& Result : Results)
+		{
+			const auto SizeChange = Current && Current->Total.CompressedBytes > 0
+				                        ? 100.0 * (Result.Total.CompressedBytes - Current->Total.CompressedBytes) /
+				                        Current->Total.CompressedBytes
+				                        : 0.0;
+			const auto WorstError = Result.WorstErrorSequence != INDEX_NONE
+				                        ? FString::Printf(TEXT("%s, %s"),
+				                                          *Sequences[Result.WorstErrorSequence].Sequence->GetName(),
+				                                          *Result.Total.WorstEffector.ToString())
+				                        : FString();
+			const auto WorstCurve = Result.WorstCurveSequence != INDEX_NONE
+				                        ? FString::Printf(TEXT("%s, %s"),
+				                                          *Sequences[Result.WorstCurveSequence].Sequence->GetName(),
+				                                          *Result.Total.WorstCurve.ToString())
+				                        : FString();
+
+			Report += FString::Printf(TEXT("%4s %-20s %8.1f %+10.1f%% %10.2f %13.4f  %-40s %15.5f  %s\n"),
+			                          Result.Passes ? *FString::FromInt(++Rank) : TEXT("-"),
+			                          *Result.Candidate->Name, Result.Total.CompressedBytes / 1024.0, SizeChange,
+			                          Result.GetMicrosecondsPerSample(), Result.Total.MaxErrorCm, *WorstError,
+			                          Result.Total.MaxCurveError, *WorstCurve);
+		}
+
+		Report += TEXT("\nCandidates\n");
+		for (const auto& Result : Results)
+		{
+			const auto& Candidate = *Result.Candidate;
+			const TCHAR* Unchanged = TEXT("unchanged");
+			const auto BoneCodec = Candidate.BoneCodecClass.IsEmpty() ? Unchanged : *Candidate.BoneCodecClass;
+			const auto CurveCodec = Candidate.CurveCodecClass.IsEmpty() ? Unchanged : *Candidate.CurveCodecClass;
+			Report += FString::Printf(TEXT("  %-20s bones: %s %s  curves: %s %s\n"), *Candidate.Name, BoneCodec,
+			                          *Candidate.BoneCodecProperties, CurveCodec, *Candidate.CurveCodecProperties);
+		}
+
+		// Where the best candidate spends its bytes and its error
+		if (Results.Num() > 0 && Results[0].Passes)
+		{
+			const auto& Best = Results[0];
+			Report += FString::Printf(TEXT("\nSequences with %s\n"), *Best.Candidate->Name);
+			for (int32 Index = 0; Index < Sequences.Num(); ++Index)
+			{
+				const auto& Measurement = Best.Sequences[Index];
+				Report += FString::Printf(TEXT("  %-32s %8.1f KB %8.4f cm %-10s %8.5f %s\n"),
+				                          *Sequences[Index].Sequence->GetName(), Measurement.CompressedBytes / 1024.0,
+				                          Measurement.MaxErrorCm, *Measurement.WorstEffector.ToString(),
+				                          Measurement.MaxCurveError, *Measurement.WorstCurve.ToString());
+			}
+		}
+
+		return Report;
+	}
+}
+#endif
+
+UAnimCompressionAuditCommandlet::UAnimCompressionAuditCommandlet()
+{
+	IsClient = false;
+	IsServer = false;
+	IsEditor = true;
+	LogToConsole = true;
+}
+
+int32 UAnimCompressionAuditCommandlet::Main(const FString& Params)
+{
+#if WITH_EDITOR
+	using namespace AnimCompressionAudit;
+
+	FString Path = TEXT("/Game/DaysGun/Animations/Character");
+	FParse::Value(*Params, TEXT("Path="), Path);
+
+	FString EffectorList = TEXT("foot_l,foot_r,hand_l,hand_r");
+	FParse::Value(*Params, TEXT("Effectors="), EffectorList, false);
+	TArray<FString> EffectorNames;
+	EffectorList.ParseIntoArray(EffectorNames, TEXT(","));
+
+	float MaxErrorCm = 0.1f;
+	float MaxCurveError = 0.01f;
+	FParse::Value(*Params, TEXT("MaxErrorCm="), MaxErrorCm);
+	FParse::Value(*Params, TEXT("MaxCurveError="), MaxCurveError);
+
+	auto Candidates = GetDefaultCandidates();
+	TArray<FString> Tokens;
+	TArray<FString> Switches;
+	ParseCommandLine(*Params, Tokens, Switches);
+	for (const auto& Switch : Switches)
+	{
+		const FString Prefix = TEXT("Candidate=");
+		if (!Switch.StartsWith(Prefix)) continue;
+
+		const auto Value = Switch.RightChop(Prefix.Len()).TrimQuotes();
+		FCandidate Candidate;
+		if (!ParseCandidate(Value, Candidate))
+		{
+			UE_LOG(LogDaysGun, Error, TEXT("AnimCompressionAudit: -Candidate expects ")
+			       TEXT("Name;BoneCodecClass;Properties;CurveCodecClass;Properties, got %s"), *Value);
+			return 1;
+		}
+		Candidates.Add(Candidate);
+	}
+
+	// The current settings stay in as the baseline sizes are compared against
+	FString Only;
+	if (FParse::Value(*Params, TEXT("Only="), Only, false))
+	{
+		TArray<FString> Names;
+		Only.ParseIntoArray(Names, TEXT(","));
+		Candidates.RemoveAll([&Names](const FCandidate& Candidate)
+		{
+			return Candidate.Name != TEXT("Current") && !Names.Contains(Candidate.Name);
+		});
+	}
+
+	auto& AssetRegistry = IAssetRegistry::GetChecked();
+	AssetRegistry.SearchAllAssets(true);
+
+	FARFilter Filter;
+	Filter.PackagePaths.Add(*Path);
+	Filter.ClassPaths.Add(UAnimSequence::StaticClass()->GetClassPathName());
+	Filter.bRecursivePaths = true;
+	TArray<FAssetData> Assets;
+	AssetRegistry.GetAssets(Filter, Assets);
+	Assets.Sort([](const FAssetData& A, const FAssetData& B) { return A.PackageName.LexicalLess(B.PackageName); });
+
+	TArray<FSequenceData> Sequences;
+	Sequences.Reserve(Assets.Num());
+	for (const auto& Asset : Assets)
+	{
+		if (const auto Sequence = Cast<UAnimSequence>(Asset.GetAsset()))
+		{
+			if (!PrepareSequence(Sequence, EffectorNames, Sequences.AddDefaulted_GetRef()))
+			{
+				Sequences.Pop();
+			}
+		}
+	}
+
+	if (Sequences.Num() == 0)
+	{
+		UE_LOG(LogDaysGun, Error, TEXT("AnimCompressionAudit: no animation sequences under %s"), *Path);
+		return 1;
+	}
+	UE_LOG(LogDaysGun, Display, TEXT("AnimCompressionAudit: %d sequences, %d candidates"), Sequences.Num(),
+	       Candidates.Num());
+
+	TArray<FCandidateResult> Results;
+	for (const auto& Candidate : Candidates)
+	{
+		const auto Outer = GetTransientPackage();
+		const auto BoneSettings = Candidate.BoneCodecClass.IsEmpty()
+			                          ? nullptr
+			                          : CreateBoneSettings(Candidate, Outer, MakeUniqueObjectName(
+				                                               Outer, UAnimBoneCompressionSettings::StaticClass()));
+		const auto CurveSettings = Candidate.CurveCodecClass.IsEmpty()
+			                           ? nullptr
+			                           : CreateCurveSettings(Candidate, Outer, MakeUniqueObjectName(
+				                                                 Outer, UAnimCurveCompressionSettings::StaticClass()));
+		if ((!Candidate.BoneCodecClass.IsEmpty() && !BoneSettings) ||
+			(!Candidate.CurveCodecClass.IsEmpty() && !CurveSettings))
+		{
+			continue;
+		}
+
+		auto& Result = Results.AddDefaulted_GetRef();
+		Result.Candidate = &Candidate;
+
+		for (int32 Index = 0; Index < Sequences.Num(); ++Index)
+		{
+			const auto& Data = Sequences[Index];
+			Recompress(Data.Sequence, BoneSettings ? BoneSettings : Data.OriginalBoneSettings,
+			           CurveSettings ? CurveSettings : Data.OriginalCurveSettings);
+
+			const auto Measurement = Measure(Data);
+			Result.Sequences.Add(Measurement);
+			Result.Total.CompressedBytes += Measurement.CompressedBytes;
+			Result.Total.DecompressCycles += Measurement.DecompressCycles;
+			Result.Total.NumSamples += Measurement.NumSamples;
+
+			if (Measurement.MaxErrorCm > Result.Total.MaxErrorCm || Result.WorstErrorSequence == INDEX_NONE)
+			{
+				Result.Total.MaxErrorCm = Measurement.MaxErrorCm;
+				Result.Total.WorstEffector = Measurement.WorstEffector;
+				Result.WorstErrorSequence = Index;
+			}
+			if (Measurement.MaxCurveError > Result.Total.MaxCurveError || Result.WorstCurveSequence == INDEX_NONE)
+			{
+				Result.Total.MaxCurveError = Measurement.MaxCurveError;
+				Result.Total.WorstCurve = Measurement.WorstCurve;
+				Result.WorstCurveSequence = Index;
+			}
+		}
+
+		Result.Passes = Result.Total.MaxErrorCm <= MaxErrorCm && Result.Total.MaxCurveError <= MaxCurveError;
+		UE_LOG(LogDaysGun, Display, TEXT("AnimCompressionAudit: %-20s %8.1f KB, %.4f cm, curves %.5f"),
+		       *Candidate.Name, Result.Total.CompressedBytes / 1024.0, Result.Total.MaxErrorCm,
+		       Result.Total.MaxCurveError);
+	}
+
+	// Back to what the sequences were saved with, the candidates above only lived in memory
+	for (const auto& Data : Sequences)
+	{
+		Recompress(Data.Sequence, Data.OriginalBoneSettings, Data.OriginalCurveSettings);
+	}
+
+	// Smallest within the limits first, then the rest by error
+	Results.Sort([](const FCandidateResult& A, const FCandidateResult& B)
+	{
+		if (A.Passes != B.Passes) return A.Passes;
+		return A.Passes ? A.Total.CompressedBytes < B.Total.CompressedBytes : A.Total.MaxErrorCm < B.Total.MaxErrorCm;
+	});
+
+	const auto Report = WriteReport(Results, Sequences, Path, MaxErrorCm, MaxCurveError);
+	UE_LOG(LogDaysGun, Display, TEXT("%s"), *Report);
+
+	FString OutPath;
+	if (!FParse::Value(*Params, TEXT("Out="), OutPath))
+	{
+		OutPath = FPaths::ProjectSavedDir() / TEXT("AnimCompressionAudit") /
+			FString::Printf(TEXT("AnimCompressionAudit-%s.txt"), *FDateTime::Now().ToString());
+	}
+	if (!FFileHelper::SaveStringToFile(Report, *OutPath))
+	{
+		UE_LOG(LogDaysGun, Error, TEXT("AnimCompressionAudit: can't write %s"), *OutPath);
+		return 1;
+	}
+	UE_LOG(LogDaysGun, Display, TEXT("AnimCompressionAudit: wrote %s"), *OutPath);
+
+	FString ApplyName;
+	if (FParse::Value(*Params, TEXT("Apply="), ApplyName))
+	{
+		const auto Candidate = Candidates.FindByPredicate([&ApplyName](const FCandidate& Candidate)
+		{
+			return Candidate.Name == ApplyName;
+		});
+		if (!Candidate)
+		{
+			UE_LOG(LogDaysGun, Error, TEXT("AnimCompressionAudit: no candidate named %s"), *ApplyName);
+			return 1;
+		}
+
+		FString SettingsPath = TEXT("/Game/DaysGun/Animations/Compression");
+		FParse::Value(*Params, TEXT("SettingsPath="), SettingsPath);
+		if (!ApplyCandidate(*Candidate, Sequences, SettingsPath))
+		{
+			UE_LOG(LogDaysGun, Error, TEXT("AnimCompressionAudit: applying %s failed"), *ApplyName);
+			return 1;
+		}
+		UE_LOG(LogDaysGun, Display, TEXT("AnimCompressionAudit: applied %s to %d sequences"), *ApplyName,
+		       Sequences.Num());
+	}
+
+	return 0;
+#else
+	UE_LOG(LogDaysGun, Error, TEXT("AnimCompressionAudit: needs an editor build"));
+	return 1;
+#endif
+}
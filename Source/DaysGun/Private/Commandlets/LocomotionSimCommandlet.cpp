@@ -0,0 +1,808 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "Commandlets/LocomotionSimCommandlet.h"
+
+#include "Async/ParallelFor.h"
+#include "DaysGun.h"
+#include "Dom/JsonObject.h"
+#include "HAL/PlatformTime.h"
+#include "Locomotion/GaitProfileSet.h"
+#include "Locomotion/LocomotionDecisionCore.h"
+#include "Locomotion/LocomotionTrajectory.h"
+#include "Math/DaysGunMath.h"
+#include "Misc/FileHelper.h"
+#include "Misc/Paths.h"
+#include "Serialization/JsonSerializer.h"
+
+namespace LocomotionSim
+{
+	constexpr int32 NumStates = static_cast<int32>(ELocomotionState::ELS_Jump) + 1;
+	constexpr int32 NumClips = static_cast<int32>(ELocomotionClip::ELC_RunStop) + 1;
+
+	struct FTunableParam
+	{
+		const TCHAR* Name;
+		float FLocomotionDecisionParams::* Member;
+	};
+
+	const FTunableParam TunableParams[] = {
+		{TEXT("MinTimeInLocomotionState"), &FLocomotionDecisionParams::MinTimeInLocomotionState},
+		{TEXT("MinTimeGaitTransitionAnim"), &FLocomotionDecisionParams::MinTimeGaitTransitionAnim},
+		{TEXT("RunMinCurrentSpeed"), &FLocomotionDecisionParams::RunMinCurrentSpeed},
+		{TEXT("RunMinMaxSpeed"), &FLocomotionDecisionParams::RunMinMaxSpeed},
+		{TEXT("RunMinInputAcceleration"), &FLocomotionDecisionParams::RunMinInputAcceleration},
+		{TEXT("WalkMinCurrentSpeed"), &FLocomotionDecisionParams::WalkMinCurrentSpeed},
+		{TEXT("WalkMinMaxSpeed"), &FLocomotionDecisionParams::WalkMinMaxSpeed},
+		{TEXT("WalkMinInputAcceleration"), &FLocomotionDecisionParams::WalkMinInputAcceleration},
+		{TEXT("MaxSpeedForPlayingStartAnim"), &FLocomotionDecisionParams::MaxSpeedForPlayingStartAnim},
+		{TEXT("RunStopSpeedLimit"), &FLocomotionDecisionParams::RunStopSpeedLimit},
+		{TEXT("MoveDataLeftFootPhaseLimit"), &FLocomotionDecisionParams::MoveDataLeftFootPhaseLimit},
+		{TEXT("StartAngleInputMinSpeed"), &FLocomotionDecisionParams::StartAngleInputMinSpeed},
+		{TEXT("TrajectoryRateWindow"), &FLocomotionDecisionParams::TrajectoryRateWindow},
+		{TEXT("StartPredictionSeconds"), &FLocomotionDecisionParams::StartPredictionSeconds},
+		{TEXT("RotationRateInputRange"), &FLocomotionDecisionParams::RotationRateInputRange},
+		{TEXT("ConstRotationRateMin"), &FLocomotionDecisionParams::ConstRotationRateMin},
+		{TEXT("ConstRotationRateMax"), &FLocomotionDecisionParams::ConstRotationRateMax},
+		{TEXT("SmoothRotationRateMin"), &FLocomotionDecisionParams::SmoothRotationRateMin},
+		{TEXT("SmoothRotationRateMax"), &FLocomotionDecisionParams::SmoothRotationRateMax},
+	};
+
+	float* FindParam(FLocomotionDecisionParams& Params, const FString& Name)
+	{
+		for (const auto& Tunable : TunableParams)
+		{
+			if (Name.Equals(Tunable.Name, ESearchCase::IgnoreCase))
+			{
+				return &(Params.*Tunable.Member);
+			}
+		}
+		return nullptr;
+	}
+
+	struct FInputKey
+	{
+		float Time = 0.f;
+		FVector2f Input = FVector2f::ZeroVector;
+		bool Sprint = false;
+	};
+
+	struct FScenario
+	{
+		FString Name;
+		float Duration = 0.f;
+
+		/** Sorted by time, each key holds until the next one */
+		TArray<FInputKey> Keys;
+
+		void AddSegment(float SegmentDuration, float InputYaw, float InputSize, bool Sprint)
+		{
+			FInputKey Key;
+			Key.Time = Duration;
+			Key.Input = FVector2f(FMath::Cos(FMath::DegreesToRadians(InputYaw)),
+			                      FMath::Sin(FMath::DegreesToRadians(InputYaw))) * InputSize;
+			Key.Sprint = Sprint;
+			Keys.Add(Key);
+			Duration += SegmentDuration;
+		}
+
+		void AddIdle(float SegmentDuration)
+		{
+			AddSegment(SegmentDuration, 0.f, 0.f, false);
+		}
+	};
+
+	struct FSimSettings
+	{
+		float StepRate = 60.f;
+		int32 Runs = 1;
+
+		/** Random input jitter per run, in input units, so repeated runs explore nearby inputs */
+		float Noise = 0.f;
+
+		/** Distance covered by one full foot phase cycle */
+		float StrideLength = 150.f;
+
+		/** How long a walk start clip counts as playing for the run entry decision */
+		float StartClipDuration = 0.5f;
+
+		float InputVectorRotationRateInterpSpeed = 10.f;
+		float GroundFriction = 8.f;
+
+		EGait DefaultGait = EGait::EG_Walk;
+		EGait SprintGait = EGait::EG_Run;
+
+		bool AllSteps = false;
+	};
+
+	struct FJob
+	{
+		const FScenario* Scenario = nullptr;
+		FLocomotionDecisionParams Params;
+		FString SweepName;
+		float SweepValue = 0.f;
+		int32 Seed = 0;
+	};
+
+	struct FEvent
+	{
+		float Time = 0.f;
+		const TCHAR* Kind = TEXT("");
+		ELocomotionState State = ELocomotionState::ELS_Idle;
+		ELocomotionState PrevState = ELocomotionState::ELS_Idle;
+		ELocomotionClip Clip = ELocomotionClip::ELC_None;
+		float GroundSpeed = 0.f;
+		float StartAngle = 0.f;
+	};
+
+	struct FRunResult
+	{
+		TArray<FEvent> Events;
+		int32 StateEntries[NumStates] = {};
+		float TimeInState[NumStates] = {};
+		int32 ClipCounts[NumClips] = {};
+		int32 Steps = 0;
+	};
+
+	/** Character stand-in: a point mass moved like the walking movement mode, steering like the anim instance */
+	class FSimCharacter : public ILocomotionDecisionQueries
+	{
+	public:
+		FSimCharacter(const FSimSettings& InSettings, const UGaitProfileSet& InGaitProfiles)
+			: Settings(InSettings), GaitProfiles(InGaitProfiles)
+		{
+		}
+
+		FRunResult Run(const FJob& Job)
+		{
+			FRunResult Result;
+			FRandomStream Random(Job.Seed);
+
+			const auto DeltaSeconds = 1.f / FMath::Max(Settings.StepRate, 1.f);
+			const auto NumSteps = FMath::CeilToInt32(Job.Scenario->Duration / DeltaSeconds);
+			Result.Steps = NumSteps;
+
+			SetGait(Settings.DefaultGait, true);
+
+			int32 KeyIndex = 0;
+			const auto& Keys = Job.Scenario->Keys;
+
+			// The first run of every job set is noiseless so it can serve as the reference
+			const auto Noise = Job.Seed > 0 ? Settings.Noise : 0.f;
+			FVector2f Jitter = FVector2f::ZeroVector;
+
+			for (int32 Step = 0; Step < NumSteps; ++Step)
+			{
+				const auto Time = Step * DeltaSeconds;
+				while (KeyIndex + 1 < Keys.Num() && Keys[KeyIndex + 1].Time <= Time)
+				{
+					++KeyIndex;
+					Jitter = FVector2f(Random.FRandRange(-Noise, Noise), Random.FRandRange(-Noise, Noise));
+				}
+
+				const auto& Key = Keys.IsValidIndex(KeyIndex) ? Keys[KeyIndex] : FInputKey();
+				auto Input = Key.Input;
+				if (!Input.IsNearlyZero())
+				{
+					Input = (Input + Jitter).GetClampedToMaxSize(1.f);
+				}
+
+				SetGait(Key.Sprint ? Settings.SprintGait : Settings.DefaultGait, false);
+				UpdateGaitBlend(DeltaSeconds);
+				UpdateMovement(Input, DeltaSeconds);
+				Trajectory.AddSample(FVector(Position.X, Position.Y, 0.f), FVector(Velocity.X, Velocity.Y, 0.f),
+				                     FVector(Input.X, Input.Y, 0.f), ActorYaw, DeltaSeconds);
+				UpdateInputRotationRate(Input, DeltaSeconds, Job.Params.TrajectoryRateWindow);
+
+				FLocomotionDecisionInput DecisionInput;
+				DecisionInput.DeltaSeconds = DeltaSeconds;
+				DecisionInput.GroundSpeed = Velocity.Size();
+				DecisionInput.MaxSpeed = MaxSpeed;
+				DecisionInput.InputSize = Input.Size();
+				DecisionInput.VelocityAccelerationDot = FVector2f::DotProduct(
+					Velocity.GetSafeNormal(), Input.GetSafeNormal());
+				DecisionInput.ActorYaw = ActorYaw;
+				DecisionInput.InputYaw = YawOf(Input);
+				DecisionInput.VelocityYaw = YawOf(Velocity);
+
+				const auto Events = Core.Step(DecisionInput, Job.Params, *this);
+				Record(Result, Events, Time, DecisionInput.GroundSpeed);
+
+				if (EnumHasAnyFlags(Events, ELocomotionDecisionEvents::StartSelected))
+				{
+					TargetYaw = FDaysGunMath::NormalizeYaw(ActorYaw + Core.GetStartAngle());
+				}
+
+				UpdateActorRotation(DeltaSeconds, Job.Params);
+				Result.TimeInState[static_cast<int32>(Core.GetLocomotionState())] += DeltaSeconds;
+			}
+
+			return Result;
+		}
+
+		//~ Begin ILocomotionDecisionQueries
+		virtual bool IsInWalkStartState() override
+		{
+			return WalkStartPlaying && Core.GetTimeInLocomotionState() < Settings.StartClipDuration;
+		}
+
+		virtual float GetFootPhase() override
+		{
+			return FootPhase;
+		}
+
+		virtual bool GetPredictedHeading(float Seconds, float& OutYaw) override
+		{
+			FTrajectoryMovementModel Model;
+			Model.MaxSpeed = MaxSpeed;
+			Model.MaxAcceleration = MaxAcceleration;
+			Model.BrakingDeceleration = Braking;
+			Model.GroundFriction = Settings.GroundFriction;
+			return Trajectory.PredictHeading(Model, Seconds, OutYaw);
+		}
+
+		virtual float GetAverageGroundSpeed(float Window) override
+		{
+			return Trajectory.GetAverageVelocity(Window).Size2D();
+		}
+		//~ End ILocomotionDecisionQueries
+
+	private:
+		static float YawOf(const FVector2f& Vector)
+		{
+			return Vector.IsNearlyZero() ? 0.f : FDaysGunMath::YawFromVector(Vector);
+		}
+
+		void SetGait(EGait NewGait, bool Snap)
+		{
+			if (!Snap && NewGait == Gait) return;
+
+			Gait = NewGait;
+			Target = &GaitProfiles.GetRuntimeProfile(Gait);
+			BlendElapsed = 0.f;
+
+			if (Snap)
+			{
+				MaxSpeed = FromSpeed = Target->MaxSpeed;
+				MaxAcceleration = FromAcceleration = Target->MaxAcceleration;
+				Braking = FromBraking = Target->BrakingDeceleration;
+			}
+			else
+			{
+				FromSpeed = MaxSpeed;
+				FromAcceleration = MaxAcceleration;
+				FromBraking = Braking;
+			}
+		}
+
+		void UpdateGaitBlend(float DeltaSeconds)
+		{
+			BlendElapsed += DeltaSeconds;
+			const auto Alpha = Target->BlendDuration > 0.f ? BlendElapsed / Target->BlendDuration : 1.f;
+
+			// Snapped at the end like UGaitBlendSubsystem, so the run state's min speed is reached exactly
+			if (Alpha >= 1.f)
+			{
+				MaxSpeed = Target->MaxSpeed;
+				MaxAcceleration = Target->MaxAcceleration;
+				Braking = Target->BrakingDeceleration;
+				return;
+			}
+
+			MaxSpeed = FMath::Lerp(FromSpeed, Target->MaxSpeed, Target->SpeedLUT.Evaluate(Alpha));
+			MaxAcceleration = FMath::Lerp(FromAcceleration, Target->MaxAcceleration,
+			                              Target->AccelerationLUT.Evaluate(Alpha));
+			Braking = FMath::Lerp(FromBraking, Target->BrakingDeceleration, Target->BrakingLUT.Evaluate(Alpha));
+		}
+
+		void UpdateMovement(const FVector2f& Input, float DeltaSeconds)
+		{
+			if (!Input.IsNearlyZero())
+			{
+				// Friction bends the velocity towards the input direction, as the walking movement mode does
+				const auto Speed = Velocity.Size();
+				Velocity -= (Velocity - Input.GetSafeNormal() * Speed) * FMath::Min(DeltaSeconds * Settings.GroundFriction, 1.f);
+				Velocity += Input * MaxAcceleration * DeltaSeconds;
+				Velocity = Velocity.GetClampedToMaxSize(MaxSpeed * Input.Size());
+			}
+			else
+			{
+				const auto Speed = Velocity.Size();
+				const auto NewSpeed = FMath::Max(Speed - Braking * DeltaSeconds, 0.f);
+				Velocity = Speed > 0.f ? Velocity * (NewSpeed / Speed) : FVector2f::ZeroVector;
+			}
+
+			Position += Velocity * DeltaSeconds;
+			FootPhase = FMath::Frac(FootPhase + Velocity.Size() * DeltaSeconds / Settings.StrideLength);
+		}
+
+		void UpdateInputRotationRate(const FVector2f& Input, float DeltaSeconds, float Window)
+		{
+			if (Input.IsNearlyZero())
+			{
+				InputRotationRate = 0.f;
+				return;
+			}
+
+			const auto RateTarget = Trajectory.GetInputYawRate(Window);
+			InputRotationRate = FMath::FInterpTo(InputRotationRate, RateTarget, DeltaSeconds,
+			                                     Settings.InputVectorRotationRateInterpSpeed);
+		}
+
+		void UpdateActorRotation(float DeltaSeconds, const FLocomotionDecisionParams& Params)
+		{
+			if (Velocity.IsNearlyZero()) return;
+
+			FLocomotionDecisionCore::AdvanceTargetYaw(YawOf(Velocity), InputRotationRate, DeltaSeconds, Params,
+			                                          TargetYaw, ActorYaw);
+		}
+
+		void Record(FRunResult& Result, ELocomotionDecisionEvents Events, float Time, float GroundSpeed)
+		{
+			const auto AddEvent = [&](const TCHAR* Kind, ELocomotionClip Clip)
+			{
+				auto& Event = Result.Events.AddDefaulted_GetRef();
+				Event.Time = Time;
+				Event.Kind = Kind;
+				Event.State = Core.GetLocomotionState();
+				Event.PrevState = Core.GetPrevLocomotionState();
+				Event.Clip = Clip;
+				Event.GroundSpeed = GroundSpeed;
+				Event.StartAngle = Core.GetStartAngle();
+
+				if (Clip != ELocomotionClip::ELC_None)
+				{
+					++Result.ClipCounts[static_cast<int32>(Clip)];
+				}
+			};
+
+			if (EnumHasAnyFlags(Events, ELocomotionDecisionEvents::StateEntered))
+			{
+				WalkStartPlaying = false;
+				++Result.StateEntries[static_cast<int32>(Core.GetLocomotionState())];
+				AddEvent(TEXT("State"), ELocomotionClip::ELC_None);
+			}
+
+			if (EnumHasAnyFlags(Events, ELocomotionDecisionEvents::StopSelected))
+			{
+				AddEvent(TEXT("Stop"), Core.GetStopClip());
+			}
+
+			if (EnumHasAnyFlags(Events, ELocomotionDecisionEvents::StartSelected))
+			{
+				WalkStartPlaying = Core.GetLocomotionState() == ELocomotionState::ELS_Walk;
+				AddEvent(TEXT("Start"), Core.GetStartClip());
+			}
+
+			// The core's foot phase threshold pick, the anim instance may swap it for a UGaitTransitionEntryTable entry
+			if (EnumHasAnyFlags(Events, ELocomotionDecisionEvents::GaitTransitionSelected))
+			{
+				AddEvent(TEXT("Transition"), Core.GetGaitTransitionClip());
+			}
+
+			if (Settings.AllSteps && Events == ELocomotionDecisionEvents::None)
+			{
+				AddEvent(TEXT("Step"), ELocomotionClip::ELC_None);
+			}
+		}
+
+	private:
+		const FSimSettings& Settings;
+		const UGaitProfileSet& GaitProfiles;
+
+		FLocomotionDecisionCore Core;
+
+		EGait Gait = EGait::EG_Walk;
+		const FGaitRuntimeProfile* Target = nullptr;
+		float BlendElapsed = 0.f;
+		float FromSpeed = 0.f;
+		float FromAcceleration = 0.f;
+		float FromBraking = 0.f;
+
+		float MaxSpeed = 0.f;
+		float MaxAcceleration = 0.f;
+		float Braking = 0.f;
+
+		FLocomotionTrajectory Trajectory;
+		FVector2f Position = FVector2f::ZeroVector;
+		FVector2f Velocity = FVector2f::ZeroVector;
+		float InputRotationRate = 0.f;
+		float ActorYaw = 0.f;
+		float TargetYaw = 0.f;
+		float FootPhase = 0.f;
+		bool WalkStartPlaying = false;
+	};
+
+	TArray<FScenario> MakeBuiltInScenarios()
+	{
+		TArray<FScenario> Scenarios;
+
+		auto& StartStop = Scenarios.AddDefaulted_GetRef();
+		StartStop.Name = TEXT("StartStop");
+		StartStop.AddIdle(0.5f);
+		StartStop.AddSegment(3.f, 0.f, 1.f, false);
+		StartStop.AddIdle(2.f);
+		StartStop.AddSegment(3.f, 0.f, 1.f, true);
+		StartStop.AddIdle(2.f);
+		StartStop.AddSegment(0.3f, 0.f, 1.f, false);
+		StartStop.AddIdle(2.f);
+
+		// Every start clip: each start direction is measured from where the previous move left the actor facing
+		auto& Turns = Scenarios.AddDefaulted_GetRef();
+		Turns.Name = TEXT("Turns");
+		float Yaw = 0.f;
+		for (const auto TurnAngle : {0.f, 90.f, -90.f, 170.f, -170.f, 60.f, -120.f})
+		{
+			Yaw += TurnAngle;
+			Turns.AddIdle(1.f);
+			Turns.AddSegment(2.f, Yaw, 1.f, false);
+			Turns.AddIdle(1.f);
+			Turns.AddSegment(2.f, Yaw + TurnAngle, 1.f, true);
+			Yaw += TurnAngle;
+		}
+		Turns.AddIdle(1.5f);
+
+		auto& GaitToggle = Scenarios.AddDefaulted_GetRef();
+		GaitToggle.Name = TEXT("GaitToggle");
+		GaitToggle.AddIdle(0.5f);
+		GaitToggle.AddSegment(0.3f, 0.f, 1.f, false);
+		GaitToggle.AddSegment(2.5f, 0.f, 1.f, true);
+		GaitToggle.AddSegment(2.5f, 0.f, 1.f, false);
+		GaitToggle.AddSegment(0.6f, 0.f, 1.f, true);
+		GaitToggle.AddSegment(0.6f, 0.f, 1.f, false);
+		GaitToggle.AddSegment(3.f, 0.f, 1.f, true);
+		GaitToggle.AddSegment(3.f, 0.f, 0.4f, true);
+		GaitToggle.AddIdle(2.f);
+
+		auto& Zigzag = Scenarios.AddDefaulted_GetRef();
+		Zigzag.Name = TEXT("Zigzag");
+		Zigzag.AddIdle(0.5f);
+		for (int32 Index = 0; Index < 12; ++Index)
+		{
+			Zigzag.AddSegment(0.75f, Index % 2 ? -60.f : 60.f, 1.f, Index >= 6);
+		}
+		Zigzag.AddIdle(2.f);
+
+		auto& Reverse = Scenarios.AddDefaulted_GetRef();
+		Reverse.Name = TEXT("Reverse");
+		Reverse.AddIdle(0.5f);
+		Reverse.AddSegment(2.f, 0.f, 1.f, true);
+		Reverse.AddSegment(2.f, 180.f, 1.f, true);
+		Reverse.AddSegment(2.f, 0.f, 1.f, false);
+		Reverse.AddSegment(2.f, 180.f, 1.f, false);
+		Reverse.AddIdle(2.f);
+
+		return Scenarios;
+	}
+
+	bool LoadRecordedScenario(const FString& Path, FScenario& OutScenario)
+	{
+		TArray<FString> Lines;
+		if (!FFileHelper::LoadFileToStringArray(Lines, *Path)) return false;
+
+		OutScenario.Name = FPaths::GetBaseFilename(Path);
+		for (int32 Index = 1; Index < Lines.Num(); ++Index)
+		{
+			TArray<FString> Columns;
+			if (Lines[Index].ParseIntoArray(Columns, TEXT(",")) < 3) continue;
+
+			FInputKey Key;
+			Key.Time = FCString::Atof(*Columns[0]);
+			Key.Input = FVector2f(FCString::Atof(*Columns[1]), FCString::Atof(*Columns[2])).GetClampedToMaxSize(1.f);
+			Key.Sprint = Columns.Num() > 3 && FCString::Atoi(*Columns[3]) != 0;
+			OutScenario.Keys.Add(Key);
+		}
+
+		OutScenario.Keys.Sort([](const FInputKey& A, const FInputKey& B) { return A.Time < B.Time; });
+
+		// Hold the last recorded input for a moment so its decisions are part of the timeline
+		OutScenario.Duration = OutScenario.Keys.Num() > 0 ? OutScenario.Keys.Last().Time + 1.f : 0.f;
+		return OutScenario.Keys.Num() > 0;
+	}
+
+	FString WriteCsv(const TArray<FJob>& Jobs, const TArray<FRunResult>& Results)
+	{
+		const auto States = StaticEnum<ELocomotionState>();
+		const auto Clips = StaticEnum<ELocomotionClip>();
+
+		FString Out = TEXT("Run,Scenario,Seed,SweepParam,SweepValue,Time,Event,State,PrevState,Clip,GroundSpeed,StartAngle\n");
+		for (int32 RunIndex = 0; RunIndex < Jobs.Num(); ++RunIndex)
+		{
+			const auto& Job = Jobs[RunIndex];
+			for (const auto& Event : Results[RunIndex].Events)
+			{
+				Out += FString::Printf(TEXT("%d,%s,%d,%s,%.3f,%.4f,%s,%s,%s,%s,%.1f,%.1f\n"),
+				                       RunIndex, *Job.Scenario->Name, Job.Seed, *Job.SweepName, Job.SweepValue,
+				                       Event.Time, Event.Kind,
+				                       *States->GetNameStringByValue(static_cast<int64>(Event.State)),
+				                       *States->GetNameStringByValue(static_cast<int64>(Event.PrevState)),
+				                       *Clips->GetNameStringByValue(static_cast<int64>(Event.Clip)),
+				                       Event.GroundSpeed, Event.StartAngle);
+			}
+		}
+		return Out;
+	}
+
+	FString WriteJson(const TArray<FJob>& Jobs, const TArray<FRunResult>& Results, const FSimSettings& Settings)
+	{
+		const auto States = StaticEnum<ELocomotionState>();
+		const auto Clips = StaticEnum<ELocomotionClip>();
+
+		TArray<TSharedPtr<FJsonValue>> Runs;
+		for (int32 RunIndex = 0; RunIndex < Jobs.Num(); ++RunIndex)
+		{
+			const auto& Job = Jobs[RunIndex];
+			const auto& Result = Results[RunIndex];
+
+			const auto Run = MakeShared<FJsonObject>();
+			Run->SetStringField(TEXT("scenario"), Job.Scenario->Name);
+			Run->SetNumberField(TEXT("seed"), Job.Seed);
+			Run->SetStringField(TEXT("sweepParam"), Job.SweepName);
+			Run->SetNumberField(TEXT("sweepValue"), Job.SweepValue);
+			Run->SetNumberField(TEXT("steps"), Result.Steps);
+
+			const auto StateEntries = MakeShared<FJsonObject>();
+			const auto TimeInState = MakeShared<FJsonObject>();
+			for (int32 State = 0; State < NumStates; ++State)
+			{
+				const auto Name = States->GetNameStringByValue(State);
+				StateEntries->SetNumberField(Name, Result.StateEntries[State]);
+				TimeInState->SetNumberField(Name, Result.TimeInState[State]);
+			}
+			Run->SetObjectField(TEXT("stateEntries"), StateEntries);
+			Run->SetObjectField(TEXT("timeInState"), TimeInState);
+
+			const auto ClipCounts = MakeShared<FJsonObject>();
+			for (int32 Clip = 1; Clip < NumClips; ++Clip)
+			{
+				ClipCounts->SetNumberField(Clips->GetNameStringByValue(Clip), Result.ClipCounts[Clip]);
+			}
+			Run->SetObjectField(TEXT("clips"), ClipCounts);
+
+			TArray<TSharedPtr<FJsonValue>> Events;
+			for (const auto& Event : Result.Events)
+			{
+				const auto EventObject = MakeShared<FJsonObject>();
+				EventObject->SetNumberField(TEXT("time"), Event.Time);
+				EventObject->SetStringField(TEXT("event"), Event.Kind);
+				EventObject->SetStringField(TEXT("state"), States->GetNameStringByValue(static_cast<int64>(Event.State)));
+				EventObject->SetStringField(TEXT("prevState"), States->GetNameStringByValue(static_cast<int64>(Event.PrevState)));
+				EventObject->SetStringField(TEXT("clip"), Clips->GetNameStringByValue(static_cast<int64>(Event.Clip)));
+				EventObject->SetNumberField(TEXT("groundSpeed"), Event.GroundSpeed);
+				EventObject->SetNumberField(TEXT("startAngle"), Event.StartAngle);
+				Events.Add(MakeShared<FJsonValueObject>(EventObject));
+			}
+			Run->SetArrayField(TEXT("events"), Events);
+
+			Runs.Add(MakeShared<FJsonValueObject>(Run));
+		}
+
+		const auto Root = MakeShared<FJsonObject>();
+		Root->SetNumberField(TEXT("stepRate"), Settings.StepRate);
+		Root->SetArrayField(TEXT("runs"), Runs);
+
+		FString Out;
+		const auto Writer = TJsonWriterFactory<>::Create(&Out);
+		FJsonSerializer::Serialize(Root, Writer);
+		return Out;
+	}
+
+	/** Returns the number of differing lines, logging the first few */
+	int32 CompareWithBaseline(const FString& Output, const FString& BaselinePath)
+	{
+		FString Baseline;
+		if (!FFileHelper::LoadFileToString(Baseline, *BaselinePath))
+		{
+			UE_LOG(LogDaysGun, Error, TEXT("LocomotionSim: can't read baseline %s"), *BaselinePath);
+			return 1;
+		}
+
+		TArray<FString> OutputLines;
+		TArray<FString> BaselineLines;
+		Output.ParseIntoArrayLines(OutputLines, false);
+		Baseline.ParseIntoArrayLines(BaselineLines, false);
+
+		int32 Differences = FMath::Abs(OutputLines.Num() - BaselineLines.Num());
+		const auto NumLines = FMath::Min(OutputLines.Num(), BaselineLines.Num());
+		for (int32 Line = 0; Line < NumLines; ++Line)
+		{
+			if (OutputLines[Line] == BaselineLines[Line]) continue;
+
+			if (++Differences <= 10)
+			{
+				UE_LOG(LogDaysGun, Warning, TEXT("LocomotionSim: line %d differs\n  baseline: %s\n  current:  %s"),
+				       Line + 1, *BaselineLines[Line], *OutputLines[Line]);
+			}
+		}
+		return Differences;
+	}
+}
+
+ULocomotionSimCommandlet::ULocomotionSimCommandlet()
+{
+	IsClient = false;
+	IsServer = false;
+	IsEditor = false;
+	LogToConsole = true;
+}
+
+int32 ULocomotionSimCommandlet::Main(const FString& Params)
+{
+	using namespace LocomotionSim;
+
+	FSimSettings Settings;
+	FParse::Value(*Params, TEXT("StepRate="), Settings.StepRate);
+	FParse::Value(*Params, TEXT("Runs="), Settings.Runs);
+	FParse::Value(*Params, TEXT("Noise="), Settings.Noise);
+	FParse::Value(*Params, TEXT("StrideLength="), Settings.StrideLength);
+	FParse::Value(*Params, TEXT("StartClipDuration="), Settings.StartClipDuration);
+	Settings.AllSteps = FParse::Param(*Params, TEXT("AllSteps"));
+	Settings.Runs = FMath::Max(Settings.Runs, 1);
+
+	const UGaitProfileSet* GaitProfiles = GetDefault<UGaitProfileSet>();
+	FString GaitProfilesPath;
+	if (FParse::Value(*Params, TEXT("GaitProfiles="), GaitProfilesPath))
+	{
+		GaitProfiles = LoadObject<UGaitProfileSet>(nullptr, *GaitProfilesPath);
+		if (!GaitProfiles)
+		{
+			UE_LOG(LogDaysGun, Error, TEXT("LocomotionSim: can't load gait profiles %s"), *GaitProfilesPath);
+			return 1;
+		}
+	}
+
+	// Same derivation as the anim instance so the simulated thresholds match the game
+	FLocomotionDecisionParams BaseParams;
+	BaseParams.RunMinMaxSpeed = GaitProfiles->GetMinSpeedForState(ELocomotionState::ELS_Run);
+
+	FString Overrides;
+	if (FParse::Value(*Params, TEXT("Set="), Overrides, false))
+	{
+		TArray<FString> Pairs;
+		Overrides.ParseIntoArray(Pairs, TEXT(","));
+		for (const auto& Pair : Pairs)
+		{
+			FString Name;
+			FString Value;
+			const auto Param = Pair.Split(TEXT("="), &Name, &Value) ? FindParam(BaseParams, Name) : nullptr;
+			if (!Param)
+			{
+				UE_LOG(LogDaysGun, Error, TEXT("LocomotionSim: unknown parameter in -Set: %s"), *Pair);
+				return 1;
+			}
+			*Param = FCString::Atof(*Value);
+		}
+	}
+
+	TArray<FScenario> Scenarios;
+	FString InputPath;
+	if (FParse::Value(*Params, TEXT("Input="), InputPath))
+	{
+		auto& Recorded = Scenarios.AddDefaulted_GetRef();
+		if (!LoadRecordedScenario(InputPath, Recorded))
+		{
+			UE_LOG(LogDaysGun, Error, TEXT("LocomotionSim: can't read recorded input %s"), *InputPath);
+			return 1;
+		}
+	}
+	else
+	{
+		Scenarios = MakeBuiltInScenarios();
+
+		FString ScenarioName;
+		if (FParse::Value(*Params, TEXT("Scenario="), ScenarioName) && ScenarioName != TEXT("All"))
+		{
+			Scenarios.RemoveAll([&ScenarioName](const FScenario& Scenario)
+			{
+				return !Scenario.Name.Equals(ScenarioName, ESearchCase::IgnoreCase);
+			});
+		}
+	}
+
+	if (Scenarios.Num() == 0)
+	{
+		UE_LOG(LogDaysGun, Error, TEXT("LocomotionSim: no scenario to run"));
+		return 1;
+	}
+
+	// Sweep values, or a single unnamed value when nothing is swept
+	FString SweepName;
+	TArray<float> SweepValues = {0.f};
+	FString Sweep;
+	if (FParse::Value(*Params, TEXT("Sweep="), Sweep))
+	{
+		TArray<FString> Parts;
+		Sweep.ParseIntoArray(Parts, TEXT(":"));
+		const auto Min = Parts.Num() > 1 ? FCString::Atof(*Parts[1]) : 0.f;
+		const auto Max = Parts.Num() > 2 ? FCString::Atof(*Parts[2]) : Min;
+		const auto StepSize = Parts.Num() > 3 ? FCString::Atof(*Parts[3]) : 0.f;
+		if (Parts.Num() < 2 || !FindParam(BaseParams, Parts[0]) || Max < Min)
+		{
+			UE_LOG(LogDaysGun, Error, TEXT("LocomotionSim: -Sweep expects Name:Min:Max:Step, got %s"), *Sweep);
+			return 1;
+		}
+
+		SweepName = Parts[0];
+		SweepValues.Reset();
+		const auto NumValues = StepSize > 0.f ? FMath::FloorToInt32((Max - Min) / StepSize + KINDA_SMALL_NUMBER) + 1 : 1;
+		for (int32 Index = 0; Index < NumValues; ++Index)
+		{
+			SweepValues.Add(Min + Index * StepSize);
+		}
+	}
+
+	TArray<FJob> Jobs;
+	for (const auto& Scenario : Scenarios)
+	{
+		for (const auto SweepValue : SweepValues)
+		{
+			for (int32 Run = 0; Run < Settings.Runs; ++Run)
+			{
+				auto& Job = Jobs.AddDefaulted_GetRef();
+				Job.Scenario = &Scenario;
+				Job.Params = BaseParams;
+				Job.SweepName = SweepName;
+				Job.SweepValue = SweepValue;
+				Job.Seed = Run;
+
+				if (!SweepName.IsEmpty())
+				{
+					*FindParam(Job.Params, SweepName) = SweepValue;
+				}
+			}
+		}
+	}
+
+	TArray<FRunResult> Results;
+	Results.SetNum(Jobs.Num());
+
+	const auto StartTime = FPlatformTime::Seconds();
+	ParallelFor(Jobs.Num(), [&](int32 Index)
+	{
+		FSimCharacter Character(Settings, *GaitProfiles);
+		Results[Index] = Character.Run(Jobs[Index]);
+	});
+	const auto WallSeconds = FPlatformTime::Seconds() - StartTime;
+
+	int64 TotalSteps = 0;
+	for (const auto& Result : Results)
+	{
+		TotalSteps += Result.Steps;
+	}
+	const auto SimulatedSeconds = TotalSteps / FMath::Max(Settings.StepRate, 1.f);
+	UE_LOG(LogDaysGun, Display, TEXT("LocomotionSim: %d runs, %.0f simulated s in %.3f wall s (%.0fx real time)"),
+	       Jobs.Num(), SimulatedSeconds, WallSeconds, SimulatedSeconds / FMath::Max(WallSeconds, 1e-6));
+
+	FString Format = TEXT("Csv");
+	FParse::Value(*Params, TEXT("Format="), Format);
+	const bool Json = Format.Equals(TEXT("Json"), ESearchCase::IgnoreCase);
+	const auto Output = Json ? WriteJson(Jobs, Results, Settings) : WriteCsv(Jobs, Results);
+
+	FString OutPath;
+	if (!FParse::Value(*Params, TEXT("Out="), OutPath))
+	{
+		OutPath = FPaths::ProjectSavedDir() / TEXT("LocomotionSim") /
+			FString::Printf(TEXT("LocomotionSim-%s.%s"), *FDateTime::Now().ToString(), Json ? TEXT("json") : TEXT("csv"));
+	}
+
+	if (!FFileHelper::SaveStringToFile(Output, *OutPath))
+	{
+		UE_LOG(LogDaysGun, Error, TEXT("LocomotionSim: can't write %s"), *OutPath);
+		return 1;
+	}
+	UE_LOG(LogDaysGun, Display, TEXT("LocomotionSim: wrote %s"), *OutPath);
+
+	FString BaselinePath;
+	if (FParse::Value(*Params, TEXT("Baseline="), BaselinePath))
+	{
+		const auto Differences = CompareWithBaseline(Output, BaselinePath);
+		if (Differences > 0)
+		{
+			UE_LOG(LogDaysGun, Error, TEXT("LocomotionSim: %d lines differ from %s"), Differences, *BaselinePath);
+			return 1;
+		}
+		UE_LOG(LogDaysGun, Display, TEXT("LocomotionSim: matches %s"), *BaselinePath);
+	}
+
+	return 0;
+}
@@ -0,0 +1,36 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "Crowd/CrowdAIController.h"
+
+#include "Crowd/CrowdPathFollowingComponent.h"
+#include "Crowd/CrowdSteeringSubsystem.h"
+#include "Engine/World.h"
+#include "Player/BaseCharacter.h"
+
+ACrowdAIController::ACrowdAIController(const FObjectInitializer& ObjectInitializer)
+	: Super(ObjectInitializer.SetDefaultSubobjectClass<UCrowdPathFollowingComponent>(TEXT("PathFollowingComponent")))
+{
+}
+
+void ACrowdAIController::OnPossess(APawn* InPawn)
+{
+	Super::OnPossess(InPawn);
+
+	const auto CrowdSteering = GetWorld()->GetSubsystem<UCrowdSteeringSubsystem>();
+	if (CrowdSteering)
+	{
+		CrowdSteering->Register(Cast<ABaseCharacter>(InPawn));
+	}
+}
+
+void ACrowdAIController::OnUnPossess()
+{
+	const auto CrowdSteering = GetWorld()->GetSubsystem<UCrowdSteeringSubsystem>();
+	if (CrowdSteering)
+	{
+		CrowdSteering->Unregister(Cast<ABaseCharacter>(GetPawn()));
+	}
+
+	Super::OnUnPossess();
+}
@@ -0,0 +1,23 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "Crowd/CrowdPathFollowingComponent.h"
+
+#include "Crowd/CrowdSteeringSubsystem.h"
+#include "Engine/World.h"
+#include "GameFramework/NavMovementComponent.h"
+#include "Player/BaseCharacter.h"
+
+void UCrowdPathFollowingComponent::FollowPathSegment(float DeltaTime)
+{
+	const auto Character = MovementComp ? Cast<ABaseCharacter>(MovementComp->GetOwner()) : nullptr;
+	const auto CrowdSteering = GetWorld()->GetSubsystem<UCrowdSteeringSubsystem>();
+	if (!Path.IsValid() || !CrowdSteering || !CrowdSteering->IsAgent(Character))
+	{
+		Super::FollowPathSegment(DeltaTime);
+		return;
+	}
+
+	const auto ToTarget = GetCurrentTargetLocation() - MovementComp->GetActorFeetLocation();
+	CrowdSteering->SetDesiredMove(Character, ToTarget.GetSafeNormal2D());
+}
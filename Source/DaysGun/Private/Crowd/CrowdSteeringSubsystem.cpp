@@ -0,0 +1,426 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "Crowd/CrowdSteeringSubsystem.h"
+
+#include "DaysGun.h"
+#include "Async/ParallelFor.h"
+#include "Components/CapsuleComponent.h"
+#include "Engine/World.h"
+#include "GameFramework/CharacterMovementComponent.h"
+#include "Player/BaseCharacter.h"
+#include "Soak/SoakTestSubsystem.h"
+
+DECLARE_CYCLE_STAT(TEXT("Crowd Steering"), STAT_CrowdSteering, STATGROUP_DaysGun);
+DECLARE_CYCLE_STAT(TEXT("Crowd Steering Hash"), STAT_CrowdSteeringHash, STATGROUP_DaysGun);
+DECLARE_CYCLE_STAT(TEXT("Crowd Steering Avoidance"), STAT_CrowdSteeringAvoidance, STATGROUP_DaysGun);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Crowd Agents"), STAT_CrowdAgents, STATGROUP_DaysGun);
+
+namespace
+{
+	/** Benchmark bots cross at least this far past the center so the crowd stays dense */
+	constexpr float BenchmarkMinCrossRadius = 1500.f;
+
+	FVector2f ClampToMaxSize(const FVector2f& Vector, float MaxSize)
+	{
+		const auto SizeSquared = Vector.SizeSquared();
+		return SizeSquared > FMath::Square(MaxSize) ? Vector * (MaxSize * FMath::InvSqrt(SizeSquared)) : Vector;
+	}
+}
+
+void UCrowdSteeringSubsystem::Tick(float DeltaTime)
+{
+	if (Agents.Num() > 0)
+	{
+		SCOPE_CYCLE_COUNTER(STAT_CrowdSteering);
+		const auto StartCycles = FPlatformTime::Cycles64();
+
+		GatherAgents();
+		BuildSpatialHash();
+		SteerAgents(DeltaTime);
+		ApplySteering();
+
+		LastSteeringMs = FPlatformTime::ToMilliseconds64(FPlatformTime::Cycles64() - StartCycles);
+		SET_DWORD_STAT(STAT_CrowdAgents, Agents.Num());
+	}
+
+	if (Benchmark.IsRunning())
+	{
+		TickBenchmark(DeltaTime);
+	}
+}
+
+bool UCrowdSteeringSubsystem::IsTickable() const
+{
+	return Agents.Num() > 0 || Benchmark.IsRunning();
+}
+
+TStatId UCrowdSteeringSubsystem::GetStatId() const
+{
+	RETURN_QUICK_DECLARE_CYCLE_STAT(UCrowdSteeringSubsystem, STATGROUP_Tickables);
+}
+
+void UCrowdSteeringSubsystem::Deinitialize()
+{
+	Agents.Reset();
+	States.Reset();
+	SteeredVelocities.Reset();
+	Benchmark = FSubsystemBenchmark();
+
+	Super::Deinitialize();
+}
+
+void UCrowdSteeringSubsystem::Register(ABaseCharacter* Character)
+{
+	if (!Character || Agents.Contains(Character)) return;
+
+	FCrowdAgent Agent;
+	Agent.Character = Character;
+
+	Agents.Add(Character, Agent);
+	States.AddDefaulted();
+	SteeredVelocities.Add(FVector2f::ZeroVector);
+}
+
+void UCrowdSteeringSubsystem::Unregister(const ABaseCharacter* Character)
+{
+	const auto Index = Agents.Find(Character);
+	if (Index != INDEX_NONE)
+	{
+		RemoveAt(Index);
+	}
+}
+
+void UCrowdSteeringSubsystem::SetDesiredMove(const ABaseCharacter* Character, const FVector& Direction)
+{
+	if (const auto Agent = Agents.FindEntry(Character))
+	{
+		Agent->DesiredMove = Direction;
+	}
+}
+
+void UCrowdSteeringSubsystem::SetGoal(const ABaseCharacter* Character, const FVector& Goal, float AcceptanceRadius)
+{
+	if (const auto Agent = Agents.FindEntry(Character))
+	{
+		Agent->Goal = Goal;
+		Agent->GoalAcceptanceRadius = AcceptanceRadius;
+		Agent->HasGoal = true;
+	}
+}
+
+void UCrowdSteeringSubsystem::ClearGoal(const ABaseCharacter* Character)
+{
+	if (const auto Agent = Agents.FindEntry(Character))
+	{
+		Agent->HasGoal = false;
+	}
+}
+
+void UCrowdSteeringSubsystem::GatherAgents()
+{
+	for (int32 Index = Agents.Num() - 1; Index >= 0; --Index)
+	{
+		auto& Agent = Agents[Index];
+		const auto Character = Agent.Character.Get();
+		if (!Character)
+		{
+			RemoveAt(Index);
+			continue;
+		}
+
+		const auto Movement = Character->GetCharacterMovement();
+		const auto Location = Character->GetActorLocation();
+
+		auto& State = States[Index];
+		State.Position = FVector2f(Location.X, Location.Y);
+		State.Velocity = FVector2f(Movement->Velocity.X, Movement->Velocity.Y);
+		State.Radius = Character->GetCapsuleComponent()->GetScaledCapsuleRadius();
+		State.MaxSpeed = Movement->GetMaxSpeed();
+
+		if (Agent.HasGoal)
+		{
+			const auto ToGoal = Agent.Goal - Location;
+			Agent.HasGoal = ToGoal.SizeSquared2D() > FMath::Square(Agent.GoalAcceptanceRadius);
+			Agent.DesiredMove = Agent.HasGoal ? ToGoal.GetSafeNormal2D() : FVector::ZeroVector;
+		}
+
+		// Desired moves hold for one frame, whoever drives the agent sets them again before the next update
+		const auto Desired = ClampToMaxSize(FVector2f(Agent.DesiredMove.X, Agent.DesiredMove.Y), 1.f);
+		State.DesiredVelocity = Desired * State.MaxSpeed;
+		Agent.DesiredMove = FVector::ZeroVector;
+	}
+}
+
+void UCrowdSteeringSubsystem::BuildSpatialHash()
+{
+	SCOPE_CYCLE_COUNTER(STAT_CrowdSteeringHash);
+
+	const auto Num = States.Num();
+	NumBuckets = FMath::RoundUpToPowerOfTwo(FMath::Max(Num * 2, 64));
+
+	BucketStarts.SetNumZeroed(NumBuckets + 1);
+	AgentBuckets.SetNumUninitialized(Num);
+	SortedAgents.SetNumUninitialized(Num);
+
+	// Counting sort by bucket, agents of one bucket end up next to each other
+	for (int32 Index = 0; Index < Num; ++Index)
+	{
+		const auto Bucket = GetBucket(GetCell(States[Index].Position));
+		AgentBuckets[Index] = Bucket;
+		++BucketStarts[Bucket + 1];
+	}
+
+	for (uint32 Bucket = 1; Bucket <= NumBuckets; ++Bucket)
+	{
+		BucketStarts[Bucket] += BucketStarts[Bucket - 1];
+	}
+
+	BucketCursors = BucketStarts;
+	for (int32 Index = 0; Index < Num; ++Index)
+	{
+		SortedAgents[BucketCursors[AgentBuckets[Index]]++] = Index;
+	}
+}
+
+FVector2f UCrowdSteeringSubsystem::GetAvoidance(const FCrowdAgentState& Self, const FCrowdAgentState& Other) const
+{
+	const auto RelativePosition = Other.Position - Self.Position;
+	const auto DistanceSquared = RelativePosition.SizeSquared();
+	if (DistanceSquared > FMath::Square(NeighborRadius)) return FVector2f::ZeroVector;
+
+	const auto Distance = FMath::Sqrt(DistanceSquared);
+	const auto ContactDistance = Self.Radius + Other.Radius;
+
+	// Already overlapping, push straight apart
+	if (Distance < ContactDistance)
+	{
+		const auto Away = Distance > UE_KINDA_SMALL_NUMBER
+			                  ? -RelativePosition / Distance
+			                  : FVector2f(-Self.DesiredVelocity.Y, Self.DesiredVelocity.X).GetSafeNormal();
+		return Away * (SeparationStrength * Self.MaxSpeed * (1.f - Distance / ContactDistance));
+	}
+
+	// Closest approach if the other keeps its velocity and this agent moves as it wants to
+	const auto RelativeVelocity = Other.Velocity - Self.DesiredVelocity;
+	const auto RelativeSpeedSquared = RelativeVelocity.SizeSquared();
+	if (RelativeSpeedSquared < UE_KINDA_SMALL_NUMBER) return FVector2f::ZeroVector;
+
+	const auto Time = -FVector2f::DotProduct(RelativePosition, RelativeVelocity) / RelativeSpeedSquared;
+	if (Time <= 0.f || Time >= TimeHorizon) return FVector2f::ZeroVector;
+
+	const auto Clearance = ContactDistance + AvoidanceMargin;
+	const auto Closest = RelativePosition + RelativeVelocity * Time;
+	const auto ClosestSquared = Closest.SizeSquared();
+	if (ClosestSquared >= FMath::Square(Clearance)) return FVector2f::ZeroVector;
+
+	// Head-on, always sidestep to the right so both agents pick opposite sides
+	const auto ClosestDistance = FMath::Sqrt(ClosestSquared);
+	const auto Away = ClosestDistance > UE_KINDA_SMALL_NUMBER
+		                  ? -Closest / ClosestDistance
+		                  : FVector2f(RelativeVelocity.Y, -RelativeVelocity.X).GetSafeNormal();
+
+	const auto Urgency = (1.f - Time / TimeHorizon) * (1.f - ClosestDistance / Clearance);
+	return Away * (AvoidanceStrength * Self.MaxSpeed * Urgency);
+}
+
+void UCrowdSteeringSubsystem::SteerAgents(float DeltaTime)
+{
+	SCOPE_CYCLE_COUNTER(STAT_CrowdSteeringAvoidance);
+
+	const auto Num = States.Num();
+	const auto Alpha = 1.f - FMath::Exp(-SteeringResponse * DeltaTime);
+
+	ParallelFor(Num, [this, Alpha](int32 Index)
+	{
+		const auto& Self = States[Index];
+		auto& Steered = SteeredVelocities[Index];
+
+		if (Self.DesiredVelocity.IsNearlyZero() || Self.MaxSpeed <= 0.f)
+		{
+			Steered = FVector2f::ZeroVector;
+			return;
+		}
+
+		auto Avoidance = FVector2f::ZeroVector;
+		int32 NumNeighbors = 0;
+
+		// Neighboring cells can share a bucket, each bucket is visited once
+		const auto Cell = GetCell(Self.Position);
+		uint32 Visited[9];
+		int32 NumVisited = 0;
+
+		for (int32 Y = -1; Y <= 1 && NumNeighbors < MaxNeighbors; ++Y)
+		{
+			for (int32 X = -1; X <= 1 && NumNeighbors < MaxNeighbors; ++X)
+			{
+				const auto Bucket = GetBucket(Cell + FIntPoint(X, Y));
+				bool AlreadyVisited = false;
+				for (int32 Visit = 0; Visit < NumVisited; ++Visit)
+				{
+					AlreadyVisited |= Visited[Visit] == Bucket;
+				}
+				if (AlreadyVisited) continue;
+				Visited[NumVisited++] = Bucket;
+
+				for (int32 Slot = BucketStarts[Bucket]; Slot < BucketStarts[Bucket + 1]; ++Slot)
+				{
+					const auto Other = SortedAgents[Slot];
+					if (Other == Index) continue;
+
+					const auto Push = GetAvoidance(Self, States[Other]);
+					if (Push.IsNearlyZero()) continue;
+
+					Avoidance += Push;
+					if (++NumNeighbors >= MaxNeighbors) break;
+				}
+			}
+		}
+
+		const auto Target = ClampToMaxSize(Self.DesiredVelocity + Avoidance, Self.MaxSpeed);
+
+		// Starting from rest takes the target at once so starts are not delayed by the smoothing
+		Steered = Steered.IsNearlyZero() ? Target : Steered + (Target - Steered) * Alpha;
+	}, Num < MinAgentsForParallel ? EParallelForFlags::ForceSingleThread : EParallelForFlags::None);
+}
+
+void UCrowdSteeringSubsystem::ApplySteering()
+{
+	for (int32 Index = 0; Index < Agents.Num(); ++Index)
+	{
+		const auto& Steered = SteeredVelocities[Index];
+		const auto MaxSpeed = States[Index].MaxSpeed;
+		if (Steered.IsNearlyZero() || MaxSpeed <= 0.f) continue;
+
+		const auto Input = Steered / MaxSpeed;
+		Agents[Index].Character->AddMovementInput(FVector(Input.X, Input.Y, 0.f));
+	}
+}
+
+void UCrowdSteeringSubsystem::RemoveAt(int32 Index)
+{
+	Agents.RemoveAt(Index);
+	States.RemoveAtSwap(Index, 1, false);
+	SteeredVelocities.RemoveAtSwap(Index, 1, false);
+}
+
+void UCrowdSteeringSubsystem::StartBenchmark(const TArray<int32>& Counts, float Seconds)
+{
+	if (!FSubsystemBenchmark::GetIdleSoak(GetWorld()) || !Benchmark.Start(Counts.Num(), Seconds)) return;
+
+	BenchmarkCenter = FSubsystemBenchmark::GetCenter(GetWorld());
+	BenchmarkCounts = Counts;
+	BenchmarkSteps.Reset();
+	BeginBenchmarkStep();
+}
+
+void UCrowdSteeringSubsystem::BeginBenchmarkStep()
+{
+	const auto Soak = GetWorld()->GetSubsystem<USoakTestSubsystem>();
+	Soak->SpawnBotsAround(BenchmarkCounts[Benchmark.GetPhaseIndex()], BenchmarkCenter);
+
+	for (const auto Bot : Soak->GetBots())
+	{
+		Register(Bot);
+	}
+
+	auto& Step = BenchmarkSteps.AddDefaulted_GetRef();
+	Step.Agents = Soak->GetNumBots();
+}
+
+void UCrowdSteeringSubsystem::TickBenchmark(float DeltaTime)
+{
+	// Agents that arrived cross back through the center, so the crowd keeps meeting head-on
+	for (const auto& Agent : Agents)
+	{
+		const auto Character = Agent.Character.Get();
+		if (Agent.HasGoal || !Character) continue;
+
+		const auto FromCenter = Character->GetActorLocation() - BenchmarkCenter;
+		const auto Direction = FromCenter.IsNearlyZero() ? FVector::ForwardVector : -FromCenter.GetSafeNormal2D();
+		const auto Radius = FMath::Max(FromCenter.Size2D(), BenchmarkMinCrossRadius);
+		SetGoal(Character, BenchmarkCenter + Direction * Radius);
+	}
+
+	if (Benchmark.Tick(DeltaTime))
+	{
+		auto& Step = BenchmarkSteps.Last();
+		++Step.Frames;
+		Step.SteeringMs += LastSteeringMs;
+		Step.PeakSteeringMs = FMath::Max(Step.PeakSteeringMs, LastSteeringMs);
+		Step.FrameMs += FSubsystemBenchmark::GetFrameMs();
+	}
+
+	if (!Benchmark.IsPhaseDone()) return;
+
+	const auto Soak = GetWorld()->GetSubsystem<USoakTestSubsystem>();
+	for (const auto Bot : Soak->GetBots())
+	{
+		Unregister(Bot);
+	}
+	Soak->ReleaseBots();
+
+	if (Benchmark.NextPhase())
+	{
+		BeginBenchmarkStep();
+		return;
+	}
+
+	FinishBenchmark();
+}
+
+void UCrowdSteeringSubsystem::FinishBenchmark()
+{
+	UE_LOG(LogDaysGun, Display, TEXT("Crowd steering benchmark, %.0f s per step, parallel from %d agents:"),
+	       Benchmark.GetSeconds(), MinAgentsForParallel);
+	UE_LOG(LogDaysGun, Display, TEXT("  %6s %11s %11s %11s %9s"), TEXT("agents"), TEXT("steering"), TEXT("peak"),
+	       TEXT("per agent"), TEXT("frame"));
+
+	for (const auto& Step : BenchmarkSteps)
+	{
+		const auto Frames = FMath::Max(Step.Frames, 1);
+		const auto SteeringMs = Step.SteeringMs / Frames;
+		UE_LOG(LogDaysGun, Display, TEXT("  %6d %8.3f ms %8.3f ms %8.2f us %6.2f ms"), Step.Agents, SteeringMs,
+		       Step.PeakSteeringMs, SteeringMs * 1000.0 / FMath::Max(Step.Agents, 1), Step.FrameMs / Frames);
+	}
+
+	Benchmark.Finish(GetWorld());
+}
+
+#if !UE_BUILD_SHIPPING
+static FAutoConsoleCommandWithWorldAndArgs GCrowdSteeringBenchmarkCommand(
+	TEXT("DaysGun.Crowd.Benchmark"),
+	TEXT("Spawns soak bots crossing through each other under crowd steering and logs the steering cost per count. ")
+	TEXT("Args: [Seconds=10] [Counts=100 500 1000]"),
+	FConsoleCommandWithWorldAndArgsDelegate::CreateLambda([](const TArray<FString>& Args, UWorld* World)
+	{
+		if (const auto Subsystem = World ? World->GetSubsystem<UCrowdSteeringSubsystem>() : nullptr)
+		{
+			const float Seconds = Args.Num() > 0 ? FCString::Atof(*Args[0]) : 10.f;
+
+			TArray<int32> Counts;
+			for (int32 Index = 1; Index < Args.Num(); ++Index)
+			{
+				Counts.Add(FCString::Atoi(*Args[Index]));
+			}
+			if (Counts.Num() == 0)
+			{
+				Counts = {100, 500, 1000};
+			}
+
+			Subsystem->StartBenchmark(Counts, Seconds);
+		}
+	}));
+
+static FAutoConsoleCommandWithWorld GCrowdSteeringStatsCommand(
+	TEXT("DaysGun.Crowd.Stats"),
+	TEXT("Prints the number of crowd agents and the cost of the last steering update"),
+	FConsoleCommandWithWorldDelegate::CreateLambda([](UWorld* World)
+	{
+		if (const auto Subsystem = World ? World->GetSubsystem<UCrowdSteeringSubsystem>() : nullptr)
+		{
+			UE_LOG(LogDaysGun, Display, TEXT("%d crowd agents, last steering update %.3f ms"),
+			       Subsystem->GetNumAgents(), Subsystem->GetLastSteeringMs());
+		}
+	}));
+#endif
@@ -0,0 +1,71 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "DaysGun.h"
+#include "EngineUtils.h"
+#include "Player/BaseCharacter.h"
+
+#if !UE_BUILD_SHIPPING
+static FAutoConsoleCommandWithWorld GCharacterComponentReportCommand(
+	TEXT("DaysGun.Characters.ComponentReport"),
+	TEXT("Prints actor and component tick counts, component counts and object memory for every ABaseCharacter in the world"),
+	FConsoleCommandWithWorldDelegate::CreateLambda([](UWorld* World)
+	{
+		if (!World) return;
+
+		int32 NumCharacters = 0;
+		int32 NumLocalCharacters = 0;
+		int32 NumTickingCharacters = 0;
+		int32 NumComponents = 0;
+		int32 NumTickingComponents = 0;
+		int32 NumCameraComponents = 0;
+		int64 ObjectBytes = 0;
+		int64 ResourceBytes = 0;
+
+		for (TActorIterator<ABaseCharacter> It(World); It; ++It)
+		{
+			const auto Character = *It;
+			++NumCharacters;
+			if (Character->IsLocallyControlled() && Character->IsPlayerControlled()) ++NumLocalCharacters;
+			if (Character->IsActorTickEnabled()) ++NumTickingCharacters;
+
+			ObjectBytes += Character->GetClass()->GetStructureSize();
+			ResourceBytes += Character->GetResourceSizeBytes(EResourceSizeMode::Exclusive);
+
+			for (const auto Component : Character->GetComponents())
+			{
+				if (!Component) continue;
+
+				++NumComponents;
+				if (Component->IsComponentTickEnabled()) ++NumTickingComponents;
+				if (Component == Character->GetCameraBoom() || Component == Character->GetFollowCamera())
+				{
+					++NumCameraComponents;
+				}
+
+				ObjectBytes += Component->GetClass()->GetStructureSize();
+				ResourceBytes += Component->GetResourceSizeBytes(EResourceSizeMode::Exclusive);
+			}
+
+			if (const auto AnimInstance = Character->GetMesh()->GetAnimInstance())
+			{
+				ObjectBytes += AnimInstance->GetClass()->GetStructureSize();
+			}
+		}
+
+		if (NumCharacters == 0)
+		{
+			UE_LOG(LogDaysGun, Display, TEXT("No ABaseCharacter in the world"));
+			return;
+		}
+
+		UE_LOG(LogDaysGun, Display, TEXT("%d characters (%d local), %d with actor tick enabled"),
+		       NumCharacters, NumLocalCharacters, NumTickingCharacters);
+		UE_LOG(LogDaysGun, Display,
+		       TEXT("%d components (%.1f each), %d ticking per frame (%.1f each), %d camera components"),
+		       NumComponents, static_cast<float>(NumComponents) / NumCharacters,
+		       NumTickingComponents, static_cast<float>(NumTickingComponents) / NumCharacters, NumCameraComponents);
+		UE_LOG(LogDaysGun, Display, TEXT("Object memory %.1f KB per character, resources %.1f KB per character"),
+		       ObjectBytes / 1024.0 / NumCharacters, ResourceBytes / 1024.0 / NumCharacters);
+	}));
+#endif
@@ -0,0 +1,181 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "DaysGun.h"
+#include "Kismet/KismetMathLibrary.h"
+#include "Math/DaysGunMath.h"
+
+#if !UE_BUILD_SHIPPING
+namespace DaysGunMathBenchmark
+{
+	struct FInputs
+	{
+		TArray<float> A;
+		TArray<float> B;
+		TArray<float> X;
+		TArray<float> Y;
+		TArray<FVector> VectorA;
+		TArray<FVector> VectorB;
+		TArray<FRotator> RotatorA;
+		TArray<FRotator> RotatorB;
+
+		void Generate(int32 Num)
+		{
+			FRandomStream Random(1234);
+			for (int32 Index = 0; Index < Num; ++Index)
+			{
+				A.Add(Random.FRandRange(-720.f, 720.f));
+				B.Add(Random.FRandRange(-720.f, 720.f));
+
+				// Offset away from zero so every vector has a defined heading
+				X.Add(Random.FRandRange(-500.f, 500.f) + (Index % 2 ? 1.f : -1.f));
+				Y.Add(Random.FRandRange(-500.f, 500.f));
+				VectorA.Add(FVector(X.Last(), Y.Last(), 0.f));
+				VectorB.Add(FVector(Random.FRandRange(-500.f, 500.f), Random.FRandRange(-500.f, 500.f), 0.f));
+
+				RotatorA.Add(FRotator(0.f, FRotator::NormalizeAxis(A.Last()), 0.f));
+				RotatorB.Add(FRotator(0.f, FRotator::NormalizeAxis(B.Last()), 0.f));
+			}
+		}
+	};
+
+	/** Times the Kismet call, the native helper and optionally its batched form */
+	template <typename FKismetOp, typename FNativeOp, typename FBatchOp>
+	void Time(const TCHAR* Name, int32 Num, FKismetOp KismetOp, FNativeOp NativeOp, FBatchOp BatchOp)
+	{
+		// Results are kept so the compiler can't drop the loops
+		TArray<float> KismetResults;
+		TArray<float> NativeResults;
+		TArray<float> BatchResults;
+		KismetResults.SetNumUninitialized(Num);
+		NativeResults.SetNumUninitialized(Num);
+		BatchResults.SetNumUninitialized(Num);
+
+		auto Start = FPlatformTime::Cycles64();
+		for (int32 Index = 0; Index < Num; ++Index)
+		{
+			KismetResults[Index] = KismetOp(Index);
+		}
+		const auto KismetCycles = FPlatformTime::Cycles64() - Start;
+
+		Start = FPlatformTime::Cycles64();
+		for (int32 Index = 0; Index < Num; ++Index)
+		{
+			NativeResults[Index] = NativeOp(Index);
+		}
+		const auto NativeCycles = FPlatformTime::Cycles64() - Start;
+
+		Start = FPlatformTime::Cycles64();
+		const bool HasBatch = BatchOp(BatchResults);
+		const auto BatchCycles = FPlatformTime::Cycles64() - Start;
+
+		const auto NsPerOp = [Num](uint64 Cycles) { return FPlatformTime::ToMilliseconds64(Cycles) * 1e6 / Num; };
+		UE_LOG(LogDaysGun, Display, TEXT("%-24s kismet %6.2f ns  native %6.2f ns  batch %s"),
+		       Name, NsPerOp(KismetCycles), NsPerOp(NativeCycles),
+		       HasBatch ? *FString::Printf(TEXT("%6.2f ns"), NsPerOp(BatchCycles)) : TEXT("     -   "));
+		UE_LOG(LogDaysGun, Verbose, TEXT("%s checksum %f"), Name,
+		       KismetResults[Num / 2] + NativeResults[Num / 2] + (HasBatch ? BatchResults[Num / 2] : 0.f));
+	}
+
+	const auto NoBatch = [](TArray<float>&) { return false; };
+}
+
+static FAutoConsoleCommandWithArgs GMathBenchmarkCommand(
+	TEXT("DaysGun.Math.Benchmark"),
+	TEXT("Times FDaysGunMath against the UKismetMathLibrary calls it replaces. The DaysGun.Math automation tests ")
+	TEXT("check that the results match. Args: [Count=1000000]"),
+	FConsoleCommandWithArgsDelegate::CreateLambda([](const TArray<FString>& Args)
+	{
+		using namespace DaysGunMathBenchmark;
+
+		// Multiple of four so the batched forms never fall back to their scalar tail
+		const int32 Num = Align(FMath::Max(Args.Num() > 0 ? FCString::Atoi(*Args[0]) : 1000000, 4), 4);
+
+		FInputs In;
+		In.Generate(Num);
+
+		Time(TEXT("MakeRotFromX.Yaw"), Num,
+		     [&](int32 I) { return static_cast<float>(UKismetMathLibrary::MakeRotFromX(In.VectorA[I]).Yaw); },
+		     [&](int32 I) { return FDaysGunMath::YawFromVector(In.VectorA[I]); },
+		     [&](TArray<float>& Out) { FDaysGunMath::YawFromVectorBatch(In.X, In.Y, Out); return true; });
+
+		Time(TEXT("NormalizedDeltaRotator"), Num,
+		     [&](int32 I)
+		     {
+		     	return static_cast<float>(
+		     		UKismetMathLibrary::NormalizedDeltaRotator(In.RotatorA[I], In.RotatorB[I]).Yaw);
+		     },
+		     [&](int32 I) { return FDaysGunMath::DeltaYaw(In.RotatorA[I].Yaw, In.RotatorB[I].Yaw); },
+		     [&](TArray<float>& Out) { FDaysGunMath::DeltaYawBatch(In.A, In.B, Out); return true; });
+
+		Time(TEXT("MapRangeClamped"), Num,
+		     [&](int32 I)
+		     {
+		     	return static_cast<float>(UKismetMathLibrary::MapRangeClamped(In.A[I], 0.f, 200.f, 500.f, 2000.f));
+		     },
+		     [&](int32 I) { return FDaysGunMath::MapRangeClamped(In.A[I], 0.f, 200.f, 500.f, 2000.f); },
+		     [&](TArray<float>& Out)
+		     {
+		     	FDaysGunMath::MapRangeClampedBatch(In.A, Out, 0.f, 200.f, 500.f, 2000.f);
+		     	return true;
+		     });
+
+		Time(TEXT("RInterpTo_Constant"), Num,
+		     [&](int32 I)
+		     {
+		     	return static_cast<float>(UKismetMathLibrary::RInterpTo_Constant(
+		     		In.RotatorA[I], In.RotatorB[I], 1.f / 60.f, 720.f).Yaw);
+		     },
+		     [&](int32 I)
+		     {
+		     	return FDaysGunMath::YawInterpConstantTo(In.RotatorA[I].Yaw, In.RotatorB[I].Yaw, 1.f / 60.f, 720.f);
+		     },
+		     NoBatch);
+
+		Time(TEXT("RInterpTo"), Num,
+		     [&](int32 I)
+		     {
+		     	return static_cast<float>(UKismetMathLibrary::RInterpTo(
+		     		In.RotatorA[I], In.RotatorB[I], 1.f / 60.f, 10.f).Yaw);
+		     },
+		     [&](int32 I)
+		     {
+		     	return FDaysGunMath::YawInterpTo(In.RotatorA[I].Yaw, In.RotatorB[I].Yaw, 1.f / 60.f, 10.f);
+		     },
+		     NoBatch);
+
+		Time(TEXT("InRange_FloatFloat"), Num,
+		     [&](int32 I)
+		     {
+		     	return UKismetMathLibrary::InRange_FloatFloat(In.A[I], -135.0, -45.0, false, true) ? 1.f : 0.f;
+		     },
+		     [&](int32 I) { return FDaysGunMath::InRange(In.A[I], -135.f, -45.f, false, true) ? 1.f : 0.f; },
+		     NoBatch);
+
+		Time(TEXT("DotProduct2D"), Num,
+		     [&](int32 I)
+		     {
+		     	return static_cast<float>(UKismetMathLibrary::DotProduct2D(
+		     		FVector2D(In.VectorA[I]), FVector2D(In.VectorB[I])));
+		     },
+		     [&](int32 I) { return FDaysGunMath::Dot2D(In.VectorA[I], In.VectorB[I]); },
+		     NoBatch);
+
+		Time(TEXT("Normal (X)"), Num,
+		     [&](int32 I) { return static_cast<float>(UKismetMathLibrary::Normal(In.VectorA[I]).X); },
+		     [&](int32 I) { return FDaysGunMath::SafeNormal2D(In.VectorA[I]).X; },
+		     NoBatch);
+
+		Time(TEXT("SafeDivide"), Num,
+		     [&](int32 I) { return static_cast<float>(UKismetMathLibrary::SafeDivide(In.A[I], In.B[I])); },
+		     [&](int32 I) { return FDaysGunMath::SafeDivide(In.A[I], In.B[I]); },
+		     NoBatch);
+
+		Time(TEXT("Greater_DoubleDouble"), Num,
+		     [&](int32 I) { return UKismetMathLibrary::Greater_DoubleDouble(In.A[I], In.B[I]) ? 1.f : 0.f; },
+		     [&](int32 I) { return In.A[I] > In.B[I] ? 1.f : 0.f; },
+		     NoBatch);
+
+		UE_LOG(LogDaysGun, Display, TEXT("Math benchmark over %d values"), Num);
+	}));
+#endif
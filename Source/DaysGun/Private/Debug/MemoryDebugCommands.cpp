@@ -0,0 +1,267 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "DaysGun.h"
+#include "EngineUtils.h"
+#include "Animation/AnimSequence.h"
+#include "Animation/PlayerAnimInstance.h"
+#include "Engine/SkeletalMesh.h"
+#include "HAL/FileManager.h"
+#include "PhysicsEngine/PhysicsAsset.h"
+#include "Player/BaseCharacter.h"
+
+#if !UE_BUILD_SHIPPING
+namespace DaysGunMemoryReport
+{
+	double ToKB(int64 Bytes)
+	{
+		return Bytes / 1024.0;
+	}
+
+	int64 GetResourceBytes(UObject* Object)
+	{
+		return Object ? Object->GetResourceSizeBytes(EResourceSizeMode::EstimatedTotal) : 0;
+	}
+
+	/** Current size of each project LLM tag, so headless and automated runs get them without stat LLM */
+	void LogLLMTags()
+	{
+#if ENABLE_LOW_LEVEL_MEM_TRACKER
+		if (!FLowLevelMemTracker::IsEnabled())
+		{
+			UE_LOG(LogDaysGun, Display, TEXT("Allocations by tag: LLM is off, run with -llm"));
+			return;
+		}
+
+		// Folds the per thread counts into the tag totals, the engine otherwise only does that once a frame
+		auto& Tracker = FLowLevelMemTracker::Get();
+		Tracker.UpdateStatsPerFrame();
+
+		UE_LOG(LogDaysGun, Display, TEXT("Allocations by tag:"));
+		for (const auto Tag : {TEXT("DaysGun_Character"), TEXT("DaysGun_Animation"), TEXT("DaysGun_Backpack")})
+		{
+			const auto Bytes = Tracker.GetTagAmountForTracker(ELLMTracker::Default, FName(Tag), ELLMTagSet::None);
+			UE_LOG(LogDaysGun, Display, TEXT("  %-18s %10.1f KB"), Tag, ToKB(Bytes));
+		}
+#else
+		UE_LOG(LogDaysGun, Display, TEXT("Allocations by tag: LLM is compiled out of this build"));
+#endif
+	}
+
+	struct FCharacterMemory
+	{
+		int32 NumComponents = 0;
+		int32 NumBodies = 0;
+
+		/** UObject instance sizes of the actor, its components and its anim instance */
+		int64 InstanceBytes = 0;
+		int64 AnimInstanceBytes = 0;
+
+		/** Per instance resources, shared assets are counted separately */
+		int64 ResourceBytes = 0;
+		int64 BackpackBytes = 0;
+
+		void Gather(ABaseCharacter* Character)
+		{
+			InstanceBytes += Character->GetClass()->GetStructureSize();
+			ResourceBytes += Character->GetResourceSizeBytes(EResourceSizeMode::Exclusive);
+
+			for (const auto Component : Character->GetComponents())
+			{
+				if (!Component) continue;
+
+				++NumComponents;
+				const auto ComponentInstanceBytes = Component->GetClass()->GetStructureSize();
+				const auto ComponentResourceBytes = Component->GetResourceSizeBytes(EResourceSizeMode::Exclusive);
+				InstanceBytes += ComponentInstanceBytes;
+				ResourceBytes += ComponentResourceBytes;
+
+				if (const auto SkeletalMesh = Cast<USkeletalMeshComponent>(Component))
+				{
+					NumBodies += SkeletalMesh->Bodies.Num();
+				}
+
+				if (Component == Character->GetBackpackMesh())
+				{
+					BackpackBytes += ComponentInstanceBytes + ComponentResourceBytes;
+				}
+			}
+
+			if (const auto AnimInstance = Character->GetMesh()->GetAnimInstance())
+			{
+				AnimInstanceBytes += AnimInstance->GetClass()->GetStructureSize();
+			}
+		}
+
+		void Add(const FCharacterMemory& Other)
+		{
+			NumComponents += Other.NumComponents;
+			NumBodies += Other.NumBodies;
+			InstanceBytes += Other.InstanceBytes;
+			AnimInstanceBytes += Other.AnimInstanceBytes;
+			ResourceBytes += Other.ResourceBytes;
+			BackpackBytes += Other.BackpackBytes;
+		}
+	};
+
+	void LogCharacter(const TCHAR* Name, const FCharacterMemory& Memory, int32 Divisor)
+	{
+		UE_LOG(LogDaysGun, Display,
+		       TEXT("  %-32s %5.1f components %5.1f bodies  instance %7.1f KB  anim instance %6.1f KB  ")
+		       TEXT("resources %7.1f KB  backpack %6.1f KB"),
+		       Name, static_cast<float>(Memory.NumComponents) / Divisor, static_cast<float>(Memory.NumBodies) / Divisor,
+		       ToKB(Memory.InstanceBytes) / Divisor, ToKB(Memory.AnimInstanceBytes) / Divisor,
+		       ToKB(Memory.ResourceBytes) / Divisor, ToKB(Memory.BackpackBytes) / Divisor);
+	}
+}
+
+static FAutoConsoleCommandWithWorldAndArgs GMemoryReportCommand(
+	TEXT("DaysGun.Memory.Report"),
+	TEXT("Prints per character memory and the shared meshes, physics assets and locomotion clips they keep resident. ")
+	TEXT("Works headless, e.g. -ExecCmds=\"DaysGun.Memory.Report\". Args: [MaxListedCharacters=10]"),
+	FConsoleCommandWithWorldAndArgsDelegate::CreateLambda([](const TArray<FString>& Args, UWorld* World)
+	{
+		using namespace DaysGunMemoryReport;
+		if (!World) return;
+
+		const int32 MaxListed = Args.Num() > 0 ? FCString::Atoi(*Args[0]) : 10;
+
+		FCharacterMemory Total;
+		int32 NumCharacters = 0;
+
+		TSet<USkeletalMesh*> Meshes;
+		TSet<UPhysicsAsset*> PhysicsAssets;
+		TMap<const UClass*, const UPlayerAnimInstance*> AnimClasses;
+
+		UE_LOG(LogDaysGun, Display, TEXT("Characters:"));
+		for (TActorIterator<ABaseCharacter> It(World); It; ++It)
+		{
+			const auto Character = *It;
+
+			FCharacterMemory Memory;
+			Memory.Gather(Character);
+			Total.Add(Memory);
+
+			if (NumCharacters++ < MaxListed)
+			{
+				LogCharacter(*Character->GetName(), Memory, 1);
+			}
+
+			TArray<USkeletalMeshComponent*> SkeletalMeshes;
+			Character->GetComponents(SkeletalMeshes);
+			for (const auto SkeletalMesh : SkeletalMeshes)
+			{
+				if (const auto Asset = SkeletalMesh->GetSkeletalMeshAsset())
+				{
+					Meshes.Add(Asset);
+				}
+				if (const auto PhysicsAsset = SkeletalMesh->GetPhysicsAsset())
+				{
+					PhysicsAssets.Add(PhysicsAsset);
+				}
+			}
+
+			if (const auto AnimInstance = Cast<UPlayerAnimInstance>(Character->GetMesh()->GetAnimInstance()))
+			{
+				AnimClasses.FindOrAdd(AnimInstance->GetClass(), AnimInstance);
+			}
+		}
+
+		if (NumCharacters == 0)
+		{
+			UE_LOG(LogDaysGun, Display, TEXT("No ABaseCharacter in the world"));
+			return;
+		}
+
+		LogCharacter(TEXT("Average"), Total, NumCharacters);
+
+		UE_LOG(LogDaysGun, Display, TEXT("Shared assets:"));
+		for (const auto Mesh : Meshes)
+		{
+			UE_LOG(LogDaysGun, Display, TEXT("  Mesh          %-40s %8.1f KB"), *Mesh->GetName(),
+			       ToKB(GetResourceBytes(Mesh)));
+		}
+		for (const auto PhysicsAsset : PhysicsAssets)
+		{
+			UE_LOG(LogDaysGun, Display, TEXT("  Physics asset %-40s %8.1f KB, %d bodies"), *PhysicsAsset->GetName(),
+			       ToKB(GetResourceBytes(PhysicsAsset)), PhysicsAsset->SkeletalBodySetups.Num());
+		}
+
+		// Clips shared by several anim classes count once towards the total
+		TSet<UAnimSequence*> Counted;
+		int64 LocomotionClipBytes = 0;
+		for (const auto& AnimClass : AnimClasses)
+		{
+			TMap<FName, TArray<UAnimSequence*>> Groups;
+			AnimClass.Value->GetLocomotionClipGroups(Groups);
+
+			UE_LOG(LogDaysGun, Display, TEXT("Locomotion clips of %s:"), *AnimClass.Key->GetName());
+			for (const auto& Group : Groups)
+			{
+				int32 NumClips = 0;
+				int64 GroupBytes = 0;
+				for (const auto Clip : Group.Value)
+				{
+					if (!Clip) continue;
+
+					++NumClips;
+					GroupBytes += GetResourceBytes(Clip);
+
+					bool AlreadyCounted = false;
+					Counted.Add(Clip, &AlreadyCounted);
+					if (!AlreadyCounted) LocomotionClipBytes += GetResourceBytes(Clip);
+				}
+
+				UE_LOG(LogDaysGun, Display, TEXT("  %-16s %2d clips %8.1f KB"), *Group.Key.ToString(), NumClips,
+				       ToKB(GroupBytes));
+			}
+		}
+
+		// What the warping mode still plays, the directional starts and gait transitions go once it is used everywhere
+		TSet<UAnimSequence*> WarpingClips;
+		for (const auto& AnimClass : AnimClasses)
+		{
+			TMap<FName, TArray<UAnimSequence*>> Groups;
+			AnimClass.Value->GetLocomotionClipGroups(Groups, true);
+			for (const auto& Group : Groups)
+			{
+				for (const auto Clip : Group.Value)
+				{
+					if (Clip) WarpingClips.Add(Clip);
+				}
+			}
+		}
+
+		int64 WarpingClipBytes = 0;
+		for (const auto Clip : WarpingClips)
+		{
+			WarpingClipBytes += GetResourceBytes(Clip);
+		}
+
+		UE_LOG(LogDaysGun, Display, TEXT("Warping mode: %d of %d locomotion clips, %.1f KB, %.1f KB saved"),
+		       WarpingClips.Num(), Counted.Num(), ToKB(WarpingClipBytes), ToKB(LocomotionClipBytes - WarpingClipBytes));
+
+		// Cycles, idles and anything else the anim blueprints keep loaded
+		int32 NumOtherClips = 0;
+		int64 OtherClipBytes = 0;
+		for (TObjectIterator<UAnimSequence> It; It; ++It)
+		{
+			if (Counted.Contains(*It) || It->IsTemplate()) continue;
+
+			++NumOtherClips;
+			OtherClipBytes += GetResourceBytes(*It);
+		}
+
+		UE_LOG(LogDaysGun, Display, TEXT("Resident animation: locomotion clips %.1f KB, %d other sequences %.1f KB"),
+		       ToKB(LocomotionClipBytes), NumOtherClips, ToKB(OtherClipBytes));
+		UE_LOG(LogDaysGun, Display, TEXT("%d characters, %.1f KB per character before shared assets"),
+		       NumCharacters, ToKB(Total.InstanceBytes + Total.AnimInstanceBytes + Total.ResourceBytes) / NumCharacters);
+		LogLLMTags();
+
+		// Server targets compile the cosmetic code out, compare against the game target run with -server
+		const auto GameBuild = IsRunningDedicatedServer() ? TEXT("game target with -server") : TEXT("game");
+		UE_LOG(LogDaysGun, Display, TEXT("Build: %s, executable %.1f MB"),
+		       UE_SERVER ? TEXT("server target") : GameBuild,
+		       ToKB(IFileManager::Get().FileSize(FPlatformProcess::ExecutablePath())) / 1024.0);
+	}));
+#endif
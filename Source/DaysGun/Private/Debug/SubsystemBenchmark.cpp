@@ -0,0 +1,63 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "Debug/SubsystemBenchmark.h"
+
+#include "Engine/World.h"
+#include "GameFramework/PlayerController.h"
+#include "Misc/App.h"
+#include "Soak/SoakTestSubsystem.h"
+
+double FSubsystemBenchmark::GetFrameMs()
+{
+	return (FApp::GetDeltaTime() - FApp::GetIdleTime()) * 1000.0;
+}
+
+USoakTestSubsystem* FSubsystemBenchmark::GetIdleSoak(const UWorld* World)
+{
+	const auto Soak = World ? World->GetSubsystem<USoakTestSubsystem>() : nullptr;
+	return Soak && Soak->GetNumBots() == 0 ? Soak : nullptr;
+}
+
+FVector FSubsystemBenchmark::GetCenter(const UWorld* World)
+{
+	const auto PlayerController = World->GetFirstPlayerController();
+	if (!PlayerController) return FVector::ZeroVector;
+
+	return PlayerController->GetPawn()
+		       ? PlayerController->GetPawn()->GetActorLocation()
+		       : PlayerController->GetFocalLocation();
+}
+
+bool FSubsystemBenchmark::Start(int32 InNumPhases, float InSeconds)
+{
+	if (IsRunning() || InNumPhases <= 0) return false;
+
+	NumPhases = InNumPhases;
+	PhaseIndex = 0;
+	Seconds = InSeconds;
+	PhaseTime = 0.f;
+	return true;
+}
+
+bool FSubsystemBenchmark::Tick(float DeltaTime)
+{
+	PhaseTime += DeltaTime;
+	return PhaseTime > SettleSeconds;
+}
+
+bool FSubsystemBenchmark::NextPhase()
+{
+	PhaseTime = 0.f;
+	return ++PhaseIndex < NumPhases;
+}
+
+void FSubsystemBenchmark::Finish(const UWorld* World)
+{
+	PhaseIndex = INDEX_NONE;
+
+	if (const auto Soak = World ? World->GetSubsystem<USoakTestSubsystem>() : nullptr)
+	{
+		Soak->ReleaseBots();
+	}
+}
@@ -0,0 +1,88 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "DaysGun.h"
+#include "Locomotion/LocomotionTrajectory.h"
+#include "Math/DaysGunMath.h"
+
+#if !UE_BUILD_SHIPPING
+static FAutoConsoleCommandWithArgs GTrajectoryBenchmarkCommand(
+	TEXT("DaysGun.Trajectory.Benchmark"),
+	TEXT("Times trajectory history updates and predictions per character over a synthetic walk. ")
+	TEXT("Args: [Characters=1000] [Frames=300] [Points=8]"),
+	FConsoleCommandWithArgsDelegate::CreateLambda([](const TArray<FString>& Args)
+	{
+		const int32 NumCharacters = FMath::Max(Args.Num() > 0 ? FCString::Atoi(*Args[0]) : 1000, 1);
+		const int32 NumFrames = FMath::Max(Args.Num() > 1 ? FCString::Atoi(*Args[1]) : 300, 1);
+		const int32 NumPoints = FMath::Clamp(Args.Num() > 2 ? FCString::Atoi(*Args[2]) : 8, 1, 64);
+
+		constexpr float DeltaSeconds = 1.f / 60.f;
+
+		FTrajectoryMovementModel Model;
+		Model.MaxSpeed = 500.f;
+		Model.MaxAcceleration = 2048.f;
+		Model.BrakingDeceleration = 2048.f;
+		Model.GroundFriction = 8.f;
+		Model.BrakingFriction = 16.f;
+
+		TArray<FLocomotionTrajectory> Trajectories;
+		TArray<FVector> Positions;
+		TArray<float> Headings;
+		Trajectories.SetNum(NumCharacters);
+		Positions.SetNumZeroed(NumCharacters);
+		Headings.SetNumZeroed(NumCharacters);
+
+		FRandomStream Random(1234);
+		for (auto& Heading : Headings)
+		{
+			Heading = Random.FRandRange(-180.f, 180.f);
+		}
+
+		TArray<FTrajectoryPoint> Points;
+		Points.SetNum(NumPoints);
+
+		uint64 UpdateCycles = 0;
+		uint64 PredictCycles = 0;
+		float Checksum = 0.f;
+
+		for (int32 Frame = 0; Frame < NumFrames; ++Frame)
+		{
+			// Every character walks a slow curve and stops for a while every few seconds
+			const bool Moving = Frame % 240 < 180;
+			const auto Turn = Moving ? 90.f * DeltaSeconds : 0.f;
+
+			auto Start = FPlatformTime::Cycles64();
+			for (int32 Index = 0; Index < NumCharacters; ++Index)
+			{
+				Headings[Index] = FDaysGunMath::NormalizeYaw(Headings[Index] + Turn);
+				const auto Input = Moving ? FDaysGunMath::ForwardFromYaw(Headings[Index]) : FVector::ZeroVector;
+				const auto Velocity = Input * Model.MaxSpeed;
+				Positions[Index] += Velocity * DeltaSeconds;
+
+				Trajectories[Index].AddSample(Positions[Index], Velocity, Input, Headings[Index], DeltaSeconds);
+			}
+			UpdateCycles += FPlatformTime::Cycles64() - Start;
+
+			Start = FPlatformTime::Cycles64();
+			for (int32 Index = 0; Index < NumCharacters; ++Index)
+			{
+				Trajectories[Index].Predict(Model, 0.2f, Points);
+				Checksum += Points.Last().Offset.X;
+			}
+			PredictCycles += FPlatformTime::Cycles64() - Start;
+		}
+
+		const auto NsPerCharacter = [NumCharacters, NumFrames](uint64 Cycles)
+		{
+			return FPlatformTime::ToMilliseconds64(Cycles) * 1e6 / (static_cast<double>(NumCharacters) * NumFrames);
+		};
+
+		UE_LOG(LogDaysGun, Display, TEXT("Trajectory benchmark, %d characters over %d frames, %d points 0.2s apart:"),
+		       NumCharacters, NumFrames, NumPoints);
+		UE_LOG(LogDaysGun, Display, TEXT("  history update %7.2f ns per character"), NsPerCharacter(UpdateCycles));
+		UE_LOG(LogDaysGun, Display, TEXT("  prediction     %7.2f ns per character"), NsPerCharacter(PredictCycles));
+		UE_LOG(LogDaysGun, Display, TEXT("  %d bytes per trajectory, %.1f KB total (checksum %.1f)"),
+		       static_cast<int32>(sizeof(FLocomotionTrajectory)),
+		       sizeof(FLocomotionTrajectory) * NumCharacters / 1024.0, Checksum);
+	}));
+#endif
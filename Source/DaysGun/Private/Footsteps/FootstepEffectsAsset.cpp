@@ -0,0 +1,27 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "Footsteps/FootstepEffectsAsset.h"
+
+void UFootstepEffectsAsset::PostLoad()
+{
+	Super::PostLoad();
+	BuildSurfaceLookup();
+}
+
+#if WITH_EDITOR
+void UFootstepEffectsAsset::PostEditChangeProperty(FPropertyChangedEvent& PropertyChangedEvent)
+{
+	Super::PostEditChangeProperty(PropertyChangedEvent);
+	BuildSurfaceLookup();
+}
+#endif
+
+void UFootstepEffectsAsset::BuildSurfaceLookup()
+{
+	for (int32 Surface = 0; Surface < SurfaceType_Max; ++Surface)
+	{
+		const auto Effects = SurfaceEffects.Find(static_cast<EPhysicalSurface>(Surface));
+		SurfaceLookup[Surface] = Effects ? *Effects : DefaultEffects;
+	}
+}
@@ -0,0 +1,278 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "Footsteps/FootstepSubsystem.h"
+
+#include "DaysGun.h"
+#include "Components/AudioComponent.h"
+#include "Footsteps/FootstepEffectsAsset.h"
+#include "GameFramework/Character.h"
+#include "GameFramework/CharacterMovementComponent.h"
+#include "NiagaraComponent.h"
+#include "PhysicalMaterials/PhysicalMaterial.h"
+#include "ProfilingDebugging/MiscTrace.h"
+#include "Soak/SoakTestSubsystem.h"
+
+DECLARE_CYCLE_STAT(TEXT("Footstep Play"), STAT_FootstepPlay, STATGROUP_DaysGun);
+DECLARE_CYCLE_STAT(TEXT("Footstep Surface Resolve"), STAT_FootstepSurfaceResolve, STATGROUP_DaysGun);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Footsteps"), STAT_Footsteps, STATGROUP_DaysGun);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Footstep Surface Traces"), STAT_FootstepSurfaceTraces, STATGROUP_DaysGun);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Footstep Pool Steals"), STAT_FootstepPoolSteals, STATGROUP_DaysGun);
+
+namespace
+{
+	/** Bytes LLM holds under DaysGun_Footsteps, INDEX_NONE without -llm. Thread counts are folded in once a frame */
+	int64 GetFootstepTagBytes()
+	{
+#if ENABLE_LOW_LEVEL_MEM_TRACKER
+		if (FLowLevelMemTracker::IsEnabled())
+		{
+			return FLowLevelMemTracker::Get().GetTagAmountForTracker(ELLMTracker::Default,
+			                                                         LLM_TAG_NAME(DaysGun_Footsteps), ELLMTagSet::None);
+		}
+#endif
+		return INDEX_NONE;
+	}
+}
+
+EPhysicalSurface FFootstepSurfaceCache::Resolve(const ACharacter* Character, const FVector& FootLocation,
+                                                float TraceDistance)
+{
+	SCOPE_CYCLE_COUNTER(STAT_FootstepSurfaceResolve);
+
+	const auto& Floor = Character->GetCharacterMovement()->CurrentFloor;
+	const auto Component = Floor.HitResult.GetComponent();
+	if (!Floor.bBlockingHit || !Component)
+	{
+		return SurfaceType_Default;
+	}
+
+	if (FloorComponent.Get() == Component)
+	{
+		return Surface;
+	}
+
+	INC_DWORD_STAT(STAT_FootstepSurfaceTraces);
+
+	// The floor sweep doesn't return physical materials, so resolve it once per floor component
+	static const FName FootstepTraceTag(TEXT("FootstepSurface"));
+	FCollisionQueryParams Params(FootstepTraceTag, false, Character);
+	Params.bReturnPhysicalMaterial = true;
+
+	const auto Start = FootLocation + FVector::UpVector * TraceDistance;
+	const auto End = FootLocation - FVector::UpVector * TraceDistance;
+
+	FHitResult Hit;
+	Surface = Component->LineTraceComponent(Hit, Start, End, Params)
+		          ? UPhysicalMaterial::DetermineSurfaceType(Hit.PhysMaterial.Get())
+		          : SurfaceType_Default;
+	FloorComponent = Component;
+
+	return Surface;
+}
+
+bool UFootstepSubsystem::ShouldCreateSubsystem(UObject* Outer) const
+{
+	return !IsRunningDedicatedServer() && Super::ShouldCreateSubsystem(Outer);
+}
+
+void UFootstepSubsystem::OnWorldBeginPlay(UWorld& InWorld)
+{
+	Super::OnWorldBeginPlay(InWorld);
+	CreatePools();
+}
+
+void UFootstepSubsystem::Deinitialize()
+{
+	if (PoolOwner)
+	{
+		PoolOwner->Destroy();
+	}
+
+	PoolOwner = nullptr;
+	AudioPool.Empty();
+	EffectPool.Empty();
+
+	Super::Deinitialize();
+}
+
+void UFootstepSubsystem::Tick(float DeltaTime)
+{
+	Super::Tick(DeltaTime);
+
+	if (Benchmark.IsRunning())
+	{
+		TickBenchmark(DeltaTime);
+	}
+}
+
+bool UFootstepSubsystem::IsTickable() const
+{
+	return Benchmark.IsRunning();
+}
+
+TStatId UFootstepSubsystem::GetStatId() const
+{
+	RETURN_QUICK_DECLARE_CYCLE_STAT(UFootstepSubsystem, STATGROUP_Tickables);
+}
+
+void UFootstepSubsystem::CreatePools()
+{
+	FActorSpawnParameters SpawnParams;
+	SpawnParams.Name = TEXT("FootstepPool");
+	SpawnParams.ObjectFlags |= RF_Transient;
+	SpawnParams.SpawnCollisionHandlingOverride = ESpawnActorCollisionHandlingMethod::AlwaysSpawn;
+
+	PoolOwner = GetWorld()->SpawnActor<AActor>(AActor::StaticClass(), FTransform::Identity, SpawnParams);
+	if (!PoolOwner) return;
+
+	AudioPool.Reserve(AudioPoolSize);
+	for (int32 Index = 0; Index < AudioPoolSize; ++Index)
+	{
+		const auto Audio = NewObject<UAudioComponent>(PoolOwner);
+		Audio->bAutoActivate = false;
+		Audio->bAutoDestroy = false;
+		Audio->bAllowSpatialization = true;
+		Audio->RegisterComponent();
+		AudioPool.Add(Audio);
+	}
+
+	EffectPool.Reserve(EffectPoolSize);
+	for (int32 Index = 0; Index < EffectPoolSize; ++Index)
+	{
+		const auto Effect = NewObject<UNiagaraComponent>(PoolOwner);
+		Effect->SetAutoActivate(false);
+		Effect->SetAutoDestroy(false);
+		Effect->RegisterComponent();
+		EffectPool.Add(Effect);
+	}
+}
+
+void UFootstepSubsystem::PlayFootstep(const FFootstepEvent& Event)
+{
+	SCOPE_CYCLE_COUNTER(STAT_FootstepPlay);
+	if (!Event.Effects) return;
+
+	INC_DWORD_STAT(STAT_Footsteps);
+	if (Benchmark.IsRunning()) ++PendingSteps;
+
+	const auto& Effects = Event.Effects->GetEffects(Event.Surface);
+
+	if (Effects.Sound && AudioPool.Num() > 0)
+	{
+		const auto Audio = AudioPool[NextAudio];
+		NextAudio = (NextAudio + 1) % AudioPool.Num();
+
+		if (Audio->IsPlaying())
+		{
+			INC_DWORD_STAT(STAT_FootstepPoolSteals);
+		}
+
+		Audio->SetWorldLocation(Event.Location);
+		Audio->SetSound(Effects.Sound);
+		Audio->Play();
+	}
+
+	if (Effects.Effect && EffectPool.Num() > 0)
+	{
+		const auto Effect = EffectPool[NextEffect];
+		NextEffect = (NextEffect + 1) % EffectPool.Num();
+
+		if (Effect->IsActive())
+		{
+			INC_DWORD_STAT(STAT_FootstepPoolSteals);
+		}
+
+		Effect->SetWorldLocation(Event.Location);
+		if (Effect->GetAsset() != Effects.Effect)
+		{
+			Effect->SetAsset(Effects.Effect);
+		}
+		Effect->Activate(true);
+	}
+}
+
+void UFootstepSubsystem::StartBenchmark(int32 Count, float Seconds)
+{
+	const auto Soak = FSubsystemBenchmark::GetIdleSoak(GetWorld());
+	if (!Soak || Count <= 0 || !Benchmark.Start(1, Seconds)) return;
+
+	Soak->SpawnBotsAround(Count, FSubsystemBenchmark::GetCenter(GetWorld()));
+	BenchmarkBots = Soak->GetNumBots();
+	BenchmarkFrames = INDEX_NONE;
+	BenchmarkSteps = 0;
+	BenchmarkFrameMs = 0.0;
+	PendingSteps = 0;
+
+	UE_LOG(LogDaysGun, Display, TEXT("Footstep benchmark: %d bots, %.0f s"), BenchmarkBots, Seconds);
+}
+
+void UFootstepSubsystem::TickBenchmark(float DeltaTime)
+{
+	const auto Steps = PendingSteps;
+	PendingSteps = 0;
+	if (!Benchmark.Tick(DeltaTime)) return;
+
+	// The pools went round during the settle time, so their first use is behind the baseline
+	if (BenchmarkFrames == INDEX_NONE)
+	{
+		BenchmarkFrames = 0;
+		BenchmarkStartBytes = GetFootstepTagBytes();
+		TRACE_BOOKMARK(TEXT("Footstep benchmark start"));
+		return;
+	}
+
+	++BenchmarkFrames;
+	BenchmarkSteps += Steps;
+	BenchmarkFrameMs += FSubsystemBenchmark::GetFrameMs();
+
+	if (Benchmark.IsPhaseDone())
+	{
+		FinishBenchmark();
+	}
+}
+
+void UFootstepSubsystem::FinishBenchmark()
+{
+	TRACE_BOOKMARK(TEXT("Footstep benchmark end"));
+
+	const auto Frames = FMath::Max(BenchmarkFrames, 1);
+	UE_LOG(LogDaysGun, Display,
+	       TEXT("Footstep benchmark: %d bots, %d frames, %d steps (%.1f a frame), frame %.2f ms, pools %d audio %d vfx"),
+	       BenchmarkBots, BenchmarkFrames, BenchmarkSteps, static_cast<double>(BenchmarkSteps) / Frames,
+	       BenchmarkFrameMs / Frames, AudioPool.Num(), EffectPool.Num());
+
+	// Net bytes only, memory freed again within a frame shows in Memory Insights between the bookmarks
+	const auto EndBytes = GetFootstepTagBytes();
+	if (EndBytes == INDEX_NONE || BenchmarkStartBytes == INDEX_NONE)
+	{
+		UE_LOG(LogDaysGun, Display, TEXT("Footstep benchmark: run with -llm to check what the footstep path keeps"));
+	}
+	else if (EndBytes > BenchmarkStartBytes)
+	{
+		UE_LOG(LogDaysGun, Warning, TEXT("Footstep benchmark: the footstep path kept %lld bytes, expected 0"),
+		       EndBytes - BenchmarkStartBytes);
+	}
+	else
+	{
+		UE_LOG(LogDaysGun, Display, TEXT("Footstep benchmark: the footstep path kept no memory"));
+	}
+
+	Benchmark.Finish(GetWorld());
+}
+
+#if !UE_BUILD_SHIPPING
+static FAutoConsoleCommandWithWorldAndArgs GFootstepBenchmarkCommand(
+	TEXT("DaysGun.Footsteps.Benchmark"),
+	TEXT("Spawns soak bots and measures their footsteps from the anim update to the pools, run with -llm for the ")
+	TEXT("memory check and -trace=memalloc to count allocations. Args: [Count=200] [Seconds=10]"),
+	FConsoleCommandWithWorldAndArgsDelegate::CreateLambda([](const TArray<FString>& Args, UWorld* World)
+	{
+		if (const auto Subsystem = World ? World->GetSubsystem<UFootstepSubsystem>() : nullptr)
+		{
+			const int32 Count = Args.Num() > 0 ? FCString::Atoi(*Args[0]) : 200;
+			const float Seconds = Args.Num() > 1 ? FCString::Atof(*Args[1]) : 10.f;
+			Subsystem->StartBenchmark(Count, Seconds);
+		}
+	}));
+#endif
@@ -0,0 +1,138 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "Locomotion/GaitProfileSet.h"
+
+void FGaitCurveLUT::Build(const FRuntimeFloatCurve& Curve)
+{
+	const auto RichCurve = Curve.GetRichCurveConst();
+	const bool HasKeys = RichCurve && RichCurve->GetNumKeys() > 0;
+
+	for (int32 Index = 0; Index < NumSamples; ++Index)
+	{
+		const auto Alpha = static_cast<float>(Index) / (NumSamples - 1);
+		Samples[Index] = HasKeys ? RichCurve->Eval(Alpha) : 1.f - FMath::Square(1.f - Alpha);
+	}
+
+	// Blends must end exactly on the target so the owner can be dropped from the blend list
+	Samples[NumSamples - 1] = 1.f;
+}
+
+UGaitProfileSet::UGaitProfileSet()
+{
+	auto& Walk = Profiles[static_cast<int32>(EGait::EG_Walk)];
+	Walk.MaxSpeed = 175.f;
+	Walk.MaxAcceleration = 150.f;
+	Walk.LocomotionState = ELocomotionState::ELS_Walk;
+
+	auto& Jog = Profiles[static_cast<int32>(EGait::EG_Jog)];
+	Jog.MaxSpeed = 240.f;
+	Jog.MaxAcceleration = 250.f;
+	Jog.LocomotionState = ELocomotionState::ELS_Walk;
+
+	auto& Run = Profiles[static_cast<int32>(EGait::EG_Run)];
+	Run.MaxSpeed = 300.f;
+	Run.MaxAcceleration = 350.f;
+	Run.LocomotionState = ELocomotionState::ELS_Run;
+
+	auto& Sprint = Profiles[static_cast<int32>(EGait::EG_Sprint)];
+	Sprint.MaxSpeed = 450.f;
+	Sprint.MaxAcceleration = 500.f;
+	Sprint.LocomotionState = ELocomotionState::ELS_Run;
+
+	auto& Crouch = Profiles[static_cast<int32>(EGait::EG_Crouch)];
+	Crouch.MaxSpeed = 120.f;
+	Crouch.MaxAcceleration = 150.f;
+	Crouch.LocomotionState = ELocomotionState::ELS_Crouch;
+}
+
+void UGaitProfileSet::PostInitProperties()
+{
+	Super::PostInitProperties();
+	BuildRuntimeProfiles();
+}
+
+void UGaitProfileSet::PostLoad()
+{
+	Super::PostLoad();
+	BuildRuntimeProfiles();
+}
+
+#if WITH_EDITOR
+void UGaitProfileSet::PostEditChangeProperty(FPropertyChangedEvent& PropertyChangedEvent)
+{
+	Super::PostEditChangeProperty(PropertyChangedEvent);
+	BuildRuntimeProfiles();
+}
+#endif
+
+float UGaitProfileSet::GetMinSpeedForState(ELocomotionState LocomotionState) const
+{
+	auto MinSpeed = TNumericLimits<float>::Max();
+	for (const auto& Profile : Profiles)
+	{
+		if (Profile.LocomotionState == LocomotionState)
+		{
+			MinSpeed = FMath::Min(MinSpeed, Profile.MaxSpeed);
+		}
+	}
+
+	return MinSpeed == TNumericLimits<float>::Max() ? GetMinSpeed() : MinSpeed;
+}
+
+float UGaitProfileSet::GetMinSpeed() const
+{
+	auto MinSpeed = TNumericLimits<float>::Max();
+	for (const auto& Profile : Profiles)
+	{
+		MinSpeed = FMath::Min(MinSpeed, Profile.MaxSpeed);
+	}
+
+	return MinSpeed;
+}
+
+EGait UGaitProfileSet::GetGaitForSpeed(float Speed, bool Crouched) const
+{
+	if (Crouched) return EGait::EG_Crouch;
+
+	auto Result = EGait::EG_Walk;
+	auto ResultSpeed = TNumericLimits<float>::Max();
+	auto FastestSpeed = TNumericLimits<float>::Lowest();
+	for (int32 Index = 0; Index < static_cast<int32>(EGait::EG_Num); ++Index)
+	{
+		if (static_cast<EGait>(Index) == EGait::EG_Crouch) continue;
+
+		const auto MaxSpeed = Profiles[Index].MaxSpeed;
+		if (MaxSpeed >= Speed && MaxSpeed < ResultSpeed)
+		{
+			Result = static_cast<EGait>(Index);
+			ResultSpeed = MaxSpeed;
+		}
+		else if (ResultSpeed == TNumericLimits<float>::Max() && MaxSpeed > FastestSpeed)
+		{
+			// Nothing covers Speed yet, fall back to the fastest gait
+			Result = static_cast<EGait>(Index);
+			FastestSpeed = MaxSpeed;
+		}
+	}
+
+	return Result;
+}
+
+void UGaitProfileSet::BuildRuntimeProfiles()
+{
+	for (int32 Index = 0; Index < static_cast<int32>(EGait::EG_Num); ++Index)
+	{
+		const auto& Profile = Profiles[Index];
+		auto& RuntimeProfile = RuntimeProfiles[Index];
+
+		RuntimeProfile.MaxSpeed = Profile.MaxSpeed;
+		RuntimeProfile.MaxAcceleration = Profile.MaxAcceleration;
+		RuntimeProfile.BrakingDeceleration = Profile.BrakingDeceleration;
+		RuntimeProfile.BlendDuration = Profile.BlendDuration;
+
+		RuntimeProfile.SpeedLUT.Build(Profile.SpeedCurve);
+		RuntimeProfile.AccelerationLUT.Build(Profile.AccelerationCurve);
+		RuntimeProfile.BrakingLUT.Build(Profile.BrakingCurve);
+	}
+}
@@ -0,0 +1,277 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "Locomotion/GaitTransitionEntryTable.h"
+
+#include "DaysGun.h"
+#include "UObject/UObjectIterator.h"
+
+#if WITH_EDITOR
+#include "Animation/AnimSequence.h"
+#include "Animation/AttributesRuntime.h"
+#include "BonePose.h"
+#include "UObject/ObjectSaveContext.h"
+
+namespace GaitTransitionAnalysis
+{
+	struct FPoseSample
+	{
+		float Time = 0.f;
+
+		/** Negative when the clip has no foot phase curve */
+		float FootPhase = -1.f;
+
+		/** Relative to the root bone, in MatchBones order */
+		TArray<FVector, TInlineAllocator<4>> Bones;
+	};
+
+	float GetPhaseDistance(float A, float B)
+	{
+		const auto Distance = FMath::Abs(FMath::Frac(A) - FMath::Frac(B));
+		return FMath::Min(Distance, 1.f - Distance);
+	}
+
+	float GetCost(const FPoseSample& Source, const FPoseSample& Candidate, float FootPhaseWeight)
+	{
+		auto Cost = 0.f;
+		for (int32 Bone = 0; Bone < Source.Bones.Num(); ++Bone)
+		{
+			Cost += FVector::DistSquared(Source.Bones[Bone], Candidate.Bones[Bone]);
+		}
+
+		if (Source.FootPhase >= 0.f && Candidate.FootPhase >= 0.f)
+		{
+			Cost += FootPhaseWeight * FMath::Square(GetPhaseDistance(Source.FootPhase, Candidate.FootPhase));
+		}
+		return Cost;
+	}
+
+	/** Samples the first MaxFraction of the clip at its key rate */
+	bool SampleClip(UAnimSequence* Sequence, const TArray<FName>& BoneNames, FName CurveName, float MaxFraction,
+	                TArray<FPoseSample>& OutSamples)
+	{
+		const auto Skeleton = Sequence ? Sequence->GetSkeleton() : nullptr;
+		if (!Skeleton) return false;
+
+		const auto& ReferenceSkeleton = Skeleton->GetReferenceSkeleton();
+		TArray<FBoneIndexType> RequiredBones;
+		for (int32 Bone = 0; Bone < ReferenceSkeleton.GetNum(); ++Bone)
+		{
+			RequiredBones.Add(static_cast<FBoneIndexType>(Bone));
+		}
+
+		FBoneContainer BoneContainer;
+		BoneContainer.InitializeTo(RequiredBones, UE::Anim::FCurveFilterSettings(), *Skeleton);
+
+		TArray<FCompactPoseBoneIndex> Bones;
+		for (const auto BoneName : BoneNames)
+		{
+			const auto SkeletonIndex = ReferenceSkeleton.FindBoneIndex(BoneName);
+			if (SkeletonIndex == INDEX_NONE)
+			{
+				UE_LOG(LogDaysGun, Warning, TEXT("GaitTransitionEntryTable: %s has no bone %s"),
+				       *Skeleton->GetName(), *BoneName.ToString());
+				return false;
+			}
+			Bones.Add(BoneContainer.GetCompactPoseIndexFromSkeletonIndex(SkeletonIndex));
+		}
+
+		const auto HasFootPhase = Sequence->HasCurveData(CurveName);
+		const auto NumSamples = FMath::Max(Sequence->GetNumberOfSampledKeys(), 2);
+		const auto PlayLength = Sequence->GetPlayLength();
+
+		FCompactPose Pose;
+		FBlendedCurve Curve;
+		UE::Anim::FStackAttributeContainer Attributes;
+		for (int32 Sample = 0; Sample < NumSamples; ++Sample)
+		{
+			const double Time = PlayLength * Sample / (NumSamples - 1);
+			if (Time > PlayLength * MaxFraction) break;
+
+			Pose.SetBoneContainer(&BoneContainer);
+			Curve.InitFrom(BoneContainer);
+			FAnimationPoseData PoseData(Pose, Curve, Attributes);
+			Sequence->GetBonePose(PoseData, FAnimExtractContext(Time));
+
+			FCSPose<FCompactPose> ComponentPose;
+			ComponentPose.InitPose(Pose);
+			const auto& Root = ComponentPose.GetComponentSpaceTransform(FCompactPoseBoneIndex(0));
+
+			auto& PoseSample = OutSamples.AddDefaulted_GetRef();
+			PoseSample.Time = Time;
+			PoseSample.FootPhase = HasFootPhase ? Sequence->EvaluateCurveData(CurveName, Time) : -1.f;
+			for (const auto Bone : Bones)
+			{
+				PoseSample.Bones.Add(Root.InverseTransformPosition(
+					ComponentPose.GetComponentSpaceTransform(Bone).GetLocation()));
+			}
+		}
+
+		return OutSamples.Num() > 0;
+	}
+}
+
+void UGaitTransitionEntryTable::PreSave(FObjectPreSaveContext SaveContext)
+{
+	Super::PreSave(SaveContext);
+
+	// Cooking rebuilds too, so edits to the clips never ship with a stale table
+	Rebuild();
+}
+
+void UGaitTransitionEntryTable::Build()
+{
+	Modify();
+	if (Rebuild())
+	{
+		MarkPackageDirty();
+	}
+}
+
+bool UGaitTransitionEntryTable::Rebuild()
+{
+	const auto StartCycles = FPlatformTime::Cycles64();
+
+	TArray<FGaitTransitionEntry> WalkToRun;
+	TArray<FGaitTransitionEntry> RunToWalk;
+	const auto Built =
+		BuildEntries(WalkCycle, WalkToRunLF, ELocomotionClip::ELC_WalkToRunLF, WalkToRunRF,
+		             ELocomotionClip::ELC_WalkToRunRF, WalkToRun) &&
+		BuildEntries(RunCycle, RunToWalkLF, ELocomotionClip::ELC_RunToWalkLF, RunToWalkRF,
+		             ELocomotionClip::ELC_RunToWalkRF, RunToWalk);
+
+	if (!Built)
+	{
+		UE_LOG(LogDaysGun, Warning, TEXT("GaitTransitionEntryTable %s: source clips incomplete, table kept"),
+		       *GetName());
+		return false;
+	}
+
+	WalkToRunEntries = MoveTemp(WalkToRun);
+	RunToWalkEntries = MoveTemp(RunToWalk);
+	BuildMs = static_cast<float>(FPlatformTime::ToMilliseconds64(FPlatformTime::Cycles64() - StartCycles));
+
+	const auto Bytes = (WalkToRunEntries.Num() + RunToWalkEntries.Num()) *
+		static_cast<int32>(sizeof(FGaitTransitionEntry));
+	UE_LOG(LogDaysGun, Display, TEXT("GaitTransitionEntryTable %s: %d phase bins in %.2f ms, %d bytes"), *GetName(),
+	       GetNumPhaseBins(), BuildMs, Bytes);
+	return true;
+}
+
+bool UGaitTransitionEntryTable::BuildEntries(UAnimSequence* Cycle, UAnimSequence* LeftFootClip,
+                                             ELocomotionClip LeftFoot, UAnimSequence* RightFootClip,
+                                             ELocomotionClip RightFoot, TArray<FGaitTransitionEntry>& OutEntries)
+{
+	using namespace GaitTransitionAnalysis;
+
+	TArray<FPoseSample> CycleSamples;
+	TArray<FPoseSample> LeftFootSamples;
+	TArray<FPoseSample> RightFootSamples;
+	if (!SampleClip(Cycle, MatchBones, FootPhaseCurveName, 1.f, CycleSamples) ||
+		!SampleClip(LeftFootClip, MatchBones, FootPhaseCurveName, EntryWindow, LeftFootSamples) ||
+		!SampleClip(RightFootClip, MatchBones, FootPhaseCurveName, EntryWindow, RightFootSamples))
+	{
+		return false;
+	}
+
+	if (CycleSamples[0].FootPhase < 0.f)
+	{
+		UE_LOG(LogDaysGun, Warning, TEXT("GaitTransitionEntryTable: %s has no %s curve"), *Cycle->GetName(),
+		       *FootPhaseCurveName.ToString());
+		return false;
+	}
+
+	const auto NumBins = FMath::Max(NumPhaseBins, 1);
+	OutEntries.SetNum(NumBins);
+	for (int32 Bin = 0; Bin < NumBins; ++Bin)
+	{
+		// The cycle pose closest to the middle of the bin stands for the whole bin
+		const auto Phase = (Bin + 0.5f) / NumBins;
+		const FPoseSample* Source = &CycleSamples[0];
+		for (const auto& Sample : CycleSamples)
+		{
+			if (GetPhaseDistance(Sample.FootPhase, Phase) < GetPhaseDistance(Source->FootPhase, Phase))
+			{
+				Source = &Sample;
+			}
+		}
+
+		auto BestCost = MAX_flt;
+		const auto Search = [&](const TArray<FPoseSample>& Samples, ELocomotionClip Clip)
+		{
+			for (const auto& Sample : Samples)
+			{
+				const auto Cost = GetCost(*Source, Sample, FootPhaseWeight);
+				if (Cost >= BestCost) continue;
+
+				BestCost = Cost;
+				OutEntries[Bin].Clip = Clip;
+				OutEntries[Bin].StartTime = Sample.Time;
+			}
+		};
+		Search(LeftFootSamples, LeftFoot);
+		Search(RightFootSamples, RightFoot);
+	}
+
+	return true;
+}
+#endif
+
+#if !UE_BUILD_SHIPPING
+static FAutoConsoleCommand GGaitTransitionTableCommand(
+	TEXT("DaysGun.Anim.TransitionTable"),
+	TEXT("Prints the build time and size of every loaded gait transition entry table and times its lookup against ")
+	TEXT("the foot phase threshold it replaces"),
+	FConsoleCommandDelegate::CreateLambda([]()
+	{
+		constexpr int32 NumPhases = 1024;
+		constexpr int32 NumLookups = 1000000;
+
+		FRandomStream Random(NumPhases);
+		TArray<float> Phases;
+		for (int32 Index = 0; Index < NumPhases; ++Index)
+		{
+			Phases.Add(Random.FRand());
+		}
+
+		// Summed so the compiler keeps the loops
+		uint32 Checksum = 0;
+		auto StartCycles = FPlatformTime::Cycles64();
+		const FLocomotionDecisionParams Params;
+		for (int32 Index = 0; Index < NumLookups; ++Index)
+		{
+			Checksum += static_cast<uint32>(FLocomotionDecisionCore::SelectTransitionClip(
+				Phases[Index & (NumPhases - 1)], Index & 1, Params));
+		}
+		const auto ThresholdNs = FPlatformTime::ToMilliseconds64(FPlatformTime::Cycles64() - StartCycles) * 1e6 /
+			NumLookups;
+
+		int32 NumTables = 0;
+		for (TObjectIterator<UGaitTransitionEntryTable> It; It; ++It)
+		{
+			const auto Table = *It;
+			if (Table->IsTemplate() || !Table->IsBuilt()) continue;
+
+			++NumTables;
+			StartCycles = FPlatformTime::Cycles64();
+			for (int32 Index = 0; Index < NumLookups; ++Index)
+			{
+				Checksum += static_cast<uint32>(Table->Find(Index & 1, Phases[Index & (NumPhases - 1)]).Clip);
+			}
+			const auto LookupNs = FPlatformTime::ToMilliseconds64(FPlatformTime::Cycles64() - StartCycles) * 1e6 /
+				NumLookups;
+
+			UE_LOG(LogDaysGun, Display,
+			       TEXT("%s: %d phase bins, %d bytes, built in %.2f ms, lookup %.2f ns, threshold %.2f ns"),
+			       *Table->GetName(), Table->GetNumPhaseBins(), Table->GetNumPhaseBins() * 2 *
+			       static_cast<int32>(sizeof(FGaitTransitionEntry)), Table->GetBuildMs(), LookupNs, ThresholdNs);
+		}
+
+		if (NumTables == 0)
+		{
+			UE_LOG(LogDaysGun, Display, TEXT("No built gait transition entry table loaded, threshold %.2f ns"),
+			       ThresholdNs);
+		}
+		UE_LOG(LogDaysGun, Verbose, TEXT("Checksum %u"), Checksum);
+	}));
+#endif
@@ -0,0 +1,246 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "Locomotion/LandingPrediction.h"
+
+#include "DaysGun.h"
+#include "Components/CapsuleComponent.h"
+#include "Engine/World.h"
+#include "GameFramework/Character.h"
+#include "GameFramework/CharacterMovementComponent.h"
+
+DECLARE_DWORD_COUNTER_STAT(TEXT("Landing Sweeps"), STAT_LandingSweeps, STATGROUP_DaysGun);
+
+namespace
+{
+	/** Segment index in the low bits of the trace user data, prediction generation above */
+	constexpr int32 SegmentBits = 8;
+	constexpr uint32 SegmentMask = (1u << SegmentBits) - 1;
+	constexpr uint32 GenerationMask = MAX_uint32 >> SegmentBits;
+
+	/** Game thread only, reported and reset by DaysGun.Landing.Stats */
+	struct FLandingStats
+	{
+		double AirborneSeconds = 0.0;
+		int64 NumSweeps = 0;
+		int64 NumPredictions = 0;
+		int64 NumRefreshes = 0;
+		int64 NumLandings = 0;
+		int64 NumPredictedLandings = 0;
+		double LandingTimeError = 0.0;
+		int64 NumImpactFrames = 0;
+		double ImpactFrameError = 0.0;
+	};
+
+	FLandingStats LandingStats;
+
+	/** The baseline for the stats: no sweeps, land animations start when the character touches down */
+	bool GReactiveLanding = false;
+}
+
+void FBallisticArc::SetAirControl(const FVector& InAirAcceleration, float MaxSpeed)
+{
+	AirAcceleration = FVector(InAirAcceleration.X, InAirAcceleration.Y, 0.f);
+	AirControlSeconds = 0.f;
+
+	const FVector LateralVelocity(Velocity.X, Velocity.Y, 0.f);
+	const auto A = AirAcceleration.SizeSquared();
+	const auto C = LateralVelocity.SizeSquared() - FMath::Square(MaxSpeed);
+	if (A <= UE_KINDA_SMALL_NUMBER || C >= 0.f) return;
+
+	// Positive root of |LateralVelocity + AirAcceleration * t| = MaxSpeed, C < 0 keeps it real and positive
+	const auto B = 2.f * FVector::DotProduct(LateralVelocity, AirAcceleration);
+	AirControlSeconds = (-B + FMath::Sqrt(FMath::Square(B) - 4.f * A * C)) / (2.f * A);
+}
+
+bool FLandingPredictor::IsPredictionEnabled()
+{
+	return !GReactiveLanding;
+}
+
+void FLandingPredictor::RecordImpactFrameError(float Seconds)
+{
+	++LandingStats.NumImpactFrames;
+	LandingStats.ImpactFrameError += FMath::Abs(Seconds);
+}
+
+void FLandingPredictor::Start(UObject* Owner, const ACharacter& Character, const FLandingPredictionParams& Params)
+{
+	Active = true;
+	++LandingStats.NumPredictions;
+	Predict(Owner, Character, Params);
+}
+
+void FLandingPredictor::Update(UObject* Owner, const ACharacter& Character, const FLandingPredictionParams& Params,
+                               float DeltaSeconds)
+{
+	if (!Active) return;
+	LandingStats.AirborneSeconds += DeltaSeconds;
+
+	const auto Now = Character.GetWorld()->GetTimeSeconds();
+	const float Elapsed = Now - Arc.StartTime;
+
+	// A new input direction, a bump or a jump pad moved the character off the arc
+	const auto LeftArc = FVector::DistSquared(Character.GetVelocity(), Arc.GetVelocity(Elapsed)) >
+		FMath::Square(Params.VelocityTolerance);
+
+	// Fell past the predicted touch down, or past the end of the swept arc without a hit
+	const auto Resolved = Segments.Num() > 0 && !Segments.ContainsByPredicate([](const FSegment& Segment)
+	{
+		return Segment.Result == ESegmentResult::Pending;
+	});
+	const auto Overdue = Resolved &&
+		Now > (Landing.Valid ? Landing.Time + SegmentSeconds : Arc.StartTime + Params.MaxSeconds);
+
+	if (!LeftArc && !Overdue) return;
+
+	++LandingStats.NumRefreshes;
+	Predict(Owner, Character, Params);
+}
+
+void FLandingPredictor::Stop(bool Landed, double Now)
+{
+	if (!Active) return;
+
+	if (Landed)
+	{
+		++LandingStats.NumLandings;
+		if (Landing.Valid)
+		{
+			++LandingStats.NumPredictedLandings;
+			LandingStats.LandingTimeError += FMath::Abs(Now - Landing.Time);
+		}
+	}
+
+	// Sweeps still in flight belong to this flight
+	++Generation;
+	Active = false;
+	Landing = FLandingPoint();
+	Segments.Reset();
+}
+
+void FLandingPredictor::Predict(UObject* Owner, const ACharacter& Character, const FLandingPredictionParams& Params)
+{
+	const auto World = Character.GetWorld();
+	const auto Movement = Character.GetCharacterMovement();
+	const auto Capsule = Character.GetCapsuleComponent();
+	if (!World || !Movement || !Capsule) return;
+
+	++Generation;
+	Arc.Location = Character.GetActorLocation();
+	Arc.Velocity = Character.GetVelocity();
+	Arc.Gravity = FVector(0.f, 0.f, Movement->GetGravityZ());
+	Arc.SetAirControl(Movement->GetCurrentAcceleration() * Movement->AirControl, Movement->GetMaxSpeed());
+	Arc.StartTime = World->GetTimeSeconds();
+	Landing = FLandingPoint();
+
+	const auto NumSegments = FMath::Clamp(Params.NumSegments, 1, static_cast<int32>(SegmentMask) + 1);
+	SegmentSeconds = Params.MaxSeconds / NumSegments;
+	Segments.Reset();
+	Segments.SetNum(NumSegments);
+
+	FCollisionQueryParams QueryParams(SCENE_QUERY_STAT(LandingPrediction), false, &Character);
+	FCollisionResponseParams ResponseParams;
+	Capsule->InitSweepCollisionParams(QueryParams, ResponseParams);
+
+	const auto Shape = Capsule->GetCollisionShape();
+	const auto Channel = Capsule->GetCollisionObjectType();
+	const auto Rotation = Capsule->GetComponentQuat();
+
+	FTraceDelegate Delegate = FTraceDelegate::CreateWeakLambda(Owner, [this](const FTraceHandle& Handle,
+	                                                                          FTraceDatum& Datum)
+	{
+		OnSweepDone(Handle, Datum);
+	});
+
+	const auto UserData = (Generation & GenerationMask) << SegmentBits;
+	for (int32 Index = 0; Index < NumSegments; ++Index)
+	{
+		World->AsyncSweepByChannel(EAsyncTraceType::Single, Arc.GetLocation(Index * SegmentSeconds),
+		                           Arc.GetLocation((Index + 1) * SegmentSeconds), Rotation, Channel, Shape,
+		                           QueryParams, ResponseParams, &Delegate, UserData | Index);
+	}
+
+	LandingStats.NumSweeps += NumSegments;
+	INC_DWORD_STAT_BY(STAT_LandingSweeps, NumSegments);
+}
+
+void FLandingPredictor::OnSweepDone(const FTraceHandle& Handle, FTraceDatum& Datum)
+{
+	if (!Active || Datum.UserData >> SegmentBits != (Generation & GenerationMask)) return;
+
+	const int32 Index = Datum.UserData & SegmentMask;
+	if (!Segments.IsValidIndex(Index)) return;
+
+	// The first segment starts where the character stands at take-off
+	const auto Hit = Datum.OutHits.FindByPredicate([](const FHitResult& HitResult)
+	{
+		return HitResult.bBlockingHit && !HitResult.bStartPenetrating;
+	});
+
+	auto& Segment = Segments[Index];
+	Segment.Result = Hit ? ESegmentResult::Hit : ESegmentResult::Miss;
+	if (Hit)
+	{
+		Segment.HitTime = (Index + Hit->Time) * SegmentSeconds;
+		Segment.Location = Hit->Location;
+		Segment.ImpactNormal = Hit->ImpactNormal;
+	}
+
+	ResolveLanding();
+}
+
+void FLandingPredictor::ResolveLanding()
+{
+	// Segments come back in any order, the landing is the first hit along the arc
+	for (const auto& Segment : Segments)
+	{
+		if (Segment.Result == ESegmentResult::Pending) return;
+		if (Segment.Result == ESegmentResult::Miss) continue;
+
+		Landing.Location = Segment.Location;
+		Landing.ImpactNormal = Segment.ImpactNormal;
+		Landing.Velocity = Arc.GetVelocity(Segment.HitTime);
+		Landing.Time = Arc.StartTime + Segment.HitTime;
+		Landing.Valid = true;
+		return;
+	}
+}
+
+#if !UE_BUILD_SHIPPING
+static FAutoConsoleCommandWithArgs GLandingStatsCommand(
+	TEXT("DaysGun.Landing.Stats"),
+	TEXT("Prints landing prediction sweeps per airborne second and the landing time error since the last reset. "
+		"Args: [reset]"),
+	FConsoleCommandWithArgsDelegate::CreateLambda([](const TArray<FString>& Args)
+	{
+		const auto& Stats = LandingStats;
+		UE_LOG(LogDaysGun, Display, TEXT("Landing: %.1f s airborne, %lld sweeps, %.1f sweeps per airborne second, "
+			       "%lld predictions, %lld refreshes%s"),
+		       Stats.AirborneSeconds, Stats.NumSweeps,
+		       Stats.AirborneSeconds > 0.0 ? Stats.NumSweeps / Stats.AirborneSeconds : 0.0,
+		       Stats.NumPredictions, Stats.NumRefreshes,
+		       GReactiveLanding ? TEXT(", reactive baseline") : TEXT(""));
+		UE_LOG(LogDaysGun, Display, TEXT("Landing: %lld/%lld landings predicted, mean time error %.1f ms"),
+		       Stats.NumPredictedLandings, Stats.NumLandings,
+		       Stats.NumPredictedLandings > 0 ? Stats.LandingTimeError / Stats.NumPredictedLandings * 1000.0 : 0.0);
+		UE_LOG(LogDaysGun, Display, TEXT("Landing: %lld land animations, impact frame %.1f ms from the touch down"),
+		       Stats.NumImpactFrames,
+		       Stats.NumImpactFrames > 0 ? Stats.ImpactFrameError / Stats.NumImpactFrames * 1000.0 : 0.0);
+
+		if (Args.Num() > 0 && Args[0] == TEXT("reset"))
+		{
+			LandingStats = FLandingStats();
+		}
+	}));
+
+static FAutoConsoleCommandWithArgs GLandingReactiveCommand(
+	TEXT("DaysGun.Landing.Reactive"),
+	TEXT("Plays land animations when the character touches down, without prediction, the baseline for ")
+	TEXT("DaysGun.Landing.Stats. Args: 0|1"),
+	FConsoleCommandWithArgsDelegate::CreateLambda([](const TArray<FString>& Args)
+	{
+		if (Args.Num() > 0) GReactiveLanding = Args[0].ToBool();
+		UE_LOG(LogDaysGun, Display, TEXT("Landing: reactive %s"), GReactiveLanding ? TEXT("on") : TEXT("off"));
+	}));
+#endif
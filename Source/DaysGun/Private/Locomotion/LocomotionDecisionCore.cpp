@@ -0,0 +1,244 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "Locomotion/LocomotionDecisionCore.h"
+
+#include "Math/DaysGunMath.h"
+
+void FLocomotionDecisionCore::Reset()
+{
+	LocomotionState = ELocomotionState::ELS_Idle;
+	PrevLocomotionState = ELocomotionState::ELS_Idle;
+	TimeInLocomotionState = 0.f;
+	StartAngle = 0.f;
+	EntryFlags = OnEntryFlags();
+
+	StopClip = ELocomotionClip::ELC_None;
+	StartClip = ELocomotionClip::ELC_None;
+	GaitTransitionClip = ELocomotionClip::ELC_None;
+}
+
+ELocomotionDecisionEvents FLocomotionDecisionCore::Step(const FLocomotionDecisionInput& InInput,
+                                                        const FLocomotionDecisionParams& InParams,
+                                                        ILocomotionDecisionQueries& InQueries)
+{
+	Input = &InInput;
+	Params = &InParams;
+	Queries = &InQueries;
+	Events = ELocomotionDecisionEvents::None;
+
+	DetermineLocomotionState();
+	TrackLocomotionStates();
+
+	Input = nullptr;
+	Params = nullptr;
+	Queries = nullptr;
+	return Events;
+}
+
+ELocomotionClip FLocomotionDecisionCore::SelectStartClip(float Angle, bool Run)
+{
+	if (FDaysGunMath::InRange(Angle, -135.f, -45.f, false, true))
+	{
+		return Run ? ELocomotionClip::ELC_RunStart90L : ELocomotionClip::ELC_WalkStart90L;
+	}
+	if (FDaysGunMath::InRange(Angle, -180.f, -135.f, true, true))
+	{
+		return Run ? ELocomotionClip::ELC_RunStart180L : ELocomotionClip::ELC_WalkStart180L;
+	}
+	if (FDaysGunMath::InRange(Angle, 45.f, 135.f, true, false))
+	{
+		return Run ? ELocomotionClip::ELC_RunStart90R : ELocomotionClip::ELC_WalkStart90R;
+	}
+	if (FDaysGunMath::InRange(Angle, 135.f, 180.f, true, true))
+	{
+		return Run ? ELocomotionClip::ELC_RunStart180R : ELocomotionClip::ELC_WalkStart180R;
+	}
+	return Run ? ELocomotionClip::ELC_RunStartF : ELocomotionClip::ELC_WalkStartF;
+}
+
+ELocomotionClip FLocomotionDecisionCore::SelectTransitionClip(float FootPhase, bool WalkToRun,
+                                                              const FLocomotionDecisionParams& DecisionParams)
+{
+	if (FootPhase >= DecisionParams.MoveDataLeftFootPhaseLimit)
+	{
+		return WalkToRun ? ELocomotionClip::ELC_WalkToRunLF : ELocomotionClip::ELC_RunToWalkLF;
+	}
+	return WalkToRun ? ELocomotionClip::ELC_WalkToRunRF : ELocomotionClip::ELC_RunToWalkRF;
+}
+
+float FLocomotionDecisionCore::CalculateConstRotationRate(float InputVectorRotationRate,
+                                                          const FLocomotionDecisionParams& DecisionParams)
+{
+	return FDaysGunMath::MapRangeClamped(FMath::Abs(InputVectorRotationRate),
+	                                     0.f, DecisionParams.RotationRateInputRange,
+	                                     DecisionParams.ConstRotationRateMin, DecisionParams.ConstRotationRateMax);
+}
+
+float FLocomotionDecisionCore::CalculateSmoothRotationRate(float InputVectorRotationRate,
+                                                           const FLocomotionDecisionParams& DecisionParams)
+{
+	return FDaysGunMath::MapRangeClamped(FMath::Abs(InputVectorRotationRate),
+	                                     0.f, DecisionParams.RotationRateInputRange,
+	                                     DecisionParams.SmoothRotationRateMin, DecisionParams.SmoothRotationRateMax);
+}
+
+void FLocomotionDecisionCore::AdvanceTargetYaw(float VelocityYaw, float InputVectorRotationRate, float DeltaSeconds,
+                                               const FLocomotionDecisionParams& DecisionParams, float& TargetYaw,
+                                               float& SmoothedYaw)
+{
+	TargetYaw = FDaysGunMath::YawInterpConstantTo(TargetYaw, VelocityYaw, DeltaSeconds,
+	                                              CalculateConstRotationRate(InputVectorRotationRate, DecisionParams));
+	SmoothedYaw = FDaysGunMath::YawInterpTo(SmoothedYaw, TargetYaw, DeltaSeconds,
+	                                        CalculateSmoothRotationRate(InputVectorRotationRate, DecisionParams));
+}
+
+void FLocomotionDecisionCore::DetermineLocomotionState()
+{
+	PrevLocomotionState = LocomotionState;
+
+	if (Input->IsFalling || Input->StartedJumping)
+	{
+		LocomotionState = ELocomotionState::ELS_Jump;
+		return;
+	}
+
+	TimeInLocomotionState += Input->DeltaSeconds;
+	if (TimeInLocomotionState <= Params->MinTimeInLocomotionState) return;
+
+	DetermineGroundLocomotionState();
+}
+
+void FLocomotionDecisionCore::DetermineGroundLocomotionState()
+{
+	if (Input->VelocityAccelerationDot < -0.5f)
+	{
+		LocomotionState = ELocomotionState::ELS_Idle;
+		return;
+	}
+
+	if (IsMovementWithinThresholds(Params->RunMinCurrentSpeed, Params->RunMinMaxSpeed,
+	                               Params->RunMinInputAcceleration))
+	{
+		LocomotionState = ELocomotionState::ELS_Run;
+		return;
+	}
+
+	if (IsMovementWithinThresholds(Params->WalkMinCurrentSpeed, Params->WalkMinMaxSpeed,
+	                               Params->WalkMinInputAcceleration))
+	{
+		LocomotionState = ELocomotionState::ELS_Walk;
+		return;
+	}
+
+	LocomotionState = ELocomotionState::ELS_Idle;
+}
+
+void FLocomotionDecisionCore::TrackLocomotionStates()
+{
+	TrackLocomotionState(ELocomotionState::ELS_Idle, EntryFlags.IdleFlag, &FLocomotionDecisionCore::OnEntryIdle);
+	TrackLocomotionState(ELocomotionState::ELS_Walk, EntryFlags.WalkFlag, &FLocomotionDecisionCore::OnEntryWalk);
+	TrackLocomotionState(ELocomotionState::ELS_Run, EntryFlags.RunFlag, &FLocomotionDecisionCore::OnEntryRun);
+	TrackLocomotionState(ELocomotionState::ELS_Crouch, EntryFlags.CrouchFlag, nullptr);
+	TrackLocomotionState(ELocomotionState::ELS_Jump, EntryFlags.JumpFlag, nullptr);
+}
+
+bool FLocomotionDecisionCore::IsMovementWithinThresholds(float MinCurrentSpeed, float MinMaxSpeed,
+                                                         float MinInputAcceleration) const
+{
+	return MinCurrentSpeed <= Input->GroundSpeed &&
+		MinMaxSpeed <= Input->MaxSpeed &&
+		MinInputAcceleration <= Input->InputSize;
+}
+
+void FLocomotionDecisionCore::TrackLocomotionState(ELocomotionState TracedState, bool& EnterFlag,
+                                                   void (FLocomotionDecisionCore::*OnEnterCallback)())
+{
+	const bool InState = LocomotionState == TracedState;
+	if (EnterFlag == InState) return;
+
+	EnterFlag = InState;
+	if (!InState) return;
+
+	Events |= ELocomotionDecisionEvents::StateEntered;
+	if (OnEnterCallback)
+	{
+		(this->*OnEnterCallback)();
+	}
+
+	// Entry decisions read how long the previous state lasted, so the timer restarts only after them
+	TimeInLocomotionState = 0.f;
+}
+
+void FLocomotionDecisionCore::UpdateStartAngle()
+{
+	// The predicted heading already bends the current velocity towards the input, the raw yaws are the fallback
+	float MovementYaw;
+	if (!Queries->GetPredictedHeading(Params->StartPredictionSeconds, MovementYaw))
+	{
+		MovementYaw = Input->GroundSpeed > Params->StartAngleInputMinSpeed ? Input->InputYaw : Input->VelocityYaw;
+	}
+	StartAngle = FDaysGunMath::DeltaYaw(MovementYaw, Input->ActorYaw);
+}
+
+void FLocomotionDecisionCore::OnEntryIdle()
+{
+	// Averaged, so the speed braking started from picks the clip rather than the first braking step
+	const auto StopSpeed = Queries->GetAverageGroundSpeed(Params->TrajectoryRateWindow);
+	StopClip = StopSpeed > Params->RunStopSpeedLimit ? ELocomotionClip::ELC_RunStop : ELocomotionClip::ELC_WalkStop;
+	Events |= ELocomotionDecisionEvents::StopSelected;
+}
+
+void FLocomotionDecisionCore::OnEntryWalk()
+{
+	const auto SelectStart = [this]()
+	{
+		UpdateStartAngle();
+		StartClip = SelectStartClip(StartAngle, false);
+		Events |= ELocomotionDecisionEvents::StartSelected;
+	};
+
+	if (PrevLocomotionState == ELocomotionState::ELS_Run)
+	{
+		if (Input->GroundSpeed < Params->MaxSpeedForPlayingStartAnim)
+		{
+			SelectStart();
+		}
+		else if (Params->MinTimeGaitTransitionAnim < TimeInLocomotionState)
+		{
+			GaitTransitionClip = SelectTransitionClip(Queries->GetFootPhase(), false, *Params);
+			Events |= ELocomotionDecisionEvents::GaitTransitionSelected;
+		}
+	}
+	else if (PrevLocomotionState == ELocomotionState::ELS_Idle)
+	{
+		SelectStart();
+	}
+}
+
+void FLocomotionDecisionCore::OnEntryRun()
+{
+	const auto SelectStart = [this]()
+	{
+		UpdateStartAngle();
+		StartClip = SelectStartClip(StartAngle, true);
+		Events |= ELocomotionDecisionEvents::StartSelected;
+	};
+
+	if (PrevLocomotionState == ELocomotionState::ELS_Walk)
+	{
+		if (Queries->IsInWalkStartState())
+		{
+			SelectStart();
+		}
+		else if (Params->MinTimeGaitTransitionAnim < TimeInLocomotionState)
+		{
+			GaitTransitionClip = SelectTransitionClip(Queries->GetFootPhase(), true, *Params);
+			Events |= ELocomotionDecisionEvents::GaitTransitionSelected;
+		}
+	}
+	else if (PrevLocomotionState == ELocomotionState::ELS_Idle)
+	{
+		SelectStart();
+	}
+}
@@ -0,0 +1,432 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "Locomotion/LocomotionRecorderSubsystem.h"
+
+#include "DaysGun.h"
+#include "ObjectTrace.h"
+#include "Animation/PlayerAnimInstance.h"
+#include "Engine/World.h"
+#include "Misc/CommandLine.h"
+#include "Misc/FileHelper.h"
+#include "Misc/Paths.h"
+#include "Soak/SoakTestSubsystem.h"
+
+UE_TRACE_CHANNEL_DEFINE(DaysGunLocomotionChannel)
+
+UE_TRACE_EVENT_BEGIN(DaysGunLocomotion, DecisionFrame)
+	UE_TRACE_EVENT_FIELD(uint64, Cycle)
+	UE_TRACE_EVENT_FIELD(uint64, AnimInstanceId)
+	UE_TRACE_EVENT_FIELD(float, StartAngle)
+	UE_TRACE_EVENT_FIELD(float, GroundSpeed)
+	UE_TRACE_EVENT_FIELD(float, VelocityAccelerationDot)
+	UE_TRACE_EVENT_FIELD(float, TimeInLocomotionState)
+	UE_TRACE_EVENT_FIELD(float, FootPhase)
+	UE_TRACE_EVENT_FIELD(uint8, LocomotionState)
+	UE_TRACE_EVENT_FIELD(uint8, Events)
+	UE_TRACE_EVENT_FIELD(uint8, Clip)
+UE_TRACE_EVENT_END()
+
+namespace
+{
+	FString GetEnumName(ELocomotionState State)
+	{
+		return StaticEnum<ELocomotionState>()->GetDisplayNameTextByValue(static_cast<int64>(State)).ToString();
+	}
+
+	FString GetEnumName(ELocomotionClip Clip)
+	{
+		return StaticEnum<ELocomotionClip>()->GetDisplayNameTextByValue(static_cast<int64>(Clip)).ToString();
+	}
+
+	FString DescribeEvents(ELocomotionDecisionEvents Events, ELocomotionClip Clip)
+	{
+		FString Description;
+		if (EnumHasAnyFlags(Events, ELocomotionDecisionEvents::StateEntered)) Description += TEXT(" <state entered>");
+		if (EnumHasAnyFlags(Events, ELocomotionDecisionEvents::StopSelected |
+		                            ELocomotionDecisionEvents::StartSelected |
+		                            ELocomotionDecisionEvents::GaitTransitionSelected))
+		{
+			Description += FString::Printf(TEXT(" <selected %s>"), *GetEnumName(Clip));
+		}
+		return Description;
+	}
+}
+
+void ULocomotionRecorderSubsystem::Initialize(FSubsystemCollectionBase& Collection)
+{
+	Super::Initialize(Collection);
+
+	if (FParse::Param(FCommandLine::Get(), TEXT("DaysGunLocomotionRecorder")))
+	{
+		StartCapture();
+	}
+}
+
+void ULocomotionRecorderSubsystem::Tick(float DeltaTime)
+{
+	if (!Benchmark.Tick(DeltaTime)) return;
+
+	auto& Phase = BenchmarkPhases[Benchmark.GetPhaseIndex()];
+	if (Phase.Frames == 0)
+	{
+		// Drop what was recorded while settling
+		RecordCycles = 0;
+		NumRecords = 0;
+	}
+
+	++Phase.Frames;
+	Phase.FrameMs += FSubsystemBenchmark::GetFrameMs();
+	Phase.RecordCycles = RecordCycles;
+	Phase.NumRecords = NumRecords;
+
+	if (!Benchmark.IsPhaseDone()) return;
+	if (!Benchmark.NextPhase())
+	{
+		FinishBenchmark();
+		return;
+	}
+
+	if (Benchmark.GetPhaseIndex() == 1)
+	{
+		StartCapture();
+		return;
+	}
+
+	// What a Rewind Debugger session costs on top of the capture
+	WasTracing = UE_TRACE_CHANNELEXPR_IS_ENABLED(DaysGunLocomotionChannel);
+	UE::Trace::ToggleChannel(TEXT("DaysGunLocomotion"), true);
+}
+
+bool ULocomotionRecorderSubsystem::IsTickable() const
+{
+	return Benchmark.IsRunning();
+}
+
+TStatId ULocomotionRecorderSubsystem::GetStatId() const
+{
+	RETURN_QUICK_DECLARE_CYCLE_STAT(ULocomotionRecorderSubsystem, STATGROUP_Tickables);
+}
+
+bool ULocomotionRecorderSubsystem::DoesSupportWorldType(const EWorldType::Type WorldType) const
+{
+	return WorldType == EWorldType::Game || WorldType == EWorldType::PIE;
+}
+
+void ULocomotionRecorderSubsystem::Record(const UPlayerAnimInstance* AnimInstance, const FLocomotionRecord& InRecord)
+{
+	const auto StartCycles = FPlatformTime::Cycles64();
+
+	if (UE_TRACE_CHANNELEXPR_IS_ENABLED(DaysGunLocomotionChannel))
+	{
+#if OBJECT_TRACE_ENABLED
+		const auto AnimInstanceId = FObjectTrace::GetObjectId(AnimInstance);
+#else
+		const uint64 AnimInstanceId = reinterpret_cast<UPTRINT>(AnimInstance);
+#endif
+		UE_TRACE_LOG(DaysGunLocomotion, DecisionFrame, DaysGunLocomotionChannel)
+			<< DecisionFrame.Cycle(StartCycles)
+			<< DecisionFrame.AnimInstanceId(AnimInstanceId)
+			<< DecisionFrame.StartAngle(InRecord.StartAngle)
+			<< DecisionFrame.GroundSpeed(InRecord.GroundSpeed)
+			<< DecisionFrame.VelocityAccelerationDot(InRecord.VelocityAccelerationDot)
+			<< DecisionFrame.TimeInLocomotionState(InRecord.TimeInLocomotionState)
+			<< DecisionFrame.FootPhase(InRecord.FootPhase)
+			<< DecisionFrame.LocomotionState(static_cast<uint8>(InRecord.LocomotionState))
+			<< DecisionFrame.Events(static_cast<uint8>(InRecord.Events))
+			<< DecisionFrame.Clip(static_cast<uint8>(InRecord.Clip));
+
+		if (EnumHasAnyFlags(InRecord.Events, ELocomotionDecisionEvents::StopSelected))
+		{
+			TRACE_OBJECT_EVENT(AnimInstance, LocomotionStopSelected);
+		}
+		if (EnumHasAnyFlags(InRecord.Events, ELocomotionDecisionEvents::StartSelected))
+		{
+			TRACE_OBJECT_EVENT(AnimInstance, LocomotionStartSelected);
+		}
+		if (EnumHasAnyFlags(InRecord.Events, ELocomotionDecisionEvents::GaitTransitionSelected))
+		{
+			TRACE_OBJECT_EVENT(AnimInstance, LocomotionGaitTransitionSelected);
+		}
+	}
+
+	if (Capturing)
+	{
+		const FObjectKey Key(AnimInstance);
+		auto TrackIndex = Tracks.Find(Key);
+		if (TrackIndex == INDEX_NONE && Tracks.Num() < MaxCharacters)
+		{
+			FTrack NewTrack;
+			NewTrack.AnimInstance = AnimInstance;
+			NewTrack.Name = AnimInstance->GetOwningActor()
+				                ? AnimInstance->GetOwningActor()->GetName()
+				                : AnimInstance->GetName();
+			NewTrack.FirstSlot = Tracks.Num() * FramesPerCharacter;
+			TrackIndex = Tracks.Add(Key, NewTrack);
+		}
+		else if (TrackIndex == INDEX_NONE)
+		{
+			Dropped.Add(Key);
+		}
+
+		if (TrackIndex != INDEX_NONE)
+		{
+			auto& Track = Tracks[TrackIndex];
+			Track.Head = (Track.Head + 1) % FramesPerCharacter;
+			Track.Count = FMath::Min(Track.Count + 1, FramesPerCharacter);
+			Records[Track.FirstSlot + Track.Head] = InRecord;
+		}
+	}
+
+	RecordCycles += FPlatformTime::Cycles64() - StartCycles;
+	++NumRecords;
+}
+
+void ULocomotionRecorderSubsystem::StartCapture()
+{
+	LLM_SCOPE_BYTAG(DaysGun_Animation);
+
+	MaxCharacters = FMath::Max(MaxCharacters, 0);
+	FramesPerCharacter = FMath::Max(FramesPerCharacter, 1);
+
+	Records.Reset();
+	Records.SetNumZeroed(MaxCharacters * FramesPerCharacter);
+	Tracks.Reset();
+	Dropped.Reset();
+	Capturing = true;
+
+	UE_LOG(LogDaysGun, Display, TEXT("Locomotion recorder capturing %d characters x %d steps, %.1f MB"),
+	       MaxCharacters, FramesPerCharacter, Records.GetAllocatedSize() / (1024.0 * 1024.0));
+}
+
+void ULocomotionRecorderSubsystem::StopCapture()
+{
+	Capturing = false;
+}
+
+const FLocomotionRecord& ULocomotionRecorderSubsystem::GetRecord(const FTrack& Track, int32 Age) const
+{
+	const auto Slot = (Track.Head - Age + FramesPerCharacter) % FramesPerCharacter;
+	return Records[Track.FirstSlot + Slot];
+}
+
+const ULocomotionRecorderSubsystem::FTrack* ULocomotionRecorderSubsystem::FindTrack(const FString& Character) const
+{
+	for (const auto& Track : Tracks)
+	{
+		if (Track.Count > 0 && (Character.IsEmpty() || Track.Name.Contains(Character))) return &Track;
+	}
+	return nullptr;
+}
+
+void ULocomotionRecorderSubsystem::PrintRecord(const FLocomotionRecord& Record, const TCHAR* Marker) const
+{
+	UE_LOG(LogDaysGun, Display,
+	       TEXT("%s %9.3f s frame %6u  %-6s %5.2f s  speed %6.1f  start angle %7.1f  vel.acc %5.2f  foot phase %5.2f%s"),
+	       Marker, Record.Time, Record.FrameNumber, *GetEnumName(Record.LocomotionState),
+	       Record.TimeInLocomotionState, Record.GroundSpeed, Record.StartAngle, Record.VelocityAccelerationDot,
+	       Record.FootPhase, *DescribeEvents(Record.Events, Record.Clip));
+}
+
+void ULocomotionRecorderSubsystem::PrintScrub(const FString& Character, float SecondsAgo, float Window) const
+{
+	const auto Track = FindTrack(Character);
+	if (!Track)
+	{
+		UE_LOG(LogDaysGun, Display, TEXT("No recorded character matches '%s'"), *Character);
+		return;
+	}
+
+	const auto Time = GetRecord(*Track, 0).Time - SecondsAgo;
+
+	// The step closest to the scrub time gets the cursor
+	int32 CursorAge = 0;
+	for (int32 Age = 0; Age < Track->Count; ++Age)
+	{
+		if (GetRecord(*Track, Age).Time <= Time)
+		{
+			CursorAge = Age;
+			break;
+		}
+		CursorAge = Age;
+	}
+
+	UE_LOG(LogDaysGun, Display, TEXT("%s at %.3f s (%.2f s ago), +-%.2f s:"), *Track->Name, Time, SecondsAgo, Window);
+	for (int32 Age = Track->Count - 1; Age >= 0; --Age)
+	{
+		const auto& Record = GetRecord(*Track, Age);
+		if (FMath::Abs(Record.Time - Time) > Window) continue;
+
+		PrintRecord(Record, Age == CursorAge ? TEXT(">") : TEXT(" "));
+	}
+}
+
+void ULocomotionRecorderSubsystem::PrintDecisions(const FString& Character) const
+{
+	int32 NumDecisions = 0;
+	for (const auto& Track : Tracks)
+	{
+		if (!Character.IsEmpty() && !Track.Name.Contains(Character)) continue;
+
+		UE_LOG(LogDaysGun, Display, TEXT("%s:"), *Track.Name);
+		for (int32 Age = Track.Count - 1; Age >= 0; --Age)
+		{
+			const auto& Record = GetRecord(Track, Age);
+			if (Record.Clip == ELocomotionClip::ELC_None) continue;
+
+			PrintRecord(Record, TEXT(" "));
+			++NumDecisions;
+		}
+	}
+
+	UE_LOG(LogDaysGun, Display, TEXT("%d decisions"), NumDecisions);
+}
+
+void ULocomotionRecorderSubsystem::PrintStatus() const
+{
+	int64 NumStored = 0;
+	for (const auto& Track : Tracks)
+	{
+		NumStored += Track.Count;
+	}
+
+	UE_LOG(LogDaysGun, Display,
+	       TEXT("Locomotion recorder %s: %d/%d characters, %d dropped, %lld steps stored, %.1f MB, trace channel %s"),
+	       Capturing ? TEXT("capturing") : TEXT("stopped"), Tracks.Num(), MaxCharacters, Dropped.Num(), NumStored,
+	       Records.GetAllocatedSize() / (1024.0 * 1024.0),
+	       UE_TRACE_CHANNELEXPR_IS_ENABLED(DaysGunLocomotionChannel) ? TEXT("on") : TEXT("off"));
+	UE_LOG(LogDaysGun, Display, TEXT("  %lld steps recorded, %.1f ns each"), NumRecords,
+	       NumRecords > 0 ? FPlatformTime::ToMilliseconds64(RecordCycles) * 1e6 / NumRecords : 0.0);
+}
+
+void ULocomotionRecorderSubsystem::StartBenchmark(int32 Count, float Seconds)
+{
+	const auto Soak = FSubsystemBenchmark::GetIdleSoak(GetWorld());
+	if (Capturing || !Soak || Count <= 0 || !Benchmark.Start(UE_ARRAY_COUNT(BenchmarkPhases), Seconds)) return;
+
+	Soak->SpawnBotsAround(Count, FSubsystemBenchmark::GetCenter(GetWorld()));
+	for (auto& Phase : BenchmarkPhases)
+	{
+		Phase = FBenchmarkPhase();
+	}
+}
+
+void ULocomotionRecorderSubsystem::FinishBenchmark()
+{
+	StopCapture();
+	if (!WasTracing)
+	{
+		UE::Trace::ToggleChannel(TEXT("DaysGunLocomotion"), false);
+	}
+
+	const auto Soak = GetWorld()->GetSubsystem<USoakTestSubsystem>();
+	FString Report = FString::Printf(TEXT("Locomotion recorder benchmark, %d characters, %s\n"),
+	                                 Soak ? Soak->GetNumBots() : 0, *FDateTime::Now().ToString());
+
+	const TCHAR* PhaseNames[] = {TEXT("Not capturing"), TEXT("Capturing"), TEXT("Capture+trace")};
+	for (int32 Index = 0; Index < UE_ARRAY_COUNT(BenchmarkPhases); ++Index)
+	{
+		const auto& Phase = BenchmarkPhases[Index];
+		const auto Frames = FMath::Max(Phase.Frames, 1);
+		Report += FString::Printf(TEXT("  %-14s frame %6.2f ms  recording %6.4f ms  %6.1f steps per frame\n"),
+		                          PhaseNames[Index], Phase.FrameMs / Frames,
+		                          FPlatformTime::ToMilliseconds64(Phase.RecordCycles) / Frames,
+		                          static_cast<double>(Phase.NumRecords) / Frames);
+	}
+
+	// The trace phase is what a Rewind Debugger session pays, so it is the one held to the budget
+	const auto& Tracing = BenchmarkPhases[2];
+	const auto RecordMs = FPlatformTime::ToMilliseconds64(Tracing.RecordCycles) / FMath::Max(Tracing.Frames, 1);
+	Report += FString::Printf(TEXT("  recording costs %.4f ms per frame, budget %.4f ms: %s\n"), RecordMs, BudgetMs,
+	                          RecordMs <= BudgetMs ? TEXT("OK") : TEXT("OVER BUDGET"));
+
+	TArray<FString> Lines;
+	Report.ParseIntoArrayLines(Lines);
+	for (const auto& Line : Lines)
+	{
+		UE_LOG(LogDaysGun, Display, TEXT("%s"), *Line);
+	}
+
+	const auto FileName = FPaths::ProjectSavedDir() / TEXT("LocomotionRecorder") / FString::Printf(
+		TEXT("Benchmark_%s.txt"), *FDateTime::Now().ToString());
+	FFileHelper::SaveStringToFile(Report, *FileName);
+	UE_LOG(LogDaysGun, Display, TEXT("Benchmark saved to %s"), *FileName);
+
+	Benchmark.Finish(GetWorld());
+}
+
+#if !UE_BUILD_SHIPPING
+static FAutoConsoleCommandWithWorld GLocomotionRecorderStartCommand(
+	TEXT("DaysGun.LocoRecorder.Start"),
+	TEXT("Starts recording locomotion decision inputs of every character, dropping the previous capture"),
+	FConsoleCommandWithWorldDelegate::CreateLambda([](UWorld* World)
+	{
+		if (const auto Subsystem = World ? World->GetSubsystem<ULocomotionRecorderSubsystem>() : nullptr)
+		{
+			Subsystem->StartCapture();
+		}
+	}));
+
+static FAutoConsoleCommandWithWorld GLocomotionRecorderStopCommand(
+	TEXT("DaysGun.LocoRecorder.Stop"),
+	TEXT("Stops recording and keeps the capture for scrubbing"),
+	FConsoleCommandWithWorldDelegate::CreateLambda([](UWorld* World)
+	{
+		if (const auto Subsystem = World ? World->GetSubsystem<ULocomotionRecorderSubsystem>() : nullptr)
+		{
+			Subsystem->StopCapture();
+			Subsystem->PrintStatus();
+		}
+	}));
+
+static FAutoConsoleCommandWithWorld GLocomotionRecorderStatusCommand(
+	TEXT("DaysGun.LocoRecorder.Status"),
+	TEXT("Prints capture size and recording cost"),
+	FConsoleCommandWithWorldDelegate::CreateLambda([](UWorld* World)
+	{
+		if (const auto Subsystem = World ? World->GetSubsystem<ULocomotionRecorderSubsystem>() : nullptr)
+		{
+			Subsystem->PrintStatus();
+		}
+	}));
+
+static FAutoConsoleCommandWithWorldAndArgs GLocomotionRecorderScrubCommand(
+	TEXT("DaysGun.LocoRecorder.Scrub"),
+	TEXT("Prints the recorded steps of a character around a point in the capture, decisions inline. ")
+	TEXT("Args: SecondsAgo [Character=first] [Window=0.25]"),
+	FConsoleCommandWithWorldAndArgsDelegate::CreateLambda([](const TArray<FString>& Args, UWorld* World)
+	{
+		if (const auto Subsystem = World ? World->GetSubsystem<ULocomotionRecorderSubsystem>() : nullptr)
+		{
+			const float SecondsAgo = Args.Num() > 0 ? FCString::Atof(*Args[0]) : 0.f;
+			const FString Character = Args.Num() > 1 ? Args[1] : FString();
+			const float Window = Args.Num() > 2 ? FCString::Atof(*Args[2]) : 0.25f;
+			Subsystem->PrintScrub(Character, SecondsAgo, Window);
+		}
+	}));
+
+static FAutoConsoleCommandWithWorldAndArgs GLocomotionRecorderDecisionsCommand(
+	TEXT("DaysGun.LocoRecorder.Decisions"),
+	TEXT("Prints every recorded start, stop and gait transition choice with its inputs. Args: [Character=all]"),
+	FConsoleCommandWithWorldAndArgsDelegate::CreateLambda([](const TArray<FString>& Args, UWorld* World)
+	{
+		if (const auto Subsystem = World ? World->GetSubsystem<ULocomotionRecorderSubsystem>() : nullptr)
+		{
+			Subsystem->PrintDecisions(Args.Num() > 0 ? Args[0] : FString());
+		}
+	}));
+
+static FAutoConsoleCommandWithWorldAndArgs GLocomotionRecorderBenchmarkCommand(
+	TEXT("DaysGun.LocoRecorder.Benchmark"),
+	TEXT("Spawns soak bots and compares frames without capture, with capture and with capture and trace. ")
+	TEXT("Args: [Count=100] [Seconds=10]"),
+	FConsoleCommandWithWorldAndArgsDelegate::CreateLambda([](const TArray<FString>& Args, UWorld* World)
+	{
+		if (const auto Subsystem = World ? World->GetSubsystem<ULocomotionRecorderSubsystem>() : nullptr)
+		{
+			const int32 Count = Args.Num() > 0 ? FCString::Atoi(*Args[0]) : 100;
+			const float Seconds = Args.Num() > 1 ? FCString::Atof(*Args[1]) : 10.f;
+			Subsystem->StartBenchmark(Count, Seconds);
+		}
+	}));
+#endif
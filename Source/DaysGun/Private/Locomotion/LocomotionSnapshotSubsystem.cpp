@@ -0,0 +1,132 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "Locomotion/LocomotionSnapshotSubsystem.h"
+
+#include "Engine/World.h"
+#include "GameFramework/Pawn.h"
+
+FLocomotionSnapshotReader::FLocomotionSnapshotReader(const ULocomotionSnapshotSubsystem& InSubsystem)
+	: Subsystem(InSubsystem)
+{
+	// Pinned in the same word the flip swaps the front in, so either the flip sees this pin or this pins the new front
+	auto Current = Subsystem.State.load(std::memory_order_relaxed);
+	do
+	{
+		Buffer = ULocomotionSnapshotSubsystem::GetFront(Current);
+	}
+	while (!Subsystem.State.compare_exchange_weak(Current, Current + ULocomotionSnapshotSubsystem::GetReaderUnit(Buffer),
+	                                              std::memory_order_acquire, std::memory_order_relaxed));
+
+	Snapshots = TConstArrayView<FLocomotionSnapshot>(Subsystem.Buffers[Buffer].GetData(),
+	                                                 Subsystem.NumUsedSlots.load(std::memory_order_acquire));
+}
+
+FLocomotionSnapshotReader::~FLocomotionSnapshotReader()
+{
+	Subsystem.State.fetch_sub(ULocomotionSnapshotSubsystem::GetReaderUnit(Buffer), std::memory_order_release);
+}
+
+const FLocomotionSnapshot* FLocomotionSnapshotReader::GetSnapshot(int32 Handle) const
+{
+	return Snapshots.IsValidIndex(Handle) ? &Snapshots[Handle] : nullptr;
+}
+
+void ULocomotionSnapshotSubsystem::Initialize(FSubsystemCollectionBase& Collection)
+{
+	Super::Initialize(Collection);
+
+	for (auto& Buffer : Buffers)
+	{
+		Buffer.SetNum(MaxSnapshots);
+	}
+	Owners.Reserve(MaxSnapshots);
+
+	PostActorTickHandle = FWorldDelegates::OnWorldPostActorTick.AddUObject(
+		this, &ULocomotionSnapshotSubsystem::OnWorldPostActorTick);
+}
+
+void ULocomotionSnapshotSubsystem::Deinitialize()
+{
+	FWorldDelegates::OnWorldPostActorTick.Remove(PostActorTickHandle);
+
+	Super::Deinitialize();
+}
+
+int32 ULocomotionSnapshotSubsystem::Register(const APawn* Owner)
+{
+	check(IsInGameThread());
+
+	int32 Handle;
+	if (FreeHandles.Num() > 0)
+	{
+		Handle = FreeHandles.Pop(false);
+		Owners[Handle] = Owner;
+	}
+	else
+	{
+		if (Owners.Num() >= MaxSnapshots) return INDEX_NONE;
+
+		Handle = Owners.Add(Owner);
+		NumUsedSlots.store(Owners.Num(), std::memory_order_release);
+	}
+
+	return Handle;
+}
+
+void ULocomotionSnapshotSubsystem::Unregister(int32 Handle)
+{
+	check(IsInGameThread());
+	if (!Owners.IsValidIndex(Handle)) return;
+
+	// Readers may be on the front buffer, the slot goes inactive with the next flip
+	Owners[Handle] = nullptr;
+	Buffers[BackIndex.load(std::memory_order_relaxed)][Handle].Active = false;
+	FreeHandles.Add(Handle);
+}
+
+void ULocomotionSnapshotSubsystem::Publish(int32 Handle, const FLocomotionSnapshot& Snapshot)
+{
+	if (Handle == INDEX_NONE) return;
+
+	auto& Slot = Buffers[BackIndex.load(std::memory_order_relaxed)][Handle];
+	Slot = Snapshot;
+	Slot.Active = true;
+}
+
+void ULocomotionSnapshotSubsystem::OnWorldPostActorTick(UWorld* World, ELevelTick TickType, float DeltaSeconds)
+{
+	if (World != GetWorld()) return;
+
+	const auto NewFront = BackIndex.load(std::memory_order_relaxed);
+
+	// The new back is picked from the same state the front is swapped in, a failed exchange means readers came or went
+	uint32 NewBack;
+	auto Current = State.load(std::memory_order_acquire);
+	do
+	{
+		const auto OldFront = GetFront(Current);
+		const auto Spare = NumBuffers - NewFront - OldFront;
+		if (GetReaders(Current, Spare) == 0)
+		{
+			NewBack = Spare;
+		}
+		else if (GetReaders(Current, OldFront) == 0)
+		{
+			NewBack = OldFront;
+		}
+		else
+		{
+			// Readers kept from earlier frames pin both, the current front and back stay for another frame
+			++NumSkippedFlips;
+			return;
+		}
+	}
+	while (!State.compare_exchange_weak(Current, (Current & ReaderCountsMask) | uint64(NewFront) << FrontShift,
+	                                    std::memory_order_acq_rel, std::memory_order_acquire));
+
+	// Characters that skip an anim update keep their last snapshot instead of an older one
+	FMemory::Memcpy(Buffers[NewBack].GetData(), Buffers[NewFront].GetData(),
+	                NumUsedSlots.load(std::memory_order_relaxed) * sizeof(FLocomotionSnapshot));
+	BackIndex.store(NewBack, std::memory_order_relaxed);
+}
@@ -0,0 +1,250 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "Locomotion/LocomotionTrajectory.h"
+
+#include "GameFramework/CharacterMovementComponent.h"
+#include "Math/DaysGunMath.h"
+
+namespace LocomotionTrajectory
+{
+	/** Past this distance from Origin the stored positions are rebased, well within float precision */
+	constexpr double RebaseDistance = 50000.0;
+
+	/** UCharacterMovementComponent::ApplyVelocityBraking stops below this speed */
+	constexpr float BrakeToStopSpeed = 10.f;
+
+	/** Shorter predicted moves have no meaningful heading */
+	constexpr float MinHeadingDistance = 1.f;
+}
+
+FTrajectoryMovementModel FTrajectoryMovementModel::FromMovement(const UCharacterMovementComponent& Movement)
+{
+	FTrajectoryMovementModel Model;
+	Model.MaxSpeed = Movement.GetMaxSpeed();
+	Model.MaxAcceleration = Movement.GetMaxAcceleration();
+	Model.BrakingDeceleration = Movement.GetMaxBrakingDeceleration();
+	Model.GroundFriction = Movement.GroundFriction;
+
+	const auto Friction = Movement.bUseSeparateBrakingFriction ? Movement.BrakingFriction : Movement.GroundFriction;
+	Model.BrakingFriction = FMath::Max(0.f, Friction * Movement.BrakingFrictionFactor);
+	return Model;
+}
+
+void FLocomotionTrajectory::Reset()
+{
+	Head = -1;
+	Count = 0;
+	Time = 0.f;
+}
+
+void FLocomotionTrajectory::AddSample(const FVector& Position, const FVector& Velocity, const FVector& Input,
+                                      float FacingYaw, float DeltaSeconds)
+{
+	if (Count == 0)
+	{
+		Origin = Position;
+	}
+	else
+	{
+		Time += DeltaSeconds;
+
+		const auto Drift = Position - Origin;
+		if (Drift.SizeSquared() > FMath::Square(LocomotionTrajectory::RebaseDistance))
+		{
+			const FVector4f Shift(FVector3f(Drift), 0.f);
+			for (int32 Age = 0; Age < Count; ++Age)
+			{
+				Positions[GetIndex(Age)] -= Shift;
+			}
+			Origin = Position;
+		}
+	}
+
+	Head = (Head + 1) & (Capacity - 1);
+	Count = FMath::Min(Count + 1, Capacity);
+
+	const FVector2f Input2D(Input.X, Input.Y);
+	Positions[Head] = FVector4f(FVector3f(Position - Origin), 0.f);
+	Velocities[Head] = FVector4f(FVector3f(Velocity), 0.f);
+	Inputs[Head] = Input2D;
+
+	// Without input the direction is undefined, hold the last one so it does not read as a turn
+	InputYaws[Head] = Input2D.SizeSquared() > UE_KINDA_SMALL_NUMBER || Count == 1
+		                  ? FDaysGunMath::YawFromVector(Input2D)
+		                  : InputYaws[GetIndex(1)];
+	FacingYaws[Head] = FacingYaw;
+	Times[Head] = Time;
+}
+
+FTrajectorySample FLocomotionTrajectory::GetSample(int32 Age) const
+{
+	check(Age >= 0 && Age < Count);
+
+	const auto Index = GetIndex(Age);
+	FTrajectorySample Sample;
+	Sample.Position = Origin + FVector(FVector3f(Positions[Index]));
+	Sample.Velocity = FVector3f(Velocities[Index]);
+	Sample.Input = Inputs[Index];
+	Sample.FacingYaw = FacingYaws[Index];
+	Sample.Time = Times[Index];
+	return Sample;
+}
+
+int32 FLocomotionTrajectory::GetAgeForWindow(float Window) const
+{
+	const auto OldestTime = Time - Window;
+	for (int32 Age = 1; Age < Count; ++Age)
+	{
+		if (Times[GetIndex(Age)] <= OldestTime) return Age;
+	}
+	return FMath::Max(Count - 1, 0);
+}
+
+FVector3f FLocomotionTrajectory::GetAcceleration(float Window) const
+{
+	const auto Age = GetAgeForWindow(Window);
+	if (Age == 0) return FVector3f::ZeroVector;
+
+	const auto Newest = GetIndex(0);
+	const auto Oldest = GetIndex(Age);
+	const auto Seconds = Times[Newest] - Times[Oldest];
+	if (Seconds <= UE_KINDA_SMALL_NUMBER) return FVector3f::ZeroVector;
+
+	return FVector3f(Velocities[Newest] - Velocities[Oldest]) / Seconds;
+}
+
+FVector3f FLocomotionTrajectory::GetAverageVelocity(float Window) const
+{
+	const auto Age = GetAgeForWindow(Window);
+	if (Age == 0) return Count > 0 ? FVector3f(Velocities[Head]) : FVector3f::ZeroVector;
+
+	const auto Newest = GetIndex(0);
+	const auto Oldest = GetIndex(Age);
+	const auto Seconds = Times[Newest] - Times[Oldest];
+	if (Seconds <= UE_KINDA_SMALL_NUMBER) return FVector3f(Velocities[Newest]);
+
+	return FVector3f(Positions[Newest] - Positions[Oldest]) / Seconds;
+}
+
+float FLocomotionTrajectory::GetFacingYawRate(float Window) const
+{
+	return GetYawRate(FacingYaws, Window);
+}
+
+float FLocomotionTrajectory::GetInputYawRate(float Window) const
+{
+	return GetYawRate(InputYaws, Window);
+}
+
+float FLocomotionTrajectory::GetYawRate(const float* Yaws, float Window) const
+{
+	const auto Age = GetAgeForWindow(Window);
+	if (Age == 0) return 0.f;
+
+	// Summing the per sample deltas unwraps turns larger than 180 degrees within the window
+	float Turned = 0.f;
+	for (int32 Step = 0; Step < Age; ++Step)
+	{
+		Turned += FDaysGunMath::DeltaYaw(Yaws[GetIndex(Step)], Yaws[GetIndex(Step + 1)]);
+	}
+
+	const auto Seconds = Times[GetIndex(0)] - Times[GetIndex(Age)];
+	return Seconds > UE_KINDA_SMALL_NUMBER ? Turned / Seconds : 0.f;
+}
+
+void FLocomotionTrajectory::Predict(const FTrajectoryMovementModel& Model, float Interval,
+                                    TArrayView<FTrajectoryPoint> OutPoints, int32 SubSteps) const
+{
+	if (Count == 0)
+	{
+		for (auto& Point : OutPoints)
+		{
+			Point = FTrajectoryPoint();
+		}
+		return;
+	}
+
+	SubSteps = FMath::Max(SubSteps, 1);
+	const auto DeltaTime = Interval / SubSteps;
+	const auto Input = Inputs[Head];
+	const auto InputSize = FMath::Min(Input.Size(), 1.f);
+	const bool Accelerating = InputSize > UE_KINDA_SMALL_NUMBER;
+
+	// Analog input scales the speed limit the same way CalcVelocity's AnalogInputModifier does
+	const auto MaxSpeed = Model.MaxSpeed * InputSize;
+	const auto TurnAlpha = FMath::Min(DeltaTime * Model.GroundFriction, 1.f);
+
+	const auto Horizontal = MakeVectorRegisterFloat(1.f, 1.f, 0.f, 0.f);
+	const auto InputDirection = Accelerating
+		                            ? MakeVectorRegisterFloat(Input.X / InputSize, Input.Y / InputSize, 0.f, 0.f)
+		                            : VectorZeroFloat();
+	const auto AccelerationStep = VectorMultiply(InputDirection,
+	                                             VectorSetFloat1(Model.MaxAcceleration * InputSize * DeltaTime));
+	const auto DeltaTimeRegister = VectorSetFloat1(DeltaTime);
+
+	auto Velocity = VectorMultiply(VectorLoad(&Velocities[Head].X), Horizontal);
+	auto Offset = VectorZeroFloat();
+
+	for (int32 PointIndex = 0; PointIndex < OutPoints.Num(); ++PointIndex)
+	{
+		for (int32 Step = 0; Step < SubSteps; ++Step)
+		{
+			const auto SpeedSquared = VectorGetComponent(VectorDot3(Velocity, Velocity), 0);
+			const auto Speed = FMath::Sqrt(SpeedSquared);
+
+			if (Accelerating)
+			{
+				// Friction turns the velocity towards the input, then the input accelerates it up to MaxSpeed
+				const auto Target = VectorMultiply(InputDirection, VectorSetFloat1(Speed));
+				Velocity = VectorSubtract(Velocity,
+				                          VectorMultiply(VectorSubtract(Velocity, Target), VectorSetFloat1(TurnAlpha)));
+				Velocity = VectorAdd(Velocity, AccelerationStep);
+
+				const auto NewSpeedSquared = VectorGetComponent(VectorDot3(Velocity, Velocity), 0);
+				if (NewSpeedSquared > FMath::Square(MaxSpeed) && NewSpeedSquared > UE_SMALL_NUMBER)
+				{
+					Velocity = VectorMultiply(Velocity, VectorSetFloat1(MaxSpeed * FMath::InvSqrt(NewSpeedSquared)));
+				}
+			}
+			else if (Speed > UE_KINDA_SMALL_NUMBER)
+			{
+				const auto Braking = VectorMultiply(Velocity, VectorSetFloat1(-Model.BrakingDeceleration / Speed));
+				const auto Previous = Velocity;
+				Velocity = VectorMultiplyAdd(
+					VectorMultiplyAdd(Velocity, VectorSetFloat1(-Model.BrakingFriction), Braking), DeltaTimeRegister,
+					Velocity);
+
+				// Braking never reverses the velocity and stops it below the engine's threshold
+				const auto Along = VectorGetComponent(VectorDot3(Velocity, Previous), 0);
+				const auto NewSpeedSquared = VectorGetComponent(VectorDot3(Velocity, Velocity), 0);
+				if (Along <= 0.f || NewSpeedSquared < FMath::Square(LocomotionTrajectory::BrakeToStopSpeed))
+				{
+					Velocity = VectorZeroFloat();
+				}
+			}
+
+			Offset = VectorMultiplyAdd(Velocity, DeltaTimeRegister, Offset);
+		}
+
+		alignas(16) float OffsetValues[4];
+		alignas(16) float VelocityValues[4];
+		VectorStoreAligned(Offset, OffsetValues);
+		VectorStoreAligned(Velocity, VelocityValues);
+
+		auto& Point = OutPoints[PointIndex];
+		Point.Offset = FVector3f(OffsetValues[0], OffsetValues[1], OffsetValues[2]);
+		Point.Velocity = FVector3f(VelocityValues[0], VelocityValues[1], VelocityValues[2]);
+		Point.Time = Interval * (PointIndex + 1);
+	}
+}
+
+bool FLocomotionTrajectory::PredictHeading(const FTrajectoryMovementModel& Model, float Seconds, float& OutYaw) const
+{
+	FTrajectoryPoint Point;
+	Predict(Model, Seconds, MakeArrayView(&Point, 1));
+	if (Point.Offset.SizeSquared2D() < FMath::Square(LocomotionTrajectory::MinHeadingDistance)) return false;
+
+	OutYaw = FDaysGunMath::YawFromVector(FVector2f(Point.Offset.X, Point.Offset.Y));
+	return true;
+}
@@ -0,0 +1,69 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "Loot/LootContainer.h"
+
+#include "DaysGun.h"
+#include "Components/SphereComponent.h"
+#include "Components/StaticMeshComponent.h"
+#include "Engine/World.h"
+#include "Loot/LootInteractionSubsystem.h"
+#include "Player/BaseCharacter.h"
+
+ALootContainer::ALootContainer()
+{
+	PrimaryActorTick.bCanEverTick = false;
+
+	InteractionSphere = CreateDefaultSubobject<USphereComponent>("InteractionSphere");
+	InteractionSphere->InitSphereRadius(50.f);
+	InteractionSphere->SetCollisionProfileName("OverlapAllDynamic");
+	InteractionSphere->SetGenerateOverlapEvents(false);
+	RootComponent = InteractionSphere;
+
+	Mesh = CreateDefaultSubobject<UStaticMeshComponent>("Mesh");
+	Mesh->SetupAttachment(InteractionSphere);
+	Mesh->SetGenerateOverlapEvents(false);
+}
+
+void ALootContainer::BeginPlay()
+{
+	Super::BeginPlay();
+
+	if (const auto LootInteraction = GetWorld()->GetSubsystem<ULootInteractionSubsystem>())
+	{
+		LootInteraction->Register(this);
+	}
+}
+
+void ALootContainer::EndPlay(const EEndPlayReason::Type EndPlayReason)
+{
+	if (const auto LootInteraction = GetWorld()->GetSubsystem<ULootInteractionSubsystem>())
+	{
+		LootInteraction->Unregister(this);
+	}
+
+	Super::EndPlay(EndPlayReason);
+}
+
+bool ALootContainer::TryOpen(ABaseCharacter* Character)
+{
+	if (!Character || (IsOpen() && Looter != Character)) return false;
+
+	Looter = Character;
+	if (const auto LootInteraction = GetWorld()->GetSubsystem<ULootInteractionSubsystem>())
+	{
+		LootInteraction->SetAvailable(this, false);
+	}
+	return true;
+}
+
+void ALootContainer::Close()
+{
+	if (!IsOpen()) return;
+
+	Looter.Reset();
+	if (const auto LootInteraction = GetWorld()->GetSubsystem<ULootInteractionSubsystem>())
+	{
+		LootInteraction->SetAvailable(this, true);
+	}
+}
@@ -0,0 +1,335 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "Loot/LootInteractionSubsystem.h"
+
+#include "DaysGun.h"
+#include "Engine/OverlapResult.h"
+#include "Engine/World.h"
+#include "Loot/LootContainer.h"
+#include "Player/BaseCharacter.h"
+#include "Soak/SoakTestSubsystem.h"
+
+DECLARE_CYCLE_STAT(TEXT("Loot Index Build"), STAT_LootIndexBuild, STATGROUP_DaysGun);
+DECLARE_CYCLE_STAT(TEXT("Loot Query"), STAT_LootQuery, STATGROUP_DaysGun);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Lootables"), STAT_Lootables, STATGROUP_DaysGun);
+
+namespace
+{
+	/** Benchmark lootables sit on a jittered grid this far apart, a little below the player's capsule center */
+	constexpr float BenchmarkSpacing = 200.f;
+	constexpr float BenchmarkHeight = -50.f;
+}
+
+void ULootInteractionSubsystem::Tick(float DeltaTime)
+{
+	TickBenchmark(DeltaTime);
+}
+
+bool ULootInteractionSubsystem::IsTickable() const
+{
+	return Benchmark.IsRunning();
+}
+
+TStatId ULootInteractionSubsystem::GetStatId() const
+{
+	RETURN_QUICK_DECLARE_CYCLE_STAT(ULootInteractionSubsystem, STATGROUP_Tickables);
+}
+
+void ULootInteractionSubsystem::Deinitialize()
+{
+	Lootables.Reset();
+	SortedPoints.Reset();
+	LootableSlots.Reset();
+	BenchmarkLootables.Reset();
+	Benchmark = FSubsystemBenchmark();
+
+	Super::Deinitialize();
+}
+
+void ULootInteractionSubsystem::Register(ALootContainer* Container)
+{
+	if (!Container || Lootables.Contains(Container)) return;
+
+	FLootable Lootable;
+	Lootable.Container = Container;
+	Lootable.Location = Container->GetActorLocation();
+	Lootable.Available = !Container->IsOpen();
+
+	Lootables.Add(Container, Lootable);
+	IndexDirty = true;
+}
+
+void ULootInteractionSubsystem::Unregister(const ALootContainer* Container)
+{
+	const auto Index = Lootables.Find(Container);
+	if (Index != INDEX_NONE)
+	{
+		RemoveAt(Index);
+	}
+}
+
+void ULootInteractionSubsystem::SetAvailable(const ALootContainer* Container, bool Available)
+{
+	const auto Index = Lootables.Find(Container);
+	if (Index == INDEX_NONE) return;
+
+	Lootables[Index].Available = Available;
+	if (!IndexDirty)
+	{
+		SortedPoints[LootableSlots[Index]].Available = Available;
+	}
+}
+
+void ULootInteractionSubsystem::RemoveAt(int32 Index)
+{
+	Lootables.RemoveAt(Index);
+	IndexDirty = true;
+}
+
+void ULootInteractionSubsystem::BuildIndex()
+{
+	SCOPE_CYCLE_COUNTER(STAT_LootIndexBuild);
+	const auto StartCycles = FPlatformTime::Cycles64();
+
+	const auto Num = Lootables.Num();
+	NumBuckets = FMath::RoundUpToPowerOfTwo(FMath::Max(Num * 2, 64));
+	CosHalfAngleSquared = FMath::Square(FMath::Cos(FMath::DegreesToRadians(FMath::Min(ConeHalfAngle, 90.f))));
+
+	BucketStarts.SetNumZeroed(NumBuckets + 1);
+	LootableBuckets.SetNumUninitialized(Num);
+	LootableSlots.SetNumUninitialized(Num);
+	SortedPoints.SetNumUninitialized(Num);
+
+	// Counting sort by bucket, the points of one bucket end up next to each other
+	for (int32 Index = 0; Index < Num; ++Index)
+	{
+		const auto Bucket = GetBucket(GetCell(FVector3f(Lootables[Index].Location)));
+		LootableBuckets[Index] = Bucket;
+		++BucketStarts[Bucket + 1];
+	}
+
+	for (uint32 Bucket = 1; Bucket <= NumBuckets; ++Bucket)
+	{
+		BucketStarts[Bucket] += BucketStarts[Bucket - 1];
+	}
+
+	BucketCursors = BucketStarts;
+	for (int32 Index = 0; Index < Num; ++Index)
+	{
+		const auto Slot = BucketCursors[LootableBuckets[Index]]++;
+		LootableSlots[Index] = Slot;
+
+		auto& Point = SortedPoints[Slot];
+		Point.Location = FVector3f(Lootables[Index].Location);
+		Point.Lootable = Index;
+		Point.Available = Lootables[Index].Available;
+	}
+
+	IndexDirty = false;
+	LastBuildMs = FPlatformTime::ToMilliseconds64(FPlatformTime::Cycles64() - StartCycles);
+	SET_DWORD_STAT(STAT_Lootables, Num);
+}
+
+ALootContainer* ULootInteractionSubsystem::FindNearestInView(const FVector& Origin, const FVector& Forward)
+{
+	SCOPE_CYCLE_COUNTER(STAT_LootQuery);
+
+	if (IndexDirty)
+	{
+		BuildIndex();
+	}
+	if (SortedPoints.Num() == 0) return nullptr;
+
+	const FVector3f Eye(Origin);
+	const auto Facing = FVector2f(Forward.X, Forward.Y).GetSafeNormal();
+
+	int32 Nearest = INDEX_NONE;
+	auto NearestDistanceSquared = MAX_flt;
+
+	// Neighboring cells can share a bucket, each bucket is visited once
+	const auto Cell = GetCell(Eye);
+	uint32 Visited[9];
+	int32 NumVisited = 0;
+
+	for (int32 Y = -1; Y <= 1; ++Y)
+	{
+		for (int32 X = -1; X <= 1; ++X)
+		{
+			const auto Bucket = GetBucket(Cell + FIntPoint(X, Y));
+			bool AlreadyVisited = false;
+			for (int32 Visit = 0; Visit < NumVisited; ++Visit)
+			{
+				AlreadyVisited |= Visited[Visit] == Bucket;
+			}
+			if (AlreadyVisited) continue;
+			Visited[NumVisited++] = Bucket;
+
+			for (int32 Slot = BucketStarts[Bucket]; Slot < BucketStarts[Bucket + 1]; ++Slot)
+			{
+				const auto& Point = SortedPoints[Slot];
+				if (!Point.Available) continue;
+
+				const auto Offset = Point.Location - Eye;
+				const auto DistanceSquared = FVector2f(Offset.X, Offset.Y).SizeSquared();
+				if (DistanceSquared >= NearestDistanceSquared || !IsInView(Offset, Facing)) continue;
+
+				Nearest = Point.Lootable;
+				NearestDistanceSquared = DistanceSquared;
+			}
+		}
+	}
+
+	return Nearest != INDEX_NONE ? Lootables[Nearest].Container.Get() : nullptr;
+}
+
+ALootContainer* ULootInteractionSubsystem::OverlapNearestInView(const FVector& Origin, const FVector& Forward) const
+{
+	TArray<FOverlapResult> Overlaps;
+	GetWorld()->OverlapMultiByObjectType(Overlaps, Origin, FQuat::Identity,
+	                                     FCollisionObjectQueryParams(ECC_WorldDynamic),
+	                                     FCollisionShape::MakeSphere(InteractionDistance + MaxHeightDifference),
+	                                     FCollisionQueryParams(SCENE_QUERY_STAT(LootOverlap), false));
+
+	const FVector3f Eye(Origin);
+	const auto Facing = FVector2f(Forward.X, Forward.Y).GetSafeNormal();
+
+	ALootContainer* Nearest = nullptr;
+	auto NearestDistanceSquared = MAX_flt;
+	for (const auto& Overlap : Overlaps)
+	{
+		const auto Container = Cast<ALootContainer>(Overlap.GetActor());
+		if (!Container || Container->IsOpen()) continue;
+
+		const auto Offset = FVector3f(Container->GetActorLocation()) - Eye;
+		const auto DistanceSquared = FVector2f(Offset.X, Offset.Y).SizeSquared();
+		if (DistanceSquared >= NearestDistanceSquared || !IsInView(Offset, Facing)) continue;
+
+		Nearest = Container;
+		NearestDistanceSquared = DistanceSquared;
+	}
+	return Nearest;
+}
+
+void ULootInteractionSubsystem::StartBenchmark(int32 NumLootables, int32 NumCharacters, float Seconds)
+{
+	const auto World = GetWorld();
+	const auto Soak = FSubsystemBenchmark::GetIdleSoak(World);
+	if (!Soak || NumLootables <= 0 || NumCharacters <= 0 || !Benchmark.Start(1, Seconds)) return;
+
+	const auto Center = FSubsystemBenchmark::GetCenter(World);
+
+	// Jittered so that lootables sit at uneven distances and angles from the bots
+	FRandomStream Random(NumLootables);
+	const auto Side = FMath::CeilToInt32(FMath::Sqrt(static_cast<float>(NumLootables)));
+	const auto Corner = Center - FVector(Side * BenchmarkSpacing * 0.5f, Side * BenchmarkSpacing * 0.5f, 0.f);
+
+	FActorSpawnParameters SpawnParams;
+	SpawnParams.SpawnCollisionHandlingOverride = ESpawnActorCollisionHandlingMethod::AlwaysSpawn;
+
+	BenchmarkLootables.Reset(NumLootables);
+	for (int32 Index = 0; Index < NumLootables; ++Index)
+	{
+		const auto Jitter = FVector(Random.FRandRange(-0.4f, 0.4f), Random.FRandRange(-0.4f, 0.4f), 0.f);
+		const auto GridLocation = FVector(Index % Side, Index / Side, 0.f) + Jitter;
+		const auto Location = Corner + GridLocation * BenchmarkSpacing + FVector(0.f, 0.f, BenchmarkHeight);
+		BenchmarkLootables.Add(World->SpawnActor<ALootContainer>(Location, FRotator::ZeroRotator, SpawnParams));
+	}
+
+	// Built now so the measured frames only see queries
+	if (IndexDirty)
+	{
+		BuildIndex();
+	}
+	Soak->SpawnBotsAround(NumCharacters, Center);
+
+	BenchmarkResult = FBenchmarkResult();
+}
+
+void ULootInteractionSubsystem::TickBenchmark(float DeltaTime)
+{
+	if (!Benchmark.Tick(DeltaTime)) return;
+
+	const auto Soak = GetWorld()->GetSubsystem<USoakTestSubsystem>();
+	const auto Bots = Soak->GetBots();
+
+	TArray<ALootContainer*, TInlineAllocator<256>> IndexResults;
+	IndexResults.SetNumUninitialized(Bots.Num());
+
+	auto StartCycles = FPlatformTime::Cycles64();
+	for (int32 Index = 0; Index < Bots.Num(); ++Index)
+	{
+		IndexResults[Index] = FindNearestInView(Bots[Index]->GetActorLocation(), Bots[Index]->GetActorForwardVector());
+	}
+	BenchmarkResult.IndexMs += FPlatformTime::ToMilliseconds64(FPlatformTime::Cycles64() - StartCycles);
+
+	StartCycles = FPlatformTime::Cycles64();
+	for (int32 Index = 0; Index < Bots.Num(); ++Index)
+	{
+		const auto Found = OverlapNearestInView(Bots[Index]->GetActorLocation(), Bots[Index]->GetActorForwardVector());
+		BenchmarkResult.Found += IndexResults[Index] ? 1 : 0;
+		BenchmarkResult.Mismatches += Found != IndexResults[Index] ? 1 : 0;
+	}
+	BenchmarkResult.OverlapMs += FPlatformTime::ToMilliseconds64(FPlatformTime::Cycles64() - StartCycles);
+
+	++BenchmarkResult.Frames;
+	BenchmarkResult.Queries += Bots.Num();
+	BenchmarkResult.FrameMs += FSubsystemBenchmark::GetFrameMs();
+
+	if (!Benchmark.IsPhaseDone()) return;
+	FinishBenchmark();
+}
+
+void ULootInteractionSubsystem::FinishBenchmark()
+{
+	const auto& Result = BenchmarkResult;
+	const auto Queries = FMath::Max<int64>(Result.Queries, 1);
+	UE_LOG(LogDaysGun, Display, TEXT("Loot interaction benchmark, %d lootables, %d characters, %.0f s:"),
+	       Lootables.Num(), GetWorld()->GetSubsystem<USoakTestSubsystem>()->GetNumBots(), Benchmark.GetSeconds());
+	UE_LOG(LogDaysGun, Display, TEXT("  %8s %11s %11s"), TEXT("method"), TEXT("per query"), TEXT("per frame"));
+	UE_LOG(LogDaysGun, Display, TEXT("  %8s %8.3f us %8.3f ms"), TEXT("index"), Result.IndexMs * 1000.0 / Queries,
+	       Result.IndexMs / FMath::Max(Result.Frames, 1));
+	UE_LOG(LogDaysGun, Display, TEXT("  %8s %8.3f us %8.3f ms"), TEXT("overlap"), Result.OverlapMs * 1000.0 / Queries,
+	       Result.OverlapMs / FMath::Max(Result.Frames, 1));
+	UE_LOG(LogDaysGun, Display, TEXT("  %lld queries, %.1f%% found a lootable, %lld disagreed, frame %.2f ms"),
+	       Result.Queries, Result.Found * 100.0 / Queries, Result.Mismatches,
+	       Result.FrameMs / FMath::Max(Result.Frames, 1));
+
+	for (const auto Container : BenchmarkLootables)
+	{
+		if (IsValid(Container))
+		{
+			Container->Destroy();
+		}
+	}
+	BenchmarkLootables.Reset();
+	Benchmark.Finish(GetWorld());
+}
+
+#if !UE_BUILD_SHIPPING
+static FAutoConsoleCommandWithWorldAndArgs GLootBenchmarkCommand(
+	TEXT("DaysGun.Loot.Benchmark"),
+	TEXT("Scatters lootables among soak bots and logs the cost of the nearest lootable in view query against a ")
+	TEXT("physics overlap. Args: [Lootables=10000] [Characters=100] [Seconds=10]"),
+	FConsoleCommandWithWorldAndArgsDelegate::CreateLambda([](const TArray<FString>& Args, UWorld* World)
+	{
+		if (const auto Subsystem = World ? World->GetSubsystem<ULootInteractionSubsystem>() : nullptr)
+		{
+			Subsystem->StartBenchmark(Args.Num() > 0 ? FCString::Atoi(*Args[0]) : 10000,
+			                          Args.Num() > 1 ? FCString::Atoi(*Args[1]) : 100,
+			                          Args.Num() > 2 ? FCString::Atof(*Args[2]) : 10.f);
+		}
+	}));
+
+static FAutoConsoleCommandWithWorld GLootStatsCommand(
+	TEXT("DaysGun.Loot.Stats"),
+	TEXT("Prints the number of lootables and the cost of the last spatial hash rebuild"),
+	FConsoleCommandWithWorldDelegate::CreateLambda([](UWorld* World)
+	{
+		if (const auto Subsystem = World ? World->GetSubsystem<ULootInteractionSubsystem>() : nullptr)
+		{
+			UE_LOG(LogDaysGun, Display, TEXT("%d lootables, last hash rebuild %.3f ms"),
+			       Subsystem->GetNumLootables(), Subsystem->GetLastBuildMs());
+		}
+	}));
+#endif
@@ -0,0 +1,286 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "Net/DaysGunReplicationGraph.h"
+
+#include "DaysGun.h"
+#include "Engine/NetConnection.h"
+#include "Engine/NetDriver.h"
+#include "Engine/World.h"
+#include "Math/DaysGunMath.h"
+#include "Player/BaseCharacter.h"
+
+DECLARE_CYCLE_STAT(TEXT("Replication Graph Replicate Actors"), STAT_RepGraphReplicateActors, STATGROUP_DaysGun);
+DECLARE_CYCLE_STAT(TEXT("Replication Graph Character Periods"), STAT_RepGraphCharacterPeriods, STATGROUP_DaysGun);
+
+UDaysGunReplicationGraph::UDaysGunReplicationGraph()
+{
+	GaitPeriodFrames[static_cast<int32>(EGait::EG_Walk)] = 4;
+	GaitPeriodFrames[static_cast<int32>(EGait::EG_Jog)] = 3;
+	GaitPeriodFrames[static_cast<int32>(EGait::EG_Run)] = 2;
+	GaitPeriodFrames[static_cast<int32>(EGait::EG_Sprint)] = 1;
+	GaitPeriodFrames[static_cast<int32>(EGait::EG_Crouch)] = 4;
+}
+
+void UDaysGunReplicationGraph::ResetGameWorldState()
+{
+	Super::ResetGameWorldState();
+
+	Characters.Reset();
+}
+
+void UDaysGunReplicationGraph::InitGlobalActorClassSettings()
+{
+	Super::InitGlobalActorClassSettings();
+
+	// Native classes only, blueprint classes resolve to their native parent or are set up when first routed
+	for (TObjectIterator<UClass> It; It; ++It)
+	{
+		const auto Class = *It;
+		if (!Class->IsChildOf(AActor::StaticClass()) || !Class->HasAnyClassFlags(CLASS_Native)) continue;
+		if (Class->HasAnyClassFlags(CLASS_Abstract | CLASS_Deprecated)) continue;
+
+		const auto ActorCDO = Class->GetDefaultObject<AActor>();
+		if (!ActorCDO || !ActorCDO->GetIsReplicated()) continue;
+
+		ClassRepNodePolicies.Set(Class, GetMappingPolicyFromDefaults(Class));
+
+		FClassReplicationInfo ClassInfo;
+		InitClassReplicationInfo(Class, ClassInfo);
+		GlobalActorReplicationInfoMap.SetClassInfo(Class, ClassInfo);
+	}
+}
+
+void UDaysGunReplicationGraph::InitGlobalGraphNodes()
+{
+	GridNode = CreateNewNode<UReplicationGraphNode_GridSpatialization2D>();
+	GridNode->CellSize = GridCellSize;
+	GridNode->SpatialBias = SpatialBias;
+	AddGlobalGraphNode(GridNode);
+
+	AlwaysRelevantNode = CreateNewNode<UReplicationGraphNode_ActorList>();
+	AddGlobalGraphNode(AlwaysRelevantNode);
+}
+
+void UDaysGunReplicationGraph::InitConnectionGraphNodes(UNetReplicationGraphConnection* RepGraphConnection)
+{
+	Super::InitConnectionGraphNodes(RepGraphConnection);
+
+	// View target and owned actors of this connection
+	AddConnectionGraphNode(CreateNewNode<UReplicationGraphNode_AlwaysRelevant_ForConnection>(), RepGraphConnection);
+}
+
+void UDaysGunReplicationGraph::RouteAddNetworkActorToNodes(const FNewReplicatedActorInfo& ActorInfo,
+                                                           FGlobalActorReplicationInfo& GlobalInfo)
+{
+	if (!ClassRepNodePolicies.Get(ActorInfo.Class))
+	{
+		// First actor of a class with no native replicated parent, e.g. a blueprint actor
+		FClassReplicationInfo ClassInfo;
+		InitClassReplicationInfo(ActorInfo.Class, ClassInfo);
+		GlobalActorReplicationInfoMap.SetClassInfo(ActorInfo.Class, ClassInfo);
+		GlobalInfo.Settings = ClassInfo;
+	}
+
+	switch (GetMappingPolicy(ActorInfo.Class))
+	{
+	case EClassRepNodeMapping::RelevantAllConnections:
+		AlwaysRelevantNode->NotifyAddNetworkActor(ActorInfo);
+		break;
+	case EClassRepNodeMapping::Spatialize_Static:
+		GridNode->AddActor_Static(ActorInfo, GlobalInfo);
+		break;
+	case EClassRepNodeMapping::Spatialize_Dynamic:
+		GridNode->AddActor_Dynamic(ActorInfo, GlobalInfo);
+		break;
+	case EClassRepNodeMapping::Spatialize_Dormancy:
+		GridNode->AddActor_Dormancy(ActorInfo, GlobalInfo);
+		break;
+	default:
+		break;
+	}
+
+	if (const auto Character = Cast<ABaseCharacter>(ActorInfo.Actor))
+	{
+		Characters.Add(Character);
+	}
+}
+
+void UDaysGunReplicationGraph::RouteRemoveNetworkActorToNodes(const FNewReplicatedActorInfo& ActorInfo)
+{
+	switch (GetMappingPolicy(ActorInfo.Class))
+	{
+	case EClassRepNodeMapping::RelevantAllConnections:
+		AlwaysRelevantNode->NotifyRemoveNetworkActor(ActorInfo);
+		break;
+	case EClassRepNodeMapping::Spatialize_Static:
+		GridNode->RemoveActor_Static(ActorInfo);
+		break;
+	case EClassRepNodeMapping::Spatialize_Dynamic:
+		GridNode->RemoveActor_Dynamic(ActorInfo);
+		break;
+	case EClassRepNodeMapping::Spatialize_Dormancy:
+		GridNode->RemoveActor_Dormancy(ActorInfo);
+		break;
+	default:
+		break;
+	}
+
+	if (const auto Character = Cast<ABaseCharacter>(ActorInfo.Actor))
+	{
+		Characters.RemoveSwap(Character);
+	}
+}
+
+int32 UDaysGunReplicationGraph::ServerReplicateActors(float DeltaSeconds)
+{
+	SCOPE_CYCLE_COUNTER(STAT_RepGraphReplicateActors);
+
+	const auto Start = FPlatformTime::Cycles64();
+
+	if (GetReplicationGraphFrame() % FMath::Max(PeriodUpdateInterval, 1) == 0)
+	{
+		UpdateCharacterPeriods();
+	}
+
+	const auto Result = Super::ServerReplicateActors(DeltaSeconds);
+
+	const auto Milliseconds = FPlatformTime::ToMilliseconds64(FPlatformTime::Cycles64() - Start);
+	AverageReplicateMs = AverageReplicateMs > 0.0 ? FMath::Lerp(AverageReplicateMs, Milliseconds, 0.05) : Milliseconds;
+	PeakReplicateMs = FMath::Max(PeakReplicateMs, Milliseconds);
+
+	return Result;
+}
+
+void UDaysGunReplicationGraph::PrintReport() const
+{
+	UE_LOG(LogDaysGun, Display, TEXT("Replication graph: %d connections, %d characters, replicate %.3f ms avg %.3f ms peak"),
+	       Connections.Num(), Characters.Num(), AverageReplicateMs, PeakReplicateMs);
+
+	for (const auto Connection : Connections)
+	{
+		const auto NetConnection = Connection ? Connection->NetConnection : nullptr;
+		if (!NetConnection) continue;
+
+		// Periods currently assigned to the characters this connection sees, 1 .. MaxPeriodFrames
+		TMap<int32, int32> PeriodCounts;
+		for (const auto Character : Characters)
+		{
+			if (const auto ActorInfo = Connection->ActorInfoMap.Find(Character))
+			{
+				++PeriodCounts.FindOrAdd(ActorInfo->ReplicationPeriodFrame);
+			}
+		}
+		PeriodCounts.KeySort(TLess<int32>());
+
+		FString Periods;
+		for (const auto& Pair : PeriodCounts)
+		{
+			Periods += FString::Printf(TEXT(" %d:%d"), Pair.Key, Pair.Value);
+		}
+
+		UE_LOG(LogDaysGun, Display, TEXT("  %s out %d B/s in %d B/s, character periods (frames:count)%s"),
+		       *NetConnection->LowLevelGetRemoteAddress(), NetConnection->OutBytesPerSecond,
+		       NetConnection->InBytesPerSecond, *Periods);
+	}
+}
+
+EClassRepNodeMapping UDaysGunReplicationGraph::GetMappingPolicy(UClass* Class)
+{
+	if (const auto Policy = ClassRepNodePolicies.Get(Class))
+	{
+		return *Policy;
+	}
+
+	const auto Policy = GetMappingPolicyFromDefaults(Class);
+	ClassRepNodePolicies.Set(Class, Policy);
+	return Policy;
+}
+
+EClassRepNodeMapping UDaysGunReplicationGraph::GetMappingPolicyFromDefaults(const UClass* Class)
+{
+	const auto ActorCDO = Class ? Class->GetDefaultObject<AActor>() : nullptr;
+	if (!ActorCDO || !ActorCDO->GetIsReplicated()) return EClassRepNodeMapping::NotRouted;
+
+	if (ActorCDO->bAlwaysRelevant) return EClassRepNodeMapping::RelevantAllConnections;
+
+	// Reaches its owner through the connection's always relevant node
+	if (ActorCDO->bOnlyRelevantToOwner) return EClassRepNodeMapping::NotRouted;
+
+	if (Class->IsChildOf(ABaseCharacter::StaticClass())) return EClassRepNodeMapping::Spatialize_Dynamic;
+
+	// Loot and other world state that only changes on interaction
+	if (ActorCDO->NetDormancy > DORM_Awake) return EClassRepNodeMapping::Spatialize_Dormancy;
+
+	return ActorCDO->IsReplicatingMovement()
+		       ? EClassRepNodeMapping::Spatialize_Dynamic
+		       : EClassRepNodeMapping::Spatialize_Static;
+}
+
+void UDaysGunReplicationGraph::InitClassReplicationInfo(const UClass* Class, FClassReplicationInfo& ClassInfo) const
+{
+	const auto ActorCDO = Class->GetDefaultObject<AActor>();
+	ClassInfo.SetCullDistanceSquared(ActorCDO->NetCullDistanceSquared);
+	ClassInfo.ReplicationPeriodFrame = GetReplicationPeriodFrameForFrequency(ActorCDO->NetUpdateFrequency);
+}
+
+void UDaysGunReplicationGraph::UpdateCharacterPeriods()
+{
+	SCOPE_CYCLE_COUNTER(STAT_RepGraphCharacterPeriods);
+
+	const auto Frame = GetReplicationGraphFrame();
+
+	for (const auto Connection : Connections)
+	{
+		const auto NetConnection = Connection ? Connection->NetConnection : nullptr;
+		const AActor* ViewTarget = NetConnection ? NetConnection->ViewTarget : nullptr;
+		if (!ViewTarget) continue;
+
+		const auto ViewLocation = ViewTarget->GetActorLocation();
+
+		for (const auto Character : Characters)
+		{
+			// The viewer's own pawn keeps its class period
+			if (!Character || Character == ViewTarget) continue;
+
+			const auto Distance = FVector::Dist2D(ViewLocation, Character->GetActorLocation());
+			const auto Period = GetCharacterPeriodFrames(Character, Distance);
+
+			auto& ActorInfo = Connection->ActorInfoMap.FindOrAdd(Character);
+			ActorInfo.ReplicationPeriodFrame = static_cast<decltype(ActorInfo.ReplicationPeriodFrame)>(Period);
+
+			// Do not wait out the old, longer period once a character speeds up or comes closer
+			ActorInfo.NextReplicationFrameNum = FMath::Min(ActorInfo.NextReplicationFrameNum,
+			                                               Frame + static_cast<uint32>(Period));
+		}
+	}
+}
+
+int32 UDaysGunReplicationGraph::GetCharacterPeriodFrames(const ABaseCharacter* Character, float Distance) const
+{
+	// Gait itself is local to the owning client, the replicated velocity is what the server knows
+	const auto Speed = static_cast<float>(Character->GetVelocity().Size2D());
+	const auto Gait = Character->GetGaitProfiles()->GetGaitForSpeed(Speed, Character->bIsCrouched);
+	const auto BasePeriod = Speed < IdleSpeed ? IdlePeriodFrames : GaitPeriodFrames[static_cast<int32>(Gait)];
+
+	const auto DistanceScale = FDaysGunMath::MapRangeClamped(Distance, NearDistance, FarDistance, 1.f, MaxDistanceScale);
+	return FMath::Clamp(FMath::RoundToInt32(BasePeriod * DistanceScale), 1, FMath::Max(MaxPeriodFrames, 1));
+}
+
+#if !UE_BUILD_SHIPPING
+static FAutoConsoleCommandWithWorld GRepGraphReportCommand(
+	TEXT("DaysGun.RepGraph.Report"),
+	TEXT("Logs replication graph cost, bytes per connection and character update periods. Run on the server."),
+	FConsoleCommandWithWorldDelegate::CreateLambda([](UWorld* World)
+	{
+		const auto NetDriver = World ? World->GetNetDriver() : nullptr;
+		const auto Graph = NetDriver ? NetDriver->GetReplicationDriver<UDaysGunReplicationGraph>() : nullptr;
+		if (!Graph)
+		{
+			UE_LOG(LogDaysGun, Display, TEXT("No UDaysGunReplicationGraph on this world's net driver"));
+			return;
+		}
+
+		Graph->PrintReport();
+	}));
+#endif
@@ -0,0 +1,411 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "Player/BackpackPhysicsSubsystem.h"
+
+#include "DaysGun.h"
+#include "Components/SkeletalMeshComponent.h"
+#include "Engine/World.h"
+#include "GameFramework/PlayerController.h"
+#include "PhysicsEngine/BodyInstance.h"
+#include "Player/BaseCharacter.h"
+#include "Soak/SoakTestSubsystem.h"
+
+DECLARE_CYCLE_STAT(TEXT("Backpack Physics Update"), STAT_BackpackPhysicsUpdate, STATGROUP_DaysGun);
+DECLARE_CYCLE_STAT(TEXT("Backpack Physics Significance"), STAT_BackpackPhysicsSignificance, STATGROUP_DaysGun);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Backpacks Simulated"), STAT_BackpacksSimulated, STATGROUP_DaysGun);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Backpacks Spring"), STAT_BackpacksSpring, STATGROUP_DaysGun);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Backpacks Frozen"), STAT_BackpacksFrozen, STATGROUP_DaysGun);
+
+bool UBackpackPhysicsSubsystem::ShouldCreateSubsystem(UObject* Outer) const
+{
+	// Server targets never register the backpack mesh
+#if UE_SERVER
+	return false;
+#else
+	return Super::ShouldCreateSubsystem(Outer);
+#endif
+}
+
+void UBackpackPhysicsSubsystem::Tick(float DeltaTime)
+{
+	Super::Tick(DeltaTime);
+	SCOPE_CYCLE_COUNTER(STAT_BackpackPhysicsUpdate);
+
+	for (int32 Index = Entries.Num() - 1; Index >= 0; --Index)
+	{
+		if (!Entries[Index].Backpack.IsValid() || !Entries[Index].Character.IsValid())
+		{
+			Entries.RemoveAt(Index);
+		}
+	}
+
+	SignificanceTimeLeft -= DeltaTime;
+	if (SignificanceTimeLeft <= 0.f)
+	{
+		UpdateSignificance();
+		SignificanceTimeLeft = SignificanceInterval;
+	}
+
+	UpdateSprings(DeltaTime);
+
+	if (Benchmark.IsRunning())
+	{
+		TickBenchmark(DeltaTime);
+	}
+}
+
+bool UBackpackPhysicsSubsystem::IsTickable() const
+{
+	return Entries.Num() > 0 || Benchmark.IsRunning();
+}
+
+TStatId UBackpackPhysicsSubsystem::GetStatId() const
+{
+	RETURN_QUICK_DECLARE_CYCLE_STAT(UBackpackPhysicsSubsystem, STATGROUP_Tickables);
+}
+
+void UBackpackPhysicsSubsystem::Deinitialize()
+{
+	SetTimingTicksEnabled(false);
+	Entries.Reset();
+
+	Super::Deinitialize();
+}
+
+void UBackpackPhysicsSubsystem::Register(ABaseCharacter* Character, USkeletalMeshComponent* Backpack)
+{
+	if (!Character || !Backpack || !Backpack->GetPhysicsAsset() || Entries.Contains(Backpack)) return;
+
+	auto& Entry = Entries[Entries.Add(Backpack)];
+	Entry.Backpack = Backpack;
+	Entry.Character = Character;
+	Entry.PhysicsRootBone = Backpack->GetBoneName(0);
+
+	// Whatever the component was set up with, backpacks start frozen until the next significance update
+	SetLOD(Entry, EBackpackPhysicsLOD::Frozen);
+	SignificanceTimeLeft = 0.f;
+}
+
+void UBackpackPhysicsSubsystem::Unregister(const USkeletalMeshComponent* Backpack)
+{
+	const auto Index = Entries.Find(Backpack);
+	if (Index == INDEX_NONE) return;
+
+	SetLOD(Entries[Index], EBackpackPhysicsLOD::Frozen);
+	Entries.RemoveAt(Index);
+}
+
+void UBackpackPhysicsSubsystem::SetForceSimulation(bool Force)
+{
+	ForceSimulation = Force;
+	SignificanceTimeLeft = 0.f;
+}
+
+void UBackpackPhysicsSubsystem::PrintStats() const
+{
+	int32 Counts[3] = {};
+	int32 SimulatedBodies = 0;
+	for (const auto& Entry : Entries)
+	{
+		++Counts[static_cast<int32>(Entry.LOD)];
+		if (Entry.LOD == EBackpackPhysicsLOD::Simulated && Entry.Backpack.IsValid())
+		{
+			for (const auto Body : Entry.Backpack->Bodies)
+			{
+				if (Body && Body->IsInstanceSimulatingPhysics()) ++SimulatedBodies;
+			}
+		}
+	}
+
+	UE_LOG(LogDaysGun, Display, TEXT("%d backpacks: %d simulated (%d bodies, budget %d), %d spring, %d frozen%s"),
+	       Entries.Num(), Counts[0], SimulatedBodies, MaxSimulatedBackpacks, Counts[1], Counts[2],
+	       ForceSimulation ? TEXT(", simulation forced") : TEXT(""));
+}
+
+void UBackpackPhysicsSubsystem::UpdateSignificance()
+{
+	SCOPE_CYCLE_COUNTER(STAT_BackpackPhysicsSignificance);
+
+	TArray<FVector, TInlineAllocator<4>> ViewLocations;
+	for (auto It = GetWorld()->GetPlayerControllerIterator(); It; ++It)
+	{
+		const auto PlayerController = It->Get();
+		if (!PlayerController || !PlayerController->IsLocalController()) continue;
+
+		FVector Location;
+		FRotator Rotation;
+		PlayerController->GetPlayerViewPoint(Location, Rotation);
+		ViewLocations.Add(Location);
+	}
+
+	TArray<EBackpackPhysicsLOD, TInlineAllocator<256>> DesiredLODs;
+	DesiredLODs.Init(EBackpackPhysicsLOD::Frozen, Entries.Num());
+
+	// Backpacks close enough to simulate, they compete for MaxSimulatedBackpacks by significance
+	TArray<int32, TInlineAllocator<64>> Candidates;
+
+	for (int32 Index = 0; Index < Entries.Num(); ++Index)
+	{
+		auto& Entry = Entries[Index];
+		if (ForceSimulation)
+		{
+			DesiredLODs[Index] = EBackpackPhysicsLOD::Simulated;
+			continue;
+		}
+
+		if (ViewLocations.Num() == 0) continue;
+
+		const auto Location = Entry.Backpack->GetComponentLocation();
+		auto DistanceSquared = TNumericLimits<double>::Max();
+		for (const auto& ViewLocation : ViewLocations)
+		{
+			DistanceSquared = FMath::Min(DistanceSquared, FVector::DistSquared(ViewLocation, Location));
+		}
+
+		const auto Character = Entry.Character.Get();
+		if (Character->IsLocallyControlled() && Character->IsPlayerControlled())
+		{
+			Entry.Significance = TNumericLimits<float>::Max();
+			Candidates.Add(Index);
+			continue;
+		}
+
+		if (!Entry.Backpack->WasRecentlyRendered(OffScreenSeconds)) continue;
+
+		const auto Distance = FMath::Sqrt(DistanceSquared);
+		if (Distance <= SimulateDistance)
+		{
+			Entry.Significance = 1.f - Distance / SimulateDistance;
+			Candidates.Add(Index);
+		}
+		else if (Distance <= SpringDistance)
+		{
+			DesiredLODs[Index] = EBackpackPhysicsLOD::Spring;
+		}
+	}
+
+	Candidates.Sort([this](int32 A, int32 B) { return Entries[A].Significance > Entries[B].Significance; });
+	for (int32 Rank = 0; Rank < Candidates.Num(); ++Rank)
+	{
+		DesiredLODs[Candidates[Rank]] = Rank < MaxSimulatedBackpacks
+			                                ? EBackpackPhysicsLOD::Simulated
+			                                : EBackpackPhysicsLOD::Spring;
+	}
+
+	int32 Counts[3] = {};
+	for (int32 Index = 0; Index < Entries.Num(); ++Index)
+	{
+		if (Entries[Index].LOD != DesiredLODs[Index])
+		{
+			SetLOD(Entries[Index], DesiredLODs[Index]);
+		}
+		++Counts[static_cast<int32>(DesiredLODs[Index])];
+	}
+
+	SET_DWORD_STAT(STAT_BackpacksSimulated, Counts[static_cast<int32>(EBackpackPhysicsLOD::Simulated)]);
+	SET_DWORD_STAT(STAT_BackpacksSpring, Counts[static_cast<int32>(EBackpackPhysicsLOD::Spring)]);
+	SET_DWORD_STAT(STAT_BackpacksFrozen, Counts[static_cast<int32>(EBackpackPhysicsLOD::Frozen)]);
+}
+
+void UBackpackPhysicsSubsystem::UpdateSprings(float DeltaTime)
+{
+	if (DeltaTime <= 0.f) return;
+
+	// Long frames would make the explicit spring step overshoot
+	const auto StepTime = FMath::Min(DeltaTime, 0.05f);
+
+	for (auto& Entry : Entries)
+	{
+		if (Entry.LOD != EBackpackPhysicsLOD::Spring) continue;
+
+		const auto Character = Entry.Character.Get();
+		const auto Velocity = Character->GetVelocity();
+		const auto Acceleration = (Velocity - Entry.LastVelocity) / DeltaTime;
+		Entry.LastVelocity = Velocity;
+
+		// Accelerating forward swings the backpack back, turning swings it outwards
+		const auto LocalAcceleration = Character->GetActorQuat().UnrotateVector(Acceleration);
+		const FVector2f Target(
+			FMath::Clamp(static_cast<float>(-LocalAcceleration.X) * SpringAccelerationScale, -MaxSwingAngle,
+			             MaxSwingAngle),
+			FMath::Clamp(static_cast<float>(LocalAcceleration.Y) * SpringAccelerationScale, -MaxSwingAngle,
+			             MaxSwingAngle));
+
+		Entry.SwingVelocity += ((Target - Entry.SwingAngle) * SpringStiffness - Entry.SwingVelocity * SpringDamping) *
+			StepTime;
+		Entry.SwingAngle += Entry.SwingVelocity * StepTime;
+
+		Entry.Backpack->SetRelativeRotation(FRotator(Entry.SwingAngle.X, 0.f, Entry.SwingAngle.Y));
+	}
+}
+
+void UBackpackPhysicsSubsystem::SetLOD(FBackpackEntry& Entry, EBackpackPhysicsLOD LOD) const
+{
+	Entry.LOD = LOD;
+
+	const auto Backpack = Entry.Backpack.Get();
+	if (!Backpack) return;
+
+	Entry.SwingAngle = FVector2f::ZeroVector;
+	Entry.SwingVelocity = FVector2f::ZeroVector;
+	Entry.LastVelocity = Entry.Character.IsValid() ? Entry.Character->GetVelocity() : FVector::ZeroVector;
+	Backpack->SetRelativeRotation(FRotator::ZeroRotator);
+
+	switch (LOD)
+	{
+	case EBackpackPhysicsLOD::Simulated:
+		Backpack->SetComponentTickEnabled(true);
+		// The root body stays kinematic so the backpack keeps following the socket
+		Backpack->SetAllBodiesBelowSimulatePhysics(Entry.PhysicsRootBone, true, false);
+		break;
+	case EBackpackPhysicsLOD::Spring:
+		Backpack->SetAllBodiesSimulatePhysics(false);
+		Backpack->SetComponentTickEnabled(true);
+		break;
+	case EBackpackPhysicsLOD::Frozen:
+		Backpack->SetAllBodiesSimulatePhysics(false);
+		// One last pose update so bodies left behind by the simulation snap back before the tick stops
+		Backpack->RefreshBoneTransforms();
+		Backpack->SetComponentTickEnabled(false);
+		break;
+	}
+}
+
+void UBackpackPhysicsSubsystem::StartBenchmark(int32 Count, float Seconds)
+{
+	const auto Soak = FSubsystemBenchmark::GetIdleSoak(GetWorld());
+	if (!Soak || Count <= 0 || !Benchmark.Start(UE_ARRAY_COUNT(BenchmarkPhases), Seconds)) return;
+
+	Soak->SpawnBotsAround(Count, FSubsystemBenchmark::GetCenter(GetWorld()));
+	BenchmarkPhases[0] = FBenchmarkPhase();
+	BenchmarkPhases[1] = FBenchmarkPhase();
+
+	SetForceSimulation(false);
+	SetTimingTicksEnabled(true);
+
+	UE_LOG(LogDaysGun, Display, TEXT("Backpack benchmark: %d bots, %.0f s with LODs then %.0f s fully simulated"),
+	       Soak->GetNumBots(), Seconds, Seconds);
+}
+
+void UBackpackPhysicsSubsystem::TickBenchmark(float DeltaTime)
+{
+	if (Benchmark.Tick(DeltaTime) && EndPhysicsTick.Cycles > StartPhysicsTick.Cycles)
+	{
+		auto& Phase = BenchmarkPhases[Benchmark.GetPhaseIndex()];
+		++Phase.Frames;
+		Phase.PhysicsMs += FPlatformTime::ToMilliseconds64(EndPhysicsTick.Cycles - StartPhysicsTick.Cycles);
+		Phase.FrameMs += FSubsystemBenchmark::GetFrameMs();
+
+		for (const auto& Entry : Entries)
+		{
+			if (Entry.LOD != EBackpackPhysicsLOD::Simulated) continue;
+
+			++Phase.SimulatedBackpacks;
+			for (const auto Body : Entry.Backpack->Bodies)
+			{
+				if (Body && Body->IsInstanceSimulatingPhysics()) ++Phase.SimulatedBodies;
+			}
+		}
+	}
+
+	if (!Benchmark.IsPhaseDone()) return;
+
+	if (Benchmark.NextPhase())
+	{
+		SetForceSimulation(true);
+		return;
+	}
+
+	FinishBenchmark();
+}
+
+void UBackpackPhysicsSubsystem::FinishBenchmark()
+{
+	SetForceSimulation(false);
+	SetTimingTicksEnabled(false);
+
+	UE_LOG(LogDaysGun, Display, TEXT("Backpack benchmark, %d backpacks, budget %d:"), Entries.Num(),
+	       MaxSimulatedBackpacks);
+
+	const TCHAR* PhaseNames[] = {TEXT("LOD"), TEXT("All simulated")};
+	for (int32 Index = 0; Index < UE_ARRAY_COUNT(BenchmarkPhases); ++Index)
+	{
+		const auto& Phase = BenchmarkPhases[Index];
+		const auto Frames = FMath::Max(Phase.Frames, 1);
+		UE_LOG(LogDaysGun, Display,
+		       TEXT("  %-14s physics %6.2f ms  frame %6.2f ms  %6.1f backpacks %7.1f bodies simulated"),
+		       PhaseNames[Index], Phase.PhysicsMs / Frames, Phase.FrameMs / Frames,
+		       static_cast<double>(Phase.SimulatedBackpacks) / Frames,
+		       static_cast<double>(Phase.SimulatedBodies) / Frames);
+	}
+
+	Benchmark.Finish(GetWorld());
+}
+
+void UBackpackPhysicsSubsystem::SetTimingTicksEnabled(bool Enabled)
+{
+	const auto World = GetWorld();
+	if (!World) return;
+
+	// Physics span: after StartPhysics kicks off the solver until EndPhysics has waited for it
+	const auto Setup = [World, Enabled](FBackpackPhysicsTimingTick& TimingTick, FTickFunction& After,
+	                                    ETickingGroup Group)
+	{
+		if (Enabled && !TimingTick.IsTickFunctionRegistered())
+		{
+			TimingTick.bCanEverTick = true;
+			TimingTick.TickGroup = Group;
+			TimingTick.EndTickGroup = Group;
+			TimingTick.AddPrerequisite(World, After);
+			TimingTick.RegisterTickFunction(World->PersistentLevel);
+		}
+		else if (!Enabled && TimingTick.IsTickFunctionRegistered())
+		{
+			TimingTick.RemovePrerequisite(World, After);
+			TimingTick.UnRegisterTickFunction();
+		}
+		TimingTick.Cycles = 0;
+	};
+
+	Setup(StartPhysicsTick, World->StartPhysicsTickFunction, TG_StartPhysics);
+	Setup(EndPhysicsTick, World->EndPhysicsTickFunction, TG_EndPhysics);
+}
+
+#if !UE_BUILD_SHIPPING
+static FAutoConsoleCommandWithWorld GBackpackPhysicsStatsCommand(
+	TEXT("DaysGun.Backpack.Stats"),
+	TEXT("Logs how many backpacks are simulated, on springs or frozen."),
+	FConsoleCommandWithWorldDelegate::CreateLambda([](UWorld* World)
+	{
+		if (const auto Subsystem = World ? World->GetSubsystem<UBackpackPhysicsSubsystem>() : nullptr)
+		{
+			Subsystem->PrintStats();
+		}
+	}));
+
+static FAutoConsoleCommandWithWorldAndArgs GBackpackPhysicsForceCommand(
+	TEXT("DaysGun.Backpack.ForceSimulation"),
+	TEXT("Simulates every backpack regardless of distance and budget. Args: 0|1"),
+	FConsoleCommandWithWorldAndArgsDelegate::CreateLambda([](const TArray<FString>& Args, UWorld* World)
+	{
+		if (const auto Subsystem = World ? World->GetSubsystem<UBackpackPhysicsSubsystem>() : nullptr)
+		{
+			Subsystem->SetForceSimulation(Args.Num() == 0 || FCString::Atoi(*Args[0]) != 0);
+		}
+	}));
+
+static FAutoConsoleCommandWithWorldAndArgs GBackpackPhysicsBenchmarkCommand(
+	TEXT("DaysGun.Backpack.Benchmark"),
+	TEXT("Spawns soak bots and compares the physics span with backpack LODs against everything simulated. ")
+	TEXT("Args: [Count=200] [Seconds=10]"),
+	FConsoleCommandWithWorldAndArgsDelegate::CreateLambda([](const TArray<FString>& Args, UWorld* World)
+	{
+		if (const auto Subsystem = World ? World->GetSubsystem<UBackpackPhysicsSubsystem>() : nullptr)
+		{
+			const int32 Count = Args.Num() > 0 ? FCString::Atoi(*Args[0]) : 200;
+			const float Seconds = Args.Num() > 1 ? FCString::Atof(*Args[1]) : 10.f;
+			Subsystem->StartBenchmark(Count, Seconds);
+		}
+	}));
+#endif
@@ -2,7 +2,11 @@
 
 
 #include "Player/BaseCharacter.h"
+#include "DaysGun.h"
+#include "Animation/AnimMontage.h"
+#include "Animation/PlayerAnimInstance.h"
 #include "Camera/CameraComponent.h"
+#include "Crowd/CrowdSteeringSubsystem.h"
 #include "Components/CapsuleComponent.h"
 #include "Components/InputComponent.h"
 #include "GameFramework/CharacterMovementComponent.h"
@@ -10,11 +14,21 @@
 #include "GameFramework/SpringArmComponent.h"
 #include "EnhancedInputComponent.h"
 #include "EnhancedInputSubsystems.h"
-#include "Kismet/KismetMathLibrary.h"
+#include "Loot/LootContainer.h"
+#include "Loot/LootInteractionSubsystem.h"
+#include "Math/DaysGunMath.h"
+#include "Player/BackpackPhysicsSubsystem.h"
+#include "Player/GaitBlendSubsystem.h"
+#include "Player/HitchRecorderSubsystem.h"
+#include "Player/MovementLODSubsystem.h"
+#include "WorldPartition/WorldPartitionSubsystem.h"
 
 ABaseCharacter::ABaseCharacter()
 {
-	PrimaryActorTick.bCanEverTick = true;
+	LLM_SCOPE_BYTAG(DaysGun_Character);
+
+	// Speed blending is batched in UGaitBlendSubsystem, nothing is left to do per actor tick
+	PrimaryActorTick.bCanEverTick = false;
 
 	// Set size for collision capsule
 	GetCapsuleComponent()->InitCapsuleSize(42.f, 96.0f);
@@ -27,44 +41,59 @@ ABaseCharacter::ABaseCharacter()
 	GetCharacterMovement()->bOrientRotationToMovement = false;
 	GetCharacterMovement()->RotationRate = FRotator(0.0f, 0.0f, 0.0f);
 
-	// Create a camera boom (pulls in towards the player if there is a collision)
-	CameraBoom = CreateDefaultSubobject<USpringArmComponent>(TEXT("CameraBoom"));
-	CameraBoom->SetupAttachment(RootComponent);
-	CameraBoom->TargetArmLength = 400.0f; // The camera follows at this distance behind the character	
-	CameraBoom->bUsePawnControlRotation = true; // Rotate the arm based on the controller
+	// CameraBoom and FollowCamera are created in CreateLocalPlayerComponents, AI and remote characters never need them
 
-	// Create a follow camera
-	FollowCamera = CreateDefaultSubobject<UCameraComponent>(TEXT("FollowCamera"));
-	FollowCamera->SetupAttachment(CameraBoom, USpringArmComponent::SocketName);
-	// Attach the camera to the end of the boom and let the boom adjust to match the controller orientation
-	FollowCamera->bUsePawnControlRotation = false; // Camera does not rotate relative to arm
+	{
+		LLM_SCOPE_BYTAG(DaysGun_Backpack);
+		BackpackMesh = CreateDefaultSubobject<USkeletalMeshComponent>("Backpack");
+		BackpackMesh->SetupAttachment(GetMesh(), "BackpackSocket");
+
+		// Registered in PostRegisterAllComponents so its render and physics state is tracked as backpack memory
+		BackpackMesh->bAutoRegister = false;
+	}
+}
+
+void ABaseCharacter::PostRegisterAllComponents()
+{
+	Super::PostRegisterAllComponents();
 
-	BackpackMesh = CreateDefaultSubobject<USkeletalMeshComponent>("Backpack");
-	BackpackMesh->SetupAttachment(GetMesh(), "BackpackSocket");
+	// The backpack is cosmetic, server targets never give it render, physics or animation state
+#if !UE_SERVER
+	if (!BackpackMesh->IsRegistered() && GetWorld())
+	{
+		LLM_SCOPE_BYTAG(DaysGun_Backpack);
+		BackpackMesh->RegisterComponent();
+	}
+#endif
 }
 
 void ABaseCharacter::BeginPlay()
 {
+	LLM_SCOPE_BYTAG(DaysGun_Character);
 	Super::BeginPlay();
 
 	SetupCharacterSettings();
+	UpdateLocalPlayerComponents();
+	UpdateStreamingSource();
+	AddInputMappingContext();
+	RegisterBackpackPhysics();
+	RegisterMovementLOD();
 
-	//Add Input Mapping Context
-	if (APlayerController* PlayerController = Cast<APlayerController>(Controller))
+	if (const auto HitchRecorder = GetWorld()->GetSubsystem<UHitchRecorderSubsystem>())
 	{
-		if (UEnhancedInputLocalPlayerSubsystem* Subsystem = ULocalPlayer::GetSubsystem<
-			UEnhancedInputLocalPlayerSubsystem>(PlayerController->GetLocalPlayer()))
-		{
-			Subsystem->AddMappingContext(DefaultMappingContext, 0);
-		}
+		HitchRecorder->AddEvent(EHitchEvent::Spawn, this);
 	}
 }
 
-void ABaseCharacter::Tick(float DeltaSeconds)
+void ABaseCharacter::EndPlay(const EEndPlayReason::Type EndPlayReason)
 {
-	Super::Tick(DeltaSeconds);
+	StopLooting();
+	CancelGaitBlend();
+	UnregisterBackpackPhysics();
+	UnregisterMovementLOD();
+	UnregisterStreamingSource();
 
-	UpdateMaxSpeed(DeltaSeconds);
+	Super::EndPlay(EndPlayReason);
 }
 
 void ABaseCharacter::SetupPlayerInputComponent(UInputComponent* PlayerInputComponent)
@@ -86,15 +115,333 @@ void ABaseCharacter::SetupPlayerInputComponent(UInputComponent* PlayerInputCompo
 		EnhancedInputComponent->BindAction(SprintAction, ETriggerEvent::Triggered, this, &ABaseCharacter::RunStarted);
 		EnhancedInputComponent->BindAction(SprintAction, ETriggerEvent::Canceled, this, &ABaseCharacter::RunFinished);
 		EnhancedInputComponent->BindAction(SprintAction, ETriggerEvent::Completed, this, &ABaseCharacter::RunFinished);
+
+		//Looting
+		if (InteractAction)
+		{
+			EnhancedInputComponent->BindAction(InteractAction, ETriggerEvent::Started, this, &ABaseCharacter::Interact);
+		}
+	}
+}
+
+void ABaseCharacter::NotifyControllerChanged()
+{
+	Super::NotifyControllerChanged();
+
+	// Pooled characters are possessed again without running BeginPlay
+	if (HasActorBegunPlay())
+	{
+		UpdateLocalPlayerComponents();
+		UpdateStreamingSource();
+		AddInputMappingContext();
+	}
+}
+
+void ABaseCharacter::UnPossessed()
+{
+	RemoveInputMappingContext();
+	DestroyPlayerInputComponent();
+	DestroyLocalPlayerComponents();
+	UnregisterStreamingSource();
+
+	Super::UnPossessed();
+}
+
+void ABaseCharacter::UpdateLocalPlayerComponents()
+{
+	if (IsLocallyControlled() && IsPlayerControlled())
+	{
+		CreateLocalPlayerComponents();
+	}
+	else
+	{
+		DestroyLocalPlayerComponents();
+	}
+}
+
+void ABaseCharacter::CreateLocalPlayerComponents()
+{
+	// Dedicated servers have no local player, server targets leave the camera out altogether
+#if !UE_SERVER
+	if (CameraBoom) return;
+
+	LLM_SCOPE_BYTAG(DaysGun_Character);
+
+	// Create a camera boom (pulls in towards the player if there is a collision)
+	CameraBoom = NewObject<USpringArmComponent>(this);
+	CameraBoom->SetupAttachment(RootComponent);
+	CameraBoom->TargetArmLength = CameraBoomArmLength;
+	CameraBoom->SocketOffset = CameraBoomSocketOffset;
+	CameraBoom->bUsePawnControlRotation = true; // Rotate the arm based on the controller
+	CameraBoom->RegisterComponent();
+
+	// Create a follow camera
+	FollowCamera = NewObject<UCameraComponent>(this);
+	FollowCamera->SetupAttachment(CameraBoom, USpringArmComponent::SocketName);
+	// Attach the camera to the end of the boom and let the boom adjust to match the controller orientation
+	FollowCamera->bUsePawnControlRotation = false; // Camera does not rotate relative to arm
+	FollowCamera->SetFieldOfView(FollowCameraFieldOfView);
+	FollowCamera->RegisterComponent();
+#endif
+}
+
+void ABaseCharacter::DestroyLocalPlayerComponents()
+{
+	if (FollowCamera)
+	{
+		FollowCamera->DestroyComponent();
+		FollowCamera = nullptr;
+	}
+
+	if (CameraBoom)
+	{
+		CameraBoom->DestroyComponent();
+		CameraBoom = nullptr;
+	}
+}
+
+void ABaseCharacter::AddInputMappingContext()
+{
+	if (APlayerController* PlayerController = Cast<APlayerController>(Controller))
+	{
+		if (UEnhancedInputLocalPlayerSubsystem* Subsystem = ULocalPlayer::GetSubsystem<
+			UEnhancedInputLocalPlayerSubsystem>(PlayerController->GetLocalPlayer()))
+		{
+			Subsystem->AddMappingContext(DefaultMappingContext, 0);
+		}
+	}
+}
+
+void ABaseCharacter::RemoveInputMappingContext()
+{
+	if (APlayerController* PlayerController = Cast<APlayerController>(Controller))
+	{
+		if (UEnhancedInputLocalPlayerSubsystem* Subsystem = ULocalPlayer::GetSubsystem<
+			UEnhancedInputLocalPlayerSubsystem>(PlayerController->GetLocalPlayer()))
+		{
+			Subsystem->RemoveMappingContext(DefaultMappingContext);
+		}
+	}
+}
+
+void ABaseCharacter::OnReleasedToPool()
+{
+	Pooled = true;
+
+	StopLooting();
+	CancelGaitBlend();
+	UnregisterMovementLOD();
+	UnregisterStreamingSource();
+	ResetJumpState();
+	GetCharacterMovement()->StopMovementImmediately();
+	GetCharacterMovement()->DisableMovement();
+	GetCharacterMovement()->SetComponentTickEnabled(false);
+
+	if (const auto AnimInstance = GetMesh()->GetAnimInstance())
+	{
+		AnimInstance->StopAllMontages(0.f);
+	}
+
+	if (const auto AnimInstance = Cast<UPlayerAnimInstance>(GetMesh()->GetAnimInstance()))
+	{
+		AnimInstance->SetPooled(true);
+	}
+
+	GetMesh()->SetComponentTickEnabled(false);
+	UnregisterBackpackPhysics();
+	BackpackMesh->SetComponentTickEnabled(false);
+
+	if (const auto CrowdSteering = GetWorld()->GetSubsystem<UCrowdSteeringSubsystem>())
+	{
+		CrowdSteering->Unregister(this);
+	}
+
+	ResetAttachments();
+
+	SetActorHiddenInGame(true);
+	SetActorEnableCollision(false);
+}
+
+void ABaseCharacter::OnAcquiredFromPool(const FTransform& SpawnTransform)
+{
+	LLM_SCOPE_BYTAG(DaysGun_Character);
+	Pooled = false;
+
+	SetActorTransform(SpawnTransform, false, nullptr, ETeleportType::ResetPhysics);
+	SetupCharacterSettings();
+
+	GetCharacterMovement()->SetComponentTickEnabled(true);
+	GetCharacterMovement()->SetMovementMode(GetCharacterMovement()->DefaultLandMovementMode);
+
+	GetMesh()->SetComponentTickEnabled(true);
+	BackpackMesh->SetComponentTickEnabled(true);
+
+	if (const auto AnimInstance = Cast<UPlayerAnimInstance>(GetMesh()->GetAnimInstance()))
+	{
+		AnimInstance->SetPooled(false);
+	}
+
+	SetActorHiddenInGame(false);
+	SetActorEnableCollision(true);
+	RegisterBackpackPhysics();
+	RegisterMovementLOD();
+
+	if (const auto HitchRecorder = GetWorld()->GetSubsystem<UHitchRecorderSubsystem>())
+	{
+		HitchRecorder->AddEvent(EHitchEvent::Spawn, this);
+	}
+}
+
+void ABaseCharacter::RegisterBackpackPhysics()
+{
+	const auto World = GetWorld();
+	if (const auto BackpackPhysics = World ? World->GetSubsystem<UBackpackPhysicsSubsystem>() : nullptr)
+	{
+		BackpackPhysics->Register(this, BackpackMesh);
+	}
+}
+
+void ABaseCharacter::UnregisterBackpackPhysics()
+{
+	const auto World = GetWorld();
+	if (const auto BackpackPhysics = World ? World->GetSubsystem<UBackpackPhysicsSubsystem>() : nullptr)
+	{
+		BackpackPhysics->Unregister(BackpackMesh);
+	}
+}
+
+void ABaseCharacter::RegisterMovementLOD()
+{
+	const auto World = GetWorld();
+	if (const auto MovementLOD = World ? World->GetSubsystem<UMovementLODSubsystem>() : nullptr)
+	{
+		MovementLOD->Register(this);
+	}
+}
+
+void ABaseCharacter::UnregisterMovementLOD()
+{
+	const auto World = GetWorld();
+	if (const auto MovementLOD = World ? World->GetSubsystem<UMovementLODSubsystem>() : nullptr)
+	{
+		MovementLOD->Unregister(this);
+	}
+}
+
+void ABaseCharacter::RequestFullMovement(float Seconds)
+{
+	const auto World = GetWorld();
+	if (const auto MovementLOD = World ? World->GetSubsystem<UMovementLODSubsystem>() : nullptr)
+	{
+		MovementLOD->RequestFullMovement(this, Seconds);
+	}
+}
+
+bool ABaseCharacter::GetStreamingSources(TArray<FWorldPartitionStreamingSource>& OutStreamingSources) const
+{
+	if (!PredictiveStreaming) return false;
+
+	const auto Velocity = GetVelocity();
+	const auto Speed = Velocity.Size2D();
+	if (Speed < StreamingMinSpeed) return false;
+
+	// Players look where they are about to go, which turns the look-ahead before the velocity follows
+	const auto ControlForward = FDaysGunMath::ForwardFromYaw(GetControlRotation().Yaw);
+	const auto Direction = FMath::Lerp(Velocity.GetSafeNormal2D(), ControlForward, StreamingControlRotationWeight)
+		.GetSafeNormal2D();
+	const auto LookAhead = FMath::Min(Speed * StreamingLookAheadSeconds, StreamingMaxLookAhead);
+
+	// Faster gaits cross cells sooner, so their sources reach further and are served before the others
+	const auto RangeScale = FMath::Lerp(1.f, StreamingMaxRangeScale, LookAhead / StreamingMaxLookAhead);
+	const auto Priority = Gait == EGait::EG_Run || Gait == EGait::EG_Sprint
+		                      ? EStreamingSourcePriority::High
+		                      : EStreamingSourcePriority::Normal;
+
+	const auto AddSource = [&](FName Name, float Distance, EStreamingSourceTargetState TargetState)
+	{
+		auto& Source = OutStreamingSources.AddDefaulted_GetRef();
+		Source.Name = Name;
+		Source.Location = GetActorLocation() + Direction * Distance;
+		Source.Rotation = Direction.Rotation();
+		Source.TargetState = TargetState;
+		Source.Priority = Priority;
+		Source.Shapes.AddDefaulted_GetRef().LoadingRangeScale = RangeScale;
+	};
+
+	AddSource(ActivateSourceName, LookAhead * 0.5f, EStreamingSourceTargetState::Activated);
+	AddSource(PreloadSourceName, LookAhead, EStreamingSourceTargetState::Loaded);
+	return true;
+}
+
+void ABaseCharacter::UpdateStreamingSource()
+{
+	if (Pooled || !IsLocallyControlled() || !IsPlayerControlled())
+	{
+		UnregisterStreamingSource();
+		return;
+	}
+
+	const auto World = GetWorld();
+	const auto WorldPartition = World ? World->GetSubsystem<UWorldPartitionSubsystem>() : nullptr;
+	if (!WorldPartition || StreamingSourceRegistered) return;
+
+	ActivateSourceName = *FString::Printf(TEXT("%s_Activate"), *GetName());
+	PreloadSourceName = *FString::Printf(TEXT("%s_Preload"), *GetName());
+	WorldPartition->RegisterStreamingSourceProvider(this);
+	StreamingSourceRegistered = true;
+}
+
+void ABaseCharacter::UnregisterStreamingSource()
+{
+	if (!StreamingSourceRegistered) return;
+	StreamingSourceRegistered = false;
+
+	const auto World = GetWorld();
+	if (const auto WorldPartition = World ? World->GetSubsystem<UWorldPartitionSubsystem>() : nullptr)
+	{
+		WorldPartition->UnregisterStreamingSourceProvider(this);
 	}
 }
 
+void ABaseCharacter::ResetAttachments()
+{
+	TArray<AActor*> AttachedActors;
+	GetAttachedActors(AttachedActors);
+	for (const auto AttachedActor : AttachedActors)
+	{
+		AttachedActor->DetachFromActor(FDetachmentTransformRules::KeepWorldTransform);
+	}
+
+	BackpackMesh->AttachToComponent(GetMesh(), FAttachmentTransformRules::SnapToTargetNotIncludingScale,
+	                                "BackpackSocket");
+	BackpackMesh->SetRelativeTransform(FTransform::Identity);
+}
+
 void ABaseCharacter::SetupCharacterSettings()
 {
-	GetCharacterMovement()->MaxWalkSpeed = WalkSpeed;
-	TargetMaxSpeed = WalkSpeed;
-	
-	GetCharacterMovement()->MaxAcceleration = WalkMaxAcceleration;
+	CancelGaitBlend();
+
+	Gait = DefaultGait;
+	const auto& Profile = GetGaitProfiles()->GetRuntimeProfile(Gait);
+	GetCharacterMovement()->MaxWalkSpeed = Profile.MaxSpeed;
+	GetCharacterMovement()->MaxAcceleration = Profile.MaxAcceleration;
+	GetCharacterMovement()->BrakingDecelerationWalking = Profile.BrakingDeceleration;
+}
+
+void ABaseCharacter::SetGait(EGait NewGait)
+{
+	if (Gait == NewGait) return;
+	Gait = NewGait;
+
+	if (const auto GaitBlend = GetWorld()->GetSubsystem<UGaitBlendSubsystem>())
+	{
+		GaitBlend->RequestBlend(GetCharacterMovement(), GetGaitProfiles(), Gait, FixedStepSettings);
+	}
+}
+
+const UGaitProfileSet* ABaseCharacter::GetGaitProfiles() const
+{
+	return GaitProfiles ? GaitProfiles : GetDefault<UGaitProfileSet>();
 }
 
 void ABaseCharacter::Move(const FInputActionValue& Value)
@@ -135,23 +482,82 @@ void ABaseCharacter::Look(const FInputActionValue& Value)
 
 void ABaseCharacter::RunStarted(const FInputActionValue& Value)
 {
-	TargetMaxSpeed = RunSpeed;
-	GetCharacterMovement()->MaxAcceleration = RunMaxAcceleration;
+	SetGait(SprintGait);
 }
 
 void ABaseCharacter::RunFinished(const FInputActionValue& Value)
 {
-	TargetMaxSpeed = WalkSpeed;
-	GetCharacterMovement()->MaxAcceleration = WalkMaxAcceleration;
+	SetGait(DefaultGait);
+}
+
+void ABaseCharacter::Interact(const FInputActionValue& Value)
+{
+	ToggleLooting();
 }
 
-void ABaseCharacter::UpdateMaxSpeed(float DeltaSeconds)
+void ABaseCharacter::ToggleLooting()
 {
-	if (UKismetMathLibrary::EqualEqual_DoubleDouble(TargetMaxSpeed, GetCharacterMovement()->MaxWalkSpeed))
+	if (LootTarget)
 	{
+		StopLooting();
 		return;
 	}
-	
-	GetCharacterMovement()->MaxWalkSpeed = FMath::FInterpTo(
-		GetCharacterMovement()->MaxWalkSpeed, TargetMaxSpeed, DeltaSeconds, MaxSpeedTransitionInterp);
+
+	StartLooting();
+}
+
+void ABaseCharacter::StartLooting()
+{
+	const auto LootInteraction = GetWorld()->GetSubsystem<ULootInteractionSubsystem>();
+	if (!LootInteraction || LootTarget) return;
+
+	// Players loot what the camera faces, AI what the body faces
+	const auto Yaw = Controller && Controller->IsLocalPlayerController()
+		                 ? GetControlRotation().Yaw
+		                 : GetActorRotation().Yaw;
+	const auto Container = LootInteraction->FindNearestInView(GetActorLocation(), FDaysGunMath::ForwardFromYaw(Yaw));
+	if (!Container || !Container->TryOpen(this)) return;
+
+	LootTarget = Container;
+	RequestFullMovement(InteractionFullMovementSeconds);
+	if (LootMontage)
+	{
+		PlayAnimMontage(LootMontage);
+	}
+}
+
+void ABaseCharacter::StopLooting()
+{
+	if (!LootTarget) return;
+
+	const auto AnimInstance = GetMesh()->GetAnimInstance();
+	if (AnimInstance && LootMontage && AnimInstance->Montage_IsPlaying(LootMontage))
+	{
+		if (LootMontage->IsValidSectionName(LootExitSection))
+		{
+			AnimInstance->Montage_JumpToSection(LootExitSection, LootMontage);
+		}
+		else
+		{
+			AnimInstance->Montage_Stop(LootMontage->BlendOut.GetBlendTime(), LootMontage);
+		}
+	}
+
+	if (IsValid(LootTarget))
+	{
+		LootTarget->Close();
+	}
+	LootTarget = nullptr;
+
+	// Covers the exit section
+	RequestFullMovement(InteractionFullMovementSeconds);
+}
+
+void ABaseCharacter::CancelGaitBlend()
+{
+	const auto World = GetWorld();
+	if (const auto GaitBlend = World ? World->GetSubsystem<UGaitBlendSubsystem>() : nullptr)
+	{
+		GaitBlend->CancelBlend(GetCharacterMovement());
+	}
 }
@@ -0,0 +1,232 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "Player/CharacterPoolSubsystem.h"
+
+#include "AIController.h"
+#include "DaysGun.h"
+#include "Player/BaseCharacter.h"
+
+DECLARE_CYCLE_STAT(TEXT("Character Pool Acquire"), STAT_CharacterPoolAcquire, STATGROUP_DaysGun);
+DECLARE_CYCLE_STAT(TEXT("Character Pool Release"), STAT_CharacterPoolRelease, STATGROUP_DaysGun);
+DECLARE_CYCLE_STAT(TEXT("Character Pool Spawn"), STAT_CharacterPoolSpawn, STATGROUP_DaysGun);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Character Pool Misses"), STAT_CharacterPoolMisses, STATGROUP_DaysGun);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Controller Pool Misses"), STAT_ControllerPoolMisses, STATGROUP_DaysGun);
+
+void UCharacterPoolSubsystem::OnWorldBeginPlay(UWorld& InWorld)
+{
+	Super::OnWorldBeginPlay(InWorld);
+
+	for (const auto& Entry : PrewarmClasses)
+	{
+		Prewarm(Entry.CharacterClass.LoadSynchronous(), Entry.Count);
+	}
+}
+
+void UCharacterPoolSubsystem::Deinitialize()
+{
+	Pool.Empty();
+	ControllerPool.Empty();
+	Super::Deinitialize();
+}
+
+void UCharacterPoolSubsystem::Prewarm(TSubclassOf<ABaseCharacter> CharacterClass, int32 Count)
+{
+	if (!CharacterClass) return;
+
+	auto& Bucket = Pool.FindOrAdd(CharacterClass);
+	Bucket.Characters.Reserve(Bucket.Characters.Num() + Count);
+
+	for (int32 Index = 0; Index < Count; ++Index)
+	{
+		const auto Character = SpawnCharacter(CharacterClass, FTransform(PoolLocation));
+		if (!Character) return;
+
+		Release(Character);
+	}
+}
+
+ABaseCharacter* UCharacterPoolSubsystem::Acquire(TSubclassOf<ABaseCharacter> CharacterClass,
+                                                 const FTransform& SpawnTransform,
+                                                 TSubclassOf<AAIController> ControllerClass)
+{
+	SCOPE_CYCLE_COUNTER(STAT_CharacterPoolAcquire);
+	if (!CharacterClass) return nullptr;
+
+	ABaseCharacter* Character = nullptr;
+	if (auto Bucket = Pool.Find(CharacterClass))
+	{
+		while (!Character && Bucket->Characters.Num() > 0)
+		{
+			Character = Bucket->Characters.Pop(false);
+			if (!IsValid(Character)) Character = nullptr;
+		}
+	}
+
+	if (!Character)
+	{
+		INC_DWORD_STAT(STAT_CharacterPoolMisses);
+		Character = SpawnCharacter(CharacterClass, SpawnTransform);
+		if (!Character || !ControllerClass) return Character;
+
+		// A fresh character comes with its default controller, which joins the pool when another class is wanted
+		const auto Controller = Character->GetController();
+		if (Controller && Controller->IsA(ControllerClass)) return Character;
+
+		ReleaseController(Controller);
+	}
+	else
+	{
+		Character->OnAcquiredFromPool(SpawnTransform);
+	}
+
+	const auto PossessesAI = Character->AutoPossessAI == EAutoPossessAI::Spawned ||
+		Character->AutoPossessAI == EAutoPossessAI::PlacedInWorldOrSpawned;
+	if (ControllerClass)
+	{
+		PossessFromPool(Character, ControllerClass);
+	}
+	else if (PossessesAI && Character->AIControllerClass && Character->AIControllerClass->IsChildOf<AAIController>())
+	{
+		PossessFromPool(Character, Character->AIControllerClass.Get());
+	}
+	else if (PossessesAI && !Character->GetController())
+	{
+		Character->SpawnDefaultController();
+	}
+
+	return Character;
+}
+
+void UCharacterPoolSubsystem::Release(ABaseCharacter* Character)
+{
+	SCOPE_CYCLE_COUNTER(STAT_CharacterPoolRelease);
+	if (!IsValid(Character) || Character->IsPooled()) return;
+
+	ReleaseController(Character->GetController());
+
+	Character->OnReleasedToPool();
+	Character->SetActorLocation(PoolLocation, false, nullptr, ETeleportType::ResetPhysics);
+
+	Pool.FindOrAdd(Character->GetClass()).Characters.Add(Character);
+}
+
+int32 UCharacterPoolSubsystem::GetNumPooled(TSubclassOf<ABaseCharacter> CharacterClass) const
+{
+	const auto Bucket = Pool.Find(CharacterClass);
+	return Bucket ? Bucket->Characters.Num() : 0;
+}
+
+ABaseCharacter* UCharacterPoolSubsystem::SpawnCharacter(TSubclassOf<ABaseCharacter> CharacterClass,
+                                                        const FTransform& SpawnTransform) const
+{
+	SCOPE_CYCLE_COUNTER(STAT_CharacterPoolSpawn);
+	LLM_SCOPE_BYTAG(DaysGun_Character);
+
+	FActorSpawnParameters SpawnParams;
+	SpawnParams.SpawnCollisionHandlingOverride = ESpawnActorCollisionHandlingMethod::AlwaysSpawn;
+
+	return GetWorld()->SpawnActor<ABaseCharacter>(CharacterClass, SpawnTransform, SpawnParams);
+}
+
+void UCharacterPoolSubsystem::PossessFromPool(ABaseCharacter* Character, TSubclassOf<AAIController> ControllerClass)
+{
+	AAIController* Controller = nullptr;
+	if (auto Bucket = ControllerPool.Find(ControllerClass))
+	{
+		while (!Controller && Bucket->Controllers.Num() > 0)
+		{
+			Controller = Bucket->Controllers.Pop(false);
+			if (!IsValid(Controller)) Controller = nullptr;
+		}
+	}
+
+	if (Controller)
+	{
+		Controller->SetActorTickEnabled(true);
+	}
+	else
+	{
+		INC_DWORD_STAT(STAT_ControllerPoolMisses);
+
+		FActorSpawnParameters SpawnParams;
+		SpawnParams.Instigator = Character->GetInstigator();
+		SpawnParams.SpawnCollisionHandlingOverride = ESpawnActorCollisionHandlingMethod::AlwaysSpawn;
+		SpawnParams.OverrideLevel = Character->GetLevel();
+		Controller = GetWorld()->SpawnActor<AAIController>(ControllerClass, Character->GetActorLocation(),
+		                                                   Character->GetActorRotation(), SpawnParams);
+		if (!Controller) return;
+	}
+
+	Controller->Possess(Character);
+}
+
+void UCharacterPoolSubsystem::ReleaseController(AController* Controller)
+{
+	if (!Controller) return;
+
+	Controller->StopMovement();
+	Controller->UnPossess();
+
+	const auto AIController = Cast<AAIController>(Controller);
+	if (!AIController) return;
+
+	AIController->SetActorTickEnabled(false);
+	ControllerPool.FindOrAdd(AIController->GetClass()).Controllers.Add(AIController);
+}
+
+#if !UE_BUILD_SHIPPING
+static FAutoConsoleCommandWithWorldAndArgs GCharacterPoolBenchmarkCommand(
+	TEXT("DaysGun.CharacterPool.Benchmark"),
+	TEXT("Compares spawning and destroying characters against acquiring and releasing them. Args: [ClassPath] [Count=50]"),
+	FConsoleCommandWithWorldAndArgsDelegate::CreateLambda([](const TArray<FString>& Args, UWorld* World)
+	{
+		const auto Subsystem = World ? World->GetSubsystem<UCharacterPoolSubsystem>() : nullptr;
+		if (!Subsystem) return;
+
+		const TSubclassOf<ABaseCharacter> CharacterClass = Args.Num() > 0
+			                                                   ? LoadClass<ABaseCharacter>(nullptr, *Args[0])
+			                                                   : ABaseCharacter::StaticClass();
+		const int32 Count = Args.Num() > 1 ? FCString::Atoi(*Args[1]) : 50;
+		if (!CharacterClass || Count <= 0) return;
+
+		const FTransform SpawnTransform(FVector(0.f, 0.f, 500.f));
+
+		TArray<ABaseCharacter*> Characters;
+		Characters.Reserve(Count);
+
+		auto Start = FPlatformTime::Cycles64();
+		for (int32 Index = 0; Index < Count; ++Index)
+		{
+			FActorSpawnParameters SpawnParams;
+			SpawnParams.SpawnCollisionHandlingOverride = ESpawnActorCollisionHandlingMethod::AlwaysSpawn;
+			Characters.Add(World->SpawnActor<ABaseCharacter>(CharacterClass, SpawnTransform, SpawnParams));
+		}
+		const auto SpawnCycles = FPlatformTime::Cycles64() - Start;
+
+		for (const auto Character : Characters)
+		{
+			if (Character) Character->Destroy();
+		}
+		Characters.Reset();
+
+		Subsystem->Prewarm(CharacterClass, FMath::Max(0, Count - Subsystem->GetNumPooled(CharacterClass)));
+
+		Start = FPlatformTime::Cycles64();
+		for (int32 Index = 0; Index < Count; ++Index)
+		{
+			Characters.Add(Subsystem->Acquire(CharacterClass, SpawnTransform));
+		}
+		const auto AcquireCycles = FPlatformTime::Cycles64() - Start;
+
+		for (const auto Character : Characters)
+		{
+			Subsystem->Release(Character);
+		}
+
+		UE_LOG(LogDaysGun, Display, TEXT("Character pool benchmark (%s x%d): spawn %.3f ms/character, acquire %.3f ms/character"),
+		       *CharacterClass->GetName(), Count,
+		       FPlatformTime::ToMilliseconds64(SpawnCycles) / Count,
+		       FPlatformTime::ToMilliseconds64(AcquireCycles) / Count);
+	}));
+#endif
@@ -0,0 +1,109 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "Player/GaitBlendSubsystem.h"
+
+#include "DaysGun.h"
+#include "GameFramework/CharacterMovementComponent.h"
+#include "Locomotion/GaitProfileSet.h"
+
+DECLARE_CYCLE_STAT(TEXT("Gait Blend Update"), STAT_GaitBlendUpdate, STATGROUP_DaysGun);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Gait Blends Active"), STAT_GaitBlendsActive, STATGROUP_DaysGun);
+
+void UGaitBlendSubsystem::Tick(float DeltaTime)
+{
+	Super::Tick(DeltaTime);
+	SCOPE_CYCLE_COUNTER(STAT_GaitBlendUpdate);
+	SET_DWORD_STAT(STAT_GaitBlendsActive, Entries.Num());
+
+	for (int32 Index = Entries.Num() - 1; Index >= 0; --Index)
+	{
+		auto& Entry = Entries[Index];
+		if (!Entry.Movement.IsValid() || !Entry.Profiles.IsValid() || UpdateEntry(Entry, DeltaTime))
+		{
+			Entries.RemoveAt(Index);
+		}
+	}
+}
+
+bool UGaitBlendSubsystem::IsTickable() const
+{
+	return Entries.Num() > 0;
+}
+
+TStatId UGaitBlendSubsystem::GetStatId() const
+{
+	RETURN_QUICK_DECLARE_CYCLE_STAT(UGaitBlendSubsystem, STATGROUP_Tickables);
+}
+
+void UGaitBlendSubsystem::Deinitialize()
+{
+	Entries.Reset();
+
+	Super::Deinitialize();
+}
+
+void UGaitBlendSubsystem::RequestBlend(UCharacterMovementComponent* Movement, const UGaitProfileSet* Profiles,
+                                       EGait Gait, const FFixedStepSettings& FixedStepSettings)
+{
+	if (!Movement || !Profiles) return;
+
+	auto Index = Entries.Find(Movement);
+	if (Index == INDEX_NONE)
+	{
+		Index = Entries.Add(Movement);
+		Entries[Index].Movement = Movement;
+	}
+
+	auto& Entry = Entries[Index];
+	Entry.Profiles = Profiles;
+	Entry.Gait = Gait;
+	Entry.State.FromSpeed = Movement->MaxWalkSpeed;
+	Entry.State.FromAcceleration = Movement->MaxAcceleration;
+	Entry.State.FromBraking = Movement->BrakingDecelerationWalking;
+	Entry.State.Elapsed = 0.f;
+	Entry.FixedStepSettings = FixedStepSettings;
+	Entry.Accumulator.Reset();
+}
+
+void UGaitBlendSubsystem::CancelBlend(const UCharacterMovementComponent* Movement)
+{
+	const auto Index = Entries.Find(Movement);
+	if (Index != INDEX_NONE)
+	{
+		Entries.RemoveAt(Index);
+	}
+}
+
+bool UGaitBlendSubsystem::UpdateEntry(FGaitBlendEntry& Entry, float DeltaTime) const
+{
+	const auto Steps = Entry.FixedStepSettings.UseFixedStep
+		                   ? Entry.Accumulator.Advance(DeltaTime, Entry.FixedStepSettings)
+		                   : 1;
+	const auto StepDeltaSeconds = Entry.FixedStepSettings.UseFixedStep
+		                              ? Entry.FixedStepSettings.GetStepDeltaSeconds()
+		                              : DeltaTime;
+
+	auto& State = Entry.State;
+	const auto& Target = Entry.Profiles->GetRuntimeProfile(Entry.Gait);
+
+	State.Elapsed += Steps * StepDeltaSeconds;
+	const auto Alpha = Target.BlendDuration > 0.f ? State.Elapsed / Target.BlendDuration : 1.f;
+
+	const auto Movement = Entry.Movement.Get();
+	if (Alpha >= 1.f)
+	{
+		// Exactly the target, the run state's min speed is the run profile's max speed and a lerp can fall an ulp short
+		Movement->MaxWalkSpeed = Target.MaxSpeed;
+		Movement->MaxAcceleration = Target.MaxAcceleration;
+		Movement->BrakingDecelerationWalking = Target.BrakingDeceleration;
+		return true;
+	}
+
+	Movement->MaxWalkSpeed = FMath::Lerp(State.FromSpeed, Target.MaxSpeed, Target.SpeedLUT.Evaluate(Alpha));
+	Movement->MaxAcceleration = FMath::Lerp(State.FromAcceleration, Target.MaxAcceleration,
+	                                        Target.AccelerationLUT.Evaluate(Alpha));
+	Movement->BrakingDecelerationWalking = FMath::Lerp(State.FromBraking, Target.BrakingDeceleration,
+	                                                   Target.BrakingLUT.Evaluate(Alpha));
+	return false;
+}
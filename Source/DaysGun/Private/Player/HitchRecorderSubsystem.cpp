@@ -0,0 +1,365 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "Player/HitchRecorderSubsystem.h"
+
+#include "DaysGun.h"
+#include "Async/Async.h"
+#include "Engine/World.h"
+#include "Locomotion/LocomotionDecisionCore.h"
+#include "Misc/App.h"
+#include "Misc/DateTime.h"
+#include "Misc/FileHelper.h"
+#include "Misc/Paths.h"
+#include "Misc/ScopeLock.h"
+#include <atomic>
+
+DECLARE_CYCLE_STAT(TEXT("Hitch Recorder Tick"), STAT_HitchRecorderTick, STATGROUP_DaysGun);
+
+namespace
+{
+	const TCHAR* TimerNames[] = {
+		TEXT("anim update"), TEXT("graph update"), TEXT("evaluate"), TEXT("rotation"), TEXT("location")
+	};
+	static_assert(UE_ARRAY_COUNT(TimerNames) == static_cast<int32>(EHitchTimer::Num));
+
+	/** Handed out once per thread on its first timer, shared by the recorders of all worlds */
+	int32 GetThreadSlotIndex()
+	{
+		static std::atomic<int32> NextIndex{0};
+		static thread_local const int32 Index = NextIndex++;
+		return Index;
+	}
+
+	FString DescribeEvent(EHitchEvent Type, uint8 Detail, float Value)
+	{
+		switch (Type)
+		{
+		case EHitchEvent::Spawn:
+			return TEXT("spawn");
+		case EHitchEvent::StateEntered:
+			return FString::Printf(TEXT("state %s"), *StaticEnum<ELocomotionState>()->GetNameStringByValue(Detail));
+		case EHitchEvent::ClipSelected:
+			return FString::Printf(TEXT("clip %s"), *StaticEnum<ELocomotionClip>()->GetNameStringByValue(Detail));
+		case EHitchEvent::StopCorrection:
+			return FString::Printf(TEXT("stop correction %.1f cm"), Value);
+		}
+		return FString();
+	}
+}
+
+bool UHitchRecorderSubsystem::ShouldCreateSubsystem(UObject* Outer) const
+{
+#if UE_BUILD_SHIPPING
+	return false;
+#else
+	return Super::ShouldCreateSubsystem(Outer);
+#endif
+}
+
+void UHitchRecorderSubsystem::Initialize(FSubsystemCollectionBase& Collection)
+{
+	Super::Initialize(Collection);
+	if (!Enabled || HistoryFrames <= 0 || MaxEvents <= 0) return;
+
+	LLM_SCOPE_BYTAG(DaysGun_Character);
+	Frames.SetNum(HistoryFrames);
+	Events.SetNum(MaxEvents);
+	ThreadSlots.SetNum(MaxThreadSlots);
+
+	PreActorTickHandle = FWorldDelegates::OnWorldPreActorTick.AddUObject(this, &UHitchRecorderSubsystem::OnPreActorTick);
+	PostActorTickHandle = FWorldDelegates::OnWorldPostActorTick.AddUObject(
+		this, &UHitchRecorderSubsystem::OnPostActorTick);
+}
+
+void UHitchRecorderSubsystem::Deinitialize()
+{
+	FWorldDelegates::OnWorldPreActorTick.Remove(PreActorTickHandle);
+	FWorldDelegates::OnWorldPostActorTick.Remove(PostActorTickHandle);
+
+	Frames.Empty();
+	Events.Empty();
+	ThreadSlots.Empty();
+	Super::Deinitialize();
+}
+
+bool UHitchRecorderSubsystem::DoesSupportWorldType(const EWorldType::Type WorldType) const
+{
+	return WorldType == EWorldType::Game || WorldType == EWorldType::PIE;
+}
+
+void UHitchRecorderSubsystem::Tick(float DeltaTime)
+{
+	SCOPE_CYCLE_COUNTER(STAT_HitchRecorderTick);
+	const auto StartCycles = FPlatformTime::Cycles64();
+
+	// Frame time of the previous frame is known now, everything else it recorded was already stored
+	if (NumFrames > 0)
+	{
+		auto& PrevFrame = Frames[FrameHead];
+		PrevFrame.FrameMs = (FApp::GetDeltaTime() - FApp::GetIdleTime()) * 1000.0;
+
+		if (PrevFrame.FrameMs > HitchThresholdMs && TotalFrames > static_cast<uint64>(WarmupFrames))
+		{
+			WriteReport(PrevFrame);
+		}
+	}
+
+	FrameHead = (FrameHead + 1) % Frames.Num();
+	NumFrames = FMath::Min(NumFrames + 1, Frames.Num());
+	++TotalFrames;
+
+	CurrentFrame.FrameNumber = GFrameCounter;
+	auto& Frame = Frames[FrameHead];
+	Frame = CurrentFrame;
+	CurrentFrame = FHitchFrame();
+
+	Frame.RecorderCycles += FPlatformTime::Cycles64() - StartCycles;
+}
+
+bool UHitchRecorderSubsystem::IsTickable() const
+{
+	return Frames.Num() > 0;
+}
+
+TStatId UHitchRecorderSubsystem::GetStatId() const
+{
+	RETURN_QUICK_DECLARE_CYCLE_STAT(UHitchRecorderSubsystem, STATGROUP_Tickables);
+}
+
+void UHitchRecorderSubsystem::FHitchTimerSums::Add(int32 Index, float Ms, const UObject* Owner)
+{
+	TimerMs[Index] += Ms;
+	++TimerCounts[Index];
+
+	if (Ms > MaxTimerMs[Index])
+	{
+		MaxTimerMs[Index] = Ms;
+		MaxTimerOwners[Index] = Owner ? Owner->GetFName() : NAME_None;
+	}
+}
+
+void UHitchRecorderSubsystem::FHitchTimerSums::Merge(const FHitchTimerSums& Other)
+{
+	for (int32 Index = 0; Index < static_cast<int32>(EHitchTimer::Num); ++Index)
+	{
+		TimerMs[Index] += Other.TimerMs[Index];
+		TimerCounts[Index] += Other.TimerCounts[Index];
+
+		if (Other.MaxTimerMs[Index] > MaxTimerMs[Index])
+		{
+			MaxTimerMs[Index] = Other.MaxTimerMs[Index];
+			MaxTimerOwners[Index] = Other.MaxTimerOwners[Index];
+		}
+	}
+	RecorderCycles += Other.RecorderCycles;
+}
+
+void UHitchRecorderSubsystem::AddTime(EHitchTimer Timer, const UObject* Owner, uint64 Cycles)
+{
+	const auto StartCycles = FPlatformTime::Cycles64();
+	const auto Index = static_cast<int32>(Timer);
+	const float Ms = FPlatformTime::ToMilliseconds64(Cycles);
+
+	if (IsInGameThread())
+	{
+		CurrentFrame.Add(Index, Ms, Owner);
+		CurrentFrame.RecorderCycles += FPlatformTime::Cycles64() - StartCycles;
+		return;
+	}
+
+	if (ThreadSlots.Num() == 0) return;
+
+	const auto SlotIndex = GetThreadSlotIndex();
+	if (SlotIndex < MaxThreadSlots - 1)
+	{
+		auto& Slot = ThreadSlots[SlotIndex];
+		Slot.Sums.Add(Index, Ms, Owner);
+		Slot.Used = true;
+		Slot.Sums.RecorderCycles += FPlatformTime::Cycles64() - StartCycles;
+		return;
+	}
+
+	FScopeLock Lock(&OverflowLock);
+	auto& Slot = ThreadSlots.Last();
+	Slot.Sums.Add(Index, Ms, Owner);
+	Slot.Used = true;
+	Slot.Sums.RecorderCycles += FPlatformTime::Cycles64() - StartCycles;
+}
+
+void UHitchRecorderSubsystem::MergeThreadSlots()
+{
+	// Parallel animation tasks are done once actors finished ticking, nothing writes the slots now
+	for (auto& Slot : ThreadSlots)
+	{
+		if (!Slot.Used) continue;
+
+		CurrentFrame.Merge(Slot.Sums);
+		Slot = FHitchThreadSlot();
+	}
+}
+
+void UHitchRecorderSubsystem::AddEvent(EHitchEvent Type, const UObject* Owner, uint8 Detail, float Value)
+{
+	if (Events.Num() == 0) return;
+
+	const auto StartCycles = FPlatformTime::Cycles64();
+	EventHead = (EventHead + 1) % Events.Num();
+	NumEvents = FMath::Min(NumEvents + 1, Events.Num());
+
+	auto& Event = Events[EventHead];
+	Event.FrameNumber = GFrameCounter;
+	Event.Owner = Owner ? Owner->GetFName() : NAME_None;
+	Event.Value = Value;
+	Event.Type = Type;
+	Event.Detail = Detail;
+
+	CurrentFrame.RecorderCycles += FPlatformTime::Cycles64() - StartCycles;
+}
+
+const UHitchRecorderSubsystem::FHitchFrame& UHitchRecorderSubsystem::GetFrame(int32 Age) const
+{
+	return Frames[(FrameHead - Age + Frames.Num()) % Frames.Num()];
+}
+
+void UHitchRecorderSubsystem::DumpReport()
+{
+	if (NumFrames == 0) return;
+
+	// The newest frame does not know its frame time yet
+	LastReportTime = -UE_BIG_NUMBER;
+	WriteReport(GetFrame(NumFrames > 1 ? 1 : 0));
+}
+
+void UHitchRecorderSubsystem::WriteReport(const FHitchFrame& HitchFrame)
+{
+	const auto Now = FPlatformTime::Seconds();
+	if (NumReports >= MaxReportsPerWorld || Now - LastReportTime < MinSecondsBetweenReports) return;
+
+	LastReportTime = Now;
+	++NumReports;
+
+	const auto OldestFrame = GetFrame(NumFrames - 1).FrameNumber;
+
+	FString Report;
+	Report.Reserve(NumFrames * 160);
+	Report += FString::Printf(TEXT("DaysGun hitch report, %s, %s\n"), *GetWorld()->GetMapName(),
+	                          LexToString(FApp::GetBuildConfiguration()));
+	Report += FString::Printf(TEXT("Frame %llu took %.1f ms, threshold %.1f ms\n\n"),
+	                          HitchFrame.FrameNumber, HitchFrame.FrameMs, HitchThresholdMs);
+
+	Report += TEXT("   frame  frame ms  actor ms    rec ms");
+	for (const auto TimerName : TimerNames)
+	{
+		Report += FString::Printf(TEXT(" | %-12s count  max ms slowest             "), TimerName);
+	}
+	Report += TEXT("\n");
+
+	for (int32 Age = NumFrames - 1; Age >= 0; --Age)
+	{
+		const auto& Frame = GetFrame(Age);
+		Report += FString::Printf(TEXT("%c%7llu %9.2f %9.2f %9.3f"), &Frame == &HitchFrame ? TEXT('>') : TEXT(' '),
+		                          Frame.FrameNumber, Frame.FrameMs, Frame.ActorTickMs,
+		                          FPlatformTime::ToMilliseconds64(Frame.RecorderCycles));
+		for (int32 Index = 0; Index < static_cast<int32>(EHitchTimer::Num); ++Index)
+		{
+			Report += FString::Printf(TEXT(" | %12.3f %5u %7.3f %-20s"), Frame.TimerMs[Index],
+			                          Frame.TimerCounts[Index], Frame.MaxTimerMs[Index],
+			                          *Frame.MaxTimerOwners[Index].ToString());
+		}
+		Report += TEXT("\n");
+	}
+
+	Report += TEXT("\nLocomotion events\n");
+	for (int32 Age = NumEvents - 1; Age >= 0; --Age)
+	{
+		const auto& Event = Events[(EventHead - Age + Events.Num()) % Events.Num()];
+		if (Event.FrameNumber < OldestFrame) continue;
+
+		Report += FString::Printf(TEXT("%c%7llu %-24s %s\n"),
+		                          Event.FrameNumber == HitchFrame.FrameNumber ? TEXT('>') : TEXT(' '),
+		                          Event.FrameNumber, *Event.Owner.ToString(),
+		                          *DescribeEvent(Event.Type, Event.Detail, Event.Value));
+	}
+
+	const auto FileName = FPaths::ProjectSavedDir() / TEXT("Hitches") / FString::Printf(
+		TEXT("Hitch_%s_%llu.txt"), *FDateTime::Now().ToString(), HitchFrame.FrameNumber);
+	UE_LOG(LogDaysGun, Warning, TEXT("Hitch of %.1f ms in frame %llu, report in %s"),
+	       HitchFrame.FrameMs, HitchFrame.FrameNumber, *FileName);
+
+	// Writing on the game thread would add to the hitch
+	AsyncTask(ENamedThreads::AnyBackgroundThreadNormalTask, [Report = MoveTemp(Report), FileName]
+	{
+		FFileHelper::SaveStringToFile(Report, *FileName);
+	});
+}
+
+void UHitchRecorderSubsystem::PrintStatus() const
+{
+	UE_LOG(LogDaysGun, Display, TEXT("Hitch recorder: %s, threshold %.1f ms, %d/%d frames, %d/%d events, %d reports"),
+	       Frames.Num() > 0 ? TEXT("on") : TEXT("off"), HitchThresholdMs, NumFrames, Frames.Num(), NumEvents,
+	       Events.Num(), NumReports);
+
+	uint64 TotalCycles = 0;
+	uint64 MaxCycles = 0;
+	for (int32 Age = 0; Age < NumFrames; ++Age)
+	{
+		TotalCycles += GetFrame(Age).RecorderCycles;
+		MaxCycles = FMath::Max(MaxCycles, GetFrame(Age).RecorderCycles);
+	}
+	UE_LOG(LogDaysGun, Display, TEXT("  recorder costs %.4f ms per frame on average, %.4f ms at most"),
+	       NumFrames > 0 ? FPlatformTime::ToMilliseconds64(TotalCycles) / NumFrames : 0.0,
+	       FPlatformTime::ToMilliseconds64(MaxCycles));
+}
+
+void UHitchRecorderSubsystem::OnPreActorTick(UWorld* InWorld, ELevelTick TickType, float DeltaSeconds)
+{
+	if (InWorld != GetWorld()) return;
+	PreActorCycles = FPlatformTime::Cycles64();
+}
+
+void UHitchRecorderSubsystem::OnPostActorTick(UWorld* InWorld, ELevelTick TickType, float DeltaSeconds)
+{
+	if (InWorld != GetWorld()) return;
+	CurrentFrame.ActorTickMs = FPlatformTime::ToMilliseconds64(FPlatformTime::Cycles64() - PreActorCycles);
+
+	const auto StartCycles = FPlatformTime::Cycles64();
+	MergeThreadSlots();
+	CurrentFrame.RecorderCycles += FPlatformTime::Cycles64() - StartCycles;
+}
+
+#if !UE_BUILD_SHIPPING
+static FAutoConsoleCommandWithWorld GHitchStatusCommand(
+	TEXT("DaysGun.Hitch.Status"),
+	TEXT("Prints the state of the hitch flight recorder"),
+	FConsoleCommandWithWorldDelegate::CreateLambda([](UWorld* World)
+	{
+		if (const auto Subsystem = World ? World->GetSubsystem<UHitchRecorderSubsystem>() : nullptr)
+		{
+			Subsystem->PrintStatus();
+		}
+	}));
+
+static FAutoConsoleCommandWithWorldAndArgs GHitchThresholdCommand(
+	TEXT("DaysGun.Hitch.Threshold"),
+	TEXT("Sets the frame time in milliseconds above which a hitch report is written. Args: <Ms>"),
+	FConsoleCommandWithWorldAndArgsDelegate::CreateLambda([](const TArray<FString>& Args, UWorld* World)
+	{
+		const auto Subsystem = World ? World->GetSubsystem<UHitchRecorderSubsystem>() : nullptr;
+		if (!Subsystem || Args.Num() == 0) return;
+
+		Subsystem->SetHitchThresholdMs(FCString::Atof(*Args[0]));
+		Subsystem->PrintStatus();
+	}));
+
+static FAutoConsoleCommandWithWorld GHitchDumpCommand(
+	TEXT("DaysGun.Hitch.Dump"),
+	TEXT("Writes a hitch report of the recorded history right away"),
+	FConsoleCommandWithWorldDelegate::CreateLambda([](UWorld* World)
+	{
+		if (const auto Subsystem = World ? World->GetSubsystem<UHitchRecorderSubsystem>() : nullptr)
+		{
+			Subsystem->DumpReport();
+		}
+	}));
+#endif
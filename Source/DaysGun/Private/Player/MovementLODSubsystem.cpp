@@ -0,0 +1,370 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "Player/MovementLODSubsystem.h"
+
+#include "DaysGun.h"
+#include "Engine/World.h"
+#include "GameFramework/CharacterMovementComponent.h"
+#include "GameFramework/PlayerController.h"
+#include "NavigationSystem.h"
+#include "Player/BaseCharacter.h"
+#include "Soak/SoakTestSubsystem.h"
+
+DECLARE_CYCLE_STAT(TEXT("Movement LOD Batch"), STAT_MovementLODBatch, STATGROUP_DaysGun);
+DECLARE_CYCLE_STAT(TEXT("Movement LOD Update"), STAT_MovementLODUpdate, STATGROUP_DaysGun);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Characters NavWalking"), STAT_CharactersNavWalking, STATGROUP_DaysGun);
+
+void FMovementLODBatchTick::ExecuteTick(float DeltaTime, ELevelTick TickType, ENamedThreads::Type CurrentThread,
+                                        const FGraphEventRef& MyCompletionGraphEvent)
+{
+	if (Subsystem)
+	{
+		Subsystem->TickBatch(DeltaTime);
+	}
+}
+
+void UMovementLODSubsystem::Tick(float DeltaTime)
+{
+	Super::Tick(DeltaTime);
+
+	UpdateTimeLeft -= DeltaTime;
+	if (UpdateTimeLeft <= 0.f)
+	{
+		UpdateLODs();
+		UpdateTimeLeft = UpdateInterval;
+	}
+
+	SET_DWORD_STAT(STAT_CharactersNavWalking, NumNavWalking);
+
+	if (Benchmark.IsRunning())
+	{
+		TickBenchmark(DeltaTime);
+	}
+}
+
+bool UMovementLODSubsystem::IsTickable() const
+{
+	return Entries.Num() > 0 || Benchmark.IsRunning();
+}
+
+TStatId UMovementLODSubsystem::GetStatId() const
+{
+	RETURN_QUICK_DECLARE_CYCLE_STAT(UMovementLODSubsystem, STATGROUP_Tickables);
+}
+
+void UMovementLODSubsystem::Deinitialize()
+{
+	for (auto& Entry : Entries)
+	{
+		SetLOD(Entry, EMovementLOD::Full);
+	}
+	Entries.Reset();
+
+	if (BatchTick.IsTickFunctionRegistered())
+	{
+		BatchTick.UnRegisterTickFunction();
+	}
+
+	Super::Deinitialize();
+}
+
+void UMovementLODSubsystem::Register(ABaseCharacter* Character)
+{
+	if (!Character || Entries.Contains(Character)) return;
+
+	FMovementLODEntry Entry;
+	Entry.Character = Character;
+	Entries.Add(Character, Entry);
+
+	// New characters get a LOD on the next update
+	UpdateTimeLeft = FMath::Min(UpdateTimeLeft, 0.f);
+}
+
+void UMovementLODSubsystem::Unregister(const ABaseCharacter* Character)
+{
+	const auto Index = Entries.Find(Character);
+	if (Index == INDEX_NONE) return;
+
+	SetLOD(Entries[Index], EMovementLOD::Full);
+	RemoveAt(Index);
+}
+
+void UMovementLODSubsystem::RequestFullMovement(const ABaseCharacter* Character, float Seconds)
+{
+	const auto Entry = Entries.FindEntry(Character);
+	if (!Entry) return;
+
+	Entry->FullMovementUntil = FMath::Max(Entry->FullMovementUntil, GetWorld()->GetTimeSeconds() + Seconds);
+	SetLOD(*Entry, EMovementLOD::Full);
+}
+
+void UMovementLODSubsystem::SetForcedLOD(TOptional<EMovementLOD> LOD)
+{
+	ForcedLOD = LOD;
+	UpdateLODs();
+}
+
+void UMovementLODSubsystem::TickBatch(float DeltaTime)
+{
+	SCOPE_CYCLE_COUNTER(STAT_MovementLODBatch);
+	const auto StartCycles = FPlatformTime::Cycles64();
+
+	for (auto& Entry : Entries)
+	{
+		if (Entry.LOD != EMovementLOD::NavWalking) continue;
+
+		const auto Character = Entry.Character.Get();
+		if (!Character) continue;
+
+		// A player took over since the last update
+		if (Character->IsPlayerControlled())
+		{
+			SetLOD(Entry, EMovementLOD::Full);
+			continue;
+		}
+
+		const auto Movement = Character->GetCharacterMovement();
+		Movement->TickComponent(DeltaTime * Character->CustomTimeDilation, LEVELTICK_All,
+		                        &Movement->PrimaryComponentTick);
+	}
+
+	LastBatchMs = FPlatformTime::ToMilliseconds64(FPlatformTime::Cycles64() - StartCycles);
+}
+
+void UMovementLODSubsystem::UpdateLODs()
+{
+	SCOPE_CYCLE_COUNTER(STAT_MovementLODUpdate);
+
+	for (int32 Index = Entries.Num() - 1; Index >= 0; --Index)
+	{
+		if (!Entries[Index].Character.IsValid())
+		{
+			RemoveAt(Index);
+		}
+	}
+
+	TArray<FVector> PlayerLocations;
+	for (auto It = GetWorld()->GetPlayerControllerIterator(); It; ++It)
+	{
+		if (const auto Pawn = It->IsValid() ? (*It)->GetPawn() : nullptr)
+		{
+			PlayerLocations.Add(Pawn->GetActorLocation());
+		}
+	}
+
+	// NavWalking without a navmesh would leave characters stuck in place
+	const auto NavSystem = FNavigationSystem::GetCurrent<UNavigationSystemV1>(GetWorld());
+	const auto HasNavData = NavSystem && NavSystem->GetDefaultNavDataInstance(FNavigationSystem::DontCreate);
+
+	for (auto& Entry : Entries)
+	{
+		const auto NavWalking = HasNavData && WantsNavWalking(Entry, PlayerLocations);
+		SetLOD(Entry, NavWalking ? EMovementLOD::NavWalking : EMovementLOD::Full);
+	}
+}
+
+bool UMovementLODSubsystem::WantsNavWalking(const FMovementLODEntry& Entry,
+                                           const TArray<FVector>& PlayerLocations) const
+{
+	const auto Character = Entry.Character.Get();
+	const auto Movement = Character->GetCharacterMovement();
+
+	if (Character->IsPlayerControlled() || Character->IsPooled() || Character->IsInteracting()) return false;
+	if (Character->GetLocalRole() != ROLE_Authority) return false;
+	if (!Movement->IsMovingOnGround() && Entry.LOD == EMovementLOD::Full) return false;
+	if (ForcedLOD.IsSet()) return ForcedLOD.GetValue() == EMovementLOD::NavWalking;
+	if (Entry.FullMovementUntil > GetWorld()->GetTimeSeconds()) return false;
+
+	const auto Distance = Entry.LOD == EMovementLOD::NavWalking
+		                      ? FullMovementDistance
+		                      : FullMovementDistance + Hysteresis;
+	const auto Location = Character->GetActorLocation();
+	for (const auto& PlayerLocation : PlayerLocations)
+	{
+		if (FVector::DistSquared(Location, PlayerLocation) < FMath::Square(Distance)) return false;
+	}
+	return true;
+}
+
+void UMovementLODSubsystem::SetLOD(FMovementLODEntry& Entry, EMovementLOD LOD)
+{
+	if (Entry.LOD == LOD) return;
+
+	const auto Character = Entry.Character.Get();
+	const auto Movement = Character ? Character->GetCharacterMovement() : nullptr;
+	const auto Mesh = Character ? Character->GetMesh() : nullptr;
+	if (!Movement || !Mesh) return;
+
+	Entry.LOD = LOD;
+
+	if (LOD == EMovementLOD::NavWalking)
+	{
+		if (!BatchTick.IsTickFunctionRegistered())
+		{
+			BatchTick.Subsystem = this;
+			BatchTick.bCanEverTick = true;
+			BatchTick.TickGroup = TG_PrePhysics;
+			BatchTick.RegisterTickFunction(GetWorld()->PersistentLevel);
+		}
+
+		Entry.SavedProjectionInterval = Movement->NavMeshProjectionInterval;
+		Entry.SavedSweepWhileNavWalking = Movement->bSweepWhileNavWalking;
+		Movement->NavMeshProjectionInterval = NavMeshProjectionInterval;
+		Movement->bSweepWhileNavWalking = false;
+
+		if (Movement->IsFalling())
+		{
+			Movement->SetGroundMovementMode(MOVE_NavWalking);
+		}
+		else
+		{
+			Movement->SetMovementMode(MOVE_NavWalking);
+		}
+
+		// Movement before animation, as with the movement component's own tick
+		Movement->SetComponentTickEnabled(false);
+		Mesh->PrimaryComponentTick.AddPrerequisite(this, BatchTick);
+
+		++NumNavWalking;
+		return;
+	}
+
+	Mesh->PrimaryComponentTick.RemovePrerequisite(this, BatchTick);
+
+	Movement->NavMeshProjectionInterval = Entry.SavedProjectionInterval;
+	Movement->bSweepWhileNavWalking = Entry.SavedSweepWhileNavWalking;
+
+	if (Movement->MovementMode == MOVE_NavWalking)
+	{
+		Movement->SetMovementMode(MOVE_Walking);
+	}
+	else if (Movement->IsFalling())
+	{
+		Movement->SetGroundMovementMode(MOVE_Walking);
+	}
+
+	// Pooled characters keep their movement off until they are handed out again
+	Movement->SetComponentTickEnabled(!Character->IsPooled());
+
+	--NumNavWalking;
+}
+
+void UMovementLODSubsystem::RemoveAt(int32 Index)
+{
+	// Destroyed characters never got back to full movement, their count goes with them
+	if (Entries[Index].LOD == EMovementLOD::NavWalking)
+	{
+		--NumNavWalking;
+	}
+
+	Entries.RemoveAt(Index);
+}
+
+void UMovementLODSubsystem::StartBenchmark(int32 Count, float Seconds)
+{
+	const auto Soak = FSubsystemBenchmark::GetIdleSoak(GetWorld());
+	if (!Soak || Count <= 0 || !Benchmark.Start(UE_ARRAY_COUNT(BenchmarkPhases), Seconds)) return;
+
+	Soak->SpawnBotsAround(Count, FSubsystemBenchmark::GetCenter(GetWorld()));
+	BenchmarkPhases[0] = FBenchmarkPhase();
+	BenchmarkPhases[1] = FBenchmarkPhase();
+
+	SetForcedLOD(EMovementLOD::Full);
+}
+
+void UMovementLODSubsystem::TickBenchmark(float DeltaTime)
+{
+	if (Benchmark.Tick(DeltaTime))
+	{
+		auto& Phase = BenchmarkPhases[Benchmark.GetPhaseIndex()];
+		++Phase.Frames;
+		Phase.FrameMs += FSubsystemBenchmark::GetFrameMs();
+		Phase.BatchMs += NumNavWalking > 0 ? LastBatchMs : 0.0;
+		Phase.NavWalking += NumNavWalking;
+	}
+
+	if (!Benchmark.IsPhaseDone()) return;
+
+	if (Benchmark.NextPhase())
+	{
+		SetForcedLOD(EMovementLOD::NavWalking);
+		return;
+	}
+
+	FinishBenchmark();
+}
+
+void UMovementLODSubsystem::FinishBenchmark()
+{
+	SetForcedLOD(TOptional<EMovementLOD>());
+
+	const auto Soak = GetWorld()->GetSubsystem<USoakTestSubsystem>();
+	UE_LOG(LogDaysGun, Display, TEXT("Movement LOD benchmark, %d characters:"), Soak ? Soak->GetNumBots() : 0);
+
+	const TCHAR* PhaseNames[] = {TEXT("Full"), TEXT("NavWalking")};
+	for (int32 Index = 0; Index < UE_ARRAY_COUNT(BenchmarkPhases); ++Index)
+	{
+		const auto& Phase = BenchmarkPhases[Index];
+		const auto Frames = FMath::Max(Phase.Frames, 1);
+		UE_LOG(LogDaysGun, Display, TEXT("  %-10s frame %6.2f ms  batch %6.3f ms  %6.1f characters NavWalking"),
+		       PhaseNames[Index], Phase.FrameMs / Frames, Phase.BatchMs / Frames,
+		       static_cast<double>(Phase.NavWalking) / Frames);
+	}
+	Benchmark.Finish(GetWorld());
+}
+
+void UMovementLODSubsystem::PrintStats() const
+{
+	UE_LOG(LogDaysGun, Display, TEXT("Movement LOD: %d characters, %d NavWalking, last batch %.3f ms%s"),
+	       Entries.Num(), NumNavWalking, LastBatchMs,
+	       ForcedLOD.IsSet() ? TEXT(", forced") : TEXT(""));
+}
+
+#if !UE_BUILD_SHIPPING
+static FAutoConsoleCommandWithWorld GMovementLODStatsCommand(
+	TEXT("DaysGun.MovementLOD.Stats"),
+	TEXT("Prints how many characters use the NavWalking movement LOD"),
+	FConsoleCommandWithWorldDelegate::CreateLambda([](UWorld* World)
+	{
+		if (const auto Subsystem = World ? World->GetSubsystem<UMovementLODSubsystem>() : nullptr)
+		{
+			Subsystem->PrintStats();
+		}
+	}));
+
+static FAutoConsoleCommandWithWorldAndArgs GMovementLODForceCommand(
+	TEXT("DaysGun.MovementLOD.Force"),
+	TEXT("Forces the movement LOD of every eligible character. Args: full|nav|auto"),
+	FConsoleCommandWithWorldAndArgsDelegate::CreateLambda([](const TArray<FString>& Args, UWorld* World)
+	{
+		const auto Subsystem = World ? World->GetSubsystem<UMovementLODSubsystem>() : nullptr;
+		if (!Subsystem || Args.Num() == 0) return;
+
+		if (Args[0] == TEXT("full"))
+		{
+			Subsystem->SetForcedLOD(EMovementLOD::Full);
+		}
+		else if (Args[0] == TEXT("nav"))
+		{
+			Subsystem->SetForcedLOD(EMovementLOD::NavWalking);
+		}
+		else
+		{
+			Subsystem->SetForcedLOD(TOptional<EMovementLOD>());
+		}
+	}));
+
+static FAutoConsoleCommandWithWorldAndArgs GMovementLODBenchmarkCommand(
+	TEXT("DaysGun.MovementLOD.Benchmark"),
+	TEXT("Spawns soak bots and compares frames with full movement against NavWalking. Args: [Count=300] [Seconds=10]"),
+	FConsoleCommandWithWorldAndArgsDelegate::CreateLambda([](const TArray<FString>& Args, UWorld* World)
+	{
+		if (const auto Subsystem = World ? World->GetSubsystem<UMovementLODSubsystem>() : nullptr)
+		{
+			const int32 Count = Args.Num() > 0 ? FCString::Atoi(*Args[0]) : 300;
+			const float Seconds = Args.Num() > 1 ? FCString::Atof(*Args[1]) : 10.f;
+			Subsystem->StartBenchmark(Count, Seconds);
+		}
+	}));
+#endif
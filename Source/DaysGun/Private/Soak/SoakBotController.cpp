@@ -0,0 +1,180 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "Soak/SoakBotController.h"
+
+#include "Crowd/CrowdSteeringSubsystem.h"
+#include "GameFramework/CharacterMovementComponent.h"
+#include "Math/DaysGunMath.h"
+#include "Player/BaseCharacter.h"
+
+ASoakBotController::ASoakBotController()
+{
+	PrimaryActorTick.bCanEverTick = true;
+
+	// Heading is set through the control rotation, which would otherwise follow the pawn
+	bSetControlRotationFromPawnOrientation = false;
+
+	ActionWeights[static_cast<int32>(ESoakBotAction::Idle)] = 2.f;
+	ActionWeights[static_cast<int32>(ESoakBotAction::Walk)] = 3.f;
+	ActionWeights[static_cast<int32>(ESoakBotAction::Run)] = 3.f;
+	ActionWeights[static_cast<int32>(ESoakBotAction::Crouch)] = 1.f;
+	ActionWeights[static_cast<int32>(ESoakBotAction::Jump)] = 1.f;
+}
+
+void ASoakBotController::Tick(float DeltaSeconds)
+{
+	Super::Tick(DeltaSeconds);
+	if (!BotCharacter) return;
+
+	if (CrowdSteering && CrowdSteering->IsAgent(BotCharacter))
+	{
+		if (Action != ESoakBotAction::Idle)
+		{
+			EndAction();
+			BotCharacter->StopJumping();
+			Action = ESoakBotAction::Idle;
+		}
+		return;
+	}
+
+	ActionTimeLeft -= DeltaSeconds;
+	if (ActionTimeLeft <= 0.f)
+	{
+		if (Action == ESoakBotAction::Jump)
+		{
+			BotCharacter->StopJumping();
+		}
+
+		ChooseNextAction();
+	}
+
+	if (Action == ESoakBotAction::Idle) return;
+
+	UpdateHeading();
+	SetControlRotation(FRotator(0.f, Heading, 0.f));
+	BotCharacter->Move(FInputActionValue(FVector2D(0.f, 1.f)));
+}
+
+void ASoakBotController::SetHome(const FVector& InHome, float Radius)
+{
+	Home = InHome;
+	HomeRadius = Radius;
+}
+
+void ASoakBotController::OnPossess(APawn* InPawn)
+{
+	Super::OnPossess(InPawn);
+
+	BotCharacter = Cast<ABaseCharacter>(InPawn);
+	if (!BotCharacter) return;
+
+	CrowdSteering = GetWorld()->GetSubsystem<UCrowdSteeringSubsystem>();
+
+	// Characters have no crouch input, the bot still wants to cover the crouch state. Pooled characters go on to
+	// other owners, so the flag is handed back on unpossess
+	auto& NavAgentProperties = BotCharacter->GetCharacterMovement()->GetNavAgentPropertiesRef();
+	CouldCrouch = NavAgentProperties.bCanCrouch;
+	NavAgentProperties.bCanCrouch = true;
+
+	// Pooled controllers possess many characters, each pairing gets its own sequence
+	Random.Initialize(static_cast<int32>(HashCombine(GetUniqueID(), BotCharacter->GetUniqueID())));
+	Heading = BotCharacter->GetActorRotation().Yaw;
+	Action = ESoakBotAction::Idle;
+	ActionTimeLeft = Random.FRandRange(IdleDuration.X, IdleDuration.Y);
+}
+
+void ASoakBotController::OnUnPossess()
+{
+	if (BotCharacter)
+	{
+		EndAction();
+		BotCharacter->StopJumping();
+		BotCharacter->GetCharacterMovement()->GetNavAgentPropertiesRef().bCanCrouch = CouldCrouch;
+	}
+	BotCharacter = nullptr;
+
+	Super::OnUnPossess();
+}
+
+void ASoakBotController::ChooseNextAction()
+{
+	float TotalWeight = 0.f;
+	for (const auto Weight : ActionWeights)
+	{
+		TotalWeight += FMath::Max(Weight, 0.f);
+	}
+
+	auto NewAction = ESoakBotAction::Idle;
+	auto Pick = Random.FRandRange(0.f, TotalWeight);
+	for (int32 Index = 0; Index < static_cast<int32>(ESoakBotAction::Num); ++Index)
+	{
+		Pick -= FMath::Max(ActionWeights[Index], 0.f);
+		if (Pick <= 0.f)
+		{
+			NewAction = static_cast<ESoakBotAction>(Index);
+			break;
+		}
+	}
+
+	if (Random.FRand() < TurnChance)
+	{
+		Heading = FDaysGunMath::NormalizeYaw(Heading + Random.FRandRange(-MaxTurnAngle, MaxTurnAngle));
+	}
+
+	EndAction();
+	BeginAction(NewAction);
+}
+
+void ASoakBotController::BeginAction(ESoakBotAction NewAction)
+{
+	Action = NewAction;
+
+	switch (Action)
+	{
+	case ESoakBotAction::Idle:
+		ActionTimeLeft = Random.FRandRange(IdleDuration.X, IdleDuration.Y);
+		break;
+	case ESoakBotAction::Run:
+		BotCharacter->RunStarted(FInputActionValue(true));
+		ActionTimeLeft = Random.FRandRange(MoveDuration.X, MoveDuration.Y);
+		break;
+	case ESoakBotAction::Crouch:
+		BotCharacter->Crouch();
+		ActionTimeLeft = Random.FRandRange(MoveDuration.X, MoveDuration.Y);
+		break;
+	case ESoakBotAction::Jump:
+		BotCharacter->Jump();
+		ActionTimeLeft = JumpHoldDuration;
+		break;
+	default:
+		ActionTimeLeft = Random.FRandRange(MoveDuration.X, MoveDuration.Y);
+		break;
+	}
+}
+
+void ASoakBotController::EndAction()
+{
+	switch (Action)
+	{
+	case ESoakBotAction::Run:
+		BotCharacter->RunFinished(FInputActionValue(false));
+		break;
+	case ESoakBotAction::Crouch:
+		BotCharacter->UnCrouch();
+		break;
+	default:
+		break;
+	}
+}
+
+void ASoakBotController::UpdateHeading()
+{
+	if (HomeRadius <= 0.f) return;
+
+	const auto ToHome = Home - BotCharacter->GetActorLocation();
+	if (ToHome.SizeSquared2D() > FMath::Square(HomeRadius))
+	{
+		Heading = FDaysGunMath::YawFromVector(ToHome);
+	}
+}
@@ -0,0 +1,383 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "Soak/SoakTestSubsystem.h"
+
+#include "DaysGun.h"
+#include "EngineUtils.h"
+#include "Engine/NetDriver.h"
+#include "Engine/World.h"
+#include "GameFramework/GameModeBase.h"
+#include "GameFramework/PlayerStart.h"
+#include "HAL/PlatformMemory.h"
+#include "Misc/App.h"
+#include "Misc/CommandLine.h"
+#include "Math/DaysGunMath.h"
+#include "Net/DaysGunReplicationGraph.h"
+#include "Player/BaseCharacter.h"
+#include "Player/CharacterPoolSubsystem.h"
+#include "Soak/SoakBotController.h"
+
+namespace
+{
+	uint64 ToMegabytes(uint64 Bytes)
+	{
+		return Bytes / (1024 * 1024);
+	}
+}
+
+void USoakTestSubsystem::OnWorldBeginPlay(UWorld& InWorld)
+{
+	Super::OnWorldBeginPlay(InWorld);
+
+	const auto CommandLine = FCommandLine::Get();
+	if (!FParse::Param(CommandLine, TEXT("DaysGunSoak"))) return;
+
+	FParse::Value(CommandLine, TEXT("SoakBudgetMs="), FrameBudgetMs);
+	FParse::Value(CommandLine, TEXT("SoakStep="), BotsPerStep);
+	FParse::Value(CommandLine, TEXT("SoakMaxBots="), MaxBots);
+	FParse::Value(CommandLine, TEXT("SoakHoldSeconds="), HoldSeconds);
+	ExitWhenDone = FParse::Param(CommandLine, TEXT("SoakExit"));
+
+	StartSoak();
+}
+
+void USoakTestSubsystem::Deinitialize()
+{
+	FWorldDelegates::OnWorldTickStart.Remove(TickStartHandle);
+	FWorldDelegates::OnWorldPreActorTick.Remove(PreActorTickHandle);
+	FWorldDelegates::OnWorldPostActorTick.Remove(PostActorTickHandle);
+
+	Bots.Empty();
+	Super::Deinitialize();
+}
+
+void USoakTestSubsystem::Tick(float DeltaTime)
+{
+	PhaseTime += DeltaTime;
+
+	const auto PreActorMs = FPlatformTime::ToMilliseconds64(PendingPreActorCycles);
+	const auto ActorMs = FPlatformTime::ToMilliseconds64(PendingActorCycles);
+	PendingPreActorCycles = 0;
+	PendingActorCycles = 0;
+
+	if (Phase == EPhase::Ramping)
+	{
+		if (PhaseTime > WarmupSeconds)
+		{
+			const auto FrameMs = (FApp::GetDeltaTime() - FApp::GetIdleTime()) * 1000.0;
+			++CurrentStep.Frames;
+			CurrentStep.FrameMs += FrameMs;
+			CurrentStep.PeakFrameMs = FMath::Max(CurrentStep.PeakFrameMs, FrameMs);
+			CurrentStep.PreActorMs += PreActorMs;
+			CurrentStep.ActorMs += ActorMs;
+		}
+
+		if (PhaseTime >= StepSeconds)
+		{
+			FinishStep();
+		}
+	}
+	else if (Phase == EPhase::Holding)
+	{
+		if (PhaseTime >= NextMemorySample)
+		{
+			SampleMemory();
+			NextMemorySample += MemorySampleSeconds;
+		}
+
+		if (PhaseTime >= HoldSeconds)
+		{
+			FinishSoak();
+		}
+	}
+}
+
+bool USoakTestSubsystem::IsTickable() const
+{
+	return Phase != EPhase::Off;
+}
+
+TStatId USoakTestSubsystem::GetStatId() const
+{
+	RETURN_QUICK_DECLARE_CYCLE_STAT(USoakTestSubsystem, STATGROUP_Tickables);
+}
+
+void USoakTestSubsystem::StartSoak()
+{
+	const auto World = GetWorld();
+	if (Phase != EPhase::Off || !World || World->GetNetMode() == NM_Client) return;
+
+	Home = FVector::ZeroVector;
+	for (TActorIterator<APlayerStart> It(World); It; ++It)
+	{
+		Home = It->GetActorLocation();
+		break;
+	}
+
+	Random.Initialize(1234);
+	Steps.Reset();
+	MemorySamples.Reset();
+	SustainableBots = 0;
+
+	TickStartHandle = FWorldDelegates::OnWorldTickStart.AddUObject(this, &USoakTestSubsystem::OnWorldTickStart);
+	PreActorTickHandle = FWorldDelegates::OnWorldPreActorTick.AddUObject(this, &USoakTestSubsystem::OnPreActorTick);
+	PostActorTickHandle = FWorldDelegates::OnWorldPostActorTick.AddUObject(this, &USoakTestSubsystem::OnPostActorTick);
+
+	UE_LOG(LogDaysGun, Display, TEXT("Soak started: %d bots + %d every %.0f s until frames exceed %.1f ms"),
+	       InitialBots, BotsPerStep, StepSeconds, FrameBudgetMs);
+
+	Phase = EPhase::Ramping;
+	SetNumBots(FMath::Min(InitialBots, MaxBots));
+	BeginStep();
+}
+
+void USoakTestSubsystem::StopSoak()
+{
+	if (Phase == EPhase::Off) return;
+
+	FWorldDelegates::OnWorldTickStart.Remove(TickStartHandle);
+	FWorldDelegates::OnWorldPreActorTick.Remove(PreActorTickHandle);
+	FWorldDelegates::OnWorldPostActorTick.Remove(PostActorTickHandle);
+
+	SetNumBots(0);
+	Phase = EPhase::Off;
+}
+
+void USoakTestSubsystem::SpawnBotsAround(int32 Count, const FVector& Center)
+{
+	if (Phase != EPhase::Off) return;
+
+	Home = Center;
+	SetNumBots(Bots.Num() + Count);
+}
+
+void USoakTestSubsystem::ReleaseBots()
+{
+	if (Phase != EPhase::Off) return;
+
+	SetNumBots(0);
+}
+
+void USoakTestSubsystem::PrintReport() const
+{
+	const auto GameBuild = IsRunningDedicatedServer() ? TEXT("game target with -server") : TEXT("game");
+	UE_LOG(LogDaysGun, Display, TEXT("Soak report, %s, budget %.1f ms: %d bots sustainable"),
+	       UE_SERVER ? TEXT("server target") : GameBuild, FrameBudgetMs, SustainableBots);
+	UE_LOG(LogDaysGun, Display, TEXT("  %6s %9s %9s %9s %9s %9s %9s %9s"), TEXT("bots"), TEXT("frame"), TEXT("peak"),
+	       TEXT("pre actor"), TEXT("actors"), TEXT("us/bot"), TEXT("replicate"), TEXT("used MB"));
+
+	for (const auto& Step : Steps)
+	{
+		UE_LOG(LogDaysGun, Display, TEXT("  %6d %9.2f %9.2f %9.2f %9.2f %9.1f %9.2f %9llu"), Step.Bots, Step.FrameMs,
+		       Step.PeakFrameMs, Step.PreActorMs, Step.ActorMs, Step.ActorMs * 1000.0 / FMath::Max(Step.Bots, 1),
+		       Step.ReplicateMs, Step.UsedPhysicalMB);
+	}
+
+	if (MemorySamples.Num() > 1)
+	{
+		const auto Growth = static_cast<int64>(MemorySamples.Last()) - static_cast<int64>(HoldStartUsedPhysical);
+		const auto Hours = FMath::Max((MemorySamples.Num() - 1) * MemorySampleSeconds / 3600.f, UE_SMALL_NUMBER);
+		UE_LOG(LogDaysGun, Display, TEXT("  Memory over %.1f min at %d bots: %llu MB -> %llu MB, %.1f MB/h"),
+		       Hours * 60.f, SustainableBots, ToMegabytes(HoldStartUsedPhysical), ToMegabytes(MemorySamples.Last()),
+		       Growth / (1024.0 * 1024.0) / Hours);
+	}
+}
+
+void USoakTestSubsystem::SetNumBots(int32 Count)
+{
+	while (Bots.Num() < Count)
+	{
+		const auto Before = Bots.Num();
+		SpawnBot();
+		if (Bots.Num() == Before) break;
+	}
+
+	while (Bots.Num() > Count)
+	{
+		ReleaseBot();
+	}
+}
+
+void USoakTestSubsystem::SpawnBot()
+{
+	const auto World = GetWorld();
+	const auto Pool = World->GetSubsystem<UCharacterPoolSubsystem>();
+	const auto BotClass = GetBotClass();
+	if (!Pool || !BotClass) return;
+
+	const auto Offset = FDaysGunMath::ForwardFromYaw(Random.FRandRange(-180.f, 180.f)) * Random.FRandRange(0.f, SpawnRadius);
+	const FTransform SpawnTransform(FRotator(0.f, Random.FRandRange(-180.f, 180.f), 0.f), Home + Offset);
+
+	// Bot controllers are pooled along with the characters, released bots park theirs for the next wave
+	const auto Character = Pool->Acquire(BotClass, SpawnTransform, ASoakBotController::StaticClass());
+	if (!Character) return;
+
+	if (const auto Bot = Cast<ASoakBotController>(Character->GetController()))
+	{
+		Bot->SetHome(Home, SpawnRadius);
+	}
+
+	Bots.Add(Character);
+}
+
+void USoakTestSubsystem::ReleaseBot()
+{
+	const auto Character = Bots.Pop(false);
+	if (const auto Pool = GetWorld()->GetSubsystem<UCharacterPoolSubsystem>())
+	{
+		Pool->Release(Character);
+	}
+}
+
+TSubclassOf<ABaseCharacter> USoakTestSubsystem::GetBotClass() const
+{
+	if (const auto BotClass = BotCharacterClass.LoadSynchronous()) return BotClass;
+
+	const auto GameMode = GetWorld()->GetAuthGameMode();
+	if (GameMode && GameMode->DefaultPawnClass && GameMode->DefaultPawnClass->IsChildOf<ABaseCharacter>())
+	{
+		return GameMode->DefaultPawnClass.Get();
+	}
+
+	return ABaseCharacter::StaticClass();
+}
+
+void USoakTestSubsystem::BeginStep()
+{
+	PhaseTime = 0.f;
+	CurrentStep = FSoakStepResult();
+	CurrentStep.Bots = Bots.Num();
+}
+
+void USoakTestSubsystem::FinishStep()
+{
+	const auto Frames = FMath::Max(CurrentStep.Frames, 1);
+	CurrentStep.FrameMs /= Frames;
+	CurrentStep.PreActorMs /= Frames;
+	CurrentStep.ActorMs /= Frames;
+	CurrentStep.UsedPhysicalMB = ToMegabytes(FPlatformMemory::GetStats().UsedPhysical);
+
+	const auto NetDriver = GetWorld()->GetNetDriver();
+	if (const auto Graph = NetDriver ? NetDriver->GetReplicationDriver<UDaysGunReplicationGraph>() : nullptr)
+	{
+		CurrentStep.ReplicateMs = Graph->GetAverageReplicateMs();
+	}
+
+	Steps.Add(CurrentStep);
+
+	UE_LOG(LogDaysGun, Display, TEXT("Soak step: %d bots, %.2f ms avg %.2f ms peak"), CurrentStep.Bots,
+	       CurrentStep.FrameMs, CurrentStep.PeakFrameMs);
+
+	if (CurrentStep.FrameMs > FrameBudgetMs)
+	{
+		SetNumBots(SustainableBots);
+		BeginHold();
+		return;
+	}
+
+	SustainableBots = CurrentStep.Bots;
+	if (Bots.Num() >= MaxBots || BotsPerStep <= 0)
+	{
+		BeginHold();
+		return;
+	}
+
+	SetNumBots(FMath::Min(Bots.Num() + BotsPerStep, MaxBots));
+	BeginStep();
+}
+
+void USoakTestSubsystem::BeginHold()
+{
+	UE_LOG(LogDaysGun, Display, TEXT("Soak holding %d bots for %.0f s"), Bots.Num(), HoldSeconds);
+
+	Phase = EPhase::Holding;
+	PhaseTime = 0.f;
+	NextMemorySample = 0.f;
+	HoldStartUsedPhysical = FPlatformMemory::GetStats().UsedPhysical;
+	MemorySamples.Reset();
+}
+
+void USoakTestSubsystem::FinishSoak()
+{
+	SampleMemory();
+	PrintReport();
+	StopSoak();
+
+	if (ExitWhenDone)
+	{
+		FPlatformMisc::RequestExit(false);
+	}
+}
+
+void USoakTestSubsystem::SampleMemory()
+{
+	const auto UsedPhysical = FPlatformMemory::GetStats().UsedPhysical;
+	MemorySamples.Add(UsedPhysical);
+
+	UE_LOG(LogDaysGun, Display, TEXT("Soak memory at %.0f s: %llu MB used"), PhaseTime, ToMegabytes(UsedPhysical));
+}
+
+void USoakTestSubsystem::OnWorldTickStart(UWorld* InWorld, ELevelTick TickType, float DeltaSeconds)
+{
+	if (InWorld == GetWorld())
+	{
+		TickStartCycles = FPlatformTime::Cycles64();
+	}
+}
+
+void USoakTestSubsystem::OnPreActorTick(UWorld* InWorld, ELevelTick TickType, float DeltaSeconds)
+{
+	if (InWorld == GetWorld())
+	{
+		PreActorCycles = FPlatformTime::Cycles64();
+		PendingPreActorCycles += PreActorCycles - TickStartCycles;
+	}
+}
+
+void USoakTestSubsystem::OnPostActorTick(UWorld* InWorld, ELevelTick TickType, float DeltaSeconds)
+{
+	if (InWorld == GetWorld())
+	{
+		PendingActorCycles += FPlatformTime::Cycles64() - PreActorCycles;
+	}
+}
+
+#if !UE_BUILD_SHIPPING
+static FAutoConsoleCommandWithWorldAndArgs GSoakStartCommand(
+	TEXT("DaysGun.Soak.Start"),
+	TEXT("Ramps soak bots until the frame budget is exceeded, then holds. Args: [BudgetMs] [BotsPerStep] [HoldSeconds]"),
+	FConsoleCommandWithWorldAndArgsDelegate::CreateLambda([](const TArray<FString>& Args, UWorld* World)
+	{
+		const auto Subsystem = World ? World->GetSubsystem<USoakTestSubsystem>() : nullptr;
+		if (!Subsystem) return;
+
+		if (Args.Num() > 0) Subsystem->SetFrameBudgetMs(FCString::Atof(*Args[0]));
+		if (Args.Num() > 1) Subsystem->SetBotsPerStep(FCString::Atoi(*Args[1]));
+		if (Args.Num() > 2) Subsystem->SetHoldSeconds(FCString::Atof(*Args[2]));
+		Subsystem->StartSoak();
+	}));
+
+static FAutoConsoleCommandWithWorld GSoakStopCommand(
+	TEXT("DaysGun.Soak.Stop"),
+	TEXT("Stops the soak test and releases its bots."),
+	FConsoleCommandWithWorldDelegate::CreateLambda([](UWorld* World)
+	{
+		if (const auto Subsystem = World ? World->GetSubsystem<USoakTestSubsystem>() : nullptr)
+		{
+			Subsystem->PrintReport();
+			Subsystem->StopSoak();
+		}
+	}));
+
+static FAutoConsoleCommandWithWorld GSoakReportCommand(
+	TEXT("DaysGun.Soak.Report"),
+	TEXT("Logs the soak steps so far: bots, frame time breakdown and memory."),
+	FConsoleCommandWithWorldDelegate::CreateLambda([](UWorld* World)
+	{
+		if (const auto Subsystem = World ? World->GetSubsystem<USoakTestSubsystem>() : nullptr)
+		{
+			Subsystem->PrintReport();
+		}
+	}));
+#endif
@@ -0,0 +1,258 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "Soak/StreamingFlyThroughSubsystem.h"
+
+#include "DaysGun.h"
+#include "EngineUtils.h"
+#include "Engine/World.h"
+#include "GameFramework/CharacterMovementComponent.h"
+#include "GameFramework/PlayerController.h"
+#include "Math/DaysGunMath.h"
+#include "Misc/App.h"
+#include "Player/BaseCharacter.h"
+#include "WorldPartition/WorldPartitionRuntimeCell.h"
+#include "WorldPartition/WorldPartitionSubsystem.h"
+
+void UStreamingFlyThroughSubsystem::Deinitialize()
+{
+	StopFlyThrough();
+	Super::Deinitialize();
+}
+
+bool UStreamingFlyThroughSubsystem::DoesSupportWorldType(const EWorldType::Type WorldType) const
+{
+	return WorldType == EWorldType::Game || WorldType == EWorldType::PIE;
+}
+
+void UStreamingFlyThroughSubsystem::Tick(float DeltaTime)
+{
+	if (!IsValid(FlyCharacter))
+	{
+		UE_LOG(LogDaysGun, Warning, TEXT("Streaming fly-through: the character went away, stopped"));
+		StopFlyThrough();
+		return;
+	}
+
+	PhaseTime += DeltaTime;
+	if (Phase == EFlyThroughPhase::Settling)
+	{
+		TickSettling(DeltaTime);
+	}
+	else
+	{
+		TickFlying(DeltaTime);
+	}
+}
+
+bool UStreamingFlyThroughSubsystem::IsTickable() const
+{
+	return Phase != EFlyThroughPhase::Idle;
+}
+
+TStatId UStreamingFlyThroughSubsystem::GetStatId() const
+{
+	RETURN_QUICK_DECLARE_CYCLE_STAT(UStreamingFlyThroughSubsystem, STATGROUP_Tickables);
+}
+
+void UStreamingFlyThroughSubsystem::StartFlyThrough(bool InPredictive, float InSpeed, float Seconds)
+{
+	if (Phase != EFlyThroughPhase::Idle) return;
+
+	const auto World = GetWorld();
+	if (!World->GetSubsystem<UWorldPartitionSubsystem>())
+	{
+		UE_LOG(LogDaysGun, Warning, TEXT("Streaming fly-through: %s is not a World Partition map"),
+		       *World->GetMapName());
+		return;
+	}
+
+	const auto PlayerController = World->GetFirstPlayerController();
+	FlyCharacter = PlayerController ? Cast<ABaseCharacter>(PlayerController->GetPawn()) : nullptr;
+	if (!FlyCharacter) return;
+
+	Predictive = InPredictive;
+	Speed = InSpeed > 0.f ? InSpeed : FlyCharacter->GetGaitProfiles()->GetRuntimeProfile(EGait::EG_Run).MaxSpeed;
+	BuildPath(Seconds);
+
+	SavedPredictive = FlyCharacter->IsPredictiveStreaming();
+	FlyCharacter->SetPredictiveStreaming(Predictive);
+	FlyCharacter->SetActorEnableCollision(false);
+	FlyCharacter->GetCharacterMovement()->SetMovementMode(MOVE_Flying);
+	FlyCharacter->GetCharacterMovement()->StopMovementImmediately();
+	FlyCharacter->SetActorLocation(Path[0], false, nullptr, ETeleportType::ResetPhysics);
+
+	Phase = EFlyThroughPhase::Settling;
+	PhaseTime = 0.f;
+	Distance = 0.f;
+	WasLate = false;
+	Result = FFlyThroughResult();
+
+	UE_LOG(LogDaysGun, Display, TEXT("Streaming fly-through: %d points, %.0f m at %.0f cm/s, predictive %s"),
+	       Path.Num(), PathDistances.Last() / 100.f, Speed, Predictive ? TEXT("on") : TEXT("off"));
+}
+
+void UStreamingFlyThroughSubsystem::StopFlyThrough()
+{
+	if (Phase == EFlyThroughPhase::Idle) return;
+	Phase = EFlyThroughPhase::Idle;
+
+	if (IsValid(FlyCharacter))
+	{
+		FlyCharacter->SetPredictiveStreaming(SavedPredictive);
+		FlyCharacter->SetActorEnableCollision(true);
+		FlyCharacter->GetCharacterMovement()->StopMovementImmediately();
+		FlyCharacter->GetCharacterMovement()->SetMovementMode(MOVE_Falling);
+	}
+	FlyCharacter = nullptr;
+}
+
+void UStreamingFlyThroughSubsystem::BuildPath(float Seconds)
+{
+	TArray<AActor*> PathActors;
+	for (TActorIterator<AActor> It(GetWorld()); It; ++It)
+	{
+		if (It->ActorHasTag(PathTag))
+		{
+			PathActors.Add(*It);
+		}
+	}
+	PathActors.Sort([](const AActor& A, const AActor& B) { return A.GetName() < B.GetName(); });
+
+	Path.Reset();
+	for (const auto PathActor : PathActors)
+	{
+		Path.Add(PathActor->GetActorLocation());
+	}
+
+	if (Path.Num() < 2)
+	{
+		const auto Start = FlyCharacter->GetActorLocation();
+		Path = {Start, Start + FDaysGunMath::ForwardFromYaw(FlyCharacter->GetControlRotation().Yaw) * Speed * Seconds};
+	}
+
+	PathDistances.Reset(Path.Num());
+	PathDistances.Add(0.f);
+	for (int32 Index = 1; Index < Path.Num(); ++Index)
+	{
+		PathDistances.Add(PathDistances.Last() + FVector::Dist(Path[Index - 1], Path[Index]));
+	}
+}
+
+FVector UStreamingFlyThroughSubsystem::GetPathLocation(float InDistance, FVector& OutDirection) const
+{
+	int32 Index = 1;
+	while (Index < Path.Num() - 1 && PathDistances[Index] < InDistance)
+	{
+		++Index;
+	}
+
+	const auto SegmentLength = PathDistances[Index] - PathDistances[Index - 1];
+	const auto Alpha = SegmentLength > 0.f ? (InDistance - PathDistances[Index - 1]) / SegmentLength : 1.f;
+	OutDirection = (Path[Index] - Path[Index - 1]).GetSafeNormal();
+	return FMath::Lerp(Path[Index - 1], Path[Index], FMath::Clamp(Alpha, 0.f, 1.f));
+}
+
+bool UStreamingFlyThroughSubsystem::IsStreamingCompleted(const FVector& Location, float Radius) const
+{
+	const auto WorldPartition = GetWorld()->GetSubsystem<UWorldPartitionSubsystem>();
+	if (!WorldPartition) return true;
+
+	// Radius 0 asks for the loading range of every grid
+	FWorldPartitionStreamingQuerySource QuerySource;
+	QuerySource.Location = Location;
+	QuerySource.Radius = Radius;
+	QuerySource.bUseGridLoadingRange = Radius <= 0.f;
+	QuerySource.bSpatialQuery = true;
+	return WorldPartition->IsStreamingCompleted(EWorldPartitionRuntimeCellState::Activated, {QuerySource}, false);
+}
+
+void UStreamingFlyThroughSubsystem::TickSettling(float DeltaTime)
+{
+	if (!IsStreamingCompleted(Path[0], 0.f) && PhaseTime < MaxSettleSeconds) return;
+
+	if (PhaseTime >= MaxSettleSeconds)
+	{
+		UE_LOG(LogDaysGun, Warning, TEXT("Streaming fly-through: start not streamed in after %.0f s, flying anyway"),
+		       MaxSettleSeconds);
+	}
+
+	Phase = EFlyThroughPhase::Flying;
+	PhaseTime = 0.f;
+}
+
+void UStreamingFlyThroughSubsystem::TickFlying(float DeltaTime)
+{
+	// The engine knows the time of the last frame now, which flew the character to where it is
+	if (PhaseTime > DeltaTime)
+	{
+		const auto FrameMs = (FApp::GetDeltaTime() - FApp::GetIdleTime()) * 1000.0;
+		++Result.Frames;
+		Result.FrameMs += FrameMs;
+		Result.PeakFrameMs = FMath::Max(Result.PeakFrameMs, FrameMs);
+		Result.Hitches += FrameMs > HitchThresholdMs ? 1 : 0;
+
+		const auto Late = !IsStreamingCompleted(FlyCharacter->GetActorLocation(), LateLoadRadius);
+		Result.LateFrames += Late ? 1 : 0;
+		Result.LateLoads += Late && !WasLate ? 1 : 0;
+		WasLate = Late;
+	}
+
+	Distance += Speed * DeltaTime;
+	if (Distance >= PathDistances.Last())
+	{
+		FinishFlyThrough();
+		return;
+	}
+
+	FVector Direction;
+	const auto Location = GetPathLocation(Distance, Direction);
+	FlyCharacter->SetActorLocation(Location);
+
+	// The streaming source looks ahead along the velocity and the control rotation
+	FlyCharacter->GetCharacterMovement()->Velocity = Direction * Speed;
+	if (const auto Controller = FlyCharacter->GetController())
+	{
+		Controller->SetControlRotation(FRotator(0.f, Direction.Rotation().Yaw, 0.f));
+	}
+}
+
+void UStreamingFlyThroughSubsystem::FinishFlyThrough()
+{
+	const auto Frames = FMath::Max(Result.Frames, 1);
+	UE_LOG(LogDaysGun, Display, TEXT("Streaming fly-through, predictive %s, %.0f m at %.0f cm/s in %.1f s:"),
+	       Predictive ? TEXT("on") : TEXT("off"), PathDistances.Last() / 100.f, Speed, PhaseTime);
+	UE_LOG(LogDaysGun, Display, TEXT("  frames %6d  mean %6.2f ms  peak %7.2f ms  hitches over %.0f ms %d"),
+	       Result.Frames, Result.FrameMs / Frames, Result.PeakFrameMs, HitchThresholdMs, Result.Hitches);
+	UE_LOG(LogDaysGun, Display, TEXT("  late loads within %.0f m %d, %d frames late"),
+	       LateLoadRadius / 100.f, Result.LateLoads, Result.LateFrames);
+
+	StopFlyThrough();
+}
+
+#if !UE_BUILD_SHIPPING
+static FAutoConsoleCommandWithWorldAndArgs GStreamingFlyThroughCommand(
+	TEXT("DaysGun.Streaming.FlyThrough"),
+	TEXT("Flies the player's character through the map and reports streaming hitches and late cell loads. "
+		"Args: [Predictive=1] [Speed=run speed] [Seconds=30]"),
+	FConsoleCommandWithWorldAndArgsDelegate::CreateLambda([](const TArray<FString>& Args, UWorld* World)
+	{
+		if (const auto Subsystem = World ? World->GetSubsystem<UStreamingFlyThroughSubsystem>() : nullptr)
+		{
+			Subsystem->StartFlyThrough(Args.Num() > 0 ? Args[0].ToBool() : true,
+			                           Args.Num() > 1 ? FCString::Atof(*Args[1]) : 0.f,
+			                           Args.Num() > 2 ? FCString::Atof(*Args[2]) : 30.f);
+		}
+	}));
+
+static FAutoConsoleCommandWithWorld GStreamingStopCommand(
+	TEXT("DaysGun.Streaming.Stop"),
+	TEXT("Stops a running streaming fly-through without a report"),
+	FConsoleCommandWithWorldDelegate::CreateLambda([](UWorld* World)
+	{
+		if (const auto Subsystem = World ? World->GetSubsystem<UStreamingFlyThroughSubsystem>() : nullptr)
+		{
+			Subsystem->StopFlyThrough();
+		}
+	}));
+#endif
@@ -0,0 +1,414 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "Math/DaysGunMath.h"
+
+#include "Kismet/KismetMathLibrary.h"
+#include "Misc/AutomationTest.h"
+
+#include <limits>
+
+#if WITH_DEV_AUTOMATION_TESTS
+
+namespace DaysGunMathTest
+{
+	constexpr int32 NumRandom = 4096;
+
+	/** Not a multiple of four, so the batched forms run their scalar tail too */
+	constexpr int32 NumBatch = NumRandom + 3;
+
+	constexpr float Tiny = 1e-5f;
+	const float NaN = std::numeric_limits<float>::quiet_NaN();
+
+	/** Rounding error of NumOps float operations on values up to Magnitude */
+	double FloatTolerance(double Magnitude, int32 NumOps)
+	{
+		return NumOps * static_cast<double>(FLT_EPSILON) * FMath::Max(FMath::Abs(Magnitude), 1.0);
+	}
+
+	/** Float Atan2 against the double one, in degrees */
+	constexpr double YawFromVectorTolerance = 1e-4;
+
+	/** Inputs reach +-720, so a difference can reach 1440 before it is normalized */
+	const double DeltaYawTolerance = FloatTolerance(1440.0, 2);
+	const double DeltaYawBatchTolerance = FloatTolerance(1440.0, 3);
+	const double InterpTolerance = FloatTolerance(1440.0, 4);
+
+	/** InvSqrt on a unit length result */
+	constexpr double NormalTolerance = 1e-6;
+
+	/** NaN on both sides is a match: the helpers must propagate NaN wherever Kismet does */
+	bool BothNaN(double Expected, double Actual)
+	{
+		return FMath::IsNaN(Expected) && FMath::IsNaN(Actual);
+	}
+
+	void CheckNear(FAutomationTestBase& Test, const FString& What, double Expected, double Actual, double Tolerance)
+	{
+		if (BothNaN(Expected, Actual)) return;
+		if (!FMath::IsNaN(Expected) && !FMath::IsNaN(Actual) && FMath::Abs(Expected - Actual) <= Tolerance) return;
+
+		Test.AddError(FString::Printf(TEXT("%s: expected %.7f, got %.7f, tolerance %g"), *What, Expected, Actual,
+		                              Tolerance));
+	}
+
+	/** Yaws on either side of the +-180 seam are the same rotation */
+	void CheckNearYaw(FAutomationTestBase& Test, const FString& What, double Expected, double Actual, double Tolerance)
+	{
+		if (BothNaN(Expected, Actual)) return;
+
+		const auto Error = FMath::Abs(FRotator::NormalizeAxis(Expected - Actual));
+		if (!FMath::IsNaN(Error) && Error <= Tolerance) return;
+
+		Test.AddError(FString::Printf(TEXT("%s: expected yaw %.7f, got %.7f, tolerance %g"), *What, Expected, Actual,
+		                              Tolerance));
+	}
+
+	/** The same values every run, so a failure reproduces */
+	TArray<float> MakeRandom(int32 Num, int32 Seed, float Range)
+	{
+		FRandomStream Random(Seed);
+		TArray<float> Values;
+		Values.SetNumUninitialized(Num);
+		for (auto& Value : Values)
+		{
+			Value = Random.FRandRange(-Range, Range);
+		}
+		return Values;
+	}
+
+	double KismetYawFromVector(float X, float Y)
+	{
+		return UKismetMathLibrary::MakeRotFromX(FVector(X, Y, 0.f)).Yaw;
+	}
+
+	double KismetDeltaYaw(float A, float B)
+	{
+		return UKismetMathLibrary::NormalizedDeltaRotator(FRotator(0.f, A, 0.f), FRotator(0.f, B, 0.f)).Yaw;
+	}
+
+	double KismetMapRangeClamped(float Value, float InMin, float InMax, float OutMin, float OutMax)
+	{
+		return UKismetMathLibrary::MapRangeClamped(Value, InMin, InMax, OutMin, OutMax);
+	}
+
+	struct FYawPair
+	{
+		float A;
+		float B;
+	};
+
+	/** The +-180 seam, values past a full turn, NaN */
+	const FYawPair YawPairs[] = {
+		{0.f, 0.f}, {179.f, -179.f}, {-179.f, 179.f}, {180.f, -180.f}, {-180.f, 0.f}, {180.f, 0.f}, {540.f, 0.f},
+		{-540.f, 0.f}, {720.f, -720.f}, {90.f, -90.f}, {NaN, 0.f}, {0.f, NaN},
+	};
+
+	/** Zero and below GetSafeNormal's tolerance, the axes, both sides of the seam, just above tolerance, NaN */
+	const FVector2f Vectors[] = {
+		{0.f, 0.f}, {Tiny, Tiny}, {-Tiny, 0.f}, {1.f, 0.f}, {0.f, 1.f}, {-1.f, 0.f}, {-1.f, -0.f}, {-1.f, 1e-3f},
+		{-1.f, -1e-3f}, {0.f, -1.f}, {1e-3f, -1e-3f}, {NaN, 1.f}, {1.f, NaN},
+	};
+
+	struct FRangeRow
+	{
+		float Value;
+		float InMin;
+		float InMax;
+		float OutMin;
+		float OutMax;
+	};
+
+	/** Inside, both clamps, reversed ranges, flat and nearly flat input ranges, NaN */
+	const FRangeRow RangeRows[] = {
+		{100.f, 0.f, 200.f, 500.f, 2000.f}, {-5.f, 0.f, 200.f, 500.f, 2000.f}, {300.f, 0.f, 200.f, 500.f, 2000.f},
+		{0.f, 0.f, 200.f, 500.f, 2000.f}, {200.f, 0.f, 200.f, 500.f, 2000.f}, {50.f, 200.f, 0.f, 500.f, 2000.f},
+		{50.f, 0.f, 200.f, 2000.f, 500.f}, {5.f, 10.f, 10.f, 0.f, 1.f}, {10.f, 10.f, 10.f, 0.f, 1.f},
+		{11.f, 10.f, 10.f, 0.f, 1.f}, {0.5e-9f, 0.f, 1e-9f, 0.f, 1.f}, {2e-9f, 0.f, 1e-9f, 0.f, 1.f},
+		{NaN, 0.f, 200.f, 500.f, 2000.f}, {100.f, 0.f, 200.f, NaN, 2000.f},
+	};
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FDaysGunMathYawTest, "DaysGun.Math.Yaw",
+                                 EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::ProductFilter)
+
+bool FDaysGunMathYawTest::RunTest(const FString& Parameters)
+{
+	using namespace DaysGunMathTest;
+
+	for (const auto& Pair : YawPairs)
+	{
+		const auto Row = FString::Printf(TEXT("DeltaYaw(%f, %f)"), Pair.A, Pair.B);
+		CheckNear(*this, Row, KismetDeltaYaw(Pair.A, Pair.B), FDaysGunMath::DeltaYaw(Pair.A, Pair.B),
+		          DeltaYawTolerance);
+	}
+
+	// Same range as FRotator::NormalizeAxis, so -180 comes back as 180 rather than just the same rotation
+	CheckNear(*this, TEXT("NormalizeYaw(-180)"), FRotator::NormalizeAxis(-180.0), FDaysGunMath::NormalizeYaw(-180.f),
+	          0.0);
+	CheckNear(*this, TEXT("NormalizeYaw(540)"), FRotator::NormalizeAxis(540.0), FDaysGunMath::NormalizeYaw(540.f),
+	          0.0);
+
+	for (const auto& Vector : Vectors)
+	{
+		const auto Row = FString::Printf(TEXT("YawFromVector(%g, %g)"), Vector.X, Vector.Y);
+		CheckNearYaw(*this, Row, KismetYawFromVector(Vector.X, Vector.Y), FDaysGunMath::YawFromVector(Vector),
+		             YawFromVectorTolerance);
+		CheckNearYaw(*this, Row + TEXT(" from FVector"), KismetYawFromVector(Vector.X, Vector.Y),
+		             FDaysGunMath::YawFromVector(FVector(Vector.X, Vector.Y, 0.f)), YawFromVectorTolerance);
+	}
+
+	const auto A = MakeRandom(NumRandom, 1, 720.f);
+	const auto B = MakeRandom(NumRandom, 2, 720.f);
+	const auto X = MakeRandom(NumRandom, 3, 500.f);
+	const auto Y = MakeRandom(NumRandom, 4, 500.f);
+	for (int32 Index = 0; Index < NumRandom; ++Index)
+	{
+		CheckNear(*this, FString::Printf(TEXT("DeltaYaw(%f, %f)"), A[Index], B[Index]),
+		          KismetDeltaYaw(A[Index], B[Index]), FDaysGunMath::DeltaYaw(A[Index], B[Index]), DeltaYawTolerance);
+		CheckNearYaw(*this, FString::Printf(TEXT("YawFromVector(%f, %f)"), X[Index], Y[Index]),
+		             KismetYawFromVector(X[Index], Y[Index]),
+		             FDaysGunMath::YawFromVector(FVector2f(X[Index], Y[Index])), YawFromVectorTolerance);
+	}
+
+	return true;
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FDaysGunMathYawInterpTest, "DaysGun.Math.YawInterp",
+                                 EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::ProductFilter)
+
+bool FDaysGunMathYawInterpTest::RunTest(const FString& Parameters)
+{
+	using namespace DaysGunMathTest;
+
+	struct FInterpRow
+	{
+		float Current;
+		float Target;
+		float DeltaTime;
+		float InterpSpeed;
+	};
+
+	// Already there, no time, no speed, across the seam both ways, half a turn, a step that overshoots, NaN
+	const FInterpRow Rows[] = {
+		{10.f, 10.f, 1.f / 60.f, 10.f}, {10.f, 50.f, 0.f, 10.f}, {10.f, 50.f, 1.f / 60.f, 0.f},
+		{10.f, 50.f, 1.f / 60.f, -1.f}, {179.f, -179.f, 1.f / 60.f, 10.f}, {-179.f, 179.f, 1.f / 60.f, 10.f},
+		{179.f, -179.f, 1.f / 60.f, 720.f}, {0.f, 180.f, 1.f / 60.f, 10.f}, {0.f, 1e-7f, 1.f / 60.f, 10.f},
+		{0.f, 90.f, 1.f, 720.f}, {540.f, -540.f, 1.f / 60.f, 10.f}, {NaN, 10.f, 1.f / 60.f, 10.f},
+		{10.f, NaN, 1.f / 60.f, 10.f},
+	};
+
+	const auto Check = [this](const FInterpRow& Row)
+	{
+		const FRotator Current(0.f, Row.Current, 0.f);
+		const FRotator Target(0.f, Row.Target, 0.f);
+		const auto Args = FString::Printf(TEXT("(%f, %f, %f, %f)"), Row.Current, Row.Target, Row.DeltaTime,
+		                                  Row.InterpSpeed);
+
+		CheckNearYaw(*this, TEXT("YawInterpTo") + Args,
+		             UKismetMathLibrary::RInterpTo(Current, Target, Row.DeltaTime, Row.InterpSpeed).Yaw,
+		             FDaysGunMath::YawInterpTo(Row.Current, Row.Target, Row.DeltaTime, Row.InterpSpeed),
+		             InterpTolerance);
+		CheckNearYaw(*this, TEXT("YawInterpConstantTo") + Args,
+		             UKismetMathLibrary::RInterpTo_Constant(Current, Target, Row.DeltaTime, Row.InterpSpeed).Yaw,
+		             FDaysGunMath::YawInterpConstantTo(Row.Current, Row.Target, Row.DeltaTime, Row.InterpSpeed),
+		             InterpTolerance);
+	};
+
+	for (const auto& Row : Rows)
+	{
+		Check(Row);
+	}
+
+	const auto A = MakeRandom(NumRandom, 5, 720.f);
+	const auto B = MakeRandom(NumRandom, 6, 720.f);
+	for (int32 Index = 0; Index < NumRandom; ++Index)
+	{
+		Check({A[Index], B[Index], 1.f / 60.f, 10.f});
+		Check({A[Index], B[Index], 1.f / 60.f, 720.f});
+	}
+
+	return true;
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FDaysGunMathMapRangeClampedTest, "DaysGun.Math.MapRangeClamped",
+                                 EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::ProductFilter)
+
+bool FDaysGunMathMapRangeClampedTest::RunTest(const FString& Parameters)
+{
+	using namespace DaysGunMathTest;
+
+	for (const auto& Row : RangeRows)
+	{
+		CheckNear(*this, FString::Printf(TEXT("MapRangeClamped(%g, %g, %g, %g, %g)"), Row.Value, Row.InMin, Row.InMax,
+		                                 Row.OutMin, Row.OutMax),
+		          KismetMapRangeClamped(Row.Value, Row.InMin, Row.InMax, Row.OutMin, Row.OutMax),
+		          FDaysGunMath::MapRangeClamped(Row.Value, Row.InMin, Row.InMax, Row.OutMin, Row.OutMax),
+		          FloatTolerance(FMath::Max(FMath::Abs(Row.OutMin), FMath::Abs(Row.OutMax)), 4));
+	}
+
+	const auto Values = MakeRandom(NumRandom, 7, 720.f);
+	for (const auto Value : Values)
+	{
+		CheckNear(*this, FString::Printf(TEXT("MapRangeClamped(%f, 0, 200, 500, 2000)"), Value),
+		          KismetMapRangeClamped(Value, 0.f, 200.f, 500.f, 2000.f),
+		          FDaysGunMath::MapRangeClamped(Value, 0.f, 200.f, 500.f, 2000.f), FloatTolerance(2000.0, 4));
+	}
+
+	return true;
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FDaysGunMathVector2DTest, "DaysGun.Math.Vector2D",
+                                 EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::ProductFilter)
+
+bool FDaysGunMathVector2DTest::RunTest(const FString& Parameters)
+{
+	using namespace DaysGunMathTest;
+
+	const auto CheckDot = [this](const FVector& A, const FVector& B)
+	{
+		const auto Magnitude = FMath::Abs(A.X * B.X) + FMath::Abs(A.Y * B.Y);
+		CheckNear(*this, FString::Printf(TEXT("Dot2D(%s, %s)"), *A.ToString(), *B.ToString()),
+		          UKismetMathLibrary::DotProduct2D(FVector2D(A), FVector2D(B)), FDaysGunMath::Dot2D(A, B),
+		          FloatTolerance(Magnitude, 2));
+	};
+
+	const auto CheckNormal = [this](const FVector& Vector)
+	{
+		const auto Expected = UKismetMathLibrary::Normal(Vector);
+		const auto Actual = FDaysGunMath::SafeNormal2D(Vector);
+		const auto Row = FString::Printf(TEXT("SafeNormal2D(%s)"), *Vector.ToString());
+		CheckNear(*this, Row + TEXT(".X"), Expected.X, Actual.X, NormalTolerance);
+		CheckNear(*this, Row + TEXT(".Y"), Expected.Y, Actual.Y, NormalTolerance);
+	};
+
+	const auto CheckDivide = [this](float A, float B)
+	{
+		const auto Expected = UKismetMathLibrary::SafeDivide(A, B);
+		CheckNear(*this, FString::Printf(TEXT("SafeDivide(%g, %g)"), A, B), Expected, FDaysGunMath::SafeDivide(A, B),
+		          FloatTolerance(Expected, 1));
+	};
+
+	for (const auto& Vector : Vectors)
+	{
+		const FVector Vector3(Vector.X, Vector.Y, 0.f);
+		CheckNormal(Vector3);
+		CheckDot(Vector3, Vector3);
+		CheckDot(Vector3, FVector(-Vector.Y, Vector.X, 0.f));
+		CheckDot(Vector3, FVector::ZeroVector);
+	}
+
+	const TPair<float, float> Divisions[] = {
+		{1.f, 0.f}, {0.f, 0.f}, {-1.f, -0.f}, {NaN, 0.f}, {0.f, NaN}, {1.f, Tiny}, {1.f, 3.f}, {-7.f, 2.f},
+	};
+	for (const auto& Division : Divisions)
+	{
+		CheckDivide(Division.Key, Division.Value);
+	}
+
+	// Inclusive and exclusive bounds on the bound itself, an inverted range, NaN
+	for (const auto Value : {-135.f, -45.f, -90.f, -136.f, -44.f, NaN})
+	{
+		for (const auto InclusiveMin : {false, true})
+		{
+			for (const auto InclusiveMax : {false, true})
+			{
+				const auto Row = FString::Printf(TEXT("InRange(%g, -135, -45, %d, %d)"), Value, InclusiveMin,
+				                                 InclusiveMax);
+				TestTrue(*Row, FDaysGunMath::InRange(Value, -135.f, -45.f, InclusiveMin, InclusiveMax) ==
+				         UKismetMathLibrary::InRange_FloatFloat(Value, -135.0, -45.0, InclusiveMin, InclusiveMax));
+				TestTrue(*(Row + TEXT(" inverted")),
+				         FDaysGunMath::InRange(Value, -45.f, -135.f, InclusiveMin, InclusiveMax) ==
+				         UKismetMathLibrary::InRange_FloatFloat(Value, -45.0, -135.0, InclusiveMin, InclusiveMax));
+			}
+		}
+	}
+
+	const auto X = MakeRandom(NumRandom, 8, 500.f);
+	const auto Y = MakeRandom(NumRandom, 9, 500.f);
+	for (int32 Index = 0; Index + 1 < NumRandom; ++Index)
+	{
+		const FVector A(X[Index], Y[Index], 0.f);
+		const FVector B(X[Index + 1], Y[Index + 1], 0.f);
+		CheckDot(A, B);
+		CheckNormal(A);
+		CheckDivide(X[Index], Y[Index]);
+	}
+
+	return true;
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FDaysGunMathBatchTest, "DaysGun.Math.Batch",
+                                 EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::ProductFilter)
+
+bool FDaysGunMathBatchTest::RunTest(const FString& Parameters)
+{
+	using namespace DaysGunMathTest;
+
+	// SSE min and max don't carry NaN the way FMath::Clamp does, so NaN rows are scalar only
+	auto A = MakeRandom(NumBatch, 10, 720.f);
+	auto B = MakeRandom(NumBatch, 11, 720.f);
+	auto X = MakeRandom(NumBatch, 12, 500.f);
+	auto Y = MakeRandom(NumBatch, 13, 500.f);
+
+	// Edge cases go first, inside the groups of four, and the last three of them again in the scalar tail
+	int32 Row = 0;
+	for (const auto& Pair : YawPairs)
+	{
+		if (FMath::IsNaN(Pair.A) || FMath::IsNaN(Pair.B)) continue;
+
+		A[Row] = A[NumBatch - 1 - Row % 3] = Pair.A;
+		B[Row] = B[NumBatch - 1 - Row % 3] = Pair.B;
+		++Row;
+	}
+
+	Row = 0;
+	for (const auto& Vector : Vectors)
+	{
+		if (Vector.ContainsNaN()) continue;
+
+		X[Row] = X[NumBatch - 1 - Row % 3] = Vector.X;
+		Y[Row] = Y[NumBatch - 1 - Row % 3] = Vector.Y;
+		++Row;
+	}
+
+	TArray<float> Out;
+	Out.SetNumUninitialized(NumBatch);
+
+	FDaysGunMath::DeltaYawBatch(A, B, Out);
+	for (int32 Index = 0; Index < NumBatch; ++Index)
+	{
+		// Exact range, not just the same rotation: -180 must still come back as 180
+		CheckNear(*this, FString::Printf(TEXT("DeltaYawBatch[%d](%f, %f)"), Index, A[Index], B[Index]),
+		          KismetDeltaYaw(A[Index], B[Index]), Out[Index], DeltaYawBatchTolerance);
+	}
+
+	FDaysGunMath::YawFromVectorBatch(X, Y, Out);
+	for (int32 Index = 0; Index < NumBatch; ++Index)
+	{
+		CheckNearYaw(*this, FString::Printf(TEXT("YawFromVectorBatch[%d](%g, %g)"), Index, X[Index], Y[Index]),
+		             KismetYawFromVector(X[Index], Y[Index]), Out[Index], YawFromVectorTolerance);
+	}
+
+	for (const auto& Range : RangeRows)
+	{
+		if (FMath::IsNaN(Range.Value) || FMath::IsNaN(Range.OutMin)) continue;
+
+		auto Values = MakeRandom(NumBatch, 14, 720.f);
+		Values[0] = Values[NumBatch - 1] = Range.Value;
+
+		FDaysGunMath::MapRangeClampedBatch(Values, Out, Range.InMin, Range.InMax, Range.OutMin, Range.OutMax);
+		const auto Tolerance = FloatTolerance(FMath::Max(FMath::Abs(Range.OutMin), FMath::Abs(Range.OutMax)), 4);
+		for (int32 Index = 0; Index < NumBatch; ++Index)
+		{
+			CheckNear(*this, FString::Printf(TEXT("MapRangeClampedBatch[%d](%g, %g, %g, %g, %g)"), Index, Values[Index],
+			                                 Range.InMin, Range.InMax, Range.OutMin, Range.OutMax),
+			          KismetMapRangeClamped(Values[Index], Range.InMin, Range.InMax, Range.OutMin, Range.OutMax),
+			          Out[Index], Tolerance);
+		}
+	}
+
+	return true;
+}
+
+#endif
@@ -0,0 +1,272 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "Locomotion/FixedStepSimulation.h"
+
+#include "Locomotion/LocomotionDecisionCore.h"
+#include "Locomotion/LocomotionTrajectory.h"
+#include "Math/DaysGunMath.h"
+#include "Misc/AutomationTest.h"
+
+#if WITH_DEV_AUTOMATION_TESTS
+
+namespace FixedStepTest
+{
+	constexpr float StepRate = 60.f;
+	constexpr double Duration = 9.0;
+	constexpr float InputVectorRotationRateInterpSpeed = 10.f;
+
+	/** Foot phase cycles per second, a function of the step so every frame rate asks the same */
+	constexpr float FootPhaseRate = 1.3f;
+
+	/** Decisions may land one step apart where a frame straddles a key of the scripted movement */
+	constexpr int32 StepTolerance = 1;
+	constexpr float YawTolerance = 0.5f;
+
+	struct FKey
+	{
+		double Time;
+		float Value;
+	};
+
+	/** Idle, walk start, a turn, a blend into run, a turn back while running, a blend into walk, stop */
+	const FKey SpeedKeys[] = {
+		{0.5, 0.f}, {1.0, 200.f}, {3.0, 200.f}, {3.3, 500.f}, {6.0, 500.f}, {6.3, 200.f}, {7.5, 200.f}, {8.0, 0.f}
+	};
+	const FKey MaxSpeedKeys[] = {{3.0, 200.f}, {3.3, 500.f}, {6.0, 500.f}, {6.3, 200.f}};
+	const FKey InputSizeKeys[] = {{0.45, 0.f}, {0.5, 1.f}, {7.5, 1.f}, {7.55, 0.f}};
+	const FKey YawKeys[] = {{1.5, 0.f}, {2.5, 90.f}, {4.0, 90.f}, {5.0, -45.f}};
+
+	float Evaluate(TConstArrayView<FKey> Keys, double Time)
+	{
+		if (Time <= Keys[0].Time) return Keys[0].Value;
+
+		for (int32 Index = 1; Index < Keys.Num(); ++Index)
+		{
+			if (Time > Keys[Index].Time) continue;
+
+			const auto& From = Keys[Index - 1];
+			const auto& To = Keys[Index];
+			return FMath::Lerp(From.Value, To.Value, static_cast<float>((Time - From.Time) / (To.Time - From.Time)));
+		}
+		return Keys.Last().Value;
+	}
+
+	/** Movement component stand-in, sampled once per rendered frame like the anim instance does */
+	FLocomotionMovementSample SampleMovement(double Time)
+	{
+		const auto Direction = FDaysGunMath::ForwardFromYaw(Evaluate(YawKeys, Time));
+		const auto InputSize = Evaluate(InputSizeKeys, Time);
+
+		FLocomotionMovementSample Sample;
+		Sample.Velocity = Direction * Evaluate(SpeedKeys, Time);
+		Sample.InputVector = Direction * InputSize;
+		Sample.Acceleration = Sample.InputVector * 2048.f;
+		Sample.MaxSpeed = Evaluate(MaxSpeedKeys, Time);
+		return Sample;
+	}
+
+	class FQueries : public ILocomotionDecisionQueries
+	{
+	public:
+		FQueries()
+		{
+			Model.MaxSpeed = 500.f;
+			Model.MaxAcceleration = 2048.f;
+			Model.BrakingDeceleration = 2048.f;
+			Model.GroundFriction = 8.f;
+		}
+
+		virtual bool IsInWalkStartState() override { return false; }
+		virtual float GetFootPhase() override { return FootPhase; }
+
+		virtual bool GetPredictedHeading(float Seconds, float& OutYaw) override
+		{
+			return Trajectory.PredictHeading(Model, Seconds, OutYaw);
+		}
+
+		virtual float GetAverageGroundSpeed(float Window) override
+		{
+			return Trajectory.GetAverageVelocity(Window).Size2D();
+		}
+
+		float FootPhase = 0.f;
+		FLocomotionTrajectory Trajectory;
+		FTrajectoryMovementModel Model;
+	};
+
+	struct FStepRecord
+	{
+		ELocomotionState State = ELocomotionState::ELS_Idle;
+
+		/** Clip selected during the step, None for most steps */
+		ELocomotionClip Clip = ELocomotionClip::ELC_None;
+
+		float Yaw = 0.f;
+	};
+
+	/** Renders at FramesPerSecond and simulates fixed steps the way UPlayerAnimInstance::SimulateFixedSteps does */
+	TArray<FStepRecord> Simulate(float FramesPerSecond)
+	{
+		FFixedStepSettings Settings;
+		Settings.UseFixedStep = true;
+		Settings.StepRate = StepRate;
+
+		FFixedStepAccumulator Accumulator;
+		FLocomotionDecisionCore Core;
+		const FLocomotionDecisionParams Params;
+		FQueries Queries;
+
+		const auto StepDeltaSeconds = Settings.GetStepDeltaSeconds();
+		const auto FrameDeltaSeconds = 1.f / FramesPerSecond;
+
+		auto PrevFrame = SampleMovement(0.0);
+		auto Position = FVector::ZeroVector;
+		auto InputVectorRotationRate = 0.f;
+		auto TargetYaw = 0.f;
+		auto ActorYaw = 0.f;
+
+		TArray<FStepRecord> Records;
+		for (int32 Frame = 1; Frame * static_cast<double>(FrameDeltaSeconds) <= Duration; ++Frame)
+		{
+			const auto CurrentFrame = SampleMovement(Frame * static_cast<double>(FrameDeltaSeconds));
+			const auto Steps = Accumulator.Advance(FrameDeltaSeconds, Settings);
+
+			for (int32 Step = 0; Step < Steps; ++Step)
+			{
+				const auto Sample = FLocomotionMovementSample::Interpolate(PrevFrame, CurrentFrame,
+				                                                           Accumulator.GetStepFrameAlpha(Step));
+
+				FLocomotionDecisionInput Input;
+				Input.DeltaSeconds = StepDeltaSeconds;
+				Input.GroundSpeed = Sample.Velocity.Size2D();
+				Input.MaxSpeed = Sample.MaxSpeed;
+				Input.InputSize = Sample.InputVector.Size();
+				Input.VelocityAccelerationDot = FVector::DotProduct(
+					Sample.Velocity.GetSafeNormal(UE_KINDA_SMALL_NUMBER),
+					Sample.Acceleration.GetSafeNormal(UE_KINDA_SMALL_NUMBER));
+				Input.ActorYaw = ActorYaw;
+				Input.InputYaw = FDaysGunMath::YawFromVector(Sample.InputVector);
+				Input.VelocityYaw = FDaysGunMath::YawFromVector(Sample.Velocity);
+				Input.IsFalling = Sample.IsFalling;
+
+				Position += Sample.Velocity * StepDeltaSeconds;
+				Queries.Model.MaxSpeed = Sample.MaxSpeed;
+				Queries.Trajectory.AddSample(Position, Sample.Velocity, Sample.InputVector, ActorYaw, StepDeltaSeconds);
+
+				if (Sample.InputVector.IsNearlyZero())
+				{
+					InputVectorRotationRate = 0.f;
+				}
+				else
+				{
+					const auto RateTarget = Queries.Trajectory.GetInputYawRate(Params.TrajectoryRateWindow);
+					InputVectorRotationRate = FMath::FInterpTo(InputVectorRotationRate, RateTarget, StepDeltaSeconds,
+					                                           InputVectorRotationRateInterpSpeed);
+				}
+
+				Queries.FootPhase = FMath::Frac(Records.Num() * StepDeltaSeconds * FootPhaseRate);
+				const auto Events = Core.Step(Input, Params, Queries);
+
+				auto& Record = Records.AddDefaulted_GetRef();
+				Record.State = Core.GetLocomotionState();
+				if (EnumHasAnyFlags(Events, ELocomotionDecisionEvents::StopSelected))
+				{
+					Record.Clip = Core.GetStopClip();
+				}
+				else if (EnumHasAnyFlags(Events, ELocomotionDecisionEvents::StartSelected))
+				{
+					Record.Clip = Core.GetStartClip();
+				}
+				else if (EnumHasAnyFlags(Events, ELocomotionDecisionEvents::GaitTransitionSelected))
+				{
+					Record.Clip = Core.GetGaitTransitionClip();
+				}
+
+				if (!Sample.Velocity.IsNearlyZero())
+				{
+					FLocomotionDecisionCore::AdvanceTargetYaw(Input.VelocityYaw, InputVectorRotationRate,
+					                                          StepDeltaSeconds, Params, TargetYaw, ActorYaw);
+				}
+				Record.Yaw = ActorYaw;
+			}
+
+			PrevFrame = CurrentFrame;
+		}
+
+		return Records;
+	}
+
+	struct FDecision
+	{
+		int32 Step = 0;
+		ELocomotionState State = ELocomotionState::ELS_Idle;
+		ELocomotionClip Clip = ELocomotionClip::ELC_None;
+	};
+
+	/** Steps that entered a state or selected a clip */
+	TArray<FDecision> GetDecisions(const TArray<FStepRecord>& Records)
+	{
+		TArray<FDecision> Decisions;
+		for (int32 Step = 0; Step < Records.Num(); ++Step)
+		{
+			const auto StateChanged = Step > 0 && Records[Step].State != Records[Step - 1].State;
+			if (!StateChanged && Records[Step].Clip == ELocomotionClip::ELC_None) continue;
+
+			Decisions.Add({Step, Records[Step].State, Records[Step].Clip});
+		}
+		return Decisions;
+	}
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FFixedStepFrameRateEquivalenceTest,
+                                 "DaysGun.Locomotion.FixedStep.FrameRateEquivalence",
+                                 EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::ProductFilter)
+
+bool FFixedStepFrameRateEquivalenceTest::RunTest(const FString& Parameters)
+{
+	using namespace FixedStepTest;
+
+	// The highest frame rate is the closest to sampling the movement at every step
+	const auto Reference = Simulate(144.f);
+	const auto ReferenceDecisions = GetDecisions(Reference);
+	TestTrue(TEXT("Scenario reaches run and back"), ReferenceDecisions.ContainsByPredicate([](const FDecision& Decision)
+	{
+		return Decision.State == ELocomotionState::ELS_Run;
+	}));
+
+	for (const auto FramesPerSecond : {30.f, 60.f})
+	{
+		const auto Records = Simulate(FramesPerSecond);
+		const auto Decisions = GetDecisions(Records);
+		const auto Label = FString::Printf(TEXT("%.0f fps"), FramesPerSecond);
+
+		if (!TestEqual(*(Label + TEXT(" decision count")), Decisions.Num(), ReferenceDecisions.Num())) continue;
+
+		for (int32 Index = 0; Index < Decisions.Num(); ++Index)
+		{
+			const auto& Decision = Decisions[Index];
+			const auto& Expected = ReferenceDecisions[Index];
+			const auto Context = FString::Printf(TEXT("%s decision %d at step %d"), *Label, Index, Expected.Step);
+
+			TestEqual(*(Context + TEXT(" state")), static_cast<int32>(Decision.State),
+			          static_cast<int32>(Expected.State));
+			TestEqual(*(Context + TEXT(" clip")), static_cast<int32>(Decision.Clip), static_cast<int32>(Expected.Clip));
+			TestTrue(*(Context + TEXT(" step")), FMath::Abs(Decision.Step - Expected.Step) <= StepTolerance);
+		}
+
+		auto MaxYawError = 0.f;
+		const auto NumSteps = FMath::Min(Records.Num(), Reference.Num());
+		for (int32 Step = 0; Step < NumSteps; ++Step)
+		{
+			MaxYawError = FMath::Max(MaxYawError, FMath::Abs(FDaysGunMath::DeltaYaw(Records[Step].Yaw,
+			                                                                        Reference[Step].Yaw)));
+		}
+		TestTrue(*FString::Printf(TEXT("%s yaw within %.2f, was %.3f"), *Label, YawTolerance, MaxYawError),
+		         MaxYawError <= YawTolerance);
+	}
+
+	return true;
+}
+
+#endif
@@ -4,37 +4,56 @@
 
 #include "CoreMinimal.h"
 #include "Animation/AnimInstance.h"
+#include "Footsteps/FootstepSubsystem.h"
+#include "Locomotion/FixedStepSimulation.h"
+#include "Locomotion/LandingPrediction.h"
+#include "Locomotion/LocomotionDecisionCore.h"
+#include "Locomotion/LocomotionTrajectory.h"
 #include "PlayerAnimInstance.generated.h"
 
 
-UENUM(BlueprintType)
-enum class ELocomotionState : uint8
-{
-	ELS_Idle UMETA(DisplayName = "Idle"),
-	ELS_Walk UMETA(DisplayName = "Walk"),
-	ELS_Run UMETA(DisplayName = "Run"),
-	ELS_Crouch UMETA(DisplayName = "Crouch"),
-	ELS_Jump UMETA(DisplayName = "Jump"),
-};
-
-struct OnEntryFlags
-{
-	bool IdleFlag = true;
-	bool WalkFlag = false;
-	bool RunFlag = false;
-	bool CrouchFlag = false;
-	bool JumpFlag = false;
-};
-
 UCLASS()
-class DAYSGUN_API UPlayerAnimInstance : public UAnimInstance
+class DAYSGUN_API UPlayerAnimInstance : public UAnimInstance, public ILocomotionDecisionQueries
 {
 	GENERATED_BODY()
 
+	friend struct FPlayerAnimInstanceProxy;
+
 public:
 	virtual void NativeInitializeAnimation() override;
 	virtual void NativeUpdateAnimation(float DeltaSeconds) override;
 	virtual void NativePostEvaluateAnimation() override;
+	virtual void NativeUninitializeAnimation() override;
+	virtual FAnimInstanceProxy* CreateAnimInstanceProxy() override;
+	virtual void DestroyAnimInstanceProxy(FAnimInstanceProxy* InProxy) override;
+
+	/** Clears all locomotion history and stops publishing while the owner sits in the character pool */
+	void SetPooled(bool Pooled);
+
+	/**
+	 * Start, stop and gait transition clips by group, unset clips are included as nullptr.
+	 * WarpingClipsOnly leaves out the clips the warping mode covers by warping the forward ones.
+	 */
+	void GetLocomotionClipGroups(TMap<FName, TArray<UAnimSequence*>>& OutGroups, bool WarpingClipsOnly = false) const;
+
+	/** The asset's UseWarping unless DaysGun.Anim.Warping overrides it */
+	bool IsWarpingEnabled() const;
+
+	/** Handle into ULocomotionSnapshotSubsystem, INDEX_NONE when not registered */
+	FORCEINLINE int32 GetLocomotionSnapshotHandle() const { return SnapshotHandle; }
+
+	/** Past samples of the owner, one per simulated sample */
+	FORCEINLINE const FLocomotionTrajectory& GetTrajectory() const { return Trajectory; }
+
+	/** Predicts the owner's path from its movement component assuming the current input is held */
+	void PredictTrajectory(float Interval, TArrayView<FTrajectoryPoint> OutPoints) const;
+
+	//~ Begin ILocomotionDecisionQueries
+	virtual bool IsInWalkStartState() override;
+	virtual float GetFootPhase() override;
+	virtual bool GetPredictedHeading(float Seconds, float& OutYaw) override;
+	virtual float GetAverageGroundSpeed(float Window) override;
+	//~ End ILocomotionDecisionQueries
 
 protected:
 	UFUNCTION(BlueprintImplementableEvent)
@@ -51,9 +70,23 @@ protected:
 
 private:
 	void SetReferences();
+	void ResetLocomotion();
+	FLocomotionMovementSample SampleMovement() const;
+	void SimulateLocomotionStep();
+	void SimulateFixedSteps(float DeltaSeconds);
 	void SetEssentialMovementData();
-	void DetermineLocomotionState();
-	void TrackLocomotionStates();
+	void SetDecisionParams();
+	void UpdateLocomotionDecision();
+
+	/** Both return the clip that plays, which warping or the gait transition entry table may have swapped */
+	ELocomotionClip ApplyDecisionClip(ELocomotionClip Clip);
+	ELocomotionClip ApplyGaitTransitionClip(ELocomotionClip Clip);
+
+	void RecordLocomotionDecision(const FLocomotionDecisionInput& Input, ELocomotionDecisionEvents Events,
+	                              ELocomotionClip Clip);
+	void RecordHitchEvents(ELocomotionDecisionEvents Events, ELocomotionClip Clip);
+	void UpdateLanding(ELocomotionDecisionEvents Events);
+	void UpdateOrientationWarping(float DeltaSeconds);
 
 	void UpdateCharacterPosition();
 	void ResetTransition();
@@ -64,16 +97,6 @@ private:
 	void UpdateLean();
 	void UpdateAimOffset();
 
-	void DetermineGroundLocomotionState();
-
-	void UpdateStop();
-
-	void UpdateOnWalkEntry();
-	void UpdateOnRunToWalk();
-
-	void UpdateOnRunEntry();
-	void UpdateOnWalkToRun();
-
 	void UpdateLocomotionValues();
 
 	void CycleRotationBehavior();
@@ -82,7 +105,18 @@ private:
 
 	void UpdateEntryVariables();
 
-	void CalculateTargetRotationSmoothed();
+	void CalculateTargetRotationSmoothed(const FLocomotionRotationStep& Step);
+	void AdvanceTargetRotation(bool AccumulateStartAngle);
+
+	void UpdateFootsteps();
+	void PlayFootstep(EFootstepFoot Foot, FName FootSocketName);
+
+	void RegisterSnapshot();
+	void UnregisterSnapshot();
+	void PublishSnapshot() const;
+
+	FLocomotionVisualOutputs CaptureVisualOutputs() const;
+	void ApplyVisualOutputs(const FLocomotionVisualOutputs& Outputs);
 
 protected:
 #pragma region References
@@ -230,6 +264,48 @@ protected:
 	float StartAngle;
 #pragma endregion
 
+#pragma region Landing
+	/** Set from take-off once the async sweeps found where the character touches down */
+	UPROPERTY(BlueprintReadOnly, Category="Landing")
+	bool LandingPredicted;
+
+	UPROPERTY(BlueprintReadOnly, Category="Landing")
+	float TimeToLand;
+
+	UPROPERTY(BlueprintReadOnly, Category="Landing")
+	FVector LandingLocation;
+
+	/** Speed into the landing surface */
+	UPROPERTY(BlueprintReadOnly, Category="Landing")
+	float LandingImpactSpeed;
+
+	/** Set once TimeToLand is within the impact time of LandAnim, which starts at LandAnimStartTime */
+	UPROPERTY(BlueprintReadOnly, Category="Landing")
+	bool PlayLandAnim;
+
+	UPROPERTY(BlueprintReadOnly, Category="Landing")
+	UAnimSequence* LandAnim;
+
+	/** Warps LandAnim so its impact frame plays at the predicted touch down */
+	UPROPERTY(BlueprintReadOnly, Category="Landing")
+	float LandAnimStartTime;
+#pragma endregion
+
+#pragma region Warping
+	/** Switches the anim graph to its warping branch: forward starts only, no gait transition clips */
+	UPROPERTY(BlueprintReadOnly, Category="Warping")
+	bool WarpingActive;
+
+	/** Yaw of the travel direction relative to the body, for the Orientation Warping node */
+	UPROPERTY(BlueprintReadOnly, Category="Warping")
+	float OrientationWarpingAngle;
+
+	/** Stride length the play rate leaves over, for the Stride Warping node */
+	UPROPERTY(BlueprintReadOnly, Category="Warping")
+	float StrideWarpingScale = 1.f;
+#pragma endregion
+
+
 private:
 #pragma region EssentialData
 	UPROPERTY(EditDefaultsOnly, Category="EssentialData")
@@ -239,6 +315,80 @@ private:
 	float LeanInterpSpeed = 4.f;
 #pragma endregion
 
+#pragma region Footsteps
+	float PrevFootPhase = 0.f;
+	FFootstepSurfaceCache FootstepSurfaceCache;
+
+	UPROPERTY(Transient)
+	UFootstepSubsystem* FootstepSubsystem;
+#pragma endregion
+
+#pragma region Trajectory
+	FLocomotionTrajectory Trajectory;
+
+	/** History the input rotation rate, the lean acceleration and the stop speed are measured over */
+	UPROPERTY(EditDefaultsOnly, Category="Locomotion|Trajectory")
+	float TrajectoryRateWindow = 0.1f;
+
+	/** Starts turn towards where the trajectory is predicted to be this many seconds ahead */
+	UPROPERTY(EditDefaultsOnly, Category="Locomotion|Trajectory")
+	float StartPredictionSeconds = 0.2f;
+
+	FTrajectoryMovementModel GetTrajectoryModel() const;
+#pragma endregion
+
+#pragma region Recorder
+	UPROPERTY(Transient)
+	class ULocomotionRecorderSubsystem* RecorderSubsystem;
+
+	/** Null in Shipping builds */
+	UPROPERTY(Transient)
+	class UHitchRecorderSubsystem* HitchRecorder;
+#pragma endregion
+
+#pragma region Snapshot
+	int32 SnapshotHandle = INDEX_NONE;
+
+	UPROPERTY(Transient)
+	class ULocomotionSnapshotSubsystem* SnapshotSubsystem;
+#pragma endregion
+
+#pragma region FixedStep
+	/** Copied from the owning character so both simulate at the same rate */
+	FFixedStepSettings FixedStepSettings;
+	FFixedStepAccumulator SimAccumulator;
+
+	/** Steps simulated during the last update */
+	int32 SimStepsThisFrame = 1;
+
+	/** Time advanced by one simulation step */
+	float SimDeltaSeconds = 0.f;
+
+	/** Movement sampled this frame and the frame before, and interpolated to the step being simulated */
+	FLocomotionMovementSample FrameSample;
+	FLocomotionMovementSample PrevFrameSample;
+	FLocomotionMovementSample StepSample;
+	bool HasFrameSample = false;
+
+	/** Steps of the last update, replayed by the post-evaluate rotation */
+	TArray<FLocomotionRotationStep, TInlineAllocator<8>> RotationSteps;
+
+	float InputVectorRotationRateTarget = 0.f;
+	FVector LeanTarget;
+
+	FLocomotionVisualOutputs PrevVisualOutputs;
+	FLocomotionVisualOutputs CurrentVisualOutputs;
+
+	FRotator PrevTargetRotationSmoothed;
+	FRotator RenderedRotation;
+	float PrevStartAngle = 0.f;
+
+	FORCEINLINE float GetSimAlpha() const
+	{
+		return FixedStepSettings.UseFixedStep ? SimAccumulator.GetAlpha() : 1.f;
+	}
+#pragma endregion
+
 #pragma region Locomotion
 	UPROPERTY(EditDefaultsOnly, Category="Locomotion")
 	float MinTimeInLocomotionState = 0.15f;
@@ -250,7 +400,7 @@ private:
 	UPROPERTY(EditDefaultsOnly, Category="Locomotion|Run")
 	float RunMinCurrentSpeed = 1.f;
 
-	UPROPERTY(EditDefaultsOnly, Category="Locomotion|Run")
+	/** Derived from the owner's gait profiles: the slowest gait that moves in the run state */
 	float RunMinMaxSpeed = 300.f;
 
 	UPROPERTY(EditDefaultsOnly, Category="Locomotion|Run")
@@ -278,6 +428,107 @@ private:
 	float RunStopSpeedLimit = 200.f;
 #pragma endregion
 
+#pragma region Landing
+	/** Impact speed from which LandHeavyAnim plays instead of LandLightAnim */
+	UPROPERTY(EditDefaultsOnly, Category="Locomotion|Landing")
+	float HeavyLandingSpeed = 800.f;
+
+	UPROPERTY(EditDefaultsOnly, Category="Locomotion|Landing")
+	float LandingPredictionSeconds = 2.f;
+
+	UPROPERTY(EditDefaultsOnly, Category="Locomotion|Landing")
+	int32 LandingPredictionSegments = 8;
+
+	/** Velocity difference from the predicted arc in cm/s that predicts the landing again */
+	UPROPERTY(EditDefaultsOnly, Category="Locomotion|Landing")
+	float LandingVelocityTolerance = 50.f;
+
+	FLandingPredictor LandingPredictor;
+	FLandingPredictionParams LandingParams;
+
+	/** Decided with the land animation: a slow landing with input goes into a start clip at LandStartAngle */
+	bool LandIntoStart = false;
+	float LandStartAngle = 0.f;
+
+	/** Airborne and not yet touched down, LandImpactFrameTime is when the committed land animation hits its impact */
+	bool LandPending = false;
+	double LandImpactFrameTime = 0.0;
+#pragma endregion
+
+#pragma region Warping
+	/**
+	 * Covers every start direction with the forward start of each gait and every speed with the cycle's play rate
+	 * and stride warping, so the directional starts and the gait transition clips are not needed
+	 */
+	UPROPERTY(EditDefaultsOnly, Category="Locomotion|Warping")
+	bool UseWarping = false;
+
+	/** Play rate range of the cycles, stride warping makes up the rest of the speed */
+	UPROPERTY(EditDefaultsOnly, Category="Locomotion|Warping")
+	float WarpingMinPlayRate = 0.8f;
+
+	UPROPERTY(EditDefaultsOnly, Category="Locomotion|Warping")
+	float WarpingMaxPlayRate = 1.2f;
+
+	/** Larger angles are left to the body turn, the legs twist unnaturally past it */
+	UPROPERTY(EditDefaultsOnly, Category="Locomotion|Warping")
+	float MaxOrientationWarpingAngle = 90.f;
+
+	UPROPERTY(EditDefaultsOnly, Category="Locomotion|Warping")
+	float OrientationWarpingInterpSpeed = 10.f;
+
+	/** Seconds the body takes to turn to the start angle, the forward start has no rotation curve */
+	UPROPERTY(EditDefaultsOnly, Category="Locomotion|Warping")
+	float WarpingStartTurnSeconds = 0.4f;
+#pragma endregion
+
+#pragma region RotationRate
+	/** Input rotation rate (deg/s) at which the const and smooth rotation rates reach their max */
+	UPROPERTY(EditDefaultsOnly, Category="Rotation|Rate")
+	float RotationRateInputRange = 200.f;
+
+	UPROPERTY(EditDefaultsOnly, Category="Rotation|Rate")
+	float ConstRotationRateMin = 500.f;
+
+	UPROPERTY(EditDefaultsOnly, Category="Rotation|Rate")
+	float ConstRotationRateMax = 2000.f;
+
+	UPROPERTY(EditDefaultsOnly, Category="Rotation|Rate")
+	float SmoothRotationRateMin = 5.f;
+
+	UPROPERTY(EditDefaultsOnly, Category="Rotation|Rate")
+	float SmoothRotationRateMax = 15.f;
+#pragma endregion
+
+#pragma region Footsteps
+	UPROPERTY(EditDefaultsOnly, Category="Footsteps")
+	class UFootstepEffectsAsset* FootstepEffects;
+
+	/** MoveData_FootPhase value at which the left foot touches the ground */
+	UPROPERTY(EditDefaultsOnly, Category="Footsteps")
+	float LeftFootPlantPhase = 0.5f;
+
+	/** MoveData_FootPhase value at which the right foot touches the ground */
+	UPROPERTY(EditDefaultsOnly, Category="Footsteps")
+	float RightFootPlantPhase = 0.f;
+
+	/** Phase changes larger than this come from a clip switch, not from walking, and are ignored */
+	UPROPERTY(EditDefaultsOnly, Category="Footsteps")
+	float MaxFootPhaseStep = 0.5f;
+
+	UPROPERTY(EditDefaultsOnly, Category="Footsteps")
+	float FootstepMinSpeed = 10.f;
+
+	UPROPERTY(EditDefaultsOnly, Category="Footsteps")
+	float FootstepTraceDistance = 50.f;
+
+	UPROPERTY(EditDefaultsOnly, Category="Footsteps")
+	FName LeftFootSocketName = "foot_l";
+
+	UPROPERTY(EditDefaultsOnly, Category="Footsteps")
+	FName RightFootSocketName = "foot_r";
+#pragma endregion
+
 #pragma region Animations
 	UPROPERTY(EditDefaultsOnly, Category="Animations|Stop")
 	UAnimSequence* WalkStopAnim;
@@ -375,74 +626,30 @@ private:
 	UPROPERTY(EditDefaultsOnly, Category="Animations|Transition")
 	float RunToWalkRFTime = 0.f;
 
-#pragma endregion
-#pragma endregion
+	/** When built, picks the transition foot and start time instead of the foot phase limit and the times above */
+	UPROPERTY(EditDefaultsOnly, Category="Animations|Transition")
+	class UGaitTransitionEntryTable* GaitTransitionEntryTable;
 
-private:
-#pragma region HelperFunctions
-	FORCEINLINE bool IsMovementWithinThresholds(float MinCurrentSpeed, float MinMaxSpeed,
-	                                            float MinInputAcceleration) const;
-
-	FORCEINLINE void TrackLocomotionState(ELocomotionState TracedState,
-	                                      bool& EnterFlag,
-	                                      void (UPlayerAnimInstance::*OnEnterCallback)(),
-	                                      void (UPlayerAnimInstance::*OnExitCallback)(),
-	                                      void (UPlayerAnimInstance::*WhileTrueCallback)(),
-	                                      void (UPlayerAnimInstance::*WhileFalseCallback)());
-
-	FORCEINLINE void UpdateStartAnim(UAnimSequence*& FinishAnim,
-							  UAnimSequence* Start90LAnim, float Start90LAnimTime,
-							  UAnimSequence* Start180LAnim, float Start180LAnimTime,
-							  UAnimSequence* Start90RAnim, float Start90RAnimTime,
-							  UAnimSequence* Start180RAnim, float Start180RAnimTime,
-							  UAnimSequence* StartFAnim, float StartFAnimTime);
-
-	FORCEINLINE void UpdateTransitionAnim(UAnimSequence*& FinishAnim,
-	                          UAnimSequence* TransitionLFAnim, float AnimLFStartTime,
-	                          UAnimSequence* TransitionRFAnim, float AnimRFStartTime);
-
-	FORCEINLINE float CalculateConstRotationRate() const;
-	FORCEINLINE float CalculateSmoothRotationRate() const;
-#pragma endregion
+	UPROPERTY(EditDefaultsOnly, Category="Animations|Land")
+	UAnimSequence* LandLightAnim;
 
-private:
-#pragma region TrackLocomotionState
-	OnEntryFlags EntryFlags;
-
-#pragma region IdleCallbacks
-	void OnEntryIdle();
-	void OnExitIdle();
-	void WhileTrueIdle();
-	void WhileFalseIdle();
-#pragma endregion
+	/** Time of the impact frame in the clip */
+	UPROPERTY(EditDefaultsOnly, Category="Animations|Land")
+	float LandLightAnimImpactTime = 0.f;
 
-#pragma region WalkCallbacks
-	void OnEntryWalk();
-	void OnExitWalk();
-	void WhileTrueWalk();
-	void WhileFalseWalk();
-#pragma endregion
+	UPROPERTY(EditDefaultsOnly, Category="Animations|Land")
+	UAnimSequence* LandHeavyAnim;
 
-#pragma region RunCallbacks
-	void OnEntryRun();
-	void OnExitRun();
-	void WhileTrueRun();
-	void WhileFalseRun();
-#pragma endregion
+	UPROPERTY(EditDefaultsOnly, Category="Animations|Land")
+	float LandHeavyAnimImpactTime = 0.f;
 
-#pragma region CrouchCallbacks
-	void OnEntryCrouch();
-	void OnExitCrouch();
-	void WhileTrueCrouch();
-	void WhileFalseCrouch();
 #pragma endregion
-
-#pragma region JumpCallbacks
-	void OnEntryJump();
-	void OnExitJump();
-	void WhileTrueJump();
-	void WhileFalseJump();
 #pragma endregion
 
+private:
+#pragma region Decision
+	/** State machine and clip selection shared with the offline locomotion simulator */
+	FLocomotionDecisionCore DecisionCore;
+	FLocomotionDecisionParams DecisionParams;
 #pragma endregion
 };
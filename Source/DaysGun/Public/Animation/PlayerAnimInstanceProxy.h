@@ -0,0 +1,34 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Animation/AnimInstanceProxy.h"
+#include "PlayerAnimInstanceProxy.generated.h"
+
+
+class UHitchRecorderSubsystem;
+
+/** Times the anim graph update and evaluation of UPlayerAnimInstance for the hitch recorder, on whatever thread */
+USTRUCT()
+struct DAYSGUN_API FPlayerAnimInstanceProxy : public FAnimInstanceProxy
+{
+	GENERATED_BODY()
+
+	FPlayerAnimInstanceProxy() = default;
+
+	explicit FPlayerAnimInstanceProxy(UAnimInstance* InAnimInstance)
+		: FAnimInstanceProxy(InAnimInstance)
+	{
+	}
+
+protected:
+	virtual void PreUpdate(UAnimInstance* InAnimInstance, float DeltaSeconds) override;
+	virtual void UpdateAnimationNode(const FAnimationUpdateContext& InContext) override;
+	virtual void EvaluateAnimationNode(FPoseContext& Output) override;
+
+private:
+	/** Copied on the game thread in PreUpdate, the worker threads only read them */
+	UHitchRecorderSubsystem* HitchRecorder = nullptr;
+	const UObject* HitchOwner = nullptr;
+};
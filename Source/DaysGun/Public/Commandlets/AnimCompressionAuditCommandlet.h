@@ -0,0 +1,34 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Commandlets/Commandlet.h"
+#include "AnimCompressionAuditCommandlet.generated.h"
+
+
+/**
+ * Compresses every animation sequence under a content path with a set of candidate bone and curve codecs,
+ * measures compressed size, decompression time per sample, end effector error against the raw data and the
+ * error of the MoveData_ curves, and ranks the candidates that stay within the error limits by size.
+ * Editor builds only, the raw animation data is not cooked.
+ *
+ * UnrealEditor-Cmd DaysGun.uproject -run=AnimCompressionAudit
+ *     [-Path=/Game/DaysGun/Animations/Character] [-Effectors=foot_l,foot_r,hand_l,hand_r]
+ *     [-MaxErrorCm=0.1] [-MaxCurveError=0.01] [-Only=Name,...] [-Out=Path]
+ *     [-Candidate=Name;BoneCodecClass;Property=Value,...;CurveCodecClass;Property=Value,...]
+ *     [-Apply=Name] [-SettingsPath=/Game/DaysGun/Animations/Compression]
+ *
+ * Candidates without a curve codec keep each sequence's curve settings. -Apply saves the settings of a candidate
+ * as assets under SettingsPath, assigns them to every audited sequence and saves the sequences.
+ */
+UCLASS()
+class DAYSGUN_API UAnimCompressionAuditCommandlet : public UCommandlet
+{
+	GENERATED_BODY()
+
+public:
+	UAnimCompressionAuditCommandlet();
+
+	virtual int32 Main(const FString& Params) override;
+};
@@ -0,0 +1,31 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Commandlets/Commandlet.h"
+#include "LocomotionSimCommandlet.generated.h"
+
+
+/**
+ * Drives FLocomotionDecisionCore with scripted or recorded input and simple character kinematics,
+ * far faster than real time and spread over all worker threads, then writes the state and clip timeline.
+ *
+ * UnrealEditor-Cmd DaysGun.uproject -run=LocomotionSim
+ *     [-Scenario=All|StartStop|Turns|GaitToggle|Zigzag|Reverse] [-Input=Recording.csv]
+ *     [-Set=Name=Value,...] [-Sweep=Name:Min:Max:Step] [-Runs=1] [-Noise=0] [-StepRate=60]
+ *     [-GaitProfiles=/Game/Path.Asset] [-Format=Csv|Json] [-Out=Path] [-Baseline=Path] [-AllSteps]
+ *
+ * Recorded input is a CSV with a Time,InputX,InputY,Sprint header. With -Baseline the output is compared
+ * against a previous run and the commandlet fails when any line differs.
+ */
+UCLASS()
+class DAYSGUN_API ULocomotionSimCommandlet : public UCommandlet
+{
+	GENERATED_BODY()
+
+public:
+	ULocomotionSimCommandlet();
+
+	virtual int32 Main(const FString& Params) override;
+};
@@ -0,0 +1,77 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+
+/**
+ * Registered entries in one contiguous array for per frame loops, found by key through a map of indices.
+ * Keys are raw pointers or FObjectKeys kept beside the entries, so an entry can still be found and removed
+ * after its object is gone. Removing swaps the last entry into the hole; arrays kept parallel to the entries
+ * follow with RemoveAtSwap at the same index.
+ */
+template <typename KeyType, typename EntryType>
+class TIndexedRegistry
+{
+public:
+	FORCEINLINE int32 Num() const { return Entries.Num(); }
+	FORCEINLINE bool IsValidIndex(int32 Index) const { return Entries.IsValidIndex(Index); }
+	FORCEINLINE bool Contains(const KeyType& Key) const { return Indices.Contains(Key); }
+
+	/** INDEX_NONE for keys not registered */
+	FORCEINLINE int32 Find(const KeyType& Key) const { return Indices.FindRef(Key, INDEX_NONE); }
+
+	FORCEINLINE EntryType* FindEntry(const KeyType& Key)
+	{
+		const auto Index = Find(Key);
+		return Index != INDEX_NONE ? &Entries[Index] : nullptr;
+	}
+
+	FORCEINLINE EntryType& operator[](int32 Index) { return Entries[Index]; }
+	FORCEINLINE const EntryType& operator[](int32 Index) const { return Entries[Index]; }
+	FORCEINLINE const KeyType& GetKey(int32 Index) const { return Keys[Index]; }
+
+	/** Index of the new entry, the key must not be registered yet */
+	int32 Add(const KeyType& Key, const EntryType& Entry)
+	{
+		check(!Indices.Contains(Key));
+		const auto Index = Entries.Add(Entry);
+		Keys.Add(Key);
+		Indices.Add(Key, Index);
+		return Index;
+	}
+
+	FORCEINLINE int32 Add(const KeyType& Key) { return Add(Key, EntryType()); }
+
+	void RemoveAt(int32 Index)
+	{
+		Indices.Remove(Keys[Index]);
+		Entries.RemoveAtSwap(Index, 1, false);
+		Keys.RemoveAtSwap(Index, 1, false);
+
+		if (Entries.IsValidIndex(Index))
+		{
+			Indices.Add(Keys[Index], Index);
+		}
+	}
+
+	void Reset()
+	{
+		Entries.Reset();
+		Keys.Reset();
+		Indices.Reset();
+	}
+
+	FORCEINLINE auto begin() { return Entries.begin(); }
+	FORCEINLINE auto end() { return Entries.end(); }
+	FORCEINLINE auto begin() const { return Entries.begin(); }
+	FORCEINLINE auto end() const { return Entries.end(); }
+
+private:
+	TArray<EntryType> Entries;
+
+	/** Parallel to Entries */
+	TArray<KeyType> Keys;
+	TMap<KeyType, int32> Indices;
+};
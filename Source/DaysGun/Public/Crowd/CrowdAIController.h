@@ -0,0 +1,25 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "AIController.h"
+#include "CrowdAIController.generated.h"
+
+
+/**
+ * AI controller whose possessed ABaseCharacter becomes a UCrowdSteeringSubsystem agent, MoveTo and the other
+ * path following requests work as usual but avoid the rest of the crowd.
+ */
+UCLASS()
+class DAYSGUN_API ACrowdAIController : public AAIController
+{
+	GENERATED_BODY()
+
+public:
+	ACrowdAIController(const FObjectInitializer& ObjectInitializer = FObjectInitializer::Get());
+
+protected:
+	virtual void OnPossess(APawn* InPawn) override;
+	virtual void OnUnPossess() override;
+};
@@ -0,0 +1,22 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Navigation/PathFollowingComponent.h"
+#include "CrowdPathFollowingComponent.generated.h"
+
+
+/**
+ * Hands the direction of the current path segment to UCrowdSteeringSubsystem instead of requesting the move
+ * from the movement component, so the steered result reaches the character as movement input.
+ * Pawns that are not crowd agents follow their path as usual.
+ */
+UCLASS()
+class DAYSGUN_API UCrowdPathFollowingComponent : public UPathFollowingComponent
+{
+	GENERATED_BODY()
+
+protected:
+	virtual void FollowPathSegment(float DeltaTime) override;
+};
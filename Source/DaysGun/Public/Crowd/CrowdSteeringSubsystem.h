@@ -0,0 +1,155 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Containers/IndexedRegistry.h"
+#include "Debug/SubsystemBenchmark.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "CrowdSteeringSubsystem.generated.h"
+
+
+class ABaseCharacter;
+
+
+/**
+ * Local avoidance for AI driven characters. Every frame the agents are copied into contiguous arrays, bucketed
+ * into a spatial hash and steered in parallel with a predictive time-to-collision rule, then the result is fed
+ * back as movement input. The characters move exactly like player driven ones, so the anim instance's start,
+ * stop and gait logic sees ordinary input.
+ * Agents without a desired move this frame stand still, but the others still avoid them.
+ */
+UCLASS(Config = Game)
+class DAYSGUN_API UCrowdSteeringSubsystem : public UTickableWorldSubsystem
+{
+	GENERATED_BODY()
+
+public:
+	virtual void Tick(float DeltaTime) override;
+	virtual bool IsTickable() const override;
+	virtual TStatId GetStatId() const override;
+	virtual void Deinitialize() override;
+
+	void Register(ABaseCharacter* Character);
+	void Unregister(const ABaseCharacter* Character);
+
+	FORCEINLINE bool IsAgent(const ABaseCharacter* Character) const { return Agents.Contains(Character); }
+
+	/** Wanted movement for this frame only, Direction is scaled like a stick input of at most unit length */
+	void SetDesiredMove(const ABaseCharacter* Character, const FVector& Direction);
+
+	/** Walks straight to Goal until within AcceptanceRadius, overrides desired moves meanwhile */
+	void SetGoal(const ABaseCharacter* Character, const FVector& Goal, float AcceptanceRadius = 100.f);
+	void ClearGoal(const ABaseCharacter* Character);
+
+	FORCEINLINE int32 GetNumAgents() const { return Agents.Num(); }
+
+	/** Milliseconds of the last steering update, gathering and applying input included */
+	FORCEINLINE double GetLastSteeringMs() const { return LastSteeringMs; }
+
+	/** Runs a crossing crowd of soak bots for each count in turn and logs the steering cost */
+	void StartBenchmark(const TArray<int32>& Counts, float Seconds);
+
+private:
+	/** What the steering pass reads, kept apart so the parallel loop touches as little memory as possible */
+	struct FCrowdAgentState
+	{
+		FVector2f Position = FVector2f::ZeroVector;
+		FVector2f Velocity = FVector2f::ZeroVector;
+		FVector2f DesiredVelocity = FVector2f::ZeroVector;
+		float Radius = 0.f;
+		float MaxSpeed = 0.f;
+	};
+
+	struct FCrowdAgent
+	{
+		TWeakObjectPtr<ABaseCharacter> Character;
+		FVector DesiredMove = FVector::ZeroVector;
+		FVector Goal = FVector::ZeroVector;
+		float GoalAcceptanceRadius = 0.f;
+		bool HasGoal = false;
+	};
+
+	struct FBenchmarkStep
+	{
+		int32 Agents = 0;
+		int32 Frames = 0;
+		double SteeringMs = 0.0;
+		double PeakSteeringMs = 0.0;
+		double FrameMs = 0.0;
+	};
+
+	void GatherAgents();
+	void BuildSpatialHash();
+	void SteerAgents(float DeltaTime);
+	FVector2f GetAvoidance(const FCrowdAgentState& Self, const FCrowdAgentState& Other) const;
+	void ApplySteering();
+	void RemoveAt(int32 Index);
+
+	FORCEINLINE FIntPoint GetCell(const FVector2f& Position) const
+	{
+		return FIntPoint(FMath::FloorToInt32(Position.X / NeighborRadius),
+		                 FMath::FloorToInt32(Position.Y / NeighborRadius));
+	}
+
+	FORCEINLINE uint32 GetBucket(const FIntPoint& Cell) const
+	{
+		return (static_cast<uint32>(Cell.X) * 73856093u ^ static_cast<uint32>(Cell.Y) * 19349663u) & (NumBuckets - 1);
+	}
+
+	void TickBenchmark(float DeltaTime);
+	void BeginBenchmarkStep();
+	void FinishBenchmark();
+
+private:
+	/** Agents further apart than this ignore each other, also the spatial hash cell size */
+	UPROPERTY(Config)
+	float NeighborRadius = 400.f;
+
+	UPROPERTY(Config)
+	int32 MaxNeighbors = 10;
+
+	/** Seconds ahead collisions are anticipated */
+	UPROPERTY(Config)
+	float TimeHorizon = 1.5f;
+
+	/** Extra clearance kept around capsules */
+	UPROPERTY(Config)
+	float AvoidanceMargin = 20.f;
+
+	/** Fraction of max speed steered away from a collision that is about to happen */
+	UPROPERTY(Config)
+	float AvoidanceStrength = 1.f;
+
+	/** Fraction of max speed pushing overlapping agents apart */
+	UPROPERTY(Config)
+	float SeparationStrength = 1.5f;
+
+	/** How fast the steered velocity follows its target, damps jitter in dense groups */
+	UPROPERTY(Config)
+	float SteeringResponse = 8.f;
+
+	/** Below this many agents the steering pass stays on the game thread */
+	UPROPERTY(Config)
+	int32 MinAgentsForParallel = 64;
+
+	TIndexedRegistry<const ABaseCharacter*, FCrowdAgent> Agents;
+
+	/** Parallel to Agents */
+	TArray<FCrowdAgentState> States;
+	TArray<FVector2f> SteeredVelocities;
+
+	/** Agent indices sorted by bucket, BucketStarts[Bucket] to BucketStarts[Bucket + 1] */
+	TArray<int32> SortedAgents;
+	TArray<int32> BucketStarts;
+	TArray<int32> BucketCursors;
+	TArray<uint32> AgentBuckets;
+	uint32 NumBuckets = 0;
+
+	double LastSteeringMs = 0.0;
+
+	TArray<int32> BenchmarkCounts;
+	TArray<FBenchmarkStep> BenchmarkSteps;
+	FVector BenchmarkCenter = FVector::ZeroVector;
+	FSubsystemBenchmark Benchmark;
+};
@@ -0,0 +1,53 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+
+class USoakTestSubsystem;
+
+
+/**
+ * Phase timing shared by the DaysGun.*.Benchmark commands. Each phase settles for SettleSeconds after the bots
+ * spawned or the owner switched modes, then is measured for the requested seconds. The owning subsystem ticks it,
+ * records the frames it says are measured and switches modes when a phase is done.
+ */
+struct DAYSGUN_API FSubsystemBenchmark
+{
+	/** Spawned characters and mode switches settle for this long before a phase is measured */
+	static constexpr float SettleSeconds = 2.f;
+
+	/** Game thread time of the last frame in ms, without the wait for the frame rate limit */
+	static double GetFrameMs();
+
+	/** Soak subsystem with no bots out, null while a soak run or another benchmark uses them */
+	static USoakTestSubsystem* GetIdleSoak(const UWorld* World);
+
+	/** Where benchmark bots and props go: the first player's pawn, or its camera without one */
+	static FVector GetCenter(const UWorld* World);
+
+	/** False while already running */
+	bool Start(int32 InNumPhases, float InSeconds);
+
+	/** Advances the phase clock, true once the phase has settled and this frame counts */
+	bool Tick(float DeltaTime);
+
+	FORCEINLINE bool IsPhaseDone() const { return PhaseTime >= SettleSeconds + Seconds; }
+
+	/** Restarts the clock for the next phase, false after the last one */
+	bool NextPhase();
+
+	/** Stops the run and releases the soak bots */
+	void Finish(const UWorld* World);
+
+	FORCEINLINE bool IsRunning() const { return PhaseIndex != INDEX_NONE; }
+	FORCEINLINE int32 GetPhaseIndex() const { return PhaseIndex; }
+	FORCEINLINE float GetSeconds() const { return Seconds; }
+
+private:
+	int32 NumPhases = 0;
+	int32 PhaseIndex = INDEX_NONE;
+	float Seconds = 0.f;
+	float PhaseTime = 0.f;
+};
@@ -0,0 +1,57 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Engine/DataAsset.h"
+#include "Chaos/ChaosEngineInterface.h"
+#include "FootstepEffectsAsset.generated.h"
+
+
+class USoundBase;
+class UNiagaraSystem;
+
+
+USTRUCT(BlueprintType)
+struct FFootstepSurfaceEffects
+{
+	GENERATED_BODY()
+
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "Footstep")
+	USoundBase* Sound = nullptr;
+
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "Footstep")
+	UNiagaraSystem* Effect = nullptr;
+};
+
+/** Sound and VFX to play per physical surface when a foot is planted */
+UCLASS(BlueprintType)
+class DAYSGUN_API UFootstepEffectsAsset : public UDataAsset
+{
+	GENERATED_BODY()
+
+public:
+	virtual void PostLoad() override;
+#if WITH_EDITOR
+	virtual void PostEditChangeProperty(FPropertyChangedEvent& PropertyChangedEvent) override;
+#endif
+
+	/** Constant time lookup, falls back to DefaultEffects for surfaces without an entry */
+	FORCEINLINE const FFootstepSurfaceEffects& GetEffects(EPhysicalSurface Surface) const
+	{
+		return SurfaceLookup[Surface];
+	}
+
+private:
+	void BuildSurfaceLookup();
+
+private:
+	UPROPERTY(EditAnywhere, Category = "Footstep")
+	FFootstepSurfaceEffects DefaultEffects;
+
+	UPROPERTY(EditAnywhere, Category = "Footstep")
+	TMap<TEnumAsByte<EPhysicalSurface>, FFootstepSurfaceEffects> SurfaceEffects;
+
+	/** Flattened SurfaceEffects, indexed by surface type so a step never hashes */
+	TStaticArray<FFootstepSurfaceEffects, SurfaceType_Max> SurfaceLookup;
+};
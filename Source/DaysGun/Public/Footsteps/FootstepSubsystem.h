@@ -0,0 +1,115 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "Chaos/ChaosEngineInterface.h"
+#include "Debug/SubsystemBenchmark.h"
+#include "FootstepSubsystem.generated.h"
+
+
+class ACharacter;
+class UAudioComponent;
+class UNiagaraComponent;
+class UPrimitiveComponent;
+class UFootstepEffectsAsset;
+
+
+UENUM(BlueprintType)
+enum class EFootstepFoot : uint8
+{
+	EFF_Left UMETA(DisplayName = "Left"),
+	EFF_Right UMETA(DisplayName = "Right"),
+};
+
+struct FFootstepEvent
+{
+	FVector Location = FVector::ZeroVector;
+	EPhysicalSurface Surface = SurfaceType_Default;
+	EFootstepFoot Foot = EFootstepFoot::EFF_Left;
+	const UFootstepEffectsAsset* Effects = nullptr;
+};
+
+/** Remembers the surface under a character so a new trace is only needed when the floor component changes */
+struct DAYSGUN_API FFootstepSurfaceCache
+{
+	EPhysicalSurface Resolve(const ACharacter* Character, const FVector& FootLocation, float TraceDistance);
+
+	FORCEINLINE void Invalidate()
+	{
+		FloorComponent.Reset();
+		Surface = SurfaceType_Default;
+	}
+
+private:
+	TWeakObjectPtr<const UPrimitiveComponent> FloorComponent;
+	EPhysicalSurface Surface = SurfaceType_Default;
+};
+
+/**
+ * Plays footstep audio and VFX from components created once per world.
+ * Components are reused round-robin, the oldest one is stolen when the pool is exhausted.
+ */
+UCLASS(Config = Game)
+class DAYSGUN_API UFootstepSubsystem : public UTickableWorldSubsystem
+{
+	GENERATED_BODY()
+
+public:
+	virtual bool ShouldCreateSubsystem(UObject* Outer) const override;
+	virtual void OnWorldBeginPlay(UWorld& InWorld) override;
+	virtual void Deinitialize() override;
+	virtual void Tick(float DeltaTime) override;
+	virtual bool IsTickable() const override;
+	virtual TStatId GetStatId() const override;
+
+	void PlayFootstep(const FFootstepEvent& Event);
+
+	/**
+	 * Spawns Count bots and measures Seconds of their footsteps end to end: foot phase detection in the anim update,
+	 * the surface resolve and PlayFootstep. Logs the steps, the frame time and what the path kept allocated.
+	 */
+	void StartBenchmark(int32 Count, float Seconds);
+
+	FORCEINLINE int32 GetAudioPoolSize() const { return AudioPool.Num(); }
+	FORCEINLINE int32 GetEffectPoolSize() const { return EffectPool.Num(); }
+
+private:
+	void CreatePools();
+
+	void TickBenchmark(float DeltaTime);
+	void FinishBenchmark();
+
+private:
+	UPROPERTY(Config)
+	int32 AudioPoolSize = 64;
+
+	UPROPERTY(Config)
+	int32 EffectPoolSize = 64;
+
+	/** Owns the pooled components */
+	UPROPERTY(Transient)
+	AActor* PoolOwner;
+
+	UPROPERTY(Transient)
+	TArray<UAudioComponent*> AudioPool;
+
+	UPROPERTY(Transient)
+	TArray<UNiagaraComponent*> EffectPool;
+
+	int32 NextAudio = 0;
+	int32 NextEffect = 0;
+
+	FSubsystemBenchmark Benchmark;
+	int32 BenchmarkBots = 0;
+
+	/** INDEX_NONE until the first settled frame took the memory baseline */
+	int32 BenchmarkFrames = INDEX_NONE;
+	int32 BenchmarkSteps = 0;
+	double BenchmarkFrameMs = 0.0;
+	int64 BenchmarkStartBytes = 0;
+
+	/** Steps played since the last tick, the anim updates that play them tick before the subsystem */
+	int32 PendingSteps = 0;
+};
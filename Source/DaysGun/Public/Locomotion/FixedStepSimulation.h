@@ -0,0 +1,158 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "FixedStepSimulation.generated.h"
+
+
+USTRUCT(BlueprintType)
+struct DAYSGUN_API FFixedStepSettings
+{
+	GENERATED_BODY()
+
+	/** Simulate locomotion at StepRate instead of once per rendered frame */
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "FixedStep")
+	bool UseFixedStep = false;
+
+	/** Simulation steps per second */
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "FixedStep", meta = (ClampMin = "1", EditCondition = "UseFixedStep"))
+	float StepRate = 30.f;
+
+	/** Steps beyond this are dropped so a long hitch can't snowball into a longer one */
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "FixedStep", meta = (ClampMin = "1", EditCondition = "UseFixedStep"))
+	int32 MaxStepsPerFrame = 8;
+
+	FORCEINLINE float GetStepDeltaSeconds() const
+	{
+		return 1.f / FMath::Max(StepRate, 1.f);
+	}
+};
+
+/** Turns variable frame times into a whole number of fixed steps plus a render interpolation alpha */
+struct FFixedStepAccumulator
+{
+	/** Adds the frame time and returns how many fixed steps should be simulated */
+	FORCEINLINE int32 Advance(float DeltaSeconds, const FFixedStepSettings& Settings)
+	{
+		StepDeltaSeconds = Settings.GetStepDeltaSeconds();
+		FrameStartAccumulated = Accumulated;
+		FrameDeltaSeconds = DeltaSeconds;
+		Accumulated += DeltaSeconds;
+
+		int32 Steps = 0;
+		while (Accumulated >= StepDeltaSeconds && Steps < Settings.MaxStepsPerFrame)
+		{
+			Accumulated -= StepDeltaSeconds;
+			++Steps;
+		}
+
+		if (Accumulated >= StepDeltaSeconds)
+		{
+			Accumulated = FMath::Fmod(Accumulated, StepDeltaSeconds);
+		}
+
+		return Steps;
+	}
+
+	/** Fraction of a step elapsed since the last simulated step, used to blend previous and current results */
+	FORCEINLINE float GetAlpha() const
+	{
+		return StepDeltaSeconds > 0.0 ? static_cast<float>(Accumulated / StepDeltaSeconds) : 1.f;
+	}
+
+	/**
+	 * Where the end of the given step of the last Advance falls within its frame, 0 at the previous frame and 1 at
+	 * this one. Used to interpolate per frame samples to each step.
+	 */
+	FORCEINLINE float GetStepFrameAlpha(int32 Step) const
+	{
+		if (FrameDeltaSeconds <= 0.0) return 1.f;
+
+		const auto StepEnd = (Step + 1) * StepDeltaSeconds - FrameStartAccumulated;
+		return FMath::Clamp(static_cast<float>(StepEnd / FrameDeltaSeconds), 0.f, 1.f);
+	}
+
+	FORCEINLINE void Reset()
+	{
+		Accumulated = 0.0;
+		FrameStartAccumulated = 0.0;
+		FrameDeltaSeconds = 0.0;
+	}
+
+private:
+	/** Kept in double so long sessions don't drift between different frame rates */
+	double Accumulated = 0.0;
+	double StepDeltaSeconds = 0.0;
+
+	/** Accumulated before and frame time added by the last Advance */
+	double FrameStartAccumulated = 0.0;
+	double FrameDeltaSeconds = 0.0;
+};
+
+/** Movement component state, sampled once per rendered frame and interpolated to each fixed step */
+struct FLocomotionMovementSample
+{
+	FVector Location = FVector::ZeroVector;
+	FVector Velocity = FVector::ZeroVector;
+	FVector InputVector = FVector::ZeroVector;
+
+	/** The movement component's current acceleration, not the finite difference of Velocity */
+	FVector Acceleration = FVector::ZeroVector;
+
+	FRotator ActorRotation = FRotator::ZeroRotator;
+	float MaxSpeed = 0.f;
+	bool IsFalling = false;
+
+	static FORCEINLINE FLocomotionMovementSample Interpolate(const FLocomotionMovementSample& From,
+	                                                         const FLocomotionMovementSample& To, float Alpha)
+	{
+		FLocomotionMovementSample Result;
+		Result.Location = FMath::Lerp(From.Location, To.Location, Alpha);
+		Result.Velocity = FMath::Lerp(From.Velocity, To.Velocity, Alpha);
+		Result.InputVector = FMath::Lerp(From.InputVector, To.InputVector, Alpha);
+		Result.Acceleration = FMath::Lerp(From.Acceleration, To.Acceleration, Alpha);
+		Result.ActorRotation = FMath::Lerp(From.ActorRotation, To.ActorRotation, Alpha);
+		Result.MaxSpeed = FMath::Lerp(From.MaxSpeed, To.MaxSpeed, Alpha);
+
+		// Falling has no in between, a step sees it once the frame that started it does
+		Result.IsFalling = To.IsFalling;
+		return Result;
+	}
+};
+
+/** What one step of the cycle and start rotation reads, recorded during the update for the post-evaluate rotation */
+struct FLocomotionRotationStep
+{
+	float VelocityYaw = 0.f;
+	float InputVectorRotationRate = 0.f;
+};
+
+/** Locomotion values read by the anim graph that are blended between fixed steps for rendering */
+struct FLocomotionVisualOutputs
+{
+	float LeanX = 0.f;
+	float LeanY = 0.f;
+	float AimYaw = 0.f;
+	float AimPitch = 0.f;
+	float PlayRate = 0.f;
+	float StrideScale = 1.f;
+
+	static FORCEINLINE float LerpAngle(float From, float To, float Alpha)
+	{
+		return From + FMath::FindDeltaAngleDegrees(From, To) * Alpha;
+	}
+
+	static FORCEINLINE FLocomotionVisualOutputs Interpolate(const FLocomotionVisualOutputs& From,
+	                                                        const FLocomotionVisualOutputs& To, float Alpha)
+	{
+		FLocomotionVisualOutputs Result;
+		Result.LeanX = FMath::Lerp(From.LeanX, To.LeanX, Alpha);
+		Result.LeanY = FMath::Lerp(From.LeanY, To.LeanY, Alpha);
+		Result.AimYaw = LerpAngle(From.AimYaw, To.AimYaw, Alpha);
+		Result.AimPitch = LerpAngle(From.AimPitch, To.AimPitch, Alpha);
+		Result.PlayRate = FMath::Lerp(From.PlayRate, To.PlayRate, Alpha);
+		Result.StrideScale = FMath::Lerp(From.StrideScale, To.StrideScale, Alpha);
+		return Result;
+	}
+};
@@ -0,0 +1,125 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Curves/CurveFloat.h"
+#include "Engine/DataAsset.h"
+#include "Locomotion/LocomotionDecisionCore.h"
+#include "GaitProfileSet.generated.h"
+
+
+UENUM(BlueprintType)
+enum class EGait : uint8
+{
+	EG_Walk UMETA(DisplayName = "Walk"),
+	EG_Jog UMETA(DisplayName = "Jog"),
+	EG_Run UMETA(DisplayName = "Run"),
+	EG_Sprint UMETA(DisplayName = "Sprint"),
+	EG_Crouch UMETA(DisplayName = "Crouch"),
+	EG_Num UMETA(Hidden),
+};
+
+USTRUCT(BlueprintType)
+struct FGaitProfile
+{
+	GENERATED_BODY()
+
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "Gait")
+	float MaxSpeed = 175.f;
+
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "Gait")
+	float MaxAcceleration = 150.f;
+
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "Gait")
+	float BrakingDeceleration = 2048.f;
+
+	/** Seconds it takes to blend into this gait from any other */
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "Gait", meta = (ClampMin = "0"))
+	float BlendDuration = 0.5f;
+
+	/** Anim locomotion state this gait moves in, used to derive the anim instance speed thresholds */
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "Gait")
+	ELocomotionState LocomotionState = ELocomotionState::ELS_Walk;
+
+	/** Blend weight over normalized blend time for speed, ease-out when left empty */
+	UPROPERTY(EditAnywhere, Category = "Gait|Curves")
+	FRuntimeFloatCurve SpeedCurve;
+
+	/** Blend weight over normalized blend time for acceleration, ease-out when left empty */
+	UPROPERTY(EditAnywhere, Category = "Gait|Curves")
+	FRuntimeFloatCurve AccelerationCurve;
+
+	/** Blend weight over normalized blend time for braking, ease-out when left empty */
+	UPROPERTY(EditAnywhere, Category = "Gait|Curves")
+	FRuntimeFloatCurve BrakingCurve;
+};
+
+/** Curve baked into evenly spaced samples so a blend step is one lerp instead of a key search */
+struct FGaitCurveLUT
+{
+	static constexpr int32 NumSamples = 32;
+
+	void Build(const FRuntimeFloatCurve& Curve);
+
+	FORCEINLINE float Evaluate(float Alpha) const
+	{
+		const auto Position = FMath::Clamp(Alpha, 0.f, 1.f) * (NumSamples - 1);
+		const auto Index = FMath::Min(static_cast<int32>(Position), NumSamples - 2);
+		return FMath::Lerp(Samples[Index], Samples[Index + 1], Position - Index);
+	}
+
+private:
+	float Samples[NumSamples] = {};
+};
+
+struct FGaitRuntimeProfile
+{
+	float MaxSpeed = 0.f;
+	float MaxAcceleration = 0.f;
+	float BrakingDeceleration = 0.f;
+	float BlendDuration = 0.f;
+
+	FGaitCurveLUT SpeedLUT;
+	FGaitCurveLUT AccelerationLUT;
+	FGaitCurveLUT BrakingLUT;
+};
+
+/** Speed, acceleration and braking for every gait a character can move in */
+UCLASS(BlueprintType)
+class DAYSGUN_API UGaitProfileSet : public UDataAsset
+{
+	GENERATED_BODY()
+
+public:
+	UGaitProfileSet();
+
+	virtual void PostInitProperties() override;
+	virtual void PostLoad() override;
+#if WITH_EDITOR
+	virtual void PostEditChangeProperty(FPropertyChangedEvent& PropertyChangedEvent) override;
+#endif
+
+	FORCEINLINE const FGaitRuntimeProfile& GetRuntimeProfile(EGait Gait) const
+	{
+		return RuntimeProfiles[static_cast<int32>(Gait)];
+	}
+
+	/** Lowest MaxSpeed among the gaits that move in LocomotionState, or among all gaits when none does */
+	float GetMinSpeedForState(ELocomotionState LocomotionState) const;
+
+	/** Lowest MaxSpeed of any gait */
+	float GetMinSpeed() const;
+
+	/** Slowest standing gait fast enough for Speed, for when only the velocity of a character is known */
+	EGait GetGaitForSpeed(float Speed, bool Crouched) const;
+
+private:
+	void BuildRuntimeProfiles();
+
+private:
+	UPROPERTY(EditAnywhere, Category = "Gait", meta = (ArraySizeEnum = "EGait"))
+	FGaitProfile Profiles[(int32)EGait::EG_Num];
+
+	FGaitRuntimeProfile RuntimeProfiles[static_cast<int32>(EGait::EG_Num)];
+};
@@ -0,0 +1,116 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Engine/DataAsset.h"
+#include "Locomotion/LocomotionDecisionCore.h"
+#include "GaitTransitionEntryTable.generated.h"
+
+
+class UAnimSequence;
+
+
+/** Which transition clip to play and where to enter it */
+USTRUCT()
+struct FGaitTransitionEntry
+{
+	GENERATED_BODY()
+
+	UPROPERTY(VisibleAnywhere, Category = "Entry")
+	ELocomotionClip Clip = ELocomotionClip::ELC_None;
+
+	UPROPERTY(VisibleAnywhere, Category = "Entry")
+	float StartTime = 0.f;
+};
+
+/**
+ * Gait transition entry points matched offline to the pose of the cycle being left. For each foot phase bin of the
+ * walk and run cycles the build samples the cycle pose at that phase and searches the entry window of both
+ * transition clips for the closest pose, compared by the root relative positions of MatchBones and by foot phase.
+ * At runtime the current cycle phase picks the clip and start time with one array lookup.
+ * Built again whenever the asset is saved or cooked, or with Build in the editor.
+ */
+UCLASS(BlueprintType)
+class DAYSGUN_API UGaitTransitionEntryTable : public UDataAsset
+{
+	GENERATED_BODY()
+
+public:
+#if WITH_EDITOR
+	virtual void PreSave(FObjectPreSaveContext SaveContext) override;
+
+	/** Rebuilds as an undoable edit and marks the asset dirty */
+	UFUNCTION(CallInEditor, Category = "Build")
+	void Build();
+#endif
+
+	FORCEINLINE bool IsBuilt() const { return WalkToRunEntries.Num() > 0 && RunToWalkEntries.Num() > 0; }
+
+	/** FootPhase is the cycle's MoveData_FootPhase, wrapped into [0, 1) */
+	FORCEINLINE const FGaitTransitionEntry& Find(bool WalkToRun, float FootPhase) const
+	{
+		const auto& Entries = WalkToRun ? WalkToRunEntries : RunToWalkEntries;
+		const auto Bin = static_cast<int32>(FMath::Frac(FootPhase) * Entries.Num());
+		return Entries[FMath::Min(Bin, Entries.Num() - 1)];
+	}
+
+	FORCEINLINE int32 GetNumPhaseBins() const { return WalkToRunEntries.Num(); }
+	FORCEINLINE float GetBuildMs() const { return BuildMs; }
+
+private:
+#if WITH_EDITOR
+	/** False with the table left as it was when a source clip is missing */
+	bool Rebuild();
+
+	bool BuildEntries(UAnimSequence* Cycle, UAnimSequence* LeftFootClip, ELocomotionClip LeftFoot,
+	                  UAnimSequence* RightFootClip, ELocomotionClip RightFoot,
+	                  TArray<FGaitTransitionEntry>& OutEntries);
+#endif
+
+private:
+	UPROPERTY(EditAnywhere, Category = "Source")
+	UAnimSequence* WalkCycle;
+
+	UPROPERTY(EditAnywhere, Category = "Source")
+	UAnimSequence* RunCycle;
+
+	UPROPERTY(EditAnywhere, Category = "Source")
+	UAnimSequence* WalkToRunLF;
+
+	UPROPERTY(EditAnywhere, Category = "Source")
+	UAnimSequence* WalkToRunRF;
+
+	UPROPERTY(EditAnywhere, Category = "Source")
+	UAnimSequence* RunToWalkLF;
+
+	UPROPERTY(EditAnywhere, Category = "Source")
+	UAnimSequence* RunToWalkRF;
+
+	UPROPERTY(EditAnywhere, Category = "Analysis")
+	FName FootPhaseCurveName = "MoveData_FootPhase";
+
+	UPROPERTY(EditAnywhere, Category = "Analysis")
+	TArray<FName> MatchBones = {"foot_l", "foot_r", "pelvis"};
+
+	UPROPERTY(EditAnywhere, Category = "Analysis")
+	int32 NumPhaseBins = 32;
+
+	/** Fraction of each transition clip searched for an entry, later frames are already in the new gait */
+	UPROPERTY(EditAnywhere, Category = "Analysis")
+	float EntryWindow = 0.5f;
+
+	/** Cost of a full foot phase cycle of difference against a squared centimeter of bone distance */
+	UPROPERTY(EditAnywhere, Category = "Analysis")
+	float FootPhaseWeight = 2500.f;
+
+	UPROPERTY(VisibleAnywhere, Category = "Table")
+	TArray<FGaitTransitionEntry> WalkToRunEntries;
+
+	UPROPERTY(VisibleAnywhere, Category = "Table")
+	TArray<FGaitTransitionEntry> RunToWalkEntries;
+
+	/** Milliseconds the last build took, sampling included */
+	UPROPERTY(VisibleAnywhere, Category = "Table")
+	float BuildMs = 0.f;
+};
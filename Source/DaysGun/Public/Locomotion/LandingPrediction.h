@@ -0,0 +1,130 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "WorldCollision.h"
+
+
+class ACharacter;
+
+
+/** Where and when an airborne character is expected to touch down */
+struct FLandingPoint
+{
+	/** Actor location at touch down */
+	FVector Location = FVector::ZeroVector;
+	FVector ImpactNormal = FVector::UpVector;
+	FVector Velocity = FVector::ZeroVector;
+
+	/** World time of the touch down */
+	double Time = 0.0;
+
+	bool Valid = false;
+};
+
+/**
+ * Fall from a start location and velocity as UCharacterMovementComponent::PhysFalling moves it while the input is
+ * held: gravity plus the air control share of the input acceleration, until the lateral speed reaches the max
+ * speed. The air control boost at low lateral speeds is left out.
+ */
+struct FBallisticArc
+{
+	FVector Location = FVector::ZeroVector;
+	FVector Velocity = FVector::ZeroVector;
+	FVector Gravity = FVector::ZeroVector;
+
+	/** Lateral acceleration from air control, applied for AirControlSeconds */
+	FVector AirAcceleration = FVector::ZeroVector;
+	float AirControlSeconds = 0.f;
+
+	double StartTime = 0.0;
+
+	/** AirControlSeconds for a lateral speed clamped to MaxSpeed */
+	void SetAirControl(const FVector& InAirAcceleration, float MaxSpeed);
+
+	FORCEINLINE FVector GetLocation(float Seconds) const
+	{
+		const auto AirSeconds = FMath::Min(Seconds, AirControlSeconds);
+		return Location + Velocity * Seconds + 0.5f * Gravity * FMath::Square(Seconds) +
+			AirAcceleration * (AirSeconds * (Seconds - 0.5f * AirSeconds));
+	}
+
+	FORCEINLINE FVector GetVelocity(float Seconds) const
+	{
+		return Velocity + Gravity * Seconds + AirAcceleration * FMath::Min(Seconds, AirControlSeconds);
+	}
+};
+
+/** Settings for FLandingPredictor, owned by whoever drives it */
+struct FLandingPredictionParams
+{
+	/** The arc is swept this far ahead, a fall that takes longer is predicted again when it runs out */
+	float MaxSeconds = 2.f;
+
+	/** Capsule sweeps the arc is split into, all issued in one batch */
+	int32 NumSegments = 8;
+
+	/** Velocity difference from the arc in cm/s, e.g. from a new input direction or a hit, that predicts again */
+	float VelocityTolerance = 50.f;
+};
+
+/**
+ * Predicts the landing of an airborne character once at take-off with one batch of async capsule sweeps along
+ * its ballistic arc, and again only when the character's velocity leaves the arc. Results come back through
+ * the world's async trace queue the next frame, nothing traces or polls in between.
+ * Sweeps, refreshes and the landing time error are counted for DaysGun.Landing.Stats.
+ */
+class DAYSGUN_API FLandingPredictor
+{
+public:
+	/** Owner keeps the trace callbacks from outliving this predictor */
+	void Start(UObject* Owner, const ACharacter& Character, const FLandingPredictionParams& Params);
+
+	/** Checks the character against the arc, call every step while airborne */
+	void Update(UObject* Owner, const ACharacter& Character, const FLandingPredictionParams& Params,
+	            float DeltaSeconds);
+
+	/** Landed tells whether the character touched down at Now, which is checked against the prediction */
+	void Stop(bool Landed, double Now);
+
+	/** False while DaysGun.Landing.Reactive plays land animations at touch down instead, the baseline for stats */
+	static bool IsPredictionEnabled();
+
+	/** How far the land animation's impact frame played from the actual touch down, for DaysGun.Landing.Stats */
+	static void RecordImpactFrameError(float Seconds);
+
+	FORCEINLINE const FLandingPoint& GetLanding() const { return Landing; }
+	FORCEINLINE const FBallisticArc& GetArc() const { return Arc; }
+	FORCEINLINE bool IsActive() const { return Active; }
+
+private:
+	enum class ESegmentResult : uint8
+	{
+		Pending,
+		Miss,
+		Hit,
+	};
+
+	struct FSegment
+	{
+		ESegmentResult Result = ESegmentResult::Pending;
+		float HitTime = 0.f;
+		FVector Location = FVector::ZeroVector;
+		FVector ImpactNormal = FVector::UpVector;
+	};
+
+	void Predict(UObject* Owner, const ACharacter& Character, const FLandingPredictionParams& Params);
+	void OnSweepDone(const FTraceHandle& Handle, FTraceDatum& Datum);
+	void ResolveLanding();
+
+private:
+	FBallisticArc Arc;
+	FLandingPoint Landing;
+	TArray<FSegment, TInlineAllocator<16>> Segments;
+	float SegmentSeconds = 0.f;
+
+	/** Sweeps of an older prediction still in flight are ignored */
+	uint32 Generation = 0;
+	bool Active = false;
+};
@@ -0,0 +1,195 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "LocomotionDecisionCore.generated.h"
+
+
+UENUM(BlueprintType)
+enum class ELocomotionState : uint8
+{
+	ELS_Idle UMETA(DisplayName = "Idle"),
+	ELS_Walk UMETA(DisplayName = "Walk"),
+	ELS_Run UMETA(DisplayName = "Run"),
+	ELS_Crouch UMETA(DisplayName = "Crouch"),
+	ELS_Jump UMETA(DisplayName = "Jump"),
+};
+
+/** Clip choices made by the decision logic, mapped to actual sequences by whoever plays them */
+UENUM(BlueprintType)
+enum class ELocomotionClip : uint8
+{
+	ELC_None UMETA(DisplayName = "None"),
+	ELC_WalkStartF UMETA(DisplayName = "Walk Start F"),
+	ELC_WalkStart90L UMETA(DisplayName = "Walk Start 90L"),
+	ELC_WalkStart180L UMETA(DisplayName = "Walk Start 180L"),
+	ELC_WalkStart90R UMETA(DisplayName = "Walk Start 90R"),
+	ELC_WalkStart180R UMETA(DisplayName = "Walk Start 180R"),
+	ELC_RunStartF UMETA(DisplayName = "Run Start F"),
+	ELC_RunStart90L UMETA(DisplayName = "Run Start 90L"),
+	ELC_RunStart180L UMETA(DisplayName = "Run Start 180L"),
+	ELC_RunStart90R UMETA(DisplayName = "Run Start 90R"),
+	ELC_RunStart180R UMETA(DisplayName = "Run Start 180R"),
+	ELC_WalkToRunLF UMETA(DisplayName = "Walk To Run LF"),
+	ELC_WalkToRunRF UMETA(DisplayName = "Walk To Run RF"),
+	ELC_RunToWalkLF UMETA(DisplayName = "Run To Walk LF"),
+	ELC_RunToWalkRF UMETA(DisplayName = "Run To Walk RF"),
+	ELC_WalkStop UMETA(DisplayName = "Walk Stop"),
+	ELC_RunStop UMETA(DisplayName = "Run Stop"),
+};
+
+struct OnEntryFlags
+{
+	bool IdleFlag = true;
+	bool WalkFlag = false;
+	bool RunFlag = false;
+	bool CrouchFlag = false;
+	bool JumpFlag = false;
+};
+
+/** What happened during one decision step */
+enum class ELocomotionDecisionEvents : uint8
+{
+	None = 0,
+	StopSelected = 1 << 0,
+	StartSelected = 1 << 1,
+	GaitTransitionSelected = 1 << 2,
+	StateEntered = 1 << 3,
+};
+ENUM_CLASS_FLAGS(ELocomotionDecisionEvents);
+
+/** Thresholds the decision logic is tuned with */
+struct FLocomotionDecisionParams
+{
+	float MinTimeInLocomotionState = 0.15f;
+	float MinTimeGaitTransitionAnim = 1.f;
+
+	float RunMinCurrentSpeed = 1.f;
+	float RunMinMaxSpeed = 300.f;
+	float RunMinInputAcceleration = 0.5f;
+
+	float WalkMinCurrentSpeed = 1.f;
+	float WalkMinMaxSpeed = 0.f;
+	float WalkMinInputAcceleration = 0.01f;
+
+	float MaxSpeedForPlayingStartAnim = 150.f;
+	float RunStopSpeedLimit = 200.f;
+	float MoveDataLeftFootPhaseLimit = 0.5f;
+
+	/** Above this ground speed the start angle is measured from input instead of velocity */
+	float StartAngleInputMinSpeed = 15.f;
+
+	/** Seconds of trajectory history the input rotation rate, lean and stop speed are measured over */
+	float TrajectoryRateWindow = 0.1f;
+
+	/** Start angles point where the trajectory is predicted to be this many seconds ahead */
+	float StartPredictionSeconds = 0.2f;
+
+	/** Input rotation rate (deg/s) at which the rotation rate maps reach their maximum */
+	float RotationRateInputRange = 200.f;
+	float ConstRotationRateMin = 500.f;
+	float ConstRotationRateMax = 2000.f;
+	float SmoothRotationRateMin = 5.f;
+	float SmoothRotationRateMax = 15.f;
+};
+
+/** Movement data sampled for one decision step */
+struct FLocomotionDecisionInput
+{
+	float DeltaSeconds = 0.f;
+	float GroundSpeed = 0.f;
+	float MaxSpeed = 0.f;
+	float InputSize = 0.f;
+
+	/** Dot product of the normalized velocity and the normalized movement component acceleration */
+	float VelocityAccelerationDot = 0.f;
+
+	float ActorYaw = 0.f;
+	float InputYaw = 0.f;
+	float VelocityYaw = 0.f;
+
+	bool IsFalling = false;
+	bool StartedJumping = false;
+};
+
+/** Values only asked for when a decision needs them, since they can be expensive to produce */
+class ILocomotionDecisionQueries
+{
+public:
+	virtual ~ILocomotionDecisionQueries() = default;
+
+	virtual bool IsInWalkStartState() = 0;
+	virtual float GetFootPhase() = 0;
+
+	/** Yaw towards where the trajectory is predicted Seconds ahead, false while no move is predicted */
+	virtual bool GetPredictedHeading(float Seconds, float& OutYaw) = 0;
+
+	/** Ground speed averaged over the last Window seconds of trajectory */
+	virtual float GetAverageGroundSpeed(float Window) = 0;
+};
+
+/**
+ * Locomotion state machine and clip selection without any engine animation dependency,
+ * shared by UPlayerAnimInstance and the offline locomotion simulator.
+ */
+class DAYSGUN_API FLocomotionDecisionCore
+{
+public:
+	void Reset();
+
+	ELocomotionDecisionEvents Step(const FLocomotionDecisionInput& Input, const FLocomotionDecisionParams& Params,
+	                               ILocomotionDecisionQueries& Queries);
+
+	FORCEINLINE ELocomotionState GetLocomotionState() const { return LocomotionState; }
+	FORCEINLINE ELocomotionState GetPrevLocomotionState() const { return PrevLocomotionState; }
+	FORCEINLINE float GetTimeInLocomotionState() const { return TimeInLocomotionState; }
+	FORCEINLINE float GetStartAngle() const { return StartAngle; }
+
+	FORCEINLINE ELocomotionClip GetStopClip() const { return StopClip; }
+	FORCEINLINE ELocomotionClip GetStartClip() const { return StartClip; }
+	FORCEINLINE ELocomotionClip GetGaitTransitionClip() const { return GaitTransitionClip; }
+
+	static ELocomotionClip SelectStartClip(float Angle, bool Run);
+	static ELocomotionClip SelectTransitionClip(float FootPhase, bool WalkToRun, const FLocomotionDecisionParams& DecisionParams);
+	static float CalculateConstRotationRate(float InputVectorRotationRate, const FLocomotionDecisionParams& DecisionParams);
+	static float CalculateSmoothRotationRate(float InputVectorRotationRate, const FLocomotionDecisionParams& DecisionParams);
+
+	/** One step of the cycle and start rotation: TargetYaw chases VelocityYaw, SmoothedYaw eases after it */
+	static void AdvanceTargetYaw(float VelocityYaw, float InputVectorRotationRate, float DeltaSeconds,
+	                             const FLocomotionDecisionParams& DecisionParams, float& TargetYaw, float& SmoothedYaw);
+
+private:
+	void DetermineLocomotionState();
+	void DetermineGroundLocomotionState();
+	void TrackLocomotionStates();
+
+	FORCEINLINE bool IsMovementWithinThresholds(float MinCurrentSpeed, float MinMaxSpeed,
+	                                            float MinInputAcceleration) const;
+
+	FORCEINLINE void TrackLocomotionState(ELocomotionState TracedState, bool& EnterFlag,
+	                                      void (FLocomotionDecisionCore::*OnEnterCallback)());
+
+	void UpdateStartAngle();
+
+	void OnEntryIdle();
+	void OnEntryWalk();
+	void OnEntryRun();
+
+private:
+	ELocomotionState LocomotionState = ELocomotionState::ELS_Idle;
+	ELocomotionState PrevLocomotionState = ELocomotionState::ELS_Idle;
+	float TimeInLocomotionState = 0.f;
+	float StartAngle = 0.f;
+	OnEntryFlags EntryFlags;
+
+	ELocomotionClip StopClip = ELocomotionClip::ELC_None;
+	ELocomotionClip StartClip = ELocomotionClip::ELC_None;
+	ELocomotionClip GaitTransitionClip = ELocomotionClip::ELC_None;
+
+	/** Only valid during Step */
+	const FLocomotionDecisionInput* Input = nullptr;
+	const FLocomotionDecisionParams* Params = nullptr;
+	ILocomotionDecisionQueries* Queries = nullptr;
+	ELocomotionDecisionEvents Events = ELocomotionDecisionEvents::None;
+};
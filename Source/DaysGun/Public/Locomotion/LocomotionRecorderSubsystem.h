@@ -0,0 +1,142 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Containers/IndexedRegistry.h"
+#include "Debug/SubsystemBenchmark.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "Trace/Trace.h"
+#include "UObject/ObjectKey.h"
+#include "Locomotion/LocomotionDecisionCore.h"
+#include "LocomotionRecorderSubsystem.generated.h"
+
+
+class UPlayerAnimInstance;
+
+/** Enable with -trace=default,DaysGunLocomotion to stream decision frames into an Insights session */
+UE_TRACE_CHANNEL_EXTERN(DaysGunLocomotionChannel, DAYSGUN_API);
+
+
+/** Inputs behind one locomotion decision step */
+struct FLocomotionRecord
+{
+	double Time = 0.0;
+	uint32 FrameNumber = 0;
+
+	float StartAngle = 0.f;
+	float GroundSpeed = 0.f;
+	float VelocityAccelerationDot = 0.f;
+	float TimeInLocomotionState = 0.f;
+	float FootPhase = 0.f;
+
+	ELocomotionState LocomotionState = ELocomotionState::ELS_Idle;
+	ELocomotionDecisionEvents Events = ELocomotionDecisionEvents::None;
+
+	/** Clip this step started playing, ELC_None unless Events has a selection */
+	ELocomotionClip Clip = ELocomotionClip::ELC_None;
+};
+
+/**
+ * Records the locomotion decision inputs of every UPlayerAnimInstance into one buffer allocated when a capture
+ * starts, MaxCharacters tracks of FramesPerCharacter steps each, so memory stays bounded however long it runs.
+ * Each track overwrites its oldest steps. Outside a capture recording costs one branch per decision step.
+ * The same frames go to the DaysGunLocomotion trace channel, DaysGunEditor reads them into a Rewind Debugger
+ * track on each anim instance that scrubs with the rest of the recording.
+ * Capture during a playtest with -DaysGunLocomotionRecorder, scrub with DaysGun.LocoRecorder.Scrub.
+ * DaysGun.LocoRecorder.Benchmark measures the capture and trace cost against BudgetMs with 100 characters by
+ * default and saves the numbers to Saved/LocomotionRecorder.
+ */
+UCLASS(Config = Game)
+class DAYSGUN_API ULocomotionRecorderSubsystem : public UTickableWorldSubsystem
+{
+	GENERATED_BODY()
+
+public:
+	virtual void Initialize(FSubsystemCollectionBase& Collection) override;
+	virtual void Tick(float DeltaTime) override;
+	virtual bool IsTickable() const override;
+	virtual TStatId GetStatId() const override;
+
+	FORCEINLINE bool ShouldRecord() const
+	{
+		return Capturing || UE_TRACE_CHANNELEXPR_IS_ENABLED(DaysGunLocomotionChannel);
+	}
+
+	void Record(const UPlayerAnimInstance* AnimInstance, const FLocomotionRecord& InRecord);
+
+	/** Drops the previous capture */
+	void StartCapture();
+	void StopCapture();
+
+	/** Logs the steps of a character within Window seconds of SecondsAgo, decision points inline */
+	void PrintScrub(const FString& Character, float SecondsAgo, float Window) const;
+
+	/** Logs every decision point of a character, or of all characters for an empty name */
+	void PrintDecisions(const FString& Character) const;
+
+	void PrintStatus() const;
+
+	/** Spawns Count bots and compares Seconds without capture, with capture and with capture and trace */
+	void StartBenchmark(int32 Count, float Seconds);
+
+protected:
+	virtual bool DoesSupportWorldType(const EWorldType::Type WorldType) const override;
+
+private:
+	struct FTrack
+	{
+		TWeakObjectPtr<const UPlayerAnimInstance> AnimInstance;
+		FString Name;
+
+		/** First slot of this track's slice of Records */
+		int32 FirstSlot = 0;
+
+		/** Slot of the newest record within the slice */
+		int32 Head = -1;
+		int32 Count = 0;
+	};
+
+	struct FBenchmarkPhase
+	{
+		int32 Frames = 0;
+		double FrameMs = 0.0;
+		uint64 RecordCycles = 0;
+		int64 NumRecords = 0;
+	};
+
+	const FLocomotionRecord& GetRecord(const FTrack& Track, int32 Age) const;
+	const FTrack* FindTrack(const FString& Character) const;
+	void PrintRecord(const FLocomotionRecord& Record, const TCHAR* Marker) const;
+
+	void FinishBenchmark();
+
+private:
+	UPROPERTY(Config)
+	int32 MaxCharacters = 128;
+
+	/** 20 seconds at 60 decision steps per second, 40 bytes each */
+	UPROPERTY(Config)
+	int32 FramesPerCharacter = 1200;
+
+	/** Game thread time recording may take per frame, checked by the benchmark */
+	UPROPERTY(Config)
+	float BudgetMs = 0.05f;
+
+	TArray<FLocomotionRecord> Records;
+	TIndexedRegistry<FObjectKey, FTrack> Tracks;
+
+	/** Characters that found every track taken, remembered so each is counted once */
+	TSet<FObjectKey> Dropped;
+
+	bool Capturing = false;
+
+	uint64 RecordCycles = 0;
+	int64 NumRecords = 0;
+
+	FSubsystemBenchmark Benchmark;
+	FBenchmarkPhase BenchmarkPhases[3];
+
+	/** Trace channel state before the benchmark turned it on */
+	bool WasTracing = false;
+};
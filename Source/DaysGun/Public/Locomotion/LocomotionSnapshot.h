@@ -0,0 +1,38 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Locomotion/LocomotionDecisionCore.h"
+
+
+/**
+ * Immutable copy of one character's locomotion data for a completed frame.
+ * Cache line aligned so anim instances publishing from different threads never share a line.
+ */
+struct alignas(PLATFORM_CACHE_LINE_SIZE) FLocomotionSnapshot
+{
+	FVector Location = FVector::ZeroVector;
+	FVector Velocity = FVector::ZeroVector;
+	FVector Acceleration = FVector::ZeroVector;
+
+	float GroundSpeed = 0.f;
+	float MaxSpeed = 0.f;
+	float ActorYaw = 0.f;
+	float LeanX = 0.f;
+	float LeanY = 0.f;
+	float AimYaw = 0.f;
+	float AimPitch = 0.f;
+	float PlayRate = 0.f;
+	float TimeInLocomotionState = 0.f;
+
+	/** GFrameCounter of the update that produced this snapshot */
+	uint64 FrameNumber = 0;
+
+	ELocomotionState LocomotionState = ELocomotionState::ELS_Idle;
+	ELocomotionState PrevLocomotionState = ELocomotionState::ELS_Idle;
+	bool IsFalling = false;
+
+	/** False for free registry slots */
+	bool Active = false;
+};
@@ -0,0 +1,107 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "Locomotion/LocomotionSnapshot.h"
+#include <atomic>
+#include "LocomotionSnapshotSubsystem.generated.h"
+
+
+class ULocomotionSnapshotSubsystem;
+
+/**
+ * Pins the front buffer of a ULocomotionSnapshotSubsystem for as long as it lives, the flip never writes into a
+ * pinned buffer. Can be created on any thread. Readers kept past the next frame make flips skip until they go,
+ * so everyone sees older snapshots meanwhile; the game thread never waits for them.
+ */
+class DAYSGUN_API FLocomotionSnapshotReader
+{
+public:
+	explicit FLocomotionSnapshotReader(const ULocomotionSnapshotSubsystem& InSubsystem);
+	~FLocomotionSnapshotReader();
+
+	FLocomotionSnapshotReader(const FLocomotionSnapshotReader&) = delete;
+	FLocomotionSnapshotReader& operator=(const FLocomotionSnapshotReader&) = delete;
+
+	/** Snapshots of the last completed frame; inactive slots have Active == false */
+	FORCEINLINE TConstArrayView<FLocomotionSnapshot> GetSnapshots() const { return Snapshots; }
+
+	const FLocomotionSnapshot* GetSnapshot(int32 Handle) const;
+
+private:
+	const ULocomotionSnapshotSubsystem& Subsystem;
+	uint32 Buffer = 0;
+	TConstArrayView<FLocomotionSnapshot> Snapshots;
+};
+
+/**
+ * Registry of per-character locomotion snapshots, triple buffered.
+ * Anim instances write into the back buffer during their update. Once all actors ticked the back buffer becomes the
+ * front, and a buffer no FLocomotionSnapshotReader pins becomes the new back, so any thread can read the front
+ * buffer as one contiguous array without locking. With both other buffers pinned the flip is skipped that frame
+ * and the anim instances write into the same back buffer again.
+ */
+UCLASS(Config = Game)
+class DAYSGUN_API ULocomotionSnapshotSubsystem : public UWorldSubsystem
+{
+	GENERATED_BODY()
+
+	friend class FLocomotionSnapshotReader;
+
+public:
+	virtual void Initialize(FSubsystemCollectionBase& Collection) override;
+	virtual void Deinitialize() override;
+
+	/** Game thread only. Returns INDEX_NONE once the registry is full */
+	int32 Register(const APawn* Owner);
+	void Unregister(int32 Handle);
+
+	/** Each handle has exactly one writer, so this can run on any anim worker thread */
+	void Publish(int32 Handle, const FLocomotionSnapshot& Snapshot);
+
+	/** Game thread only. Parallel to FLocomotionSnapshotReader::GetSnapshots() */
+	FORCEINLINE TConstArrayView<TWeakObjectPtr<const APawn>> GetOwners() const { return Owners; }
+
+	/** Flips skipped because readers pinned both other buffers */
+	FORCEINLINE int32 GetNumSkippedFlips() const { return NumSkippedFlips; }
+
+private:
+	void OnWorldPostActorTick(UWorld* World, ELevelTick TickType, float DeltaSeconds);
+
+private:
+	static constexpr uint32 NumBuffers = 3;
+
+	/** State layout: a reader count per buffer in the low bits, the front buffer index above them */
+	static constexpr uint32 ReaderCountBits = 20;
+	static constexpr uint32 FrontShift = ReaderCountBits * NumBuffers;
+	static constexpr uint64 ReaderCountsMask = (uint64(1) << FrontShift) - 1;
+
+	FORCEINLINE static uint32 GetFront(uint64 Packed) { return static_cast<uint32>(Packed >> FrontShift); }
+	FORCEINLINE static uint64 GetReaderUnit(uint32 Buffer) { return uint64(1) << (Buffer * ReaderCountBits); }
+
+	FORCEINLINE static uint32 GetReaders(uint64 Packed, uint32 Buffer)
+	{
+		return static_cast<uint32>(Packed >> (Buffer * ReaderCountBits)) & ((1u << ReaderCountBits) - 1);
+	}
+
+	/** All buffers are allocated once so readers never see a reallocation */
+	UPROPERTY(Config)
+	int32 MaxSnapshots = 1024;
+
+	TArray<FLocomotionSnapshot> Buffers[NumBuffers];
+
+	/** Front buffer and readers in one word, so a reader pins exactly the buffer the flip sees as front */
+	mutable std::atomic<uint64> State{0};
+	std::atomic<uint32> BackIndex{1};
+	int32 NumSkippedFlips = 0;
+
+	/** Number of slots ever handed out, readers don't need to look past it */
+	std::atomic<int32> NumUsedSlots{0};
+
+	TArray<TWeakObjectPtr<const APawn>> Owners;
+	TArray<int32> FreeHandles;
+
+	FDelegateHandle PostActorTickHandle;
+};
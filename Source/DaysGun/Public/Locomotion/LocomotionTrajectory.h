@@ -0,0 +1,113 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+
+class UCharacterMovementComponent;
+
+
+/** One step of trajectory history, positions are in world space */
+struct FTrajectorySample
+{
+	FVector Position = FVector::ZeroVector;
+	FVector3f Velocity = FVector3f::ZeroVector;
+
+	/** Movement input in world space, at most unit length */
+	FVector2f Input = FVector2f::ZeroVector;
+
+	float FacingYaw = 0.f;
+
+	/** Seconds since the trajectory was reset */
+	float Time = 0.f;
+};
+
+/** One predicted step, relative to where the character is now */
+struct FTrajectoryPoint
+{
+	FVector3f Offset = FVector3f::ZeroVector;
+	FVector3f Velocity = FVector3f::ZeroVector;
+
+	/** Seconds ahead of the newest sample */
+	float Time = 0.f;
+};
+
+/** The walking part of UCharacterMovementComponent::CalcVelocity and ApplyVelocityBraking */
+struct DAYSGUN_API FTrajectoryMovementModel
+{
+	float MaxSpeed = 0.f;
+	float MaxAcceleration = 0.f;
+	float BrakingDeceleration = 0.f;
+
+	/** Turns velocity towards the input direction while accelerating */
+	float GroundFriction = 0.f;
+
+	/** Already scaled by BrakingFrictionFactor */
+	float BrakingFriction = 0.f;
+
+	static FTrajectoryMovementModel FromMovement(const UCharacterMovementComponent& Movement);
+};
+
+/**
+ * Fixed size history of positions, velocities, facing and input with rates measured over a time window instead
+ * of a single frame, plus a prediction of the coming trajectory from the movement component's acceleration and
+ * braking model. Never allocates, the prediction integrates in vector registers.
+ */
+class DAYSGUN_API FLocomotionTrajectory
+{
+public:
+	/** Power of two so the ring index is a mask */
+	static constexpr int32 Capacity = 32;
+
+	void Reset();
+	void AddSample(const FVector& Position, const FVector& Velocity, const FVector& Input, float FacingYaw,
+	               float DeltaSeconds);
+
+	FORCEINLINE int32 Num() const { return Count; }
+
+	/** Age 0 is the newest sample, Age must be below Num() */
+	FTrajectorySample GetSample(int32 Age) const;
+
+	/** Velocity change per second between the newest sample and the one Window seconds before it */
+	FVector3f GetAcceleration(float Window) const;
+
+	FVector3f GetAverageVelocity(float Window) const;
+
+	/** Degrees per second, unwrapped across the ±180 seam */
+	float GetFacingYawRate(float Window) const;
+	float GetInputYawRate(float Window) const;
+
+	/**
+	 * Fills OutPoints Interval seconds apart assuming the newest input is held, SubSteps integration steps per
+	 * point. Without any sample the points stay at zero.
+	 */
+	void Predict(const FTrajectoryMovementModel& Model, float Interval, TArrayView<FTrajectoryPoint> OutPoints,
+	             int32 SubSteps = 2) const;
+
+	/** Yaw from now to where the character is predicted Seconds ahead, false when it isn't predicted to move */
+	bool PredictHeading(const FTrajectoryMovementModel& Model, float Seconds, float& OutYaw) const;
+
+private:
+	FORCEINLINE int32 GetIndex(int32 Age) const { return (Head - Age) & (Capacity - 1); }
+
+	/** Age of the newest sample at least Window seconds older than the newest, or of the oldest one */
+	int32 GetAgeForWindow(float Window) const;
+
+	float GetYawRate(const float* Yaws, float Window) const;
+
+private:
+	/** Positions are stored relative to Origin so float precision holds far from the world origin */
+	FVector Origin = FVector::ZeroVector;
+
+	FVector4f Positions[Capacity];
+	FVector4f Velocities[Capacity];
+	FVector2f Inputs[Capacity];
+	float InputYaws[Capacity];
+	float FacingYaws[Capacity];
+	float Times[Capacity];
+
+	int32 Head = -1;
+	int32 Count = 0;
+	float Time = 0.f;
+};
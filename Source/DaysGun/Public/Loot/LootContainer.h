@@ -0,0 +1,47 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "GameFramework/Actor.h"
+#include "LootContainer.generated.h"
+
+
+class ABaseCharacter;
+class USphereComponent;
+class UStaticMeshComponent;
+
+
+/**
+ * Something a character can loot. Registers itself with ULootInteractionSubsystem, which finds it for the
+ * characters around it, so it needs no overlap events or traces of its own. One character loots it at a time.
+ */
+UCLASS()
+class DAYSGUN_API ALootContainer : public AActor
+{
+	GENERATED_BODY()
+
+public:
+	ALootContainer();
+
+	/** Fails while another character loots it */
+	bool TryOpen(ABaseCharacter* Character);
+	void Close();
+
+	FORCEINLINE bool IsOpen() const { return Looter.IsValid(); }
+	FORCEINLINE ABaseCharacter* GetLooter() const { return Looter.Get(); }
+
+protected:
+	virtual void BeginPlay() override;
+	virtual void EndPlay(const EEndPlayReason::Type EndPlayReason) override;
+
+private:
+	/** Query only, the interaction index does not need overlap events */
+	UPROPERTY(VisibleAnywhere, Category = "Loot")
+	USphereComponent* InteractionSphere;
+
+	UPROPERTY(VisibleAnywhere, Category = "Loot")
+	UStaticMeshComponent* Mesh;
+
+	TWeakObjectPtr<ABaseCharacter> Looter;
+};
@@ -0,0 +1,143 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Containers/IndexedRegistry.h"
+#include "Debug/SubsystemBenchmark.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "LootInteractionSubsystem.generated.h"
+
+
+class ALootContainer;
+
+
+/**
+ * Answers which lootable a character is looking at. Lootables are kept in a spatial hash with InteractionDistance
+ * cells, sorted by bucket into one contiguous array, so a query reads the few points in the 3x3 cells around the
+ * character and touches no actor. The hash is built again on the next query after lootables come or go; they are
+ * assumed not to move while registered. DaysGun.Loot.Benchmark compares the query with a physics overlap.
+ */
+UCLASS(Config = Game)
+class DAYSGUN_API ULootInteractionSubsystem : public UTickableWorldSubsystem
+{
+	GENERATED_BODY()
+
+public:
+	virtual void Tick(float DeltaTime) override;
+	virtual bool IsTickable() const override;
+	virtual TStatId GetStatId() const override;
+	virtual void Deinitialize() override;
+
+	void Register(ALootContainer* Container);
+	void Unregister(const ALootContainer* Container);
+
+	/** Lootables being looted are skipped by queries */
+	void SetAvailable(const ALootContainer* Container, bool Available);
+
+	/** Nearest available lootable within InteractionDistance and the horizontal view cone around Forward */
+	ALootContainer* FindNearestInView(const FVector& Origin, const FVector& Forward);
+
+	FORCEINLINE int32 GetNumLootables() const { return Lootables.Num(); }
+
+	/** Milliseconds the last rebuild of the hash took */
+	FORCEINLINE double GetLastBuildMs() const { return LastBuildMs; }
+
+	/** Scatters lootables around soak bots and times the index query against a physics overlap for each bot */
+	void StartBenchmark(int32 NumLootables, int32 NumCharacters, float Seconds);
+
+private:
+	struct FLootable
+	{
+		TWeakObjectPtr<ALootContainer> Container;
+		FVector Location = FVector::ZeroVector;
+		bool Available = true;
+	};
+
+	/** What a query reads, sorted by bucket */
+	struct FLootPoint
+	{
+		FVector3f Location = FVector3f::ZeroVector;
+		int32 Lootable = INDEX_NONE;
+		bool Available = true;
+	};
+
+	struct FBenchmarkResult
+	{
+		int32 Frames = 0;
+		int64 Queries = 0;
+		int64 Found = 0;
+		int64 Mismatches = 0;
+		double IndexMs = 0.0;
+		double OverlapMs = 0.0;
+		double FrameMs = 0.0;
+	};
+
+	void BuildIndex();
+	void RemoveAt(int32 Index);
+
+	FORCEINLINE FIntPoint GetCell(const FVector3f& Location) const
+	{
+		return FIntPoint(FMath::FloorToInt32(Location.X / InteractionDistance),
+		                 FMath::FloorToInt32(Location.Y / InteractionDistance));
+	}
+
+	FORCEINLINE uint32 GetBucket(const FIntPoint& Cell) const
+	{
+		return (static_cast<uint32>(Cell.X) * 73856093u ^ static_cast<uint32>(Cell.Y) * 19349663u) & (NumBuckets - 1);
+	}
+
+	/** Offset from the query origin, Facing is the normalized horizontal forward */
+	FORCEINLINE bool IsInView(const FVector3f& Offset, const FVector2f& Facing) const
+	{
+		const FVector2f Offset2D(Offset.X, Offset.Y);
+		const auto DistanceSquared = Offset2D.SizeSquared();
+		const auto Dot = FVector2f::DotProduct(Offset2D, Facing);
+
+		// Inside the cone without a square root, the half angle is at most 90 degrees
+		return FMath::Abs(Offset.Z) <= MaxHeightDifference &&
+			DistanceSquared <= FMath::Square(InteractionDistance) &&
+			Dot >= 0.f && Dot * Dot >= CosHalfAngleSquared * DistanceSquared;
+	}
+
+	/** The same answer the slow way, the benchmark's baseline */
+	ALootContainer* OverlapNearestInView(const FVector& Origin, const FVector& Forward) const;
+
+	void TickBenchmark(float DeltaTime);
+	void FinishBenchmark();
+
+private:
+	/** Reach of a character, also the spatial hash cell size */
+	UPROPERTY(Config)
+	float InteractionDistance = 250.f;
+
+	/** Half angle of the horizontal view cone, up to 90 degrees */
+	UPROPERTY(Config)
+	float ConeHalfAngle = 60.f;
+
+	/** Lootables further above or below the query origin are on another floor */
+	UPROPERTY(Config)
+	float MaxHeightDifference = 150.f;
+
+	TIndexedRegistry<const ALootContainer*, FLootable> Lootables;
+
+	/** Points sorted by bucket, BucketStarts[Bucket] to BucketStarts[Bucket + 1] */
+	TArray<FLootPoint> SortedPoints;
+	TArray<int32> BucketStarts;
+	TArray<int32> BucketCursors;
+	TArray<uint32> LootableBuckets;
+
+	/** Slot of each lootable in SortedPoints */
+	TArray<int32> LootableSlots;
+	uint32 NumBuckets = 0;
+	bool IndexDirty = false;
+	float CosHalfAngleSquared = 0.f;
+
+	double LastBuildMs = 0.0;
+
+	UPROPERTY(Transient)
+	TArray<ALootContainer*> BenchmarkLootables;
+
+	FSubsystemBenchmark Benchmark;
+	FBenchmarkResult BenchmarkResult;
+};
@@ -0,0 +1,192 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+
+/**
+ * Float precision math for locomotion hot paths. Characters only ever rotate around yaw, so rotations are
+ * plain angles in degrees instead of rotators, and the UKismetMathLibrary wrappers are avoided altogether.
+ * The *4 variants process four values per call for batched updates.
+ */
+struct FDaysGunMath
+{
+	/** Same range as FRotator::NormalizeAxis: (-180, 180] */
+	static FORCEINLINE float NormalizeYaw(float Yaw)
+	{
+		return FRotator3f::NormalizeAxis(Yaw);
+	}
+
+	/** Yaw of NormalizedDeltaRotator(A, B) */
+	static FORCEINLINE float DeltaYaw(float A, float B)
+	{
+		return NormalizeYaw(A - B);
+	}
+
+	/** Yaw of MakeRotFromX(Vector), 0 for a vector too short for GetSafeNormal */
+	static FORCEINLINE float YawFromVector(const FVector& Vector)
+	{
+		return YawFromVector(FVector2f(Vector.X, Vector.Y));
+	}
+
+	static FORCEINLINE float YawFromVector(const FVector2f& Vector)
+	{
+		// Written as GetSafeNormal's test so NaN still reaches Atan2, the way it does in MakeRotFromX
+		if (Vector.SizeSquared() < UE_SMALL_NUMBER) return 0.f;
+		return FMath::RadiansToDegrees(FMath::Atan2(Vector.Y, Vector.X));
+	}
+
+	static FORCEINLINE FVector ForwardFromYaw(float Yaw)
+	{
+		float Sin;
+		float Cos;
+		FMath::SinCos(&Sin, &Cos, FMath::DegreesToRadians(Yaw));
+		return FVector(Cos, Sin, 0.f);
+	}
+
+	/** Yaw of RInterpTo on yaw-only rotators */
+	static FORCEINLINE float YawInterpTo(float Current, float Target, float DeltaTime, float InterpSpeed)
+	{
+		if (DeltaTime == 0.f || Current == Target) return Current;
+		if (InterpSpeed <= 0.f) return NormalizeYaw(Target);
+
+		const auto Delta = DeltaYaw(Target, Current);
+		if (FMath::IsNearlyZero(Delta, UE_KINDA_SMALL_NUMBER)) return NormalizeYaw(Target);
+
+		return NormalizeYaw(Current + Delta * FMath::Clamp(DeltaTime * InterpSpeed, 0.f, 1.f));
+	}
+
+	/** Yaw of RInterpTo_Constant on yaw-only rotators */
+	static FORCEINLINE float YawInterpConstantTo(float Current, float Target, float DeltaTime, float InterpSpeed)
+	{
+		if (DeltaTime == 0.f || Current == Target) return Current;
+		if (InterpSpeed <= 0.f) return NormalizeYaw(Target);
+
+		const auto MaxStep = InterpSpeed * DeltaTime;
+		return NormalizeYaw(Current + FMath::Clamp(DeltaYaw(Target, Current), -MaxStep, MaxStep));
+	}
+
+	static FORCEINLINE float Dot2D(const FVector& A, const FVector& B)
+	{
+		return static_cast<float>(A.X) * static_cast<float>(B.X) + static_cast<float>(A.Y) * static_cast<float>(B.Y);
+	}
+
+	/** Normal(Vector) of a vector without Z */
+	static FORCEINLINE FVector2f SafeNormal2D(const FVector& Vector, float Tolerance = UE_SMALL_NUMBER)
+	{
+		const FVector2f Vector2D(Vector.X, Vector.Y);
+		const auto SizeSquared = Vector2D.SizeSquared();
+		return SizeSquared < Tolerance ? FVector2f::ZeroVector : Vector2D * FMath::InvSqrt(SizeSquared);
+	}
+
+	static FORCEINLINE float SafeDivide(float A, float B)
+	{
+		return B != 0.f ? A / B : 0.f;
+	}
+
+	/** Same result as MapRangeClamped, including the nearly flat InMin == InMax case */
+	static FORCEINLINE float MapRangeClamped(float Value, float InMin, float InMax, float OutMin, float OutMax)
+	{
+		const auto Divisor = InMax - InMin;
+		const auto Alpha = FMath::IsNearlyZero(Divisor) ? (Value >= InMax ? 1.f : 0.f) : (Value - InMin) / Divisor;
+		return FMath::Lerp(OutMin, OutMax, FMath::Clamp(Alpha, 0.f, 1.f));
+	}
+
+	static FORCEINLINE bool InRange(float Value, float Min, float Max, bool InclusiveMin = true, bool InclusiveMax = true)
+	{
+		return (InclusiveMin ? Value >= Min : Value > Min) && (InclusiveMax ? Value <= Max : Value < Max);
+	}
+
+#pragma region VectorRegister
+	static FORCEINLINE VectorRegister4Float NormalizeYaw4(const VectorRegister4Float& Yaw)
+	{
+		const auto Full = VectorSetFloat1(360.f);
+		const auto Half = VectorSetFloat1(180.f);
+
+		// [-180, 180) first, then -180 is moved to 180 to match NormalizeYaw
+		const auto Turns = VectorFloor(VectorDivide(VectorAdd(Yaw, Half), Full));
+		const auto Wrapped = VectorSubtract(Yaw, VectorMultiply(Turns, Full));
+		return VectorSelect(VectorCompareGE(VectorNegate(Half), Wrapped), VectorAdd(Wrapped, Full), Wrapped);
+	}
+
+	static FORCEINLINE VectorRegister4Float DeltaYaw4(const VectorRegister4Float& A, const VectorRegister4Float& B)
+	{
+		return NormalizeYaw4(VectorSubtract(A, B));
+	}
+
+	static FORCEINLINE VectorRegister4Float YawFromVector4(const VectorRegister4Float& X, const VectorRegister4Float& Y)
+	{
+		const auto Yaw = VectorMultiply(VectorATan2(Y, X), VectorSetFloat1(180.f / UE_PI));
+		const auto SizeSquared = VectorMultiplyAdd(X, X, VectorMultiply(Y, Y));
+		return VectorSelect(VectorCompareLT(SizeSquared, VectorSetFloat1(UE_SMALL_NUMBER)), VectorZeroFloat(), Yaw);
+	}
+
+	static FORCEINLINE VectorRegister4Float MapRangeClamped4(const VectorRegister4Float& Value, float InMin, float InMax,
+	                                                         float OutMin, float OutMax)
+	{
+		const auto Divisor = InMax - InMin;
+		if (FMath::IsNearlyZero(Divisor))
+		{
+			return VectorSelect(VectorCompareGE(Value, VectorSetFloat1(InMax)),
+			                    VectorSetFloat1(OutMax), VectorSetFloat1(OutMin));
+		}
+
+		const auto Alpha = VectorMultiply(VectorSubtract(Value, VectorSetFloat1(InMin)), VectorSetFloat1(1.f / Divisor));
+		const auto Clamped = VectorMin(VectorMax(Alpha, VectorZeroFloat()), VectorOneFloat());
+		return VectorMultiplyAdd(Clamped, VectorSetFloat1(OutMax - OutMin), VectorSetFloat1(OutMin));
+	}
+#pragma endregion
+
+#pragma region Batch
+	/** Runs Op4 over groups of four and Op on the remainder */
+	template <typename FOp4, typename FOp>
+	static FORCEINLINE void ForEachBatch(int32 Num, FOp4 Op4, FOp Op)
+	{
+		int32 Index = 0;
+		for (; Index + 4 <= Num; Index += 4)
+		{
+			Op4(Index);
+		}
+		for (; Index < Num; ++Index)
+		{
+			Op(Index);
+		}
+	}
+
+	static void DeltaYawBatch(TConstArrayView<float> A, TConstArrayView<float> B, TArrayView<float> Out)
+	{
+		check(A.Num() == B.Num() && A.Num() == Out.Num());
+		ForEachBatch(Out.Num(),
+		             [&](int32 Index)
+		             {
+			             VectorStore(DeltaYaw4(VectorLoad(&A[Index]), VectorLoad(&B[Index])), &Out[Index]);
+		             },
+		             [&](int32 Index) { Out[Index] = DeltaYaw(A[Index], B[Index]); });
+	}
+
+	static void YawFromVectorBatch(TConstArrayView<float> X, TConstArrayView<float> Y, TArrayView<float> Out)
+	{
+		check(X.Num() == Y.Num() && X.Num() == Out.Num());
+		ForEachBatch(Out.Num(),
+		             [&](int32 Index)
+		             {
+			             VectorStore(YawFromVector4(VectorLoad(&X[Index]), VectorLoad(&Y[Index])), &Out[Index]);
+		             },
+		             [&](int32 Index) { Out[Index] = YawFromVector(FVector2f(X[Index], Y[Index])); });
+	}
+
+	static void MapRangeClampedBatch(TConstArrayView<float> Values, TArrayView<float> Out,
+	                                 float InMin, float InMax, float OutMin, float OutMax)
+	{
+		check(Values.Num() == Out.Num());
+		ForEachBatch(Out.Num(),
+		             [&](int32 Index)
+		             {
+			             VectorStore(MapRangeClamped4(VectorLoad(&Values[Index]), InMin, InMax, OutMin, OutMax),
+			                         &Out[Index]);
+		             },
+		             [&](int32 Index) { Out[Index] = MapRangeClamped(Values[Index], InMin, InMax, OutMin, OutMax); });
+	}
+#pragma endregion
+};
@@ -0,0 +1,110 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "ReplicationGraph.h"
+#include "Locomotion/GaitProfileSet.h"
+#include "DaysGunReplicationGraph.generated.h"
+
+class ABaseCharacter;
+class UReplicationGraphNode_ActorList;
+class UReplicationGraphNode_GridSpatialization2D;
+
+UENUM()
+enum class EClassRepNodeMapping : uint8
+{
+	NotRouted,
+	RelevantAllConnections,
+	Spatialize_Static,
+	Spatialize_Dynamic,
+	Spatialize_Dormancy,
+};
+
+/**
+ * Routes characters through a 2D spatial grid instead of per-actor relevancy checks and, per connection,
+ * replicates them less often the further away and the slower they move. Dormant actors live in the grid's
+ * dormancy lists so they cost nothing until FlushNetDormancy.
+ *
+ * To profile: start a dedicated server with -server -log, connect headless clients with
+ * -game -nullrhi -nosound 127.0.0.1, then run DaysGun.RepGraph.Report on the server.
+ */
+UCLASS(Transient, Config = Game)
+class DAYSGUN_API UDaysGunReplicationGraph : public UReplicationGraph
+{
+	GENERATED_BODY()
+
+public:
+	UDaysGunReplicationGraph();
+
+	virtual void ResetGameWorldState() override;
+	virtual void InitGlobalActorClassSettings() override;
+	virtual void InitGlobalGraphNodes() override;
+	virtual void InitConnectionGraphNodes(UNetReplicationGraphConnection* RepGraphConnection) override;
+	virtual void RouteAddNetworkActorToNodes(const FNewReplicatedActorInfo& ActorInfo,
+	                                         FGlobalActorReplicationInfo& GlobalInfo) override;
+	virtual void RouteRemoveNetworkActorToNodes(const FNewReplicatedActorInfo& ActorInfo) override;
+	virtual int32 ServerReplicateActors(float DeltaSeconds) override;
+
+	/** Logs replication cost, bytes per connection and the spread of character update periods */
+	void PrintReport() const;
+
+	FORCEINLINE double GetAverageReplicateMs() const { return AverageReplicateMs; }
+
+private:
+	EClassRepNodeMapping GetMappingPolicy(UClass* Class);
+	static EClassRepNodeMapping GetMappingPolicyFromDefaults(const UClass* Class);
+	void InitClassReplicationInfo(const UClass* Class, FClassReplicationInfo& ClassInfo) const;
+	void UpdateCharacterPeriods();
+	int32 GetCharacterPeriodFrames(const ABaseCharacter* Character, float Distance) const;
+
+private:
+	UPROPERTY(Config)
+	float GridCellSize = 10000.f;
+
+	UPROPERTY(Config)
+	FVector2D SpatialBias = FVector2D(-150000.f, -200000.f);
+
+	/** Update periods (in replication frames) of characters that stand still */
+	UPROPERTY(Config)
+	int32 IdlePeriodFrames = 8;
+
+	/** Update periods (in replication frames) of moving characters, by the gait their speed falls into */
+	UPROPERTY(Config, meta = (ArraySizeEnum = "EGait"))
+	int32 GaitPeriodFrames[(int32)EGait::EG_Num];
+
+	/** Below this ground speed a character counts as idle */
+	UPROPERTY(Config)
+	float IdleSpeed = 10.f;
+
+	/** Periods are scaled from 1 at NearDistance to MaxDistanceScale at FarDistance from the viewer */
+	UPROPERTY(Config)
+	float NearDistance = 1500.f;
+
+	UPROPERTY(Config)
+	float FarDistance = 15000.f;
+
+	UPROPERTY(Config)
+	float MaxDistanceScale = 4.f;
+
+	UPROPERTY(Config)
+	int32 MaxPeriodFrames = 30;
+
+	/** Character periods are recomputed once every this many replication frames */
+	UPROPERTY(Config)
+	int32 PeriodUpdateInterval = 10;
+
+	UPROPERTY(Transient)
+	UReplicationGraphNode_GridSpatialization2D* GridNode;
+
+	UPROPERTY(Transient)
+	UReplicationGraphNode_ActorList* AlwaysRelevantNode;
+
+	UPROPERTY(Transient)
+	TArray<ABaseCharacter*> Characters;
+
+	TClassMap<EClassRepNodeMapping> ClassRepNodePolicies;
+
+	double AverageReplicateMs = 0.0;
+	double PeakReplicateMs = 0.0;
+};
@@ -0,0 +1,151 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Containers/IndexedRegistry.h"
+#include "Debug/SubsystemBenchmark.h"
+#include "Engine/EngineBaseTypes.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "BackpackPhysicsSubsystem.generated.h"
+
+
+class ABaseCharacter;
+class USkeletalMeshComponent;
+
+
+UENUM()
+enum class EBackpackPhysicsLOD : uint8
+{
+	/** Rigid bodies of PA_Backpack below the root bone simulate */
+	Simulated,
+
+	/** Physics off, a damped spring swings the backpack from the socket's acceleration */
+	Spring,
+
+	/** Physics and animation off, the backpack follows the socket in its reference pose */
+	Frozen,
+};
+
+/** Ticks at a fixed point of the frame so the subsystem can time the physics span */
+struct FBackpackPhysicsTimingTick : public FTickFunction
+{
+	uint64 Cycles = 0;
+
+	virtual void ExecuteTick(float DeltaTime, ELevelTick TickType, ENamedThreads::Type CurrentThread,
+	                         const FGraphEventRef& MyCompletionGraphEvent) override
+	{
+		Cycles = FPlatformTime::Cycles64();
+	}
+
+	virtual FString DiagnosticMessage() override { return TEXT("FBackpackPhysicsTimingTick"); }
+};
+
+/**
+ * Picks a physics LOD for every character backpack: full simulation for the most significant backpacks near
+ * the camera, capped at MaxSimulatedBackpacks, a kinematic spring in mid range and a frozen pose beyond that or
+ * off screen. Significance is refreshed every SignificanceInterval, the springs update every frame in one loop.
+ * Without a local viewer (dedicated servers) every backpack is frozen, server targets do not create the subsystem.
+ */
+UCLASS(Config = Game)
+class DAYSGUN_API UBackpackPhysicsSubsystem : public UTickableWorldSubsystem
+{
+	GENERATED_BODY()
+
+public:
+	virtual bool ShouldCreateSubsystem(UObject* Outer) const override;
+	virtual void Tick(float DeltaTime) override;
+	virtual bool IsTickable() const override;
+	virtual TStatId GetStatId() const override;
+	virtual void Deinitialize() override;
+
+	void Register(ABaseCharacter* Character, USkeletalMeshComponent* Backpack);
+
+	/** Turns physics off and hands the backpack back in its reference pose */
+	void Unregister(const USkeletalMeshComponent* Backpack);
+
+	/** Simulates every backpack regardless of distance and budget, the baseline the LODs are measured against */
+	void SetForceSimulation(bool Force);
+
+	/** Spawns Count bots, measures Seconds with LODs and Seconds with everything simulated, then logs both */
+	void StartBenchmark(int32 Count, float Seconds);
+
+	void PrintStats() const;
+
+private:
+	struct FBackpackEntry
+	{
+		TWeakObjectPtr<USkeletalMeshComponent> Backpack;
+		TWeakObjectPtr<ABaseCharacter> Character;
+		FName PhysicsRootBone;
+		EBackpackPhysicsLOD LOD = EBackpackPhysicsLOD::Frozen;
+		float Significance = 0.f;
+
+		/** Pitch and roll of the spring in degrees */
+		FVector2f SwingAngle = FVector2f::ZeroVector;
+		FVector2f SwingVelocity = FVector2f::ZeroVector;
+		FVector LastVelocity = FVector::ZeroVector;
+	};
+
+	struct FBenchmarkPhase
+	{
+		int32 Frames = 0;
+		double PhysicsMs = 0.0;
+		double FrameMs = 0.0;
+		int64 SimulatedBackpacks = 0;
+		int64 SimulatedBodies = 0;
+	};
+
+	void UpdateSignificance();
+	void UpdateSprings(float DeltaTime);
+	void SetLOD(FBackpackEntry& Entry, EBackpackPhysicsLOD LOD) const;
+
+	void TickBenchmark(float DeltaTime);
+	void FinishBenchmark();
+	void SetTimingTicksEnabled(bool Enabled);
+
+private:
+	/** Backpacks simulated at the same time, the rest fall back to springs */
+	UPROPERTY(Config)
+	int32 MaxSimulatedBackpacks = 16;
+
+	UPROPERTY(Config)
+	float SimulateDistance = 1500.f;
+
+	UPROPERTY(Config)
+	float SpringDistance = 5000.f;
+
+	/** Backpacks not rendered for this long count as off screen */
+	UPROPERTY(Config)
+	float OffScreenSeconds = 0.25f;
+
+	UPROPERTY(Config)
+	float SignificanceInterval = 0.25f;
+
+	/** Degrees of swing per cm/s^2 of socket acceleration */
+	UPROPERTY(Config)
+	float SpringAccelerationScale = 0.01f;
+
+	UPROPERTY(Config)
+	float SpringStiffness = 120.f;
+
+	UPROPERTY(Config)
+	float SpringDamping = 12.f;
+
+	UPROPERTY(Config)
+	float MaxSwingAngle = 20.f;
+
+	TIndexedRegistry<const USkeletalMeshComponent*, FBackpackEntry> Entries;
+
+	float SignificanceTimeLeft = 0.f;
+	bool ForceSimulation = false;
+
+	FBackpackPhysicsTimingTick StartPhysicsTick;
+	FBackpackPhysicsTimingTick EndPhysicsTick;
+
+	UPROPERTY(Transient)
+	TArray<ABaseCharacter*> BenchmarkCharacters;
+
+	FSubsystemBenchmark Benchmark;
+	FBenchmarkPhase BenchmarkPhases[2];
+};
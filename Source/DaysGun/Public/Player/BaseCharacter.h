@@ -5,6 +5,9 @@
 #include "CoreMinimal.h"
 #include "GameFramework/Character.h"
 #include "InputActionValue.h"
+#include "Locomotion/FixedStepSimulation.h"
+#include "Locomotion/GaitProfileSet.h"
+#include "WorldPartition/WorldPartitionStreamingSource.h"
 #include "BaseCharacter.generated.h"
 
 
@@ -13,22 +16,24 @@ class USpringArmComponent;
 class UCameraComponent;
 class UInputMappingContext;
 class UInputAction;
+class ALootContainer;
+class UAnimMontage;
 
 
 UCLASS()
-class DAYSGUN_API ABaseCharacter : public ACharacter
+class DAYSGUN_API ABaseCharacter : public ACharacter, public IWorldPartitionStreamingSourceProvider
 {
 	GENERATED_BODY()
 
 #pragma region Components
 
 private:
-	/** Camera boom positioning the camera behind the character */
-	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category = Camera, meta = (AllowPrivateAccess = "true"))
+	/** Camera boom positioning the camera behind the character, only exists while a local player possesses it */
+	UPROPERTY(Transient, VisibleInstanceOnly, BlueprintReadOnly, Category = Camera, meta = (AllowPrivateAccess = "true"))
 	USpringArmComponent* CameraBoom;
 
-	/** Follow camera */
-	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category = Camera, meta = (AllowPrivateAccess = "true"))
+	/** Follow camera, only exists while a local player possesses the character */
+	UPROPERTY(Transient, VisibleInstanceOnly, BlueprintReadOnly, Category = Camera, meta = (AllowPrivateAccess = "true"))
 	UCameraComponent* FollowCamera;
 
 #pragma region Meshes
@@ -41,28 +46,172 @@ public:
 	ABaseCharacter();
 
 protected:
+	virtual void PostRegisterAllComponents() override;
 	virtual void BeginPlay() override;
-	virtual void Tick(float DeltaSeconds) override;
+	virtual void EndPlay(const EEndPlayReason::Type EndPlayReason) override;
 	virtual void SetupPlayerInputComponent(class UInputComponent* PlayerInputComponent) override;
+	virtual void NotifyControllerChanged() override;
+	virtual void UnPossessed() override;
 
 
 #pragma region CharacterSettings
 
 private:
+	/** Speed, acceleration and braking per gait, the UGaitProfileSet defaults are used when empty */
 	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "Settings|Speed", meta = (AllowPrivateAccess = "true"))
-	float WalkSpeed = 175.f;
+	UGaitProfileSet* GaitProfiles;
 
+	/** Gait used when no sprint input is held */
 	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "Settings|Speed", meta = (AllowPrivateAccess = "true"))
-	float RunSpeed = 300.f;
+	EGait DefaultGait = EGait::EG_Walk;
 
+	/** Gait used while the sprint input is held */
 	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "Settings|Speed", meta = (AllowPrivateAccess = "true"))
-	float WalkMaxAcceleration = 150.f;
-	
-	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "Settings|Speed", meta = (AllowPrivateAccess = "true"))
-	float RunMaxAcceleration = 350.f;
+	EGait SprintGait = EGait::EG_Run;
+
+	UPROPERTY(VisibleInstanceOnly, BlueprintReadOnly, Category = "Settings|Speed", meta = (AllowPrivateAccess = "true"))
+	EGait Gait = EGait::EG_Walk;
 
 private:
 	void SetupCharacterSettings();
+
+public:
+	/** Blends movement speed, acceleration and braking into the profile of NewGait */
+	UFUNCTION(BlueprintCallable, Category = "Settings|Speed")
+	void SetGait(EGait NewGait);
+
+	FORCEINLINE EGait GetGait() const { return Gait; }
+
+	const UGaitProfileSet* GetGaitProfiles() const;
+#pragma endregion
+
+#pragma region LocalPlayerComponents
+private:
+	/** The camera follows at this distance behind the character */
+	UPROPERTY(EditDefaultsOnly, Category = Camera, meta = (AllowPrivateAccess = "true"))
+	float CameraBoomArmLength = 400.f;
+
+	UPROPERTY(EditDefaultsOnly, Category = Camera, meta = (AllowPrivateAccess = "true"))
+	FVector CameraBoomSocketOffset = FVector::ZeroVector;
+
+	UPROPERTY(EditDefaultsOnly, Category = Camera, meta = (AllowPrivateAccess = "true"))
+	float FollowCameraFieldOfView = 90.f;
+
+	/** Camera components are created when a local player takes control and removed when it lets go */
+	void UpdateLocalPlayerComponents();
+	void CreateLocalPlayerComponents();
+	void DestroyLocalPlayerComponents();
+
+public:
+	FORCEINLINE USpringArmComponent* GetCameraBoom() const { return CameraBoom; }
+	FORCEINLINE UCameraComponent* GetFollowCamera() const { return FollowCamera; }
+	FORCEINLINE USkeletalMeshComponent* GetBackpackMesh() const { return BackpackMesh; }
+#pragma endregion
+
+#pragma region Pooling
+public:
+	/** Called by UCharacterPoolSubsystem when the character is parked in the pool */
+	void OnReleasedToPool();
+
+	/** Called by UCharacterPoolSubsystem before handing the character out again */
+	void OnAcquiredFromPool(const FTransform& SpawnTransform);
+
+	FORCEINLINE bool IsPooled() const { return Pooled; }
+
+private:
+	bool Pooled = false;
+
+	void ResetAttachments();
+#pragma endregion
+
+#pragma region Backpack
+private:
+	/** Physics LOD of the backpack is picked by UBackpackPhysicsSubsystem */
+	void RegisterBackpackPhysics();
+	void UnregisterBackpackPhysics();
+#pragma endregion
+
+#pragma region MovementLOD
+private:
+	/** Background characters drop to NavWalking, picked by UMovementLODSubsystem */
+	void RegisterMovementLOD();
+	void UnregisterMovementLOD();
+
+	/** Interactions move fully even far from players, their montages and root motion need the real floor */
+	void RequestFullMovement(float Seconds);
+
+	/** How long an interaction keeps full movement after it starts or ends */
+	UPROPERTY(EditDefaultsOnly, Category = "Settings|MovementLOD", meta = (AllowPrivateAccess = "true"))
+	float InteractionFullMovementSeconds = 3.f;
+#pragma endregion
+
+#pragma region Streaming
+public:
+	//~ Begin IWorldPartitionStreamingSourceProvider
+	virtual bool GetStreamingSources(TArray<FWorldPartitionStreamingSource>& OutStreamingSources) const override;
+	virtual const UObject* GetStreamingSourceOwner() const override { return this; }
+	//~ End IWorldPartitionStreamingSourceProvider
+
+	/** Off leaves streaming to the player controller's source at the character's position */
+	void SetPredictiveStreaming(bool Enabled) { PredictiveStreaming = Enabled; }
+	FORCEINLINE bool IsPredictiveStreaming() const { return PredictiveStreaming; }
+
+private:
+	/**
+	 * Locally controlled players request the cells ahead of them: one source activates the cells halfway along
+	 * the look-ahead, a second one loads the cells at its end
+	 */
+	UPROPERTY(EditDefaultsOnly, Category = "Settings|Streaming", meta = (AllowPrivateAccess = "true"))
+	bool PredictiveStreaming = true;
+
+	/** Seconds of travel at the current speed the sources look ahead */
+	UPROPERTY(EditDefaultsOnly, Category = "Settings|Streaming", meta = (AllowPrivateAccess = "true"))
+	float StreamingLookAheadSeconds = 4.f;
+
+	UPROPERTY(EditDefaultsOnly, Category = "Settings|Streaming", meta = (AllowPrivateAccess = "true"))
+	float StreamingMaxLookAhead = 10000.f;
+
+	/** Below this speed the player controller's source is enough */
+	UPROPERTY(EditDefaultsOnly, Category = "Settings|Streaming", meta = (AllowPrivateAccess = "true"))
+	float StreamingMinSpeed = 100.f;
+
+	/** How much the look-ahead turns from the velocity towards the control rotation, 0 to 1 */
+	UPROPERTY(EditDefaultsOnly, Category = "Settings|Streaming", meta = (AllowPrivateAccess = "true"))
+	float StreamingControlRotationWeight = 0.3f;
+
+	/** Grid loading range scale of the look-ahead sources at StreamingMaxLookAhead, 1 when standing */
+	UPROPERTY(EditDefaultsOnly, Category = "Settings|Streaming", meta = (AllowPrivateAccess = "true"))
+	float StreamingMaxRangeScale = 1.5f;
+
+	bool StreamingSourceRegistered = false;
+	FName ActivateSourceName;
+	FName PreloadSourceName;
+
+	/** Registers the character as a streaming source while a local player controls it */
+	void UpdateStreamingSource();
+	void UnregisterStreamingSource();
+#pragma endregion
+
+#pragma region Looting
+public:
+	/** Opens the lootable the character looks at, found by ULootInteractionSubsystem, or closes the open one */
+	void ToggleLooting();
+	FORCEINLINE ALootContainer* GetLootTarget() const { return LootTarget; }
+	FORCEINLINE bool IsInteracting() const { return LootTarget != nullptr; }
+
+private:
+	/** Starts at its first section, loops until looting stops, then jumps to LootExitSection */
+	UPROPERTY(EditDefaultsOnly, Category = "Settings|Looting", meta = (AllowPrivateAccess = "true"))
+	UAnimMontage* LootMontage;
+
+	UPROPERTY(EditDefaultsOnly, Category = "Settings|Looting", meta = (AllowPrivateAccess = "true"))
+	FName LootExitSection = "Exit";
+
+	UPROPERTY(Transient)
+	ALootContainer* LootTarget;
+
+	void StartLooting();
+	void StopLooting();
 #pragma endregion
 
 #pragma region Input
@@ -88,6 +237,17 @@ private:
 	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = Input, meta = (AllowPrivateAccess = "true"))
 	UInputAction* SprintAction;
 
+	/** Interact Input Action, starts and stops looting */
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = Input, meta = (AllowPrivateAccess = "true"))
+	UInputAction* InteractAction;
+
+private:
+	void AddInputMappingContext();
+	void RemoveInputMappingContext();
+
+	/** Soak test bots drive the character through the same input handlers as players */
+	friend class ASoakBotController;
+
 protected:
 	/** Called for movement input */
 	void Move(const FInputActionValue& Value);
@@ -98,16 +258,24 @@ protected:
 	/** Called for sptring input */
 	void RunStarted(const FInputActionValue& Value);
 	void RunFinished(const FInputActionValue& Value);
+
+	/** Called for interact input */
+	void Interact(const FInputActionValue& Value);
 #pragma endregion
 
 #pragma region SmoothSpeedTransition
 private:
-	UPROPERTY(EditDefaultsOnly, Category="Settings|Speed", meta = (AllowPrivateAccess = "true"))
-	float MaxSpeedTransitionInterp = 4.f;
-	
-	float TargetMaxSpeed;
+	/** The blend itself runs in UGaitBlendSubsystem, the character never ticks */
+	void CancelGaitBlend();
+#pragma endregion
 
+#pragma region FixedStep
 private:
-	void UpdateMaxSpeed(float DeltaSeconds);
+	/** Shared by the character, its gait blend and its anim instance so all simulate at the same rate */
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category="Settings|FixedStep", meta = (AllowPrivateAccess = "true"))
+	FFixedStepSettings FixedStepSettings;
+
+public:
+	FORCEINLINE const FFixedStepSettings& GetFixedStepSettings() const { return FixedStepSettings; }
 #pragma endregion
 };
@@ -0,0 +1,97 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "CharacterPoolSubsystem.generated.h"
+
+
+class AAIController;
+class ABaseCharacter;
+
+
+USTRUCT()
+struct FCharacterPoolPrewarm
+{
+	GENERATED_BODY()
+
+	UPROPERTY(Config)
+	TSoftClassPtr<ABaseCharacter> CharacterClass;
+
+	UPROPERTY(Config)
+	int32 Count = 0;
+};
+
+USTRUCT()
+struct FCharacterPoolBucket
+{
+	GENERATED_BODY()
+
+	UPROPERTY(Transient)
+	TArray<ABaseCharacter*> Characters;
+};
+
+USTRUCT()
+struct FControllerPoolBucket
+{
+	GENERATED_BODY()
+
+	UPROPERTY(Transient)
+	TArray<AAIController*> Controllers;
+};
+
+/**
+ * Keeps released characters alive and hidden so waves of NPCs don't pay for construction, BeginPlay and
+ * component registration again. Classes listed in PrewarmClasses are filled when the world begins play.
+ * AI controllers are unpossessed and parked by class next to the characters, and possess again on acquire.
+ */
+UCLASS(Config = Game)
+class DAYSGUN_API UCharacterPoolSubsystem : public UWorldSubsystem
+{
+	GENERATED_BODY()
+
+public:
+	virtual void OnWorldBeginPlay(UWorld& InWorld) override;
+	virtual void Deinitialize() override;
+
+	UFUNCTION(BlueprintCallable, Category = "CharacterPool")
+	void Prewarm(TSubclassOf<ABaseCharacter> CharacterClass, int32 Count);
+
+	/**
+	 * Returns a pooled character of exactly this class, or spawns a new one when the pool is empty.
+	 * A pooled controller of ControllerClass possesses it, or of its AIControllerClass when it possesses AI on spawn
+	 */
+	UFUNCTION(BlueprintCallable, Category = "CharacterPool")
+	ABaseCharacter* Acquire(TSubclassOf<ABaseCharacter> CharacterClass, const FTransform& SpawnTransform,
+	                        TSubclassOf<AAIController> ControllerClass = nullptr);
+
+	/** Unpossesses the character and parks it and its AI controller in the pool instead of destroying them */
+	UFUNCTION(BlueprintCallable, Category = "CharacterPool")
+	void Release(ABaseCharacter* Character);
+
+	int32 GetNumPooled(TSubclassOf<ABaseCharacter> CharacterClass) const;
+
+private:
+	ABaseCharacter* SpawnCharacter(TSubclassOf<ABaseCharacter> CharacterClass, const FTransform& SpawnTransform) const;
+
+	/** Possesses the character with a pooled controller of ControllerClass, spawning one when none is parked */
+	void PossessFromPool(ABaseCharacter* Character, TSubclassOf<AAIController> ControllerClass);
+
+	/** Unpossesses and parks an AI controller, player controllers belong to their player and are left alone */
+	void ReleaseController(AController* Controller);
+
+private:
+	UPROPERTY(Config)
+	TArray<FCharacterPoolPrewarm> PrewarmClasses;
+
+	/** Pooled characters are parked here, away from gameplay */
+	UPROPERTY(Config)
+	FVector PoolLocation = FVector(0.f, 0.f, -100000.f);
+
+	UPROPERTY(Transient)
+	TMap<UClass*, FCharacterPoolBucket> Pool;
+
+	UPROPERTY(Transient)
+	TMap<UClass*, FControllerPoolBucket> ControllerPool;
+};
@@ -0,0 +1,70 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Containers/IndexedRegistry.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "Locomotion/FixedStepSimulation.h"
+#include "GaitBlendSubsystem.generated.h"
+
+
+class UCharacterMovementComponent;
+class UGaitProfileSet;
+enum class EGait : uint8;
+
+
+/**
+ * Blends MaxWalkSpeed, MaxAcceleration and BrakingDecelerationWalking into a gait profile for the characters
+ * that are currently changing gait, in one loop over contiguous data. A character is dropped as soon as its
+ * blend finishes, so idle characters cost nothing and the subsystem stops ticking when nobody is blending.
+ */
+UCLASS()
+class DAYSGUN_API UGaitBlendSubsystem : public UTickableWorldSubsystem
+{
+	GENERATED_BODY()
+
+public:
+	virtual void Tick(float DeltaTime) override;
+	virtual bool IsTickable() const override;
+	virtual TStatId GetStatId() const override;
+	virtual void Deinitialize() override;
+
+	/**
+	 * Starts blending from the current movement values into the Gait profile of Profiles. The profile is looked up
+	 * every tick, so a rebuilt set is picked up mid blend and a collected one ends the blend
+	 */
+	void RequestBlend(UCharacterMovementComponent* Movement, const UGaitProfileSet* Profiles, EGait Gait,
+	                  const FFixedStepSettings& FixedStepSettings);
+
+	/** Stops blending without touching the current values */
+	void CancelBlend(const UCharacterMovementComponent* Movement);
+
+	FORCEINLINE int32 GetNumActiveBlends() const { return Entries.Num(); }
+
+private:
+	/** Blend progress, small enough to keep hundreds of characters in a few cache lines */
+	struct FGaitBlendState
+	{
+		float FromSpeed = 0.f;
+		float FromAcceleration = 0.f;
+		float FromBraking = 0.f;
+		float Elapsed = 0.f;
+	};
+
+	struct FGaitBlendEntry
+	{
+		TWeakObjectPtr<UCharacterMovementComponent> Movement;
+		TWeakObjectPtr<const UGaitProfileSet> Profiles;
+		EGait Gait{};
+		FGaitBlendState State;
+		FFixedStepSettings FixedStepSettings;
+		FFixedStepAccumulator Accumulator;
+	};
+
+	/** Advances one entry and returns true once the blend finished */
+	bool UpdateEntry(FGaitBlendEntry& Entry, float DeltaTime) const;
+
+private:
+	TIndexedRegistry<const UCharacterMovementComponent*, FGaitBlendEntry> Entries;
+};
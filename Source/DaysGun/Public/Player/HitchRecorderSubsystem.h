@@ -0,0 +1,199 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Engine/EngineBaseTypes.h"
+#include "HAL/CriticalSection.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "HitchRecorderSubsystem.generated.h"
+
+
+/** Per frame timers of the character systems, each summed over all characters */
+enum class EHitchTimer : uint8
+{
+	AnimUpdate,
+
+	/** Anim graph update, on a worker thread with parallel animation update */
+	ThreadSafeUpdate,
+
+	/** Anim graph evaluation, on a worker thread with parallel animation evaluation */
+	Evaluate,
+
+	PostEvaluateRotation,
+	PostEvaluateLocation,
+	Num,
+};
+
+enum class EHitchEvent : uint8
+{
+	/** Spawned or handed out by the character pool */
+	Spawn,
+
+	/** Detail is the entered ELocomotionState */
+	StateEntered,
+
+	/** Detail is the selected ELocomotionClip */
+	ClipSelected,
+
+	/** Value is the distance of the stop correction sweep */
+	StopCorrection,
+};
+
+/**
+ * Always on flight recorder for hitches: keeps the last HistoryFrames frames of character timings and the last
+ * MaxEvents locomotion events in buffers allocated once, and writes a report of them to Saved/Hitches when a frame
+ * takes longer than HitchThresholdMs. Reports are written on a background thread and rate limited.
+ * Timers are added from any thread: worker threads sum into a slot of their own that the game thread merges once
+ * actors finished ticking, so the hot path takes no lock. Events are game thread only. Each frame also records
+ * what the recorder itself cost, on all threads. Not created in Shipping builds, where the timing scopes compile to
+ * a null check.
+ * DaysGun.Hitch.Status, DaysGun.Hitch.Threshold <Ms>, DaysGun.Hitch.Dump.
+ */
+UCLASS(Config = Game)
+class DAYSGUN_API UHitchRecorderSubsystem : public UTickableWorldSubsystem
+{
+	GENERATED_BODY()
+
+public:
+	virtual bool ShouldCreateSubsystem(UObject* Outer) const override;
+	virtual void Initialize(FSubsystemCollectionBase& Collection) override;
+	virtual void Deinitialize() override;
+	virtual void Tick(float DeltaTime) override;
+	virtual bool IsTickable() const override;
+	virtual TStatId GetStatId() const override;
+
+	void AddTime(EHitchTimer Timer, const UObject* Owner, uint64 Cycles);
+	void AddEvent(EHitchEvent Type, const UObject* Owner, uint8 Detail = 0, float Value = 0.f);
+
+	void SetHitchThresholdMs(float InHitchThresholdMs) { HitchThresholdMs = InHitchThresholdMs; }
+
+	/** Writes a report of the current history right away, regardless of the threshold */
+	void DumpReport();
+
+	void PrintStatus() const;
+
+protected:
+	virtual bool DoesSupportWorldType(const EWorldType::Type WorldType) const override;
+
+private:
+	struct FHitchTimerSums
+	{
+		float TimerMs[static_cast<int32>(EHitchTimer::Num)] = {};
+		float MaxTimerMs[static_cast<int32>(EHitchTimer::Num)] = {};
+		uint16 TimerCounts[static_cast<int32>(EHitchTimer::Num)] = {};
+
+		/** Character behind MaxTimerMs */
+		FName MaxTimerOwners[static_cast<int32>(EHitchTimer::Num)];
+
+		/** Time spent inside the recorder itself */
+		uint64 RecorderCycles = 0;
+
+		void Add(int32 Index, float Ms, const UObject* Owner);
+		void Merge(const FHitchTimerSums& Other);
+	};
+
+	struct FHitchFrame : FHitchTimerSums
+	{
+		uint64 FrameNumber = 0;
+
+		/** Filled in one frame late, once the engine knows how long the frame took */
+		float FrameMs = 0.f;
+		float ActorTickMs = 0.f;
+	};
+
+	/** One per worker thread, only that thread writes it until the game thread merges it */
+	struct alignas(PLATFORM_CACHE_LINE_SIZE) FHitchThreadSlot
+	{
+		FHitchTimerSums Sums;
+		bool Used = false;
+	};
+
+	struct FHitchEventRecord
+	{
+		uint64 FrameNumber = 0;
+		FName Owner;
+		float Value = 0.f;
+		EHitchEvent Type = EHitchEvent::Spawn;
+		uint8 Detail = 0;
+	};
+
+	void MergeThreadSlots();
+
+	const FHitchFrame& GetFrame(int32 Age) const;
+	void WriteReport(const FHitchFrame& HitchFrame);
+
+	void OnPreActorTick(UWorld* InWorld, ELevelTick TickType, float DeltaSeconds);
+	void OnPostActorTick(UWorld* InWorld, ELevelTick TickType, float DeltaSeconds);
+
+private:
+	UPROPERTY(Config)
+	bool Enabled = true;
+
+	UPROPERTY(Config)
+	float HitchThresholdMs = 50.f;
+
+	/** About five seconds at 60 fps */
+	UPROPERTY(Config)
+	int32 HistoryFrames = 300;
+
+	UPROPERTY(Config)
+	int32 MaxEvents = 1024;
+
+	/** Loading and the first frames of a map always hitch */
+	UPROPERTY(Config)
+	int32 WarmupFrames = 120;
+
+	UPROPERTY(Config)
+	float MinSecondsBetweenReports = 10.f;
+
+	UPROPERTY(Config)
+	int32 MaxReportsPerWorld = 20;
+
+	/** Ring buffers, allocated once in Initialize */
+	TArray<FHitchFrame> Frames;
+	TArray<FHitchEventRecord> Events;
+	int32 FrameHead = INDEX_NONE;
+	int32 NumFrames = 0;
+	int32 EventHead = INDEX_NONE;
+	int32 NumEvents = 0;
+	uint64 TotalFrames = 0;
+
+	FHitchFrame CurrentFrame;
+	uint64 PreActorCycles = 0;
+
+	/** Worker threads past MaxThreadSlots share the last slot under OverflowLock */
+	static constexpr int32 MaxThreadSlots = 64;
+	TArray<FHitchThreadSlot> ThreadSlots;
+	FCriticalSection OverflowLock;
+
+	int32 NumReports = 0;
+	double LastReportTime = -UE_BIG_NUMBER;
+
+	FDelegateHandle PreActorTickHandle;
+	FDelegateHandle PostActorTickHandle;
+};
+
+/** Adds the time until the end of the scope to a timer, nothing without a recorder */
+struct FHitchRecorderScope
+{
+	FORCEINLINE FHitchRecorderScope(UHitchRecorderSubsystem* InRecorder, EHitchTimer InTimer, const UObject* InOwner)
+		: Recorder(InRecorder), Owner(InOwner), Timer(InTimer),
+		  StartCycles(InRecorder ? FPlatformTime::Cycles64() : 0)
+	{
+	}
+
+	FORCEINLINE ~FHitchRecorderScope()
+	{
+		if (Recorder)
+		{
+			Recorder->AddTime(Timer, Owner, FPlatformTime::Cycles64() - StartCycles);
+		}
+	}
+
+private:
+	UHitchRecorderSubsystem* Recorder;
+	const UObject* Owner;
+	EHitchTimer Timer;
+	uint64 StartCycles;
+};
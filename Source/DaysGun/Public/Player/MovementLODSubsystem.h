@@ -0,0 +1,131 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Containers/IndexedRegistry.h"
+#include "Debug/SubsystemBenchmark.h"
+#include "Engine/EngineBaseTypes.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "MovementLODSubsystem.generated.h"
+
+
+class ABaseCharacter;
+class UCharacterMovementComponent;
+class UMovementLODSubsystem;
+
+
+UENUM()
+enum class EMovementLOD : uint8
+{
+	/** Walking with capsule sweeps and floor traces, ticked by the movement component itself */
+	Full,
+
+	/** MOVE_NavWalking without sweeps, ticked with every other cheap character in one batch */
+	NavWalking,
+};
+
+/**
+ * Moves all NavWalking characters in one go before their meshes. Controllers are not prerequisites: one tick
+ * function can't follow hundreds of them, and input a controller adds after the batch moves the next frame.
+ */
+struct FMovementLODBatchTick : public FTickFunction
+{
+	UMovementLODSubsystem* Subsystem = nullptr;
+
+	virtual void ExecuteTick(float DeltaTime, ELevelTick TickType, ENamedThreads::Type CurrentThread,
+	                         const FGraphEventRef& MyCompletionGraphEvent) override;
+	virtual FString DiagnosticMessage() override { return TEXT("FMovementLODBatchTick"); }
+};
+
+/**
+ * Drops background characters to a cheap movement mode: MOVE_NavWalking projects onto the navmesh instead of
+ * sweeping the capsule and finding the floor, and their movement components stop ticking on their own and are
+ * ticked together from one tick function instead. They still run the movement component's own velocity and
+ * acceleration code, so UPlayerAnimInstance reads the same data as for full movement.
+ * Player controlled characters, characters near a player, interacting characters and characters asked for full
+ * movement keep walking normally. Only characters simulated locally with authority are considered.
+ */
+UCLASS(Config = Game)
+class DAYSGUN_API UMovementLODSubsystem : public UTickableWorldSubsystem
+{
+	GENERATED_BODY()
+
+public:
+	virtual void Tick(float DeltaTime) override;
+	virtual bool IsTickable() const override;
+	virtual TStatId GetStatId() const override;
+	virtual void Deinitialize() override;
+
+	void Register(ABaseCharacter* Character);
+
+	/** Hands the character back with full movement */
+	void Unregister(const ABaseCharacter* Character);
+
+	/** Full movement right away and for at least Seconds, e.g. when the character starts or ends an interaction */
+	void RequestFullMovement(const ABaseCharacter* Character, float Seconds);
+
+	/** Overrides distance based selection for every character, for benchmarks and debugging */
+	void SetForcedLOD(TOptional<EMovementLOD> LOD);
+
+	/** Spawns Count bots, measures Seconds with full movement and Seconds with NavWalking, then logs both */
+	void StartBenchmark(int32 Count, float Seconds);
+
+	void PrintStats() const;
+
+private:
+	friend struct FMovementLODBatchTick;
+
+	struct FMovementLODEntry
+	{
+		TWeakObjectPtr<ABaseCharacter> Character;
+		EMovementLOD LOD = EMovementLOD::Full;
+		float FullMovementUntil = 0.f;
+		float SavedProjectionInterval = 0.f;
+		bool SavedSweepWhileNavWalking = true;
+	};
+
+	struct FBenchmarkPhase
+	{
+		int32 Frames = 0;
+		double FrameMs = 0.0;
+		double BatchMs = 0.0;
+		int64 NavWalking = 0;
+	};
+
+	void TickBatch(float DeltaTime);
+	void UpdateLODs();
+	bool WantsNavWalking(const FMovementLODEntry& Entry, const TArray<FVector>& PlayerLocations) const;
+	void SetLOD(FMovementLODEntry& Entry, EMovementLOD LOD);
+	void RemoveAt(int32 Index);
+
+	void TickBenchmark(float DeltaTime);
+	void FinishBenchmark();
+
+private:
+	/** Characters closer than this to a player pawn always move fully */
+	UPROPERTY(Config)
+	float FullMovementDistance = 3000.f;
+
+	/** Extra distance before a character drops back to NavWalking, so it does not flip at the border */
+	UPROPERTY(Config)
+	float Hysteresis = 500.f;
+
+	UPROPERTY(Config)
+	float UpdateInterval = 0.5f;
+
+	/** UCharacterMovementComponent::NavMeshProjectionInterval while NavWalking */
+	UPROPERTY(Config)
+	float NavMeshProjectionInterval = 0.2f;
+
+	TIndexedRegistry<const ABaseCharacter*, FMovementLODEntry> Entries;
+
+	FMovementLODBatchTick BatchTick;
+	int32 NumNavWalking = 0;
+	float UpdateTimeLeft = 0.f;
+	double LastBatchMs = 0.0;
+	TOptional<EMovementLOD> ForcedLOD;
+
+	FSubsystemBenchmark Benchmark;
+	FBenchmarkPhase BenchmarkPhases[2];
+};
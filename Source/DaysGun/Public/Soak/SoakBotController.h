@@ -0,0 +1,95 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "AIController.h"
+#include "SoakBotController.generated.h"
+
+
+class ABaseCharacter;
+class UCrowdSteeringSubsystem;
+
+
+UENUM()
+enum class ESoakBotAction : uint8
+{
+	Idle,
+	Walk,
+	Run,
+	Crouch,
+	Jump,
+	Num UMETA(Hidden),
+};
+
+/**
+ * Wanders a character around its home through ABaseCharacter::Move, RunStarted/RunFinished and Jump, the same
+ * paths player input takes, switching between idling, walking, running, crouching and jumping at random so
+ * every locomotion state, start angle and gait transition gets exercised.
+ * While its character is a UCrowdSteeringSubsystem agent the bot stands by and leaves the moving to the crowd.
+ */
+UCLASS(Config = Game)
+class DAYSGUN_API ASoakBotController : public AAIController
+{
+	GENERATED_BODY()
+
+public:
+	ASoakBotController();
+
+	virtual void Tick(float DeltaSeconds) override;
+
+	/** Bots turn back towards Home once they wander further than Radius from it */
+	void SetHome(const FVector& InHome, float Radius);
+
+	FORCEINLINE ESoakBotAction GetAction() const { return Action; }
+
+protected:
+	virtual void OnPossess(APawn* InPawn) override;
+	virtual void OnUnPossess() override;
+
+private:
+	void ChooseNextAction();
+	void BeginAction(ESoakBotAction NewAction);
+	void EndAction();
+	void UpdateHeading();
+
+private:
+	/** Relative chance of each action being picked next */
+	UPROPERTY(Config, meta = (ArraySizeEnum = "ESoakBotAction"))
+	float ActionWeights[(int32)ESoakBotAction::Num];
+
+	/** Seconds an action lasts, picked between X and Y */
+	UPROPERTY(Config)
+	FVector2D IdleDuration = FVector2D(0.5f, 3.f);
+
+	UPROPERTY(Config)
+	FVector2D MoveDuration = FVector2D(1.f, 6.f);
+
+	/** Seconds the jump input is held */
+	UPROPERTY(Config)
+	float JumpHoldDuration = 0.3f;
+
+	/** Chance of turning when a new action starts, so starts and gait changes happen at any angle */
+	UPROPERTY(Config)
+	float TurnChance = 0.6f;
+
+	UPROPERTY(Config)
+	float MaxTurnAngle = 180.f;
+
+	UPROPERTY(Transient)
+	ABaseCharacter* BotCharacter;
+
+	UPROPERTY(Transient)
+	UCrowdSteeringSubsystem* CrowdSteering;
+
+	FRandomStream Random;
+	ESoakBotAction Action = ESoakBotAction::Idle;
+	float ActionTimeLeft = 0.f;
+	float Heading = 0.f;
+
+	/** The character's own bCanCrouch, restored on unpossess */
+	bool CouldCrouch = false;
+
+	FVector Home = FVector::ZeroVector;
+	float HomeRadius = 0.f;
+};
@@ -0,0 +1,157 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Engine/EngineBaseTypes.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "SoakTestSubsystem.generated.h"
+
+
+class ABaseCharacter;
+
+
+/** Averages over one step of the ramp, all times in milliseconds */
+struct FSoakStepResult
+{
+	int32 Bots = 0;
+	int32 Frames = 0;
+
+	/** Frame time without the wait for the max tick rate */
+	double FrameMs = 0.0;
+	double PeakFrameMs = 0.0;
+
+	/** World tick up to the actor tick, network receive among others */
+	double PreActorMs = 0.0;
+
+	/** Actor and component ticks, movement, animation and the bots themselves */
+	double ActorMs = 0.0;
+
+	/** UDaysGunReplicationGraph::ServerReplicateActors, 0 without the replication graph */
+	double ReplicateMs = 0.0;
+
+	uint64 UsedPhysicalMB = 0;
+};
+
+/**
+ * Finds how many characters a server sustains: spawns ASoakBotController driven characters in steps until the
+ * average frame time of a step exceeds FrameBudgetMs, falls back to the last step within budget and holds it
+ * for HoldSeconds to watch memory growth, then logs the report.
+ *
+ * Headless: run the map with -server -log -DaysGunSoak [-SoakBudgetMs=33.3] [-SoakStep=10] [-SoakMaxBots=1000]
+ * [-SoakHoldSeconds=1800] [-SoakExit]. In a running game: DaysGun.Soak.Start, DaysGun.Soak.Stop, DaysGun.Soak.Report.
+ */
+UCLASS(Config = Game)
+class DAYSGUN_API USoakTestSubsystem : public UTickableWorldSubsystem
+{
+	GENERATED_BODY()
+
+public:
+	virtual void OnWorldBeginPlay(UWorld& InWorld) override;
+	virtual void Deinitialize() override;
+	virtual void Tick(float DeltaTime) override;
+	virtual bool IsTickable() const override;
+	virtual TStatId GetStatId() const override;
+
+	void StartSoak();
+	void StopSoak();
+	void PrintReport() const;
+
+	FORCEINLINE int32 GetNumBots() const { return Bots.Num(); }
+	FORCEINLINE TConstArrayView<ABaseCharacter*> GetBots() const { return Bots; }
+
+	/** Bots outside of a soak run, e.g. for benchmarks that need moving characters */
+	void SpawnBotsAround(int32 Count, const FVector& Center);
+	void ReleaseBots();
+
+	/** Budget and ramp can be overridden per run, e.g. from the command line or the console */
+	void SetFrameBudgetMs(float InFrameBudgetMs) { FrameBudgetMs = InFrameBudgetMs; }
+	void SetBotsPerStep(int32 InBotsPerStep) { BotsPerStep = InBotsPerStep; }
+	void SetMaxBots(int32 InMaxBots) { MaxBots = InMaxBots; }
+	void SetHoldSeconds(float InHoldSeconds) { HoldSeconds = InHoldSeconds; }
+
+private:
+	enum class EPhase : uint8
+	{
+		Off,
+		Ramping,
+		Holding,
+	};
+
+	void SetNumBots(int32 Count);
+	void SpawnBot();
+	void ReleaseBot();
+	TSubclassOf<ABaseCharacter> GetBotClass() const;
+
+	void BeginStep();
+	void FinishStep();
+	void BeginHold();
+	void FinishSoak();
+	void SampleMemory();
+
+	void OnWorldTickStart(UWorld* InWorld, ELevelTick TickType, float DeltaSeconds);
+	void OnPreActorTick(UWorld* InWorld, ELevelTick TickType, float DeltaSeconds);
+	void OnPostActorTick(UWorld* InWorld, ELevelTick TickType, float DeltaSeconds);
+
+private:
+	/** Character bots drive, the game mode's default pawn when empty */
+	UPROPERTY(Config)
+	TSoftClassPtr<ABaseCharacter> BotCharacterClass;
+
+	UPROPERTY(Config)
+	int32 InitialBots = 10;
+
+	UPROPERTY(Config)
+	int32 BotsPerStep = 10;
+
+	UPROPERTY(Config)
+	int32 MaxBots = 1000;
+
+	/** Seconds per ramp step, the first WarmupSeconds of a step are not measured */
+	UPROPERTY(Config)
+	float StepSeconds = 20.f;
+
+	UPROPERTY(Config)
+	float WarmupSeconds = 5.f;
+
+	/** 30 Hz server tick */
+	UPROPERTY(Config)
+	float FrameBudgetMs = 33.3f;
+
+	UPROPERTY(Config)
+	float HoldSeconds = 1800.f;
+
+	UPROPERTY(Config)
+	float MemorySampleSeconds = 60.f;
+
+	/** Bots spawn and wander within this distance of the first player start */
+	UPROPERTY(Config)
+	float SpawnRadius = 5000.f;
+
+	UPROPERTY(Transient)
+	TArray<ABaseCharacter*> Bots;
+
+	EPhase Phase = EPhase::Off;
+	float PhaseTime = 0.f;
+	float NextMemorySample = 0.f;
+	bool ExitWhenDone = false;
+
+	FVector Home = FVector::ZeroVector;
+	FRandomStream Random;
+
+	int32 SustainableBots = 0;
+	FSoakStepResult CurrentStep;
+	TArray<FSoakStepResult> Steps;
+
+	uint64 HoldStartUsedPhysical = 0;
+	TArray<uint64> MemorySamples;
+
+	uint64 TickStartCycles = 0;
+	uint64 PreActorCycles = 0;
+	uint64 PendingPreActorCycles = 0;
+	uint64 PendingActorCycles = 0;
+
+	FDelegateHandle TickStartHandle;
+	FDelegateHandle PreActorTickHandle;
+	FDelegateHandle PostActorTickHandle;
+};
@@ -0,0 +1,97 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "StreamingFlyThroughSubsystem.generated.h"
+
+
+class ABaseCharacter;
+
+
+/**
+ * Repeatable World Partition streaming test: flies the local player's character along a path at a fixed speed with
+ * collision off, and counts hitch frames and late cell loads, runs of frames in which cells within LateLoadRadius
+ * of the character were not activated yet. The path runs through the always loaded actors tagged PathTag in name
+ * order, or straight ahead of the character when there are none. Flying starts once the cells around the first
+ * point are activated. Restart the map between runs, cells loaded by one run would hide the late loads of the next.
+ * DaysGun.Streaming.FlyThrough [Predictive=1] [Speed] [Seconds], DaysGun.Streaming.Stop.
+ */
+UCLASS(Config = Game)
+class DAYSGUN_API UStreamingFlyThroughSubsystem : public UTickableWorldSubsystem
+{
+	GENERATED_BODY()
+
+public:
+	virtual void Deinitialize() override;
+	virtual void Tick(float DeltaTime) override;
+	virtual bool IsTickable() const override;
+	virtual TStatId GetStatId() const override;
+
+	/** Predictive switches the character's look-ahead streaming source, Speed 0 flies at its run speed */
+	void StartFlyThrough(bool Predictive, float InSpeed, float Seconds);
+	void StopFlyThrough();
+
+protected:
+	virtual bool DoesSupportWorldType(const EWorldType::Type WorldType) const override;
+
+private:
+	enum class EFlyThroughPhase : uint8
+	{
+		Idle,
+		Settling,
+		Flying,
+	};
+
+	struct FFlyThroughResult
+	{
+		int32 Frames = 0;
+		double FrameMs = 0.0;
+		double PeakFrameMs = 0.0;
+		int32 Hitches = 0;
+		int32 LateFrames = 0;
+		int32 LateLoads = 0;
+	};
+
+	void BuildPath(float Seconds);
+	FVector GetPathLocation(float Distance, FVector& OutDirection) const;
+	bool IsStreamingCompleted(const FVector& Location, float Radius) const;
+
+	void TickSettling(float DeltaTime);
+	void TickFlying(float DeltaTime);
+	void FinishFlyThrough();
+
+private:
+	UPROPERTY(Config)
+	float HitchThresholdMs = 50.f;
+
+	/** Cells this close to the character should have been activated before it arrives */
+	UPROPERTY(Config)
+	float LateLoadRadius = 2000.f;
+
+	/** Flying starts anyway when the cells around the first point take longer */
+	UPROPERTY(Config)
+	float MaxSettleSeconds = 30.f;
+
+	UPROPERTY(Config)
+	FName PathTag = "FlyThrough";
+
+	UPROPERTY(Transient)
+	ABaseCharacter* FlyCharacter;
+
+	TArray<FVector> Path;
+
+	/** Distance along the path at each point */
+	TArray<float> PathDistances;
+
+	EFlyThroughPhase Phase = EFlyThroughPhase::Idle;
+	float Speed = 0.f;
+	float Distance = 0.f;
+	float PhaseTime = 0.f;
+	bool Predictive = true;
+	bool SavedPredictive = true;
+	bool WasLate = false;
+
+	FFlyThroughResult Result;
+};
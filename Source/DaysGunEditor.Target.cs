@@ -10,6 +10,6 @@ public class DaysGunEditorTarget : TargetRules
 		Type = TargetType.Editor;
 		DefaultBuildSettings = BuildSettingsVersion.V2;
 
-		ExtraModuleNames.AddRange( new string[] { "DaysGun" } );
+		ExtraModuleNames.AddRange( new string[] { "DaysGun", "DaysGunEditor" } );
 	}
 }
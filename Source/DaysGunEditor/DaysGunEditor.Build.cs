@@ -0,0 +1,15 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+using UnrealBuildTool;
+
+public class DaysGunEditor : ModuleRules
+{
+	public DaysGunEditor(ReadOnlyTargetRules Target) : base(Target)
+	{
+		PCHUsage = PCHUsageMode.UseExplicitOrSharedPCHs;
+
+		PublicDependencyModuleNames.AddRange(new string[] { "Core", "CoreUObject", "Engine", "DaysGun" });
+
+		PrivateDependencyModuleNames.AddRange(new string[] { "Slate", "SlateCore", "TraceAnalysis", "TraceServices", "RewindDebuggerInterface" });
+	}
+}
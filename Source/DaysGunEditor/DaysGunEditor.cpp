@@ -0,0 +1,34 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "DaysGunEditor.h"
+
+#include "Features/IModularFeatures.h"
+#include "Locomotion/LocomotionRewindTrack.h"
+#include "Locomotion/LocomotionTraceProvider.h"
+#include "Modules/ModuleManager.h"
+
+DEFINE_LOG_CATEGORY(LogDaysGunEditor);
+
+void FDaysGunEditorModule::StartupModule()
+{
+	LocomotionTraceModule = MakeUnique<FLocomotionTraceModule>();
+	LocomotionTrackCreator = MakeUnique<FLocomotionRewindTrackCreator>();
+
+	auto& ModularFeatures = IModularFeatures::Get();
+	ModularFeatures.RegisterModularFeature(TraceServices::ModuleFeatureName, LocomotionTraceModule.Get());
+	ModularFeatures.RegisterModularFeature(RewindDebugger::IRewindDebuggerTrackCreator::ModularFeatureName,
+	                                       LocomotionTrackCreator.Get());
+}
+
+void FDaysGunEditorModule::ShutdownModule()
+{
+	auto& ModularFeatures = IModularFeatures::Get();
+	ModularFeatures.UnregisterModularFeature(RewindDebugger::IRewindDebuggerTrackCreator::ModularFeatureName,
+	                                         LocomotionTrackCreator.Get());
+	ModularFeatures.UnregisterModularFeature(TraceServices::ModuleFeatureName, LocomotionTraceModule.Get());
+
+	LocomotionTrackCreator.Reset();
+	LocomotionTraceModule.Reset();
+}
+
+IMPLEMENT_MODULE(FDaysGunEditorModule, DaysGunEditor);
@@ -0,0 +1,23 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Modules/ModuleInterface.h"
+
+DECLARE_LOG_CATEGORY_EXTERN(LogDaysGunEditor, Log, All);
+
+class FLocomotionTraceModule;
+class FLocomotionRewindTrackCreator;
+
+/** Editor only tooling, registers the locomotion decision track with the Rewind Debugger */
+class FDaysGunEditorModule : public IModuleInterface
+{
+public:
+	virtual void StartupModule() override;
+	virtual void ShutdownModule() override;
+
+private:
+	TUniquePtr<FLocomotionTraceModule> LocomotionTraceModule;
+	TUniquePtr<FLocomotionRewindTrackCreator> LocomotionTrackCreator;
+};
@@ -0,0 +1,175 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "Locomotion/LocomotionRewindTrack.h"
+
+#include "Animation/AnimInstance.h"
+#include "IRewindDebugger.h"
+#include "Locomotion/LocomotionTraceProvider.h"
+#include "Styling/SlateIconFinder.h"
+#include "Widgets/Text/STextBlock.h"
+
+#define LOCTEXT_NAMESPACE "LocomotionRewindTrack"
+
+namespace
+{
+	const FName TrackName(TEXT("DaysGunLocomotion"));
+
+	FText GetStateText(ELocomotionState State)
+	{
+		return StaticEnum<ELocomotionState>()->GetDisplayNameTextByValue(static_cast<int64>(State));
+	}
+
+	FText GetClipText(ELocomotionClip Clip)
+	{
+		return StaticEnum<ELocomotionClip>()->GetDisplayNameTextByValue(static_cast<int64>(Clip));
+	}
+
+	FLinearColor GetStateColor(ELocomotionState State)
+	{
+		switch (State)
+		{
+		case ELocomotionState::ELS_Walk: return FLinearColor(0.2f, 0.6f, 0.2f);
+		case ELocomotionState::ELS_Run: return FLinearColor(0.8f, 0.5f, 0.1f);
+		case ELocomotionState::ELS_Jump: return FLinearColor(0.3f, 0.4f, 0.9f);
+		default: return FLinearColor(0.35f, 0.35f, 0.35f);
+		}
+	}
+
+	/** Extends the state window while the state holds, decisions become points */
+	void AddRecord(SEventTimelineView::FTimelineEventData& Data, const FLocomotionRecord& Record,
+	               TOptional<ELocomotionState> PrevState)
+	{
+		if (PrevState == Record.LocomotionState)
+		{
+			Data.Windows.Last().TimeEnd = Record.Time;
+		}
+		else
+		{
+			const auto StateText = GetStateText(Record.LocomotionState);
+			Data.Windows.Add({Record.Time, Record.Time, StateText, StateText, GetStateColor(Record.LocomotionState)});
+		}
+
+		if (Record.Clip == ELocomotionClip::ELC_None) return;
+
+		const auto ClipText = GetClipText(Record.Clip);
+		const auto Description = FText::Format(LOCTEXT("Decision", "{0}, speed {1}, start angle {2}"), ClipText,
+		                                       FText::AsNumber(FMath::RoundToInt(Record.GroundSpeed)),
+		                                       FText::AsNumber(FMath::RoundToInt(Record.StartAngle)));
+		Data.Points.Add({Record.Time, ClipText, Description, FLinearColor::White});
+	}
+
+	const FLocomotionTraceProvider* ReadProvider(const TraceServices::IAnalysisSession* Session)
+	{
+		return Session
+			       ? Session->ReadProvider<FLocomotionTraceProvider>(FLocomotionTraceProvider::ProviderName)
+			       : nullptr;
+	}
+}
+
+FLocomotionRewindTrack::FLocomotionRewindTrack(uint64 InObjectId)
+	: ObjectId(InObjectId), EventData(MakeShared<SEventTimelineView::FTimelineEventData>())
+{
+}
+
+bool FLocomotionRewindTrack::UpdateInternal()
+{
+	const auto RewindDebugger = IRewindDebugger::Instance();
+	const auto Session = RewindDebugger->GetAnalysisSession();
+	if (!Session) return false;
+
+	TraceServices::FAnalysisSessionReadScope ReadScope(*Session);
+	const auto Provider = ReadProvider(Session);
+	const auto Timeline = Provider ? Provider->FindTimeline(ObjectId) : nullptr;
+	if (!Timeline) return false;
+
+	// Rebuilt for the visible range only, a long session has far more frames than fit on screen
+	auto NewEventData = MakeShared<SEventTimelineView::FTimelineEventData>();
+	TOptional<ELocomotionState> PrevState;
+	const auto ViewRange = RewindDebugger->GetCurrentViewRange();
+	Timeline->EnumerateEvents(ViewRange.GetLowerBoundValue(), ViewRange.GetUpperBoundValue(),
+	                          [&](double StartTime, double EndTime, uint32 Depth, const FLocomotionRecord& Record)
+	                          {
+		                          AddRecord(*NewEventData, Record, PrevState);
+		                          PrevState = Record.LocomotionState;
+		                          return TraceServices::EEventEnumerate::Continue;
+	                          });
+	EventData = NewEventData;
+
+	FLocomotionRecord Record;
+	if (Provider->FindFrame(ObjectId, RewindDebugger->CurrentTraceTime(), Record))
+	{
+		DetailsText = FText::FromString(FString::Printf(
+			TEXT("%s for %.2f s\nspeed %.1f\nstart angle %.1f\nvel.acc %.2f\nfoot phase %.2f\nclip %s"),
+			*GetStateText(Record.LocomotionState).ToString(), Record.TimeInLocomotionState, Record.GroundSpeed,
+			Record.StartAngle, Record.VelocityAccelerationDot, Record.FootPhase, *GetClipText(Record.Clip).ToString()));
+	}
+	else
+	{
+		DetailsText = LOCTEXT("NoFrame", "No decision frame at this time");
+	}
+
+	return false;
+}
+
+TSharedPtr<SWidget> FLocomotionRewindTrack::GetTimelineViewInternal()
+{
+	return SNew(SEventTimelineView)
+		.ViewRange_Lambda([]() { return IRewindDebugger::Instance()->GetCurrentViewRange(); })
+		.EventData_Raw(this, &FLocomotionRewindTrack::GetEventData);
+}
+
+TSharedPtr<SWidget> FLocomotionRewindTrack::GetDetailsViewInternal()
+{
+	return SNew(STextBlock).Text_Raw(this, &FLocomotionRewindTrack::GetDetailsText);
+}
+
+FSlateIcon FLocomotionRewindTrack::GetIconInternal()
+{
+	return FSlateIconFinder::FindIconForClass(UAnimInstance::StaticClass());
+}
+
+FName FLocomotionRewindTrack::GetNameInternal() const
+{
+	return TrackName;
+}
+
+FText FLocomotionRewindTrack::GetDisplayNameInternal() const
+{
+	return LOCTEXT("TrackDisplayName", "Locomotion Decisions");
+}
+
+FName FLocomotionRewindTrackCreator::GetTargetTypeNameInternal() const
+{
+	static const FName TargetTypeName(TEXT("PlayerAnimInstance"));
+	return TargetTypeName;
+}
+
+FName FLocomotionRewindTrackCreator::GetNameInternal() const
+{
+	return TrackName;
+}
+
+void FLocomotionRewindTrackCreator::GetTrackTypesInternal(
+	TArray<RewindDebugger::FRewindDebuggerTrackType>& Types) const
+{
+	Types.Add({TrackName, LOCTEXT("TrackTypeName", "Locomotion Decisions")});
+}
+
+TSharedPtr<RewindDebugger::FRewindDebuggerTrack> FLocomotionRewindTrackCreator::CreateTrackInternal(
+	uint64 ObjectId) const
+{
+	return MakeShared<FLocomotionRewindTrack>(ObjectId);
+}
+
+bool FLocomotionRewindTrackCreator::HasDebugInfoInternal(uint64 ObjectId) const
+{
+	const auto Session = IRewindDebugger::Instance()->GetAnalysisSession();
+	if (!Session) return false;
+
+	TraceServices::FAnalysisSessionReadScope ReadScope(*Session);
+	const auto Provider = ReadProvider(Session);
+	return Provider && Provider->FindTimeline(ObjectId);
+}
+
+#undef LOCTEXT_NAMESPACE
@@ -0,0 +1,45 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "IRewindDebuggerTrackCreator.h"
+#include "RewindDebuggerTrack.h"
+#include "SEventTimelineView.h"
+
+
+/**
+ * Rewind Debugger track of a UPlayerAnimInstance: locomotion states as windows, start, stop and gait transition
+ * choices as points, and the decision inputs at the scrub time in the details panel
+ */
+class FLocomotionRewindTrack : public RewindDebugger::FRewindDebuggerTrack
+{
+public:
+	explicit FLocomotionRewindTrack(uint64 InObjectId);
+
+private:
+	virtual bool UpdateInternal() override;
+	virtual TSharedPtr<SWidget> GetTimelineViewInternal() override;
+	virtual TSharedPtr<SWidget> GetDetailsViewInternal() override;
+	virtual FSlateIcon GetIconInternal() override;
+	virtual FName GetNameInternal() const override;
+	virtual FText GetDisplayNameInternal() const override;
+	virtual uint64 GetObjectIdInternal() const override { return ObjectId; }
+
+	TSharedPtr<SEventTimelineView::FTimelineEventData> GetEventData() const { return EventData; }
+	FText GetDetailsText() const { return DetailsText; }
+
+	uint64 ObjectId;
+	TSharedPtr<SEventTimelineView::FTimelineEventData> EventData;
+	FText DetailsText;
+};
+
+class FLocomotionRewindTrackCreator : public RewindDebugger::IRewindDebuggerTrackCreator
+{
+private:
+	virtual FName GetTargetTypeNameInternal() const override;
+	virtual FName GetNameInternal() const override;
+	virtual void GetTrackTypesInternal(TArray<RewindDebugger::FRewindDebuggerTrackType>& Types) const override;
+	virtual TSharedPtr<RewindDebugger::FRewindDebuggerTrack> CreateTrackInternal(uint64 ObjectId) const override;
+	virtual bool HasDebugInfoInternal(uint64 ObjectId) const override;
+};
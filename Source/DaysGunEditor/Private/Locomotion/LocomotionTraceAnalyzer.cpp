@@ -0,0 +1,44 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "Locomotion/LocomotionTraceAnalyzer.h"
+
+#include "Locomotion/LocomotionTraceProvider.h"
+#include "TraceServices/Model/AnalysisSession.h"
+
+FLocomotionTraceAnalyzer::FLocomotionTraceAnalyzer(TraceServices::IAnalysisSession& InSession,
+                                                   FLocomotionTraceProvider& InProvider)
+	: Session(InSession), Provider(InProvider)
+{
+}
+
+void FLocomotionTraceAnalyzer::OnAnalysisBegin(const FOnAnalysisContext& Context)
+{
+	Context.InterfaceBuilder.RouteEvent(RouteId_DecisionFrame, "DaysGunLocomotion", "DecisionFrame");
+}
+
+bool FLocomotionTraceAnalyzer::OnEvent(uint16 RouteId, EStyle Style, const FOnEventContext& Context)
+{
+	TraceServices::FAnalysisSessionEditScope EditScope(Session);
+
+	if (RouteId != RouteId_DecisionFrame) return true;
+
+	// Field names match UE_TRACE_EVENT_BEGIN(DaysGunLocomotion, DecisionFrame) in LocomotionRecorderSubsystem.cpp
+	const auto& EventData = Context.EventData;
+	const auto Time = Context.EventTime.AsSeconds(EventData.GetValue<uint64>("Cycle"));
+
+	FLocomotionRecord Record;
+	Record.Time = Time;
+	Record.StartAngle = EventData.GetValue<float>("StartAngle");
+	Record.GroundSpeed = EventData.GetValue<float>("GroundSpeed");
+	Record.VelocityAccelerationDot = EventData.GetValue<float>("VelocityAccelerationDot");
+	Record.TimeInLocomotionState = EventData.GetValue<float>("TimeInLocomotionState");
+	Record.FootPhase = EventData.GetValue<float>("FootPhase");
+	Record.LocomotionState = static_cast<ELocomotionState>(EventData.GetValue<uint8>("LocomotionState"));
+	Record.Events = static_cast<ELocomotionDecisionEvents>(EventData.GetValue<uint8>("Events"));
+	Record.Clip = static_cast<ELocomotionClip>(EventData.GetValue<uint8>("Clip"));
+
+	Session.UpdateDurationSeconds(Time);
+	Provider.AppendDecisionFrame(EventData.GetValue<uint64>("AnimInstanceId"), Record);
+	return true;
+}
@@ -0,0 +1,33 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Trace/Analyzer.h"
+
+class FLocomotionTraceProvider;
+
+namespace TraceServices
+{
+	class IAnalysisSession;
+}
+
+
+/** Reads the DaysGunLocomotion.DecisionFrame events ULocomotionRecorderSubsystem traces */
+class FLocomotionTraceAnalyzer : public UE::Trace::IAnalyzer
+{
+public:
+	FLocomotionTraceAnalyzer(TraceServices::IAnalysisSession& InSession, FLocomotionTraceProvider& InProvider);
+
+	virtual void OnAnalysisBegin(const FOnAnalysisContext& Context) override;
+	virtual bool OnEvent(uint16 RouteId, EStyle Style, const FOnEventContext& Context) override;
+
+private:
+	enum : uint16
+	{
+		RouteId_DecisionFrame,
+	};
+
+	TraceServices::IAnalysisSession& Session;
+	FLocomotionTraceProvider& Provider;
+};
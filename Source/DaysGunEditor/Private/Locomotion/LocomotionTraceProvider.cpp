@@ -0,0 +1,74 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "Locomotion/LocomotionTraceProvider.h"
+
+#include "Locomotion/LocomotionTraceAnalyzer.h"
+
+namespace
+{
+	/** How far back the frame at a scrub time is looked for, decision steps are much closer than this */
+	constexpr double FrameSearchSeconds = 1.0;
+}
+
+const FName FLocomotionTraceProvider::ProviderName(TEXT("DaysGunLocomotionProvider"));
+
+FLocomotionTraceProvider::FLocomotionTraceProvider(TraceServices::IAnalysisSession& InSession)
+	: Session(InSession)
+{
+}
+
+void FLocomotionTraceProvider::AppendDecisionFrame(uint64 AnimInstanceId, const FLocomotionRecord& Record)
+{
+	Session.WriteAccessCheck();
+
+	auto* Timeline = Timelines.Find(AnimInstanceId);
+	if (!Timeline)
+	{
+		Timeline = &Timelines.Add(AnimInstanceId, MakeShared<FTimeline>(Session.GetLinearAllocator()));
+	}
+	(*Timeline)->AppendEvent(Record.Time, Record);
+}
+
+const FLocomotionTraceProvider::FTimeline* FLocomotionTraceProvider::FindTimeline(uint64 AnimInstanceId) const
+{
+	Session.ReadAccessCheck();
+
+	const auto Timeline = Timelines.Find(AnimInstanceId);
+	return Timeline ? &Timeline->Get() : nullptr;
+}
+
+bool FLocomotionTraceProvider::FindFrame(uint64 AnimInstanceId, double Time, FLocomotionRecord& OutRecord) const
+{
+	const auto Timeline = FindTimeline(AnimInstanceId);
+	if (!Timeline) return false;
+
+	// Frames are appended in time order, the last one enumerated up to Time is the newest
+	bool Found = false;
+	Timeline->EnumerateEvents(Time - FrameSearchSeconds, Time,
+	                          [&](double StartTime, double EndTime, uint32 Depth, const FLocomotionRecord& Record)
+	                          {
+		                          OutRecord = Record;
+		                          Found = true;
+		                          return TraceServices::EEventEnumerate::Continue;
+	                          });
+	return Found;
+}
+
+void FLocomotionTraceModule::GetModuleInfo(TraceServices::FModuleInfo& OutModuleInfo)
+{
+	OutModuleInfo.Name = TEXT("DaysGunLocomotionTrace");
+	OutModuleInfo.DisplayName = TEXT("DaysGun Locomotion");
+}
+
+void FLocomotionTraceModule::OnAnalysisBegin(TraceServices::IAnalysisSession& InSession)
+{
+	const auto Provider = MakeShared<FLocomotionTraceProvider>(InSession);
+	InSession.AddProvider(FLocomotionTraceProvider::ProviderName, Provider);
+	InSession.AddAnalyzer(new FLocomotionTraceAnalyzer(InSession, *Provider));
+}
+
+void FLocomotionTraceModule::GetLoggers(TArray<const TCHAR*>& OutLoggers)
+{
+	OutLoggers.Add(TEXT("DaysGunLocomotion"));
+}
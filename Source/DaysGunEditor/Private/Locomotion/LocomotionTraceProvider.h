@@ -0,0 +1,44 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Locomotion/LocomotionRecorderSubsystem.h"
+#include "Model/PointTimeline.h"
+#include "TraceServices/Model/AnalysisSession.h"
+#include "TraceServices/ModuleService.h"
+
+
+/** Decision frames of every traced UPlayerAnimInstance, one timeline per anim instance object id */
+class FLocomotionTraceProvider : public TraceServices::IProvider
+{
+public:
+	using FTimeline = TraceServices::TPointTimeline<FLocomotionRecord>;
+
+	static const FName ProviderName;
+
+	explicit FLocomotionTraceProvider(TraceServices::IAnalysisSession& InSession);
+
+	void AppendDecisionFrame(uint64 AnimInstanceId, const FLocomotionRecord& Record);
+
+	const FTimeline* FindTimeline(uint64 AnimInstanceId) const;
+
+	/** Newest frame at or before Time, false when the anim instance has none yet */
+	bool FindFrame(uint64 AnimInstanceId, double Time, FLocomotionRecord& OutRecord) const;
+
+private:
+	TraceServices::IAnalysisSession& Session;
+	TMap<uint64, TSharedRef<FTimeline>> Timelines;
+};
+
+/** Adds the provider and its analyzer to every analysis session, so Insights and the Rewind Debugger read it */
+class FLocomotionTraceModule : public TraceServices::IModule
+{
+public:
+	virtual void GetModuleInfo(TraceServices::FModuleInfo& OutModuleInfo) override;
+	virtual void OnAnalysisBegin(TraceServices::IAnalysisSession& InSession) override;
+	virtual void GetLoggers(TArray<const TCHAR*>& OutLoggers) override;
+	virtual void GenerateReports(const TraceServices::IAnalysisSession& Session, const TCHAR* CmdLine,
+	                             const TCHAR* OutputDirectory) override {}
+	virtual const TCHAR* GetCommandLineArgument() override { return TEXT("daysgunlocomotiontrace"); }
+};